@@ -0,0 +1,413 @@
+/***********************************************************************
+ * Header:
+ *    ADAPTIVE SET
+ * Summary:
+ *    A set that watches how it is being used and picks its own
+ *    representation: a BST while it is being written, a sorted
+ *    array once it is only being read. Sets that are loaded once
+ *    and then searched for hours get binary search over contiguous
+ *    memory without the caller doing anything.
+ *
+ *    This will contain the class definition of:
+ *        AdaptiveSet            : A set that moves between a tree and an array
+ *        AdaptiveSet::iterator  : An iterator through the AdaptiveSet
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"      // the representation for writing
+#include <algorithm>  // for std::lower_bound and std::upper_bound
+#include <cstddef>    // for size_t
+#include <initializer_list>
+#include <utility>    // for std::move, std::forward, and std::swap
+#include <vector>     // the representation for reading
+
+namespace custom
+{
+
+/*****************************************************************
+ * ADAPTIVE SET
+ * Same interface as BST. The values live either in tree or, sorted
+ * with equal values side by side, in array; never in both.
+ *
+ * Operations are counted in windows of max(MIN_WINDOW, size())
+ * operations. Both rules below are stated in values slid by the
+ * array's inserts and erases, the one cost the array has that the
+ * tree does not:
+ *
+ *    tree to array  At the end of a window whose writes, had they
+ *                   gone to an array, would each have slid about
+ *                   half of it, and all of them together no more than
+ *                   half a window's worth.
+ *    array to tree  As soon as the writes in the current window
+ *                   have really slid more than SHIFT_BUDGET windows'
+ *                   worth of values.
+ *
+ * The two thresholds are far apart so a steady mix sits on one side
+ * and stays there. Appending in order slides nothing, so the array
+ * keeps a load that arrives sorted. Either move is O(n) and happens
+ * only after O(n) operations or O(n) sliding, so its cost is
+ * amortized against work already done.
+ *
+ * Only the non-const find and count are counted as reads; through
+ * a const reference the set never changes form, so it can be read
+ * from many threads at once like any other container.
+ *****************************************************************/
+template <typename T>
+class AdaptiveSet
+{
+public:
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   AdaptiveSet() : fArray(false), numReads(0), numWrites(0), numShifted(0), numMigrations(0) {}
+   AdaptiveSet(const AdaptiveSet &  rhs) = default;
+   AdaptiveSet(      AdaptiveSet && rhs) = default;
+   AdaptiveSet(const std::initializer_list<T> & il) : AdaptiveSet() { *this = il; }
+
+   //
+   // Assign
+   //
+
+   AdaptiveSet & operator = (const AdaptiveSet &  rhs) = default;
+   AdaptiveSet & operator = (      AdaptiveSet && rhs) = default;
+   AdaptiveSet & operator = (const std::initializer_list<T> & il);
+   void swap(AdaptiveSet & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const;
+   iterator end()   const { return iterator(); }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   const T * find(const T & t)        { noteRead(); return static_cast<const AdaptiveSet &>(*this).find(t); }
+   size_t count(const T & t) const;
+   size_t count(const T & t)          { noteRead(); return static_cast<const AdaptiveSet &>(*this).count(t); }
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false) { return insertValue(t, keepUnique); }
+   bool insert(      T && t, bool keepUnique = false) { return insertValue(std::move(t), keepUnique); }
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t, bool eraseAll = false);
+
+   //
+   // Status
+   //
+
+   bool   empty()   const { return size() == 0; }
+   size_t size()    const { return fArray ? array.size() : tree.size(); }
+   bool   isArray() const noexcept { return fArray; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   static const size_t MIN_WINDOW = 64;   // fewest operations between decisions
+   static const size_t SHIFT_BUDGET = 8;  // windows' worth of sliding the array may do
+
+   BST <T> tree;              // every value, while fArray is false
+   std::vector<T> array;      // every value, sorted, while fArray is true
+   bool fArray;               // which of the two holds the values
+   size_t numReads;           // counted finds in this window
+   size_t numWrites;          // inserts and erases in this window
+   size_t numShifted;         // values the array slid over in this window
+   size_t numMigrations;      // moves between the two, for the curious
+
+private:
+   size_t window() const { return size() > MIN_WINDOW ? size() : MIN_WINDOW; }
+   void   noteRead();
+   void   noteWrite(size_t numSlid);
+   void   endWindow();
+   void   toArray();
+   void   toTree();
+   template <class U>
+   bool   insertValue(U && t, bool keepUnique);
+};
+
+template <typename T> const size_t AdaptiveSet <T> :: MIN_WINDOW;
+template <typename T> const size_t AdaptiveSet <T> :: SHIFT_BUDGET;
+
+/**********************************************************
+ * ADAPTIVE SET ITERATOR
+ * A pointer into the array, or the tree's own iterator
+ *********************************************************/
+template <typename T>
+class AdaptiveSet <T> :: iterator
+{
+   friend class AdaptiveSet <T>;
+public:
+   iterator() : p(nullptr), pEnd(nullptr) {}
+
+   bool operator == (const iterator & rhs) const { return p == rhs.p && it == rhs.it; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   const T & operator * () const { return p ? *p : *it; }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator itOld(*this); ++(*this); return itOld; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   iterator(const T * p, const T * pEnd) : p(p), pEnd(pEnd) {}
+   iterator(typename BST <T> :: iterator it) : p(nullptr), pEnd(nullptr), it(it) {}
+
+   const T * p;                       // current value in the array, or nullptr
+   const T * pEnd;                    // one past the last value in the array
+   typename BST <T> :: iterator it;   // current node in the tree
+};
+
+/*********************************************
+ * ADAPTIVE SET ITERATOR :: INCREMENT
+ ********************************************/
+template <typename T>
+typename AdaptiveSet <T> :: iterator & AdaptiveSet <T> :: iterator :: operator ++ ()
+{
+   if (p)
+   {
+      if (++p == pEnd)
+         p = pEnd = nullptr;
+   }
+   else
+      ++it;
+   return *this;
+}
+
+/*********************************************
+ * ADAPTIVE SET :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+AdaptiveSet <T> & AdaptiveSet <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * ADAPTIVE SET :: SWAP
+ ********************************************/
+template <typename T>
+void AdaptiveSet <T> :: swap(AdaptiveSet <T> & rhs)
+{
+   tree.swap(rhs.tree);
+   array.swap(rhs.array);
+   std::swap(fArray, rhs.fArray);
+   std::swap(numReads, rhs.numReads);
+   std::swap(numWrites, rhs.numWrites);
+   std::swap(numShifted, rhs.numShifted);
+   std::swap(numMigrations, rhs.numMigrations);
+}
+
+/*********************************************
+ * ADAPTIVE SET :: BEGIN
+ ********************************************/
+template <typename T>
+typename AdaptiveSet <T> :: iterator AdaptiveSet <T> :: begin() const
+{
+   if (!fArray)
+      return iterator(tree.begin());
+   return array.empty() ? end() : iterator(array.data(), array.data() + array.size());
+}
+
+/****************************************************
+ * ADAPTIVE SET :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * AdaptiveSet <T> :: find(const T & t) const
+{
+   if (!fArray)
+      return tree.find(t);
+   auto it = std::lower_bound(array.begin(), array.end(), t);
+   return it != array.end() && *it == t ? &*it : nullptr;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: COUNT
+ * How many copies of t there are
+ ****************************************************/
+template <typename T>
+size_t AdaptiveSet <T> :: count(const T & t) const
+{
+   if (!fArray)
+      return tree.count(t);
+   size_t num = 0;
+   for (auto it = std::lower_bound(array.begin(), array.end(), t);
+        it != array.end() && *it == t; ++it)
+      num++;
+   return num;
+}
+
+/*****************************************************
+ * ADAPTIVE SET :: INSERT VALUE
+ * In the array a plain insert goes after every equal
+ * value, where the tree would put it
+ ****************************************************/
+template <typename T>
+template <class U>
+bool AdaptiveSet <T> :: insertValue(U && t, bool keepUnique)
+{
+   if (!fArray)
+   {
+      bool fInserted = tree.insert(std::forward<U>(t), keepUnique);
+      noteWrite(0);
+      return fInserted;
+   }
+
+   auto it = std::upper_bound(array.begin(), array.end(), t);
+   if (keepUnique && it != array.begin() && *(it - 1) == t)
+   {
+      noteWrite(0);
+      return false;
+   }
+   size_t numSlid = array.end() - it;
+   array.insert(it, std::forward<U>(t));
+   noteWrite(numSlid);
+   return true;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: ERASE
+ * Remove one copy of t, or every copy with eraseAll
+ ****************************************************/
+template <typename T>
+bool AdaptiveSet <T> :: erase(const T & t, bool eraseAll)
+{
+   if (!fArray)
+   {
+      bool fErased = tree.erase(t, eraseAll);
+      noteWrite(0);
+      return fErased;
+   }
+
+   auto itBegin = std::lower_bound(array.begin(), array.end(), t);
+   if (itBegin == array.end() || !(*itBegin == t))
+   {
+      noteWrite(0);
+      return false;
+   }
+   auto itEnd = itBegin + 1;
+   while (eraseAll && itEnd != array.end() && *itEnd == t)
+      ++itEnd;
+   size_t numSlid = array.end() - itEnd;
+   array.erase(itBegin, itEnd);
+   noteWrite(numSlid);
+   return true;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: CLEAR
+ * The set stays in whichever form it was in
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: clear() noexcept
+{
+   tree.clear();
+   array.clear();
+   numReads = numWrites = numShifted = 0;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: NOTE READ
+ * Count a find; called before it, so a move to the
+ * array does not leave the caller a dangling pointer
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: noteRead()
+{
+   numReads++;
+   if (numReads + numWrites >= window())
+      endWindow();
+}
+
+/****************************************************
+ * ADAPTIVE SET :: NOTE WRITE
+ * Count an insert or erase that slid numSlid values.
+ * Sliding past the budget sends the values to the
+ * tree without waiting for the window to end.
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: noteWrite(size_t numSlid)
+{
+   numWrites++;
+   numShifted += numSlid;
+   if (fArray && numShifted > SHIFT_BUDGET * window())
+      toTree();
+   else if (numReads + numWrites >= window())
+      endWindow();
+}
+
+/****************************************************
+ * ADAPTIVE SET :: END WINDOW
+ * Were the writes of this window few enough that an
+ * array could have taken them, each sliding half of it?
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: endWindow()
+{
+   if (!fArray && numWrites * (size() / 2) <= window() / 2)
+      toArray();
+   numReads = numWrites = numShifted = 0;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: TO ARRAY
+ * Walk the tree in order, moving each value out;
+ * the nodes are freed right after.
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: toArray()
+{
+   array.reserve(tree.size());
+   for (typename BST <T> :: iterator it = tree.begin(); it != tree.end(); ++it)
+      array.push_back(std::move(const_cast<T &>(*it)));
+   tree.clear();
+   fArray = true;
+   numMigrations++;
+   numReads = numWrites = numShifted = 0;
+}
+
+/****************************************************
+ * ADAPTIVE SET :: TO TREE
+ * Hand the sorted values to the tree as one batch of
+ * inserts, which builds it balanced in one pass
+ ****************************************************/
+template <typename T>
+void AdaptiveSet <T> :: toTree()
+{
+   std::vector<typename BST <T> :: BatchOp> ops;
+   ops.reserve(array.size());
+   for (T & t : array)
+      ops.push_back({ std::move(t), true });
+   std::vector<T>().swap(array);
+   tree.apply_batch(std::move(ops));
+   fArray = false;
+   numMigrations++;
+   numReads = numWrites = numShifted = 0;
+}
+
+} // namespace custom
@@ -0,0 +1,251 @@
+/***********************************************************************
+ * Header:
+ *    BLOOM
+ * Summary:
+ *    A blocked Bloom filter. It answers "definitely not present" or
+ *    "maybe present" for a key's hash, touching a single 64-byte
+ *    block, which is one cache line. A tree can keep one in front
+ *    of itself so that most misses never walk the tree.
+ *
+ *    This will contain the class definition of:
+ *        BloomFilter         : A blocked Bloom filter over hashes
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t and uintptr_t
+#include <algorithm>  // for std::copy
+#include <vector>     // for the bit blocks
+
+namespace custom
+{
+
+/*****************************************************************
+ * BLOOM FILTER
+ * The bits are cut into blocks of 512. A key's hash picks one
+ * block and then numProbes bits inside it, so a lookup loads one
+ * cache line instead of numProbes scattered ones. The price is a
+ * slightly higher false positive rate than a plain Bloom filter
+ * of the same size, because some blocks fill up more than others.
+ *
+ * Sized for capacity keys at bitsPerKey bits each. Adding more
+ * than capacity keys still works, but the false positive rate
+ * climbs; the owner is expected to clear() and refill it larger.
+ * Nothing can be removed, so the owner refills it after erasing.
+ *****************************************************************/
+class BloomFilter
+{
+public:
+   //
+   // Construct
+   //
+
+   BloomFilter(size_t capacity = 0, unsigned int bitsPerKey = 10);
+   BloomFilter(const BloomFilter & rhs);
+   BloomFilter(BloomFilter && rhs) = default;          // the buffer moves with its alignment
+   BloomFilter & operator = (const BloomFilter & rhs);
+   BloomFilter & operator = (BloomFilter && rhs) = default;
+
+   //
+   // Access
+   //
+
+   void add(size_t hash);
+   bool mayContain(size_t hash) const;
+   void clear(size_t capacity);
+
+   //
+   // Status
+   //
+
+   size_t capacity()        const noexcept { return cap;        }
+   size_t size()            const noexcept { return numKeys;    }
+   size_t bytes()           const noexcept { return numBlocks * BLOCK_WORDS * sizeof(uint64_t); }
+   unsigned int numProbes() const noexcept { return probes;     }
+   double falsePositiveRate() const;
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+
+   static const size_t BLOCK_WORDS = 8;          // 8 * 64 bits = one cache line
+   static const size_t BLOCK_BITS  = BLOCK_WORDS * 64;
+
+   std::vector<uint64_t> words;   // the blocks, with slack to align them
+   size_t numBlocks;              // blocks in use
+   size_t cap;                    // keys the filter was sized for
+   size_t numKeys;                // keys added since the last clear
+   unsigned int bitsPerKey;       // bits set aside for each key
+   unsigned int probes;           // bits set per key, all in one block
+
+   const uint64_t * blocks() const;
+   uint64_t *       blocks();
+   static uint64_t mix(uint64_t h);
+   static unsigned int popCount(uint64_t w);
+};
+
+/*****************************************************
+ * BLOOM FILTER :: CONSTRUCTOR
+ * About bitsPerKey * ln 2 probes gives the fewest false
+ * positives; more than seven costs more than it saves
+ ****************************************************/
+inline BloomFilter :: BloomFilter(size_t capacity, unsigned int bitsPerKey) :
+   numBlocks(0), cap(0), numKeys(0), bitsPerKey(bitsPerKey ? bitsPerKey : 1), probes(1)
+{
+   probes = (this->bitsPerKey * 69 + 50) / 100;
+   if (probes < 1)
+      probes = 1;
+   if (probes > 7)
+      probes = 7;
+   clear(capacity);
+}
+
+/*****************************************************
+ * BLOOM FILTER :: COPY CONSTRUCTOR
+ * A copied vector need not sit at the same distance from
+ * a 64-byte boundary, so copy the blocks, not the words
+ ****************************************************/
+inline BloomFilter :: BloomFilter(const BloomFilter & rhs) :
+   numBlocks(0), cap(0), numKeys(0), bitsPerKey(rhs.bitsPerKey), probes(rhs.probes)
+{
+   *this = rhs;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: ASSIGNMENT OPERATOR
+ * The same: the bits go to this buffer's own boundary
+ ****************************************************/
+inline BloomFilter & BloomFilter :: operator = (const BloomFilter & rhs)
+{
+   if (this == &rhs)
+      return *this;
+   numBlocks = rhs.numBlocks;
+   cap = rhs.cap;
+   numKeys = rhs.numKeys;
+   bitsPerKey = rhs.bitsPerKey;
+   probes = rhs.probes;
+   words.assign(numBlocks * BLOCK_WORDS + BLOCK_WORDS - 1, 0);
+   std::copy(rhs.blocks(), rhs.blocks() + numBlocks * BLOCK_WORDS, blocks());
+   return *this;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: CLEAR
+ * Forget every key and resize for capacity of them
+ ****************************************************/
+inline void BloomFilter :: clear(size_t capacity)
+{
+   cap = capacity;
+   numKeys = 0;
+   numBlocks = (cap * bitsPerKey + BLOCK_BITS - 1) / BLOCK_BITS;
+   if (numBlocks == 0)
+      numBlocks = 1;
+   words.assign(numBlocks * BLOCK_WORDS + BLOCK_WORDS - 1, 0);
+}
+
+/*****************************************************
+ * BLOOM FILTER :: BLOCKS
+ * The vector only promises alignment for uint64_t, so
+ * the blocks start at the first 64-byte boundary in it
+ ****************************************************/
+inline const uint64_t * BloomFilter :: blocks() const
+{
+   uintptr_t address = reinterpret_cast<uintptr_t>(words.data());
+   address = (address + 63) & ~uintptr_t(63);
+   return reinterpret_cast<const uint64_t *>(address);
+}
+
+inline uint64_t * BloomFilter :: blocks()
+{
+   return const_cast<uint64_t *>(static_cast<const BloomFilter *>(this)->blocks());
+}
+
+/*****************************************************
+ * BLOOM FILTER :: MIX
+ * Hashes such as std::hash<int> are often the value
+ * itself, so scramble every bit into every other
+ ****************************************************/
+inline uint64_t BloomFilter :: mix(uint64_t h)
+{
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdull;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ull;
+   h ^= h >> 33;
+   return h;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: ADD
+ * The high half of the mixed hash picks the block and
+ * each probe takes nine more bits for its position
+ ****************************************************/
+inline void BloomFilter :: add(size_t hash)
+{
+   uint64_t h = mix(hash);
+   uint64_t * pBlock = blocks() + (((h >> 32) * numBlocks) >> 32) * BLOCK_WORDS;
+   uint64_t bits = mix(h);
+   for (unsigned int i = 0; i < probes; i++, bits >>= 9)
+      pBlock[(bits >> 6) & 7] |= uint64_t(1) << (bits & 63);
+   numKeys++;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: MAY CONTAIN
+ * False means hash was never added; true means it
+ * probably was
+ ****************************************************/
+inline bool BloomFilter :: mayContain(size_t hash) const
+{
+   uint64_t h = mix(hash);
+   const uint64_t * pBlock = blocks() + (((h >> 32) * numBlocks) >> 32) * BLOCK_WORDS;
+   uint64_t bits = mix(h);
+   for (unsigned int i = 0; i < probes; i++, bits >>= 9)
+      if (!(pBlock[(bits >> 6) & 7] & (uint64_t(1) << (bits & 63))))
+         return false;
+   return true;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: FALSE POSITIVE RATE
+ * The chance an absent key gets through: the chance its
+ * probes all hit set bits, given how full its block is,
+ * averaged over the blocks
+ ****************************************************/
+inline double BloomFilter :: falsePositiveRate() const
+{
+   const uint64_t * pBlock = blocks();
+   double sum = 0.0;
+   for (size_t i = 0; i < numBlocks; i++, pBlock += BLOCK_WORDS)
+   {
+      unsigned int numSet = 0;
+      for (size_t w = 0; w < BLOCK_WORDS; w++)
+         numSet += popCount(pBlock[w]);
+      double fill = (double)numSet / (double)BLOCK_BITS;
+      double rate = 1.0;
+      for (unsigned int p = 0; p < probes; p++)
+         rate *= fill;
+      sum += rate;
+   }
+   return sum / (double)numBlocks;
+}
+
+/*****************************************************
+ * BLOOM FILTER :: POP COUNT
+ * Number of bits set in w
+ ****************************************************/
+inline unsigned int BloomFilter :: popCount(uint64_t w)
+{
+   w = w - ((w >> 1) & 0x5555555555555555ull);
+   w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+   w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+   return (unsigned int)((w * 0x0101010101010101ull) >> 56);
+}
+
+} // namespace custom
@@ -12,8 +12,9 @@
  *
  *    This will contain the class definition of:
  *        BST                 : A class that represents a binary search tree
+ *        BST::iterator       : An iterator through the BST
  * Author
- *    Alexander Dohms, Stephen Costigan 
+ *    Alexander Dohms, Stephen Costigan
  ************************************************************************/
 
 #pragma once
@@ -24,15 +25,26 @@
 #define debug(x)
 #endif // !DEBUG
 
+#include "bloom.h"    // for BloomFilter
+#include <algorithm>  // for std::stable_sort and std::is_sorted
 #include <cassert>
-#include <utility>
+#include <cmath>      // for std::log
+#include <cstddef>    // for size_t
 #include <memory>     // for std::allocator
-#include <functional> // for std::less
+#include <functional> // for std::less and std::hash
 #include <utility>    // for std::pair
+#include <initializer_list>
+#include <vector>     // for batches
+#ifdef _MSC_VER
+#include <xmmintrin.h> // for _mm_prefetch
+#endif
 
 namespace custom
 {
 
+template <typename K, typename V, typename Compare>
+class map;
+
 /*****************************************************************
  * BINARY SEARCH TREE
  * Create a Binary Search Tree
@@ -40,17 +52,38 @@ namespace custom
 template <typename T>
 class BST
 {
+   template <typename K, typename V, typename Compare>
+   friend class map;
 public:
    //
    // Construct - Finished | Alexander
    //
 
-   BST() : root(nullptr), numElements(0) {}                                                                          //Default Constructor
-   BST(const BST& rhs) : numElements(0), root(nullptr) { *this = rhs; }                                              //Copy constructor 
-   BST(      BST && rhs) : root(rhs.root), numElements(rhs.numElements) {rhs.root = nullptr; rhs.numElements = 0;}   //Move Constructor
-   BST(const std::initializer_list<T>& il) : root(nullptr), numElements(0) {*this = il;}                             //Initializer List Constructor
-   ~BST() { 
-       clear(); 
+   BST() : root(nullptr), numElements(0), fMultiset(false),
+           splay(SPLAY_NONE), splayPeriod(1), numAccesses(0), alpha(0.0), maxElements(0), depthFactor(0.0),
+           fFinger(false), pLast(nullptr), pBloom(nullptr), hashOf(nullptr), numErased(0),
+           maxPending(0), fPendingUnique(false), pMin(nullptr), pMax(nullptr) {}                        //Default Constructor
+   BST(const BST& rhs) : root(nullptr), numElements(0), fMultiset(rhs.fMultiset),
+           splay(rhs.splay), splayPeriod(rhs.splayPeriod), numAccesses(0),
+           alpha(rhs.alpha), maxElements(0), depthFactor(rhs.depthFactor),
+           fFinger(rhs.fFinger), pLast(nullptr), pBloom(nullptr), hashOf(nullptr), numErased(0),
+           maxPending(0), fPendingUnique(false), pMin(nullptr), pMax(nullptr) { *this = rhs; }          //Copy constructor
+   BST(      BST && rhs) : root(rhs.root), numElements(rhs.numElements), fMultiset(rhs.fMultiset),
+           splay(rhs.splay), splayPeriod(rhs.splayPeriod), numAccesses(0),
+           alpha(rhs.alpha), maxElements(rhs.maxElements), depthFactor(rhs.depthFactor),
+           fFinger(rhs.fFinger), pLast(rhs.pLast), pBloom(rhs.pBloom), hashOf(rhs.hashOf), numErased(rhs.numErased),
+           pending(std::move(rhs.pending)), maxPending(rhs.maxPending), fPendingUnique(rhs.fPendingUnique),
+           pMin(rhs.pMin), pMax(rhs.pMax)
+                           {rhs.root = nullptr; rhs.numElements = 0; rhs.maxElements = 0; rhs.pLast = nullptr;
+                            rhs.pBloom = nullptr; rhs.hashOf = nullptr; rhs.numErased = 0; rhs.pending.clear();
+                            rhs.pMin = rhs.pMax = nullptr;}                                            //Move Constructor
+   BST(const std::initializer_list<T>& il) : root(nullptr), numElements(0), fMultiset(false),
+           splay(SPLAY_NONE), splayPeriod(1), numAccesses(0), alpha(0.0), maxElements(0), depthFactor(0.0),
+           fFinger(false), pLast(nullptr), pBloom(nullptr), hashOf(nullptr), numErased(0),
+           maxPending(0), fPendingUnique(false), pMin(nullptr), pMax(nullptr) {*this = il;}             //Initializer List Constructor
+   ~BST() {
+       clear();
+       delete pBloom;
    }                                                                                               //Deconstructor
 
    //
@@ -62,33 +95,178 @@ public:
    BST & operator = (const std::initializer_list<T>& il);
    void swap(BST & rhs);
 
+   //
+   // Iterator
+   //
+
+   class iterator;
+   iterator begin() const;
+   iterator end()   const noexcept { return iterator(nullptr); }
+
    //
    // Access - Shaun
    //
 
    const T* find(const T& t) const;
    T* find(const T& t);
+   size_t count(const T& t) const;
+   void find_batch(const std::vector<T> & keys, std::vector<const T *> & out) const;
+
+   //
+   // Ends: the left-most and right-most nodes are kept up to date as
+   // nodes come and go, so none of these walk down from the root. The
+   // tree must not be empty. pop_min and pop_max never splay.
+   //
+
+   const T & min() const { settle(); assert(numElements); return leftmost()->data;  }
+   const T & max() const { settle(); assert(numElements); return rightmost()->data; }
+   T pop_min();
+   T pop_max();
 
-   // 
+   //
    // Insert - Shaun
    //
 
    bool insert(const T&  t, bool keepUnique = false);
    bool insert(      T&& t, bool keepUnique = false);
 
+   //
+   // Finger search: start from a position near t rather than the root.
+   // The search climbs from the finger only until t falls inside the
+   // subtree below, then descends, so in a balanced tree it costs
+   // O(log d) where d is how many values lie between the finger and t.
+   // An end() finger searches from the root.
+   //
+
+   iterator lower_bound(const T & t) const { settle(); return iterator(lowerBoundNode(t)); }
+   iterator lower_bound(const T & t, iterator finger) const;
+   iterator find(const T & t, iterator finger) const;
+   iterator insert(iterator finger, const T &  t, bool keepUnique = false);
+   iterator insert(iterator finger,       T && t, bool keepUnique = false);
+
    //
    // Remove - Jon
-   // 
+   //
 
    void clear() noexcept;
-   bool erase(const T& t);
-   // 
+   bool erase(const T& t, bool eraseAll = false);
+
+   //
+   // Batch: many inserts and erases, sorted by value, in one pass
+   //
+
+   struct BatchOp
+   {
+      T data;
+      bool fInsert;          // insert data, otherwise erase one copy of it
+   };
+   std::vector<bool> apply_batch(std::vector<BatchOp> ops, bool keepUnique = false);
+
+   //
+   // Bulk removal: pred is asked once per node, in order, and the
+   // nodes kept are relinked into a balanced tree in one O(n) pass
+   // with O(1) extra space. erase_if frees the rest and returns how
+   // many values went. partition moves every node into one of two
+   // trees, the values pred accepts first, each with this tree's
+   // modes, leaving this tree empty. No node is copied or reallocated.
+   //
+
+   template <class Pred>
+   size_t erase_if(Pred pred);
+   template <class Pred>
+   std::pair<BST, BST> partition(Pred pred);
+
+   //
    // Status
    //
 
-   bool   empty() const noexcept { return numElements == 0; }
-   size_t size()  const noexcept { return numElements;   }
-   
+   bool   empty() const { settle(); return numElements == 0; }
+   size_t size()  const { settle(); return numElements;   }
+
+   //
+   // Multiset mode: duplicates share one node and bump its count
+   //
+
+   void setMultiset(bool f) { assert(empty()); fMultiset = f; }
+   bool isMultiset() const noexcept { return fMultiset; }
+
+   //
+   // Splay mode: find, insert and erase pull the node they touch up
+   // to the root, every splayPeriod-th time. find() const never does.
+   //
+
+   enum SplayMode { SPLAY_NONE, SPLAY_FULL, SPLAY_SEMI };
+   void setSplay(SplayMode mode, unsigned int period = 1);
+   SplayMode splayMode() const noexcept { return splay; }
+
+   //
+   // Scapegoat mode: no node holds any balance data. When a new node
+   // lands deeper than log base 1/alpha of the size, the subtree where
+   // the path went lopsided is rebuilt perfectly balanced. An alpha of
+   // zero turns it off; otherwise 0.5 < alpha < 1.
+   //
+
+   void setScapegoat(double alpha);
+   double scapegoatAlpha() const noexcept { return alpha; }
+
+   //
+   // Rebalancing: rebalance() relinks the tree into balance in place
+   // with Day-Stout-Warren rotations, O(n) time and O(1) extra space.
+   // With a depth factor set, an insert that lands deeper than factor
+   // times log2 of the size does the same to the lowest subtree above
+   // it that is that much too deep for its own size, so sorted inserts
+   // never grow a chain. A factor of zero turns it off; otherwise it is
+   // at least 1. Like splay and scapegoat modes, it excludes the others.
+   //
+
+   void rebalance();
+   void setAutoRebalance(double factor);
+   double autoRebalanceFactor() const noexcept { return depthFactor; }
+
+   //
+   // Last-position finger: find, insert and erase start their search
+   // from wherever the last one of them finished, so runs of nearby
+   // values pay for the distance between them rather than the depth.
+   // find() const searches from the finger but never moves it.
+   //
+
+   void setFinger(bool f) noexcept { fFinger = f; }
+   bool usesFinger() const noexcept { return fFinger; }
+
+   //
+   // Bloom filter: an optional filter in front of the tree turns most
+   // misses away after reading one cache line, before any node is
+   // touched. It learns each new value on insert and is refilled from
+   // the tree as it grows and after enough erases. Hash must agree
+   // with operator==. bloom() reports its size and false positive rate.
+   //
+
+   template <class Hash = std::hash<T>>
+   void setBloom(unsigned int bitsPerKey = 10);
+   void removeBloom() noexcept { delete pBloom; pBloom = nullptr; hashOf = nullptr; }
+   const BloomFilter * bloom() const noexcept { return pBloom; }
+
+   //
+   // Buffered mode: insert and erase only queue the change, up to
+   // capacity of them, and a full queue is sorted and applied as one
+   // batch, so nearby values share the walk down. It pays for bursts
+   // of writes with a capacity in the tens of thousands; a queue of a
+   // thousand or so is spread too thin to share much of any path.
+   //
+   // Anything that reads the tree applies the whole queue first, even
+   // through a const reference. A buffered tree with anything queued is
+   // NOT safe for concurrent readers: call flush() before sharing it.
+   // Reads mixed in with the writes also cut every batch short.
+   //
+   // A queued insert or erase returns true: what it does is not known
+   // until it is applied. eraseAll is never queued. A capacity of zero
+   // applies what is queued and turns buffering off.
+   //
+
+   void setBuffered(size_t capacity);
+   size_t bufferCapacity() const noexcept { return maxPending; }
+   void flush();
+
 
 #ifdef DEBUG // make this visible to the unit tests
 public:
@@ -99,6 +277,71 @@ private:
    class BNode;
    BNode * root;              // root node of the binary search tree
    size_t numElements;        // number of elements currently in the tree
+   bool fMultiset;            // duplicates are counted in a single node
+   SplayMode splay;           // whether accesses restructure the tree
+   unsigned int splayPeriod;  // splay on every splayPeriod-th access
+   unsigned int numAccesses;  // accesses so far, to count off the period
+   double alpha;              // scapegoat weight balance, or 0 when off
+   size_t maxElements;        // most elements since the last full rebuild
+   double depthFactor;        // rebalance past this times log2 of the size, or 0
+   bool fFinger;              // searches start from pLast, not the root
+   BNode * pLast;             // where the last find, insert or erase ended
+   BloomFilter * pBloom;      // filter in front of find, or null when off
+   size_t (*hashOf)(const T &);  // the hash the filter was set up with
+   size_t numErased;          // erases since the filter was last refilled
+   std::vector<BatchOp> pending; // queued inserts and erases, oldest first
+   size_t maxPending;         // ops the queue holds, or 0 when not buffering
+   bool fPendingUnique;       // the keepUnique every queued insert shares
+   BNode * pMin;              // left-most node, or null when empty
+   BNode * pMax;              // right-most node, or null when empty
+
+private:
+   // lookups only need K == T, K < T and T < K, so a map can search by key
+   // and each starts at pStart, or the root when that is null
+   template <class K>
+   BNode * findNode(const K & k, BNode * pStart = nullptr) const;
+   template <class K>
+   BNode * findOrParent(const K & k, BNode * & pParent, bool & fLeft, BNode * pStart = nullptr) const;
+   template <class K>
+   BNode * lowerBoundNode(const K & k, BNode * pStart = nullptr) const;
+   BNode * eraseSearch(const T & t, BNode * pStart = nullptr) const;
+   BNode * fingerRoot(BNode * pFinger, const T & t, bool fFirst = false) const;
+   BNode * searchFrom(const T & t) const { return fFinger && pLast ? fingerRoot(pLast, t) : root; }
+   void    attach(BNode * pNew, BNode * pParent, bool fLeft);
+   void    eraseNode(BNode * pDelete);
+   template <class U>
+   bool    insertValue(U && t, bool keepUnique, BNode * pStart);
+   bool    applyFrom(BNode * & pFinger, BatchOp & op, bool keepUnique);
+   std::vector<bool> mergeBatch(std::vector<BatchOp> & ops, bool keepUnique);
+   static void    flatten(BNode * p, std::vector<BNode *> & nodes);
+   static BNode * successor(BNode * p);
+   template <class Pred>
+   size_t  markIf(Pred & pred);
+   void    toVine();
+   BNode * splitVine(BNode * & pMarked, bool fFree);
+   void    adopt(BNode * pVine);
+   void    copyModes(const BST & rhs);
+   static BNode * build(std::vector<BNode *> & nodes, size_t iBegin, size_t iEnd, BNode * pParent);
+   static void    prefetch(const BNode * p);
+   void    access(BNode * p);
+   void    splayUp(BNode * p);
+   void    rotateUp(BNode * p);
+   void    rebalanceAfterInsert(BNode * pNew);
+   void    rebalanceAfterErase();
+   void    rebuild(BNode * p);
+   void    rebalanceIfDeep(BNode * pNew);
+   void    rebuildInPlace(BNode * p);
+   static size_t countNodes(const BNode * p);
+   bool    mayContain(const T & t) const { return !pBloom || pBloom->mayContain(hashOf(t)); }
+   size_t  skipAbsent(const std::vector<T> & keys, size_t i) const;
+   void    refillBloom();
+   bool    settle() const;
+   BNode * leftmost()  const { return pMin; }
+   BNode * rightmost() const { return pMax; }
+   void    findEnds();
+   T       popEnd(BNode * p);
+   template <class U>
+   bool    queue(U && t, bool fInsert, bool keepUnique);
 };
 
 
@@ -114,9 +357,12 @@ public:
    //
    // Construct
    //
-    BNode() : pLeft(nullptr), pRight(nullptr), pParent(nullptr), data(T()) {}               // Default Constructor
-    BNode(const T& t) : pParent(nullptr), pLeft(nullptr), pRight(nullptr), data(t) {}       // Copy Constructor
-    BNode(T&& t) : pLeft(nullptr), pRight(nullptr), data(std::move(t)) {}                   // Move Constructor
+    BNode()           : data(),             count(1), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}  // Default Constructor
+    BNode(const T& t) : data(t),            count(1), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}  // Copy Constructor
+    BNode(T&& t)      : data(std::move(t)), count(1), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}  // Move Constructor
+    template <class ... Args>                                                                                             // Emplace Constructor
+    BNode(std::piecewise_construct_t, Args&& ... args)
+                      : data(std::forward<Args>(args)...), count(1), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}
 
    //
    // Insert
@@ -128,22 +374,64 @@ public:
    void addLeft(       T && t);
    void addRight(      T && t);
 
-   void assign(BNode* pDest, const BNode* pSrc);
-   void clear(BNode * pThis);
-   // 
+   static void assign(BNode* & pDest, const BNode* pSrc);
+   static void clear(BNode * & pThis);
+   //
    // Status
    //
-   bool isRightChild(BNode* pNode) const { return pNode->data > pNode->pParent->data; } // DON'T KNOW IF IT CHANGES ANYTHING
-   bool isLeftChild (BNode* pNode) const { return pNode->data < pNode->pParent->data; } // <-/
+   bool isRightChild(BNode* pNode) const { return pRight == pNode; }
+   bool isLeftChild (BNode* pNode) const { return pLeft  == pNode; }
 
    //
    // Data
    //
    T data;                  // Actual data stored in the BNode
+   unsigned int count;      // Copies of data held here (multiset mode only),
+                            //    kept next to data so it fits in data's padding
+   static const unsigned int MARKED = 1u << 31;  // count's top bit, set only while
+                                                 //    erase_if or partition sorts nodes
    BNode* pLeft;          // Left child - smaller
    BNode* pRight;         // Right child - larger
    BNode* pParent;        // Parent
-   bool isRed;              // Red-black balancing stuff
+};
+
+/**********************************************************
+ * BINARY SEARCH TREE ITERATOR
+ * Forward and reverse iterator through a BST. In multiset
+ * mode each node is visited once per copy it holds.
+ *********************************************************/
+template <typename T>
+class BST <T> :: iterator
+{
+   friend class BST <T>;
+   template <typename K, typename V, typename Compare>
+   friend class map;
+public:
+   // constructors and assignment
+   iterator(BNode * p = nullptr) : pNode(p), index(0) {}
+   iterator(const iterator & rhs) = default;
+   iterator & operator = (const iterator & rhs) = default;
+
+   // compare
+   bool operator == (const iterator & rhs) const { return pNode == rhs.pNode && index == rhs.index; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   // de-reference. Cannot change because it will invalidate the BST
+   const T & operator * () const { assert(pNode); return pNode->data; }
+
+   // increment and decrement
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator it(*this); ++(*this); return it; }
+   iterator & operator -- ();
+   iterator   operator -- (int) { iterator it(*this); --(*this); return it; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   BNode * pNode;           // current node
+   unsigned int index;      // which copy of a counted node we are on
 };
 
 /*********************************************
@@ -157,48 +445,31 @@ public:
 
 /*********************************************
  * BST :: ASSIGNMENT OPERATOR
- * Copy one tree to another
+ * Copy one tree to another, reusing as many of
+ * the existing nodes as we can
  ********************************************/
 template <typename T>
 BST <T> & BST <T> :: operator = (const BST <T> & rhs)
 {
-    // No increase in % yet
-
-    // ATTEMPT #1
-    /* if (!rhs.root) { // Source is Empty
-        clear();
+    if (this == &rhs)
         return *this;
-    }
-    if (rhs.root) {
-        this->root->data = rhs.root->data;
-        this->root->pRight = rhs.root->pRight;
-        this->root->pLeft = rhs.root->pLeft;
-    
-    }
-    // Setting parent values
-    if (this->root->pRight)
-        this->root->pRight->pParent = this->root;
-    if (this->root->pLeft)
-        this->root->pLeft->pParent = this->root; */
-
-
-    // ATTEMPT #2
-    /*if (this != &rhs)
-    {
-        BST <T> ptr = rhs;
-        clear();
-        root = ptr.root;
-        ptr.root = nullptr;
-    }*/
-
-    // ATTEMPT #3
-    /*BST.copy-assignment(rhs)
-        assign(root, rhs.root)
-        numElements = rhs.numElements
-    */
 
-    root->assign(root, rhs.root);
+    rhs.settle();
+    pending.clear();
+    BNode::assign(root, rhs.root);
+    pLast = nullptr;
+    findEnds();
     numElements = rhs.numElements;
+    if (!rhs.pBloom)
+        removeBloom();
+    else if (pBloom)
+        *pBloom = *rhs.pBloom;
+    else
+        pBloom = new BloomFilter(*rhs.pBloom);
+    hashOf = rhs.hashOf;
+    numErased = rhs.numErased;
+    maxElements = rhs.numElements;
+    copyModes(rhs);
 
     return *this;
 }
@@ -210,32 +481,10 @@ BST <T> & BST <T> :: operator = (const BST <T> & rhs)
 template <typename T>
 BST <T> & BST <T> :: operator = (const std::initializer_list<T>& il)
 {
-    // ATTEMPT #1
-    /*if (il.size() == 0)
-    {
-        clear();
-        return *this;
-    }
-
-    const int* itRHS = il.begin();
-    while (itRHS != il.end())
-    {
-        root.insert(* itRHS);
-        ++itRHS;
-        numElements++;
-    }*/
-
-    // ATTEMPT #2 -- No % increase yet, but with insert done it might
-    /*clear()
-     FOREACH t IN rhs
-     insert(t)
-     RETURN *this
-    */
     clear();
-    for (T t : il) {
-        insert(t); // WILL PROB INCREASE % WHEN INSERT IS DONE
-    }
-    
+    for (const T & t : il)
+        insert(t);
+
     return *this;
 }
 
@@ -246,10 +495,8 @@ BST <T> & BST <T> :: operator = (const std::initializer_list<T>& il)
 template <typename T>
 BST <T> & BST <T> :: operator = (BST <T> && rhs)
 {
-    root->clear(root);
-    if (rhs.root != nullptr)
-        swap(rhs);
-
+    clear();
+    swap(rhs);
 
     return *this;
 }
@@ -261,30 +508,93 @@ BST <T> & BST <T> :: operator = (BST <T> && rhs)
 template <typename T>
 void BST <T> :: swap (BST <T>& rhs)
 {
-    // ATTEMPT #1
-    /*if (rhs.root == nullptr) {
-        rhs.root = root = nullptr;
-        rhs.numElements = numElements = 0;
-        return;
-    }
+    std::swap(root, rhs.root);
+    std::swap(numElements, rhs.numElements);
+    std::swap(fMultiset, rhs.fMultiset);
+    std::swap(splay, rhs.splay);
+    std::swap(splayPeriod, rhs.splayPeriod);
+    std::swap(numAccesses, rhs.numAccesses);
+    std::swap(alpha, rhs.alpha);
+    std::swap(maxElements, rhs.maxElements);
+    std::swap(depthFactor, rhs.depthFactor);
+    std::swap(fFinger, rhs.fFinger);
+    std::swap(pLast, rhs.pLast);
+    std::swap(pBloom, rhs.pBloom);
+    std::swap(hashOf, rhs.hashOf);
+    std::swap(numErased, rhs.numErased);
+    pending.swap(rhs.pending);
+    std::swap(maxPending, rhs.maxPending);
+    std::swap(fPendingUnique, rhs.fPendingUnique);
+    std::swap(pMin, rhs.pMin);
+    std::swap(pMax, rhs.pMax);
+}
+
+/*********************************************
+ * BST :: BEGIN
+ * The left-most node in the tree
+ ********************************************/
+template <typename T>
+typename BST <T> :: iterator BST <T> :: begin() const
+{
+    settle();
+    return iterator(leftmost());
+}
+
+/*********************************************
+ * BST :: FIND ENDS
+ * Walk down to the ends after the nodes were copied
+ * in. Every other change keeps them as it goes, so
+ * nothing const ever has to write them.
+ ********************************************/
+template <typename T>
+void BST <T> :: findEnds()
+{
+    pMin = pMax = root;
+    while (pMin && pMin->pLeft)
+        pMin = pMin->pLeft;
+    while (pMax && pMax->pRight)
+        pMax = pMax->pRight;
+}
 
-    BST <T> ::BNode* tempRoot = new BST <T> ::BNode();
+/*********************************************
+ * BST :: POP MIN and POP MAX
+ * Remove the smallest (largest) value and return it
+ ********************************************/
+template <typename T>
+T BST <T> :: pop_min()
+{
+    settle();
+    assert(numElements);
+    return popEnd(leftmost());
+}
 
-    rhs.root = root;
-    root = tempRoot;
-    size_t tempElements = rhs.numElements;
-    rhs.numElements = numElements;
-    numElements = tempElements;*/
-    
-    // ATTEMPT #2 (adds to %)
-    auto tempRoot = rhs.root;
-    rhs.root = root;
-    root = tempRoot;
+template <typename T>
+T BST <T> :: pop_max()
+{
+    settle();
+    assert(numElements);
+    return popEnd(rightmost());
+}
 
-    auto tempElements = rhs.numElements;
-    rhs.numElements = numElements;
-    numElements = tempElements; 
-    
+/*********************************************
+ * BST :: POP END
+ * One copy of p's value leaves the tree. The value
+ * is moved out unless other copies stay behind.
+ ********************************************/
+template <typename T>
+T BST <T> :: popEnd(BNode * p)
+{
+    if (p->count > 1)
+    {
+        p->count--;
+        numElements--;
+        rebalanceAfterErase();
+        return p->data;
+    }
+    T t(std::move(p->data));
+    eraseNode(p);
+    rebalanceAfterErase();
+    return t;
 }
 
 /*****************************************************
@@ -294,220 +604,1725 @@ void BST <T> :: swap (BST <T>& rhs)
 template <typename T>
 bool BST <T> :: insert(const T & t, bool keepUnique)
 {
-    return false;
+    if (maxPending)
+        return queue(t, true /* fInsert */, keepUnique);
+    return insertValue(t, keepUnique, searchFrom(t));
 }
 
 template <typename T>
 bool BST <T> ::insert(T && t, bool keepUnique)
 {
-   return false;
+    if (maxPending)
+        return queue(std::move(t), true /* fInsert */, keepUnique);
+    BNode * pStart = searchFrom(t);
+    return insertValue(std::move(t), keepUnique, pStart);
 }
 
-/****************************************************
- * BST :: FIND
- * Return a pointer to the value if it exists, nullptr otherwise
+/*****************************************************
+ * BST :: INSERT with a FINGER
+ * Insert starting from a node near t. The result is the
+ * new node, or the one already holding t if there was
+ * nothing to insert; either makes a good next finger.
  ****************************************************/
 template <typename T>
-const T* BST<T>::find(const T& t) const
+typename BST <T> :: iterator BST <T> :: insert(iterator finger, const T & t, bool keepUnique)
 {
-    /*BST.find(pNode, value)
-     IF pNode = NULL
-        RETURN end()
-     IF pNode.data = value
-        RETURN iterator(pNode)
-     IF value < pNode.date
-        RETURN find(pNode.pLeft)
-     ELSE
-        RETURN find(pNode.pRight)*/
-   return nullptr;
+    if (settle())
+        finger = end();
+    insertValue(t, keepUnique, fingerRoot(finger.pNode, t));
+    return iterator(pLast);
 }
 
-/****************************************************
- * BST :: FIND
- * Return a pointer to the value if it exists, nullptr otherwise
- ****************************************************/
 template <typename T>
-T* BST<T>::find(const T& t)
+typename BST <T> :: iterator BST <T> :: insert(iterator finger, T && t, bool keepUnique)
 {
-   return nullptr;
+    if (settle())
+        finger = end();
+    BNode * pStart = fingerRoot(finger.pNode, t);
+    insertValue(std::move(t), keepUnique, pStart);
+    return iterator(pLast);
 }
 
-
 /*****************************************************
- * BST :: CLEAR
- * Removes all the BNodes from a tree
+ * BST :: INSERT VALUE
+ * Shared by the copy and move versions of insert. When
+ * duplicates are not special we only need operator<, so
+ * equal values go to the right. The search starts at pStart,
+ * and pLast is left on the node inserted or found.
  ****************************************************/
 template <typename T>
-void BST <T> ::clear() noexcept
+template <class U>
+bool BST <T> :: insertValue(U && t, bool keepUnique, BNode * pStart)
 {
-   // I'm calling on BNode's functions improperly here, but I don't know how to fix it.
-   
-   /*if (root == nullptr)
-   {
-      return;
-   }
+    BNode * pParent = nullptr;
+    bool fLeft = false;
 
-   clear(BNode->pLeft);
-   clear(BNode->pRight);
-   delete root;
-   root = nullptr;*/
-}
+    if (keepUnique || fMultiset)
+    {
+        BNode * pSame = findOrParent(t, pParent, fLeft, pStart);
+        if (pSame)
+        {
+            pLast = pSame;
+            access(pSame);
+            if (!fMultiset || keepUnique)
+                return false;
+            pSame->count++;
+            numElements++;
+            return true;
+        }
+    }
+    else
+    {
+        for (BNode * p = pStart ? pStart : root; p; p = fLeft ? p->pLeft : p->pRight)
+        {
+            pParent = p;
+            fLeft = t < p->data;
+        }
+    }
 
+    BNode * pNew = new BNode(std::forward<U>(t));
+    attach(pNew, pParent, fLeft);
+    pLast = pNew;
+    access(pNew);
+    rebalanceAfterInsert(pNew);
+    return true;
+}
 
-/*************************************************
- * BST :: ERASE
- * Remove a given node as specified by the value
- ************************************************/
+/*****************************************************
+ * BST :: ATTACH
+ * Hook a new leaf onto pParent, or make it the root
+ ****************************************************/
 template <typename T>
-bool BST <T> ::erase(const T& t)
+void BST <T> :: attach(BNode * pNew, BNode * pParent, bool fLeft)
 {
-    // CALL ON FIND(T), DELETE AT ITERATOR POINT
-   return true;
+    // a new left-most node can only hang left of the old one
+    if (!pParent || (fLeft && pParent == pMin))
+        pMin = pNew;
+    if (!pParent || (!fLeft && pParent == pMax))
+        pMax = pNew;
+
+    pNew->pParent = pParent;
+    if (!pParent)
+        root = pNew;
+    else if (fLeft)
+        pParent->pLeft = pNew;
+    else
+        pParent->pRight = pNew;
+    numElements++;
+
+    if (pBloom)
+    {
+        if (numElements > pBloom->capacity())
+            refillBloom();
+        else
+            pBloom->add(hashOf(pNew->data));
+    }
 }
 
-/******************************************************
- ******************************************************
- **********************          **********************
- **********************  B NODE  **********************
- **********************          **********************
- ******************************************************
- ******************************************************/
-//// Putting this here so we can quickly see what data types we have.
-//// Data
-////
-//T data;                  // Actual data stored in the BNode
-//BNode* pLeft;          // Left child - smaller
-//BNode* pRight;         // Right child - larger
-//BNode* pParent;        // Parent
-//bool isRed;              // Red-black balancing stuff
- 
-/******************************************************
- * BINARY NODE :: ADD LEFT
- * Add a node to the left of the current node
- ******************************************************/
+/****************************************************
+ * BST :: FIND OR PARENT
+ * The first node matching k on the way down. If there is
+ * none, pParent and fLeft say where k would be attached.
+ ****************************************************/
 template <typename T>
-void BST <T> :: BNode :: addLeft (BNode * pNode)
+template <class K>
+typename BST <T> :: BNode * BST <T> :: findOrParent(const K & k, BNode * & pParent, bool & fLeft, BNode * pStart) const
 {
-    // does not increase % 
-    if (pNode)
-        pParent = pNode->pParent;
-    pLeft = pNode->pLeft;
+    pParent = nullptr;
+    fLeft = false;
+    BNode * p = pStart ? pStart : root;
+    while (p)
+    {
+        if (k == p->data)
+            return p;
+        pParent = p;
+        fLeft = k < p->data;
+        p = fLeft ? p->pLeft : p->pRight;
+    }
+    return nullptr;
 }
 
-/******************************************************
- * BINARY NODE :: ADD RIGHT
- * Add a node to the right of the current node
- ******************************************************/
+/****************************************************
+ * BST :: FIND NODE
+ * The first node matching k on the way down, nullptr otherwise
+ ****************************************************/
 template <typename T>
-void BST <T> :: BNode :: addRight (BNode * pNode)
+template <class K>
+typename BST <T> :: BNode * BST <T> :: findNode(const K & k, BNode * pStart) const
 {
-    // does not increase %
-    if (pNode)
-        pParent = pNode->pParent;
-    pRight = pNode->pRight;
+    BNode * p = pStart ? pStart : root;
+    while (p)
+    {
+        if (k == p->data)
+            return p;
+        p = (k < p->data) ? p->pLeft : p->pRight;
+    }
+    return nullptr;
 }
 
-/******************************************************
- * BINARY NODE :: ADD LEFT
- * Add a node to the left of the current node
- ******************************************************/
+/****************************************************
+ * BST :: LOWER BOUND NODE
+ * The left-most node not less than k, nullptr otherwise.
+ * If everything under pStart is less than k, the answer
+ * is the first node above it that it is left of.
+ ****************************************************/
 template <typename T>
-void BST<T> :: BNode :: addLeft (const T & t)
+template <class K>
+typename BST <T> :: BNode * BST <T> :: lowerBoundNode(const K & k, BNode * pStart) const
 {
-    // does not increase %
-    if(t)
-        this.pLeft->data = new BNode(t);
+    BNode * pBound = nullptr;
+    BNode * p = pStart ? pStart : root;
+    while (p)
+    {
+        if (p->data < k)
+            p = p->pRight;
+        else
+        {
+            pBound = p;
+            p = p->pLeft;
+        }
+    }
+    if (!pBound && pStart)
+    {
+        for (p = pStart; p->pParent && p->pParent->isRightChild(p); p = p->pParent)
+            ;
+        pBound = p->pParent;
+    }
+    return pBound;
 }
 
-/******************************************************
- * BINARY NODE :: ADD LEFT
- * Add a node to the left of the current node
- ******************************************************/
+/****************************************************
+ * BST :: FINGER ROOT
+ * The lowest node at or above pFinger whose subtree t
+ * falls inside, so that a search from there finds exactly
+ * what a search from the root would. Going toward larger
+ * values, only the parents above left children bound a
+ * subtree from above. Each such bound at or below t hands
+ * the search up to itself, because its own subtree holds
+ * a value below t; the first bound past t ends the climb,
+ * and the last node handed the search is the answer: its
+ * subtree lies between a value below t and that bound.
+ * An equal bound is not below t either, but it is as good
+ * a start for anything happy with any copy of t. With
+ * fFirst, when the first copy is wanted, duplicates may sit
+ * above it, so the search starts just under the bound past
+ * t instead, as if no bound had been handed it. Going
+ * toward smaller values is the mirror,
+ * except that a parent equal to t does hold a value not
+ * below t. A finger at either end of the tree, searching
+ * past that end, is the answer without a climb.
+ ****************************************************/
 template <typename T>
-void BST<T> ::BNode::addLeft(T && t)
+typename BST <T> :: BNode * BST <T> :: fingerRoot(BNode * pFinger, const T & t, bool fFirst) const
 {
-    // does not increase %
-    if (t)
-        this.pLeft->data = new BNode(t);
+    if (!pFinger)
+        return root;
+
+    BNode * p = pFinger;
+    BNode * pStart = p;
+    if (p->data < t)
+    {
+        if (p == rightmost())
+            return p;
+        for (; p->pParent && !(p->pParent->isLeftChild(p) && t < p->pParent->data); p = p->pParent)
+            if (p->pParent->isLeftChild(p))
+                pStart = p->pParent;
+        // bounds only grow on the way up, so only the last can equal t
+        if (fFirst && pStart != pFinger && !(pStart->data < t))
+            return p;
+        return pStart;
+    }
+    else
+    {
+        if (p == leftmost())
+            return p;
+        for (; p->pParent; p = p->pParent)
+            if (p->pParent->isRightChild(p))
+            {
+                if (p->pParent->data < t)
+                    return pStart;
+                pStart = p->pParent;
+            }
+    }
+    return pStart;
 }
 
-/******************************************************
- * BINARY NODE :: ADD RIGHT
- * Add a node to the right of the current node
- ******************************************************/
+/****************************************************
+ * BST :: LOWER BOUND with a FINGER
+ * The first value not less than t, searching from a node
+ * near it
+ ****************************************************/
 template <typename T>
-void BST <T> :: BNode :: addRight (const T & t)
+typename BST <T> :: iterator BST <T> :: lower_bound(const T & t, iterator finger) const
 {
-    // does not increase %
-    if (t)
-        this.pRight->data = new BNode(t);
+    if (settle())
+        finger = end();
+    return iterator(lowerBoundNode(t, fingerRoot(finger.pNode, t, true /* fFirst */)));
 }
 
-/******************************************************
- * BINARY NODE :: ADD RIGHT
- * Add a node to the right of the current node
- ******************************************************/
+/****************************************************
+ * BST :: FIND with a FINGER
+ * The node holding t, searching from a node near it, or
+ * end() if there is none
+ ****************************************************/
 template <typename T>
-void BST <T> ::BNode::addRight(T && t)
+typename BST <T> :: iterator BST <T> :: find(const T & t, iterator finger) const
 {
-    // does not increase %
-    if (t)
-        this.pRight->data = new BNode(t);
+    if (settle())
+        finger = end();
+    if (!mayContain(t))
+        return end();
+    return iterator(findNode(t, fingerRoot(finger.pNode, t)));
 }
 
-
-
-
- // namespace custom
-/**********************************************
- * assign
- * copy the values from pSrc onto pDest preserving
- * as many of the nodes as possible.
- *********************************************/
+/****************************************************
+ * BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
 template <typename T>
-void BST<T> ::BNode::assign(BST<T> ::BNode * pDest, const BST<T> ::BNode * pSrc)
+const T* BST<T>::find(const T& t) const
 {
+    settle();
+    if (!mayContain(t))
+        return nullptr;
+    BNode * p = findNode(t, searchFrom(t));
+    return p ? &p->data : nullptr;
+}
 
-   // Source is Empty
-   if (!pSrc) {
-      clear(pDest);
-      return;
-   }
+/****************************************************
+ * BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise.
+ * In splay mode a hit splays the node found and a miss splays
+ * the last node looked at. That node is also the next finger.
+ * A miss the Bloom filter turns away touches nothing.
+ ****************************************************/
+template <typename T>
+T* BST<T>::find(const T& t)
+{
+    settle();
+    if (!mayContain(t))
+        return nullptr;
+    if (splay == SPLAY_NONE && !fFinger)
+    {
+        BNode * p = findNode(t);
+        return p ? &p->data : nullptr;
+    }
 
-   // Neither the Source nor Destination are Empty
-   if (pDest && pSrc) {
-      pDest->data = pSrc->data;
-      assign(pDest->pRight, pSrc->pRight);
-      assign(pDest->pLeft, pSrc->pLeft);
-   }
+    BNode * pParent = nullptr;
+    bool fLeft = false;
+    BNode * p = findOrParent(t, pParent, fLeft, searchFrom(t));
+    pLast = p ? p : pParent;
+    access(pLast);
+    return p ? &p->data : nullptr;
+}
 
-   // Destination is Empty
-   if (!pDest && pSrc) {
-      pDest = new BST::BNode(pSrc->data);
-      assign(pDest->pRight, pSrc->pRight);
-      assign(pDest->pLeft, pSrc->pLeft);
-   }
+/****************************************************
+ * BST :: FIND BATCH
+ * out[i] is what find(keys[i]) would return. A lone find is
+ * a chain of cache misses, each waiting on the last, so here
+ * a group of searches advance together one level at a time:
+ * every search prefetches its next node and moves aside,
+ * and by the time it comes round again the node is loaded.
+ * A search that finishes hands its slot to the next key.
+ ****************************************************/
+template <typename T>
+void BST<T>::find_batch(const std::vector<T> & keys, std::vector<const T *> & out) const
+{
+    settle();
+    const size_t numLanes = 16;
+    size_t iKey[numLanes];
+    const BNode * pNode[numLanes];
+
+    out.assign(keys.size(), nullptr);
+    size_t numActive = 0;
+    size_t iNext = skipAbsent(keys, 0);
+    for (; numActive < numLanes && iNext < keys.size(); numActive++, iNext = skipAbsent(keys, iNext + 1))
+    {
+        iKey[numActive] = iNext;
+        pNode[numActive] = root;
+    }
+    prefetch(root);
 
-   // Setting parent values
-   if (pDest->pRight)
-      pDest->pRight->pParent = pDest;
-   if (pDest->pLeft)
-      pDest->pLeft->pParent = pDest;
+    while (numActive)
+    {
+        for (size_t i = 0; i < numActive; )
+        {
+            const T & k = keys[iKey[i]];
+            const BNode * p = pNode[i];
+            if (p && !(k == p->data))
+            {
+                // one level down, then let the others run while it loads
+                pNode[i] = (k < p->data) ? p->pLeft : p->pRight;
+                prefetch(pNode[i]);
+                i++;
+                continue;
+            }
+
+            // done: record the answer and start the next key in this slot
+            if (p)
+                out[iKey[i]] = &p->data;
+            if (iNext < keys.size())
+            {
+                iKey[i] = iNext;
+                iNext = skipAbsent(keys, iNext + 1);
+                pNode[i] = root;
+            }
+            else
+            {
+                numActive--;
+                iKey[i] = iKey[numActive];
+                pNode[i] = pNode[numActive];
+            }
+        }
+    }
 }
 
-/*****************************************************
- * DELETE BINARY TREE
- * Delete all the nodes below pThis including pThis
- * using postfix traverse: LRV
+/****************************************************
+ * BST :: PREFETCH
+ * Ask for a node's cache line without waiting for it
  ****************************************************/
-template <class T>
-void BST<T>::BNode::clear(BNode * pThis)
+template <typename T>
+void BST<T>::prefetch(const BNode * p)
 {
-   if (!pThis)
-      return;
-
-   clear(pThis->pLeft);
-   clear(pThis->pRight);
-   pThis = NULL;
+    if (!p)
+        return;
+#ifdef _MSC_VER
+    _mm_prefetch(reinterpret_cast<const char *>(p), _MM_HINT_T0);
+#else
+    __builtin_prefetch(p);
+#endif
 }
-}
\ No newline at end of file
+
+/****************************************************
+ * BST :: COUNT
+ * How many copies of t are in the tree. In multiset mode
+ * this is one descent; otherwise we walk the run of equal
+ * values starting at the lower bound.
+ ****************************************************/
+template <typename T>
+size_t BST<T>::count(const T& t) const
+{
+    settle();
+    if (!mayContain(t))
+        return 0;
+    if (fMultiset)
+    {
+        BNode * p = findNode(t);
+        return p ? p->count : 0;
+    }
+
+    size_t num = 0;
+    for (iterator it(lowerBoundNode(t)); it != end() && *it == t; ++it)
+        num++;
+    return num;
+}
+
+
+/*****************************************************
+ * BST :: CLEAR
+ * Removes all the BNodes from a tree
+ ****************************************************/
+template <typename T>
+void BST <T> ::clear() noexcept
+{
+   BNode::clear(root);
+   pending.clear();
+   pMin = pMax = nullptr;
+   numElements = 0;
+   maxElements = 0;
+   pLast = nullptr;
+   numErased = 0;
+   if (pBloom)
+      pBloom->clear(pBloom->capacity());   // same size, so nothing is allocated
+}
+
+
+/*************************************************
+ * BST :: ERASE SEARCH
+ * Locate the node to be erased. Every node visited is
+ * checked both for ordering and for equality.
+ ************************************************/
+template <typename T>
+typename BST <T> :: BNode * BST <T> :: eraseSearch(const T & t, BNode * pStart) const
+{
+    BNode * p = pStart ? pStart : root;
+    while (p)
+    {
+        bool fLess = t < p->data;
+        if (t == p->data)
+            return p;
+        p = fLess ? p->pLeft : p->pRight;
+    }
+    return nullptr;
+}
+
+/*************************************************
+ * BST :: ERASE
+ * Remove a given node as specified by the value. With
+ * eraseAll set, every copy of the value is removed.
+ ************************************************/
+template <typename T>
+bool BST <T> ::erase(const T& t, bool eraseAll)
+{
+    if (maxPending && !eraseAll)
+        return queue(t, false /* fInsert */, false);
+    settle();
+    if (!mayContain(t))
+        return false;
+    BNode * pDelete = eraseSearch(t, searchFrom(t));
+    if (!pDelete)
+        return false;
+
+    if (fMultiset)
+    {
+        if (!eraseAll && pDelete->count > 1)
+        {
+            pDelete->count--;
+            numElements--;
+            pLast = pDelete;
+            access(pDelete);
+            rebalanceAfterErase();
+            return true;
+        }
+        numElements -= pDelete->count - 1;
+    }
+
+    // in splay mode, the parent of the last node removed goes up;
+    // it is also the next finger
+    BNode * pParent = pDelete->pParent;
+    if (fMultiset || !eraseAll)
+        eraseNode(pDelete);
+    else
+    {
+        // the copies of t sit next to each other in order. Gather them
+        // before freeing any: t may be the data of one of them
+        std::vector<BNode *> same(1, pDelete);
+        for (iterator it(pDelete); (--it).pNode && it.pNode->data == t; )
+            same.push_back(it.pNode);
+        for (iterator it(pDelete); (++it).pNode && it.pNode->data == t; )
+            same.push_back(it.pNode);
+        for (BNode * p : same)
+        {
+            pParent = p->pParent;
+            eraseNode(p);
+        }
+    }
+    pLast = pParent ? pParent : root;
+    access(pParent);
+    rebalanceAfterErase();
+    return true;
+}
+
+/*************************************************
+ * BST :: ERASE NODE
+ * Unhook a node from the tree and free it. A node with two
+ * children is replaced by its in-order successor; the nodes
+ * themselves are moved, never the data.
+ ************************************************/
+template <typename T>
+void BST <T> ::eraseNode(BNode * pDelete)
+{
+    assert(pDelete);
+    BNode * pReplace;
+
+    // the left-most node has no left child, so the next one is the
+    // bottom of its right subtree or else its parent; the same for
+    // the right-most node, mirrored
+    if (pDelete == pMin)
+    {
+        pMin = pDelete->pParent;
+        for (BNode * p = pDelete->pRight; p; p = p->pLeft)
+            pMin = p;
+    }
+    if (pDelete == pMax)
+    {
+        pMax = pDelete->pParent;
+        for (BNode * p = pDelete->pLeft; p; p = p->pRight)
+            pMax = p;
+    }
+
+    if (!pDelete->pLeft)
+        pReplace = pDelete->pRight;
+    else if (!pDelete->pRight)
+        pReplace = pDelete->pLeft;
+    else
+    {
+        // the successor is the left-most node of the right subtree
+        pReplace = pDelete->pRight;
+        while (pReplace->pLeft)
+            pReplace = pReplace->pLeft;
+
+        // pull the successor out of its current spot
+        if (pReplace->pParent != pDelete)
+        {
+            pReplace->pParent->pLeft = pReplace->pRight;
+            if (pReplace->pRight)
+                pReplace->pRight->pParent = pReplace->pParent;
+            pReplace->pRight = pDelete->pRight;
+            pReplace->pRight->pParent = pReplace;
+        }
+        pReplace->pLeft = pDelete->pLeft;
+        pReplace->pLeft->pParent = pReplace;
+    }
+
+    // hook the replacement to the parent of the deleted node
+    if (pReplace)
+        pReplace->pParent = pDelete->pParent;
+    if (!pDelete->pParent)
+        root = pReplace;
+    else if (pDelete->pParent->isLeftChild(pDelete))
+        pDelete->pParent->pLeft = pReplace;
+    else
+        pDelete->pParent->pRight = pReplace;
+
+    if (pLast == pDelete)
+        pLast = pDelete->pParent ? pDelete->pParent : root;
+    delete pDelete;
+    numElements--;
+
+    // the filter cannot forget a value, so refill it once stale bits pile up
+    if (pBloom && ++numErased * 2 > numElements)
+        refillBloom();
+}
+
+/*************************************************
+ * BST :: APPLY BATCH
+ * Apply inserts and erases sorted by value, returning what
+ * insert or erase would have returned for each one. A small
+ * batch is walked in with a finger: each op starts where the
+ * last one stopped, so neighbouring values share their path
+ * from the root. A batch that is large next to the tree is
+ * merged with it and the tree is rebuilt, balanced.
+ ************************************************/
+template <typename T>
+std::vector<bool> BST <T> :: apply_batch(std::vector<BatchOp> ops, bool keepUnique)
+{
+    settle();
+
+    // below about one op per eight nodes, walking beats rebuilding
+    if (ops.size() * 8 >= numElements)
+    {
+        assert(std::is_sorted(ops.begin(), ops.end(),
+                              [](const BatchOp & lhs, const BatchOp & rhs) { return lhs.data < rhs.data; }));
+        return mergeBatch(ops, keepUnique);
+    }
+
+    std::vector<bool> results;
+    results.reserve(ops.size());
+    BNode * pFinger = nullptr;
+    bool fSameAsLast = false;
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        // an equal value may sit above the finger, so start from the top
+        if (fSameAsLast)
+            pFinger = nullptr;
+        fSameAsLast = i + 1 < ops.size() && !(ops[i].data < ops[i + 1].data);
+        assert(!fSameAsLast || !(ops[i + 1].data < ops[i].data));  // sorted, ties only
+        pFinger = fingerRoot(pFinger, ops[i].data);
+        results.push_back(applyFrom(pFinger, ops[i], keepUnique));
+    }
+    return results;
+}
+
+/*************************************************
+ * BST :: APPLY FROM
+ * One op of a batch, searching down from pFinger (or the
+ * root). Afterwards pFinger is left near where the op
+ * happened, ready for the next one.
+ ************************************************/
+template <typename T>
+bool BST <T> :: applyFrom(BNode * & pFinger, BatchOp & op, bool keepUnique)
+{
+    BNode * pParent = nullptr;
+    bool fLeft = false;
+    BNode * p = pFinger ? pFinger : root;
+
+    // a plain insert only needs operator<, exactly like insert()
+    if (op.fInsert && !keepUnique && !fMultiset)
+    {
+        for (; p; p = fLeft ? p->pLeft : p->pRight)
+        {
+            pParent = p;
+            fLeft = op.data < p->data;
+        }
+        pFinger = new BNode(std::move(op.data));
+        attach(pFinger, pParent, fLeft);
+        rebalanceAfterInsert(pFinger);
+        return true;
+    }
+
+    while (p && !(op.data == p->data))
+    {
+        pParent = p;
+        fLeft = op.data < p->data;
+        p = fLeft ? p->pLeft : p->pRight;
+    }
+
+    if (op.fInsert)
+    {
+        if (!p)
+        {
+            pFinger = new BNode(std::move(op.data));
+            attach(pFinger, pParent, fLeft);
+            rebalanceAfterInsert(pFinger);
+            return true;
+        }
+        pFinger = p;
+        if (!fMultiset || keepUnique)
+            return false;
+        p->count++;
+        numElements++;
+        return true;
+    }
+
+    if (!p)
+    {
+        pFinger = pParent;
+        return false;
+    }
+    if (p->count > 1)
+    {
+        pFinger = p;
+        p->count--;
+        numElements--;
+        rebalanceAfterErase();
+        return true;
+    }
+    pFinger = p->pParent;
+    eraseNode(p);
+    rebalanceAfterErase();
+    return true;
+}
+
+/*************************************************
+ * BST :: MERGE BATCH
+ * Lay the nodes out in order, merge the ops into them the way
+ * a merge sort would, then rebuild a balanced tree. Nodes are
+ * reused; only inserted values are allocated.
+ ************************************************/
+template <typename T>
+std::vector<bool> BST <T> :: mergeBatch(std::vector<BatchOp> & ops, bool keepUnique)
+{
+    // erased nodes are freed without eraseNode, so drop the finger
+    pLast = nullptr;
+    std::vector<BNode *> nodes;
+    nodes.reserve(numElements);
+    flatten(root, nodes);
+    std::vector<BNode *> merged;
+    merged.reserve(nodes.size() + ops.size());
+    std::vector<bool> results;
+    results.reserve(ops.size());
+
+    size_t iNode = 0;
+    for (BatchOp & op : ops)
+    {
+        while (iNode < nodes.size() && nodes[iNode]->data < op.data)
+            merged.push_back(nodes[iNode++]);
+
+        // a plain insert goes after every equal value
+        if (op.fInsert && !keepUnique && !fMultiset)
+        {
+            while (iNode < nodes.size() && !(op.data < nodes[iNode]->data))
+                merged.push_back(nodes[iNode++]);
+            merged.push_back(new BNode(std::move(op.data)));
+            numElements++;
+            results.push_back(true);
+            continue;
+        }
+
+        // an equal value is either the last one placed or the next one waiting
+        bool fBack = !merged.empty() && merged.back()->data == op.data;
+        bool fNext = !fBack && iNode < nodes.size() && nodes[iNode]->data == op.data;
+        BNode * pSame = fBack ? merged.back() : (fNext ? nodes[iNode] : nullptr);
+
+        if (op.fInsert)
+        {
+            if (!pSame)
+            {
+                merged.push_back(new BNode(std::move(op.data)));
+                numElements++;
+                results.push_back(true);
+            }
+            else if (!fMultiset || keepUnique)
+                results.push_back(false);
+            else
+            {
+                pSame->count++;
+                numElements++;
+                results.push_back(true);
+            }
+        }
+        else
+        {
+            results.push_back(pSame != nullptr);
+            if (!pSame)
+                continue;
+            numElements--;
+            if (pSame->count > 1)
+                pSame->count--;
+            else
+            {
+                if (fBack)
+                    merged.pop_back();
+                else
+                    iNode++;
+                delete pSame;
+            }
+        }
+    }
+    merged.insert(merged.end(), nodes.begin() + iNode, nodes.end());
+
+    root = build(merged, 0, merged.size(), nullptr);
+    pMin = merged.empty() ? nullptr : merged.front();
+    pMax = merged.empty() ? nullptr : merged.back();
+    maxElements = numElements;
+    if (pBloom)
+        refillBloom();
+    return results;
+}
+
+/*************************************************
+ * BST :: ERASE IF
+ * Mark the nodes pred accepts in one walk, then lay
+ * the tree out as a vine, free the marked nodes as
+ * they come up, and fold the keepers back into a
+ * balanced tree. pred has seen every node before
+ * anything changes, so if it throws nothing has.
+ ************************************************/
+template <typename T>
+template <class Pred>
+size_t BST <T> :: erase_if(Pred pred)
+{
+    settle();
+    if (!markIf(pred))
+        return 0;
+
+    size_t numBefore = numElements;
+    BNode * pMarked = nullptr;
+    toVine();
+    adopt(splitVine(pMarked, true /* fFree */));
+    return numBefore - numElements;
+}
+
+/*************************************************
+ * BST :: PARTITION
+ * The same walk as erase_if, but the rest go to a
+ * second tree rather than being freed
+ ************************************************/
+template <typename T>
+template <class Pred>
+std::pair<BST <T>, BST <T> > BST <T> :: partition(Pred pred)
+{
+    settle();
+    markIf(pred);
+
+    std::pair<BST <T>, BST <T> > parts;
+    for (BST <T> * pPart : { &parts.first, &parts.second })
+    {
+        pPart->copyModes(*this);
+        if (pBloom)
+        {
+            pPart->pBloom = new BloomFilter(*pBloom);
+            pPart->hashOf = hashOf;
+        }
+    }
+    toVine();
+    BNode * pYes = nullptr;
+    BNode * pNo = splitVine(pYes, false /* fFree */);
+
+    // the nodes belong to the parts now, so clear must not free them
+    clear();
+    parts.first.adopt(pYes);
+    parts.second.adopt(pNo);
+    return parts;
+}
+
+/*************************************************
+ * BST :: SUCCESSOR
+ * The next node in order, or null after the last
+ ************************************************/
+template <typename T>
+typename BST <T> :: BNode * BST <T> :: successor(BNode * p)
+{
+    // the left-most node of the right subtree is next
+    if (p->pRight)
+    {
+        for (p = p->pRight; p->pLeft; p = p->pLeft)
+            ;
+        return p;
+    }
+
+    // otherwise climb until we come up from the left
+    while (p->pParent && p->pParent->isRightChild(p))
+        p = p->pParent;
+    return p->pParent;
+}
+
+/*************************************************
+ * BST :: MARK IF
+ * Ask pred about every node, in order, and mark the
+ * ones it accepts with the top bit of their count.
+ * If pred throws the marks come off again.
+ ************************************************/
+template <typename T>
+template <class Pred>
+size_t BST <T> :: markIf(Pred & pred)
+{
+    size_t numMarked = 0;
+    BNode * p = pMin;
+    try
+    {
+        for (; p; p = successor(p))
+            if (pred(static_cast<const T &>(p->data)))
+            {
+                p->count |= BNode::MARKED;
+                numMarked++;
+            }
+    }
+    catch (...)
+    {
+        for (BNode * pUndo = pMin; pUndo != p; pUndo = successor(pUndo))
+            pUndo->count &= ~BNode::MARKED;
+        throw;
+    }
+    return numMarked;
+}
+
+/*************************************************
+ * BST :: TO VINE
+ * Rotate every left child up until the tree is one
+ * chain down the right, smallest at the root
+ ************************************************/
+template <typename T>
+void BST <T> :: toVine()
+{
+    BNode * p = root;
+    while (p)
+    {
+        if (p->pLeft)
+        {
+            p = p->pLeft;
+            rotateUp(p);
+        }
+        else
+            p = p->pRight;
+    }
+}
+
+/*************************************************
+ * BST :: SPLIT VINE
+ * Take the vine apart, leaving the tree empty, and
+ * return the unmarked nodes still chained in order
+ * through pRight. The marked ones are freed on the
+ * spot or, with fFree unset, chained onto pMarked.
+ ************************************************/
+template <typename T>
+typename BST <T> :: BNode * BST <T> :: splitVine(BNode * & pMarked, bool fFree)
+{
+    BNode * pHead = nullptr;
+    BNode * pTail = nullptr;
+    BNode * pMarkedTail = nullptr;
+    pMarked = nullptr;
+    BNode * pNext;
+    for (BNode * p = root; p; p = pNext)
+    {
+        pNext = p->pRight;
+        p->pRight = nullptr;
+        bool fMarked = (p->count & BNode::MARKED) != 0;
+        p->count &= ~BNode::MARKED;
+        if (fMarked && fFree)
+        {
+            delete p;
+            continue;
+        }
+        BNode * & pHeadOf = fMarked ? pMarked : pHead;
+        BNode * & pTailOf = fMarked ? pMarkedTail : pTail;
+        p->pParent = pTailOf;
+        (pTailOf ? pTailOf->pRight : pHeadOf) = p;
+        pTailOf = p;
+    }
+    root = pMin = pMax = nullptr;
+    return pHead;
+}
+
+/*************************************************
+ * BST :: ADOPT
+ * Make a vine of nodes, already in order and chained
+ * through pRight, the whole tree, balanced, and bring
+ * everything kept about the tree up to date
+ ************************************************/
+template <typename T>
+void BST <T> :: adopt(BNode * pVine)
+{
+    root = pVine;
+    numElements = 0;
+    pMin = pMax = pVine;
+    for (BNode * p = pVine; p; p = p->pRight)
+    {
+        numElements += p->count;
+        pMax = p;
+    }
+    maxElements = numElements;
+    pLast = nullptr;
+    if (root)
+        rebuildInPlace(root);
+    if (pBloom)
+        refillBloom();
+}
+
+/*************************************************
+ * BST :: COPY MODES
+ * Take on rhs's settings, but none of its values
+ ************************************************/
+template <typename T>
+void BST <T> :: copyModes(const BST <T> & rhs)
+{
+    fMultiset = rhs.fMultiset;
+    splay = rhs.splay;
+    splayPeriod = rhs.splayPeriod;
+    alpha = rhs.alpha;
+    depthFactor = rhs.depthFactor;
+    fFinger = rhs.fFinger;
+    maxPending = rhs.maxPending;
+}
+
+/*************************************************
+ * BST :: FLATTEN
+ * Every node of the subtree under p, in order
+ ************************************************/
+template <typename T>
+void BST <T> :: flatten(BNode * p, std::vector<BNode *> & nodes)
+{
+    std::vector<BNode *> stack;
+    while (p || !stack.empty())
+    {
+        for (; p; p = p->pLeft)
+            stack.push_back(p);
+        p = stack.back();
+        stack.pop_back();
+        nodes.push_back(p);
+        p = p->pRight;
+    }
+}
+
+/*************************************************
+ * BST :: BUILD
+ * Link nodes[iBegin, iEnd), already in order, into a
+ * balanced subtree hanging from pParent
+ ************************************************/
+template <typename T>
+typename BST <T> :: BNode * BST <T> :: build(std::vector<BNode *> & nodes, size_t iBegin, size_t iEnd, BNode * pParent)
+{
+    if (iBegin >= iEnd)
+        return nullptr;
+    size_t iMiddle = iBegin + (iEnd - iBegin) / 2;
+    BNode * p = nodes[iMiddle];
+    p->pParent = pParent;
+    p->pLeft = build(nodes, iBegin, iMiddle, p);
+    p->pRight = build(nodes, iMiddle + 1, iEnd, p);
+    return p;
+}
+
+/*************************************************
+ * BST :: SET BUFFERED
+ ************************************************/
+template <typename T>
+void BST <T> :: setBuffered(size_t capacity)
+{
+    flush();
+    maxPending = capacity;
+    pending.reserve(capacity);
+}
+
+/*************************************************
+ * BST :: QUEUE
+ * Add an insert or erase to the queue, applying the
+ * queue when it fills. One batch has one keepUnique
+ * for all its inserts, so a change of mind applies
+ * what came before.
+ ************************************************/
+template <typename T>
+template <class U>
+bool BST <T> :: queue(U && t, bool fInsert, bool keepUnique)
+{
+    if (fInsert && keepUnique != fPendingUnique)
+    {
+        flush();
+        fPendingUnique = keepUnique;
+    }
+    pending.push_back(BatchOp{ std::forward<U>(t), fInsert });
+    if (pending.size() >= maxPending)
+        flush();
+    return true;
+}
+
+/*************************************************
+ * BST :: FLUSH
+ * Apply every queued op. The sort is stable, so ops
+ * on one value happen in the order they were made.
+ * It sorts positions, not the ops, so that a T that
+ * can be moved but not assigned, such as a map's
+ * entry with its const key, can still be buffered.
+ ************************************************/
+template <typename T>
+void BST <T> :: flush()
+{
+    if (pending.empty())
+        return;
+    std::vector<size_t> order(pending.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t lhs, size_t rhs) { return pending[lhs].data < pending[rhs].data; });
+    std::vector<BatchOp> ops;
+    ops.reserve(order.size());
+    for (size_t i : order)
+        ops.push_back(std::move(pending[i]));
+    pending.clear();
+    apply_batch(std::move(ops), fPendingUnique);
+}
+
+/*************************************************
+ * BST :: SETTLE
+ * Before any read, apply the queue. Only a tree that
+ * queued something has anything to apply, and that
+ * tree was not created const, so a const reference
+ * may still flush it. That write is why two readers
+ * may not share a tree with anything queued. True if
+ * anything was applied, which may have freed the node
+ * a finger points to.
+ ************************************************/
+template <typename T>
+bool BST <T> :: settle() const
+{
+    if (pending.empty())
+        return false;
+    const_cast<BST <T> *>(this)->flush();
+    return true;
+}
+
+/*************************************************
+ * BST :: SET BLOOM
+ * Put a filter in front of the tree, filled from it
+ ************************************************/
+template <typename T>
+template <class Hash>
+void BST <T> :: setBloom(unsigned int bitsPerKey)
+{
+    settle();
+    delete pBloom;
+    pBloom = new BloomFilter(0, bitsPerKey);
+    hashOf = [](const T & t) -> size_t { return Hash()(t); };
+    refillBloom();
+}
+
+/*************************************************
+ * BST :: REFILL BLOOM
+ * Start the filter over with room for the tree to
+ * double, then add every value in it
+ ************************************************/
+template <typename T>
+void BST <T> :: refillBloom()
+{
+    assert(pBloom);
+    pBloom->clear(numElements < 32 ? 64 : numElements * 2);
+    numErased = 0;
+    for (BNode * p = pMin; p; p = successor(p))
+        pBloom->add(hashOf(p->data));
+}
+
+/*************************************************
+ * BST :: SKIP ABSENT
+ * The first key from i on that the filter lets through
+ ************************************************/
+template <typename T>
+size_t BST <T> :: skipAbsent(const std::vector<T> & keys, size_t i) const
+{
+    while (i < keys.size() && !mayContain(keys[i]))
+        i++;
+    return i;
+}
+
+/*************************************************
+ * BST :: SET SPLAY
+ * Splaying and rebuilding would undo each other,
+ * so turning one on turns the others off
+ ************************************************/
+template <typename T>
+void BST <T> :: setSplay(SplayMode mode, unsigned int period)
+{
+    splay = mode;
+    splayPeriod = period ? period : 1;
+    if (splay != SPLAY_NONE)
+    {
+        alpha = 0.0;
+        depthFactor = 0.0;
+    }
+}
+
+/*************************************************
+ * BST :: SET SCAPEGOAT
+ * Turning it on rebuilds the whole tree so that
+ * the depth bound holds from the start
+ ************************************************/
+template <typename T>
+void BST <T> :: setScapegoat(double alphaNew)
+{
+    assert(alphaNew == 0.0 || (alphaNew > 0.5 && alphaNew < 1.0));
+    alpha = alphaNew;
+    if (alpha == 0.0)
+        return;
+    splay = SPLAY_NONE;
+    depthFactor = 0.0;
+    if (root)
+        rebuild(root);
+    maxElements = numElements;
+}
+
+/*************************************************
+ * BST :: REBALANCE AFTER INSERT
+ * If pNew is too deep, climb until a child holds more
+ * than alpha of its parent's nodes: that parent is the
+ * scapegoat, and its subtree is rebuilt
+ ************************************************/
+template <typename T>
+void BST <T> :: rebalanceAfterInsert(BNode * pNew)
+{
+    if (depthFactor != 0.0)
+        rebalanceIfDeep(pNew);
+    if (alpha == 0.0)
+        return;
+    if (numElements > maxElements)
+        maxElements = numElements;
+
+    size_t depth = 0;
+    for (BNode * p = pNew; p->pParent; p = p->pParent)
+        depth++;
+    if ((double)depth <= std::log((double)numElements) / std::log(1.0 / alpha))
+        return;
+
+    size_t sizeChild = 1;
+    BNode * pChild = pNew;
+    for (BNode * p = pNew->pParent; p; pChild = p, p = p->pParent)
+    {
+        BNode * pSibling = p->isLeftChild(pChild) ? p->pRight : p->pLeft;
+        size_t sizeParent = sizeChild + 1 + countNodes(pSibling);
+        if ((double)sizeChild > alpha * (double)sizeParent)
+        {
+            rebuild(p);
+            return;
+        }
+        sizeChild = sizeParent;
+    }
+}
+
+/*************************************************
+ * BST :: REBALANCE AFTER ERASE
+ * Once enough has been erased since the last full
+ * rebuild, the depth bound could be broken; rebuild
+ ************************************************/
+template <typename T>
+void BST <T> :: rebalanceAfterErase()
+{
+    if (alpha == 0.0 || (double)numElements >= alpha * (double)maxElements)
+        return;
+    if (root)
+        rebuild(root);
+    maxElements = numElements;
+}
+
+/*************************************************
+ * BST :: REBUILD
+ * Relink the subtree under p into perfect balance
+ ************************************************/
+template <typename T>
+void BST <T> :: rebuild(BNode * p)
+{
+    BNode * pParent = p->pParent;
+    bool fLeft = pParent && pParent->isLeftChild(p);
+
+    std::vector<BNode *> nodes;
+    flatten(p, nodes);
+    p = build(nodes, 0, nodes.size(), pParent);
+
+    if (!pParent)
+        root = p;
+    else if (fLeft)
+        pParent->pLeft = p;
+    else
+        pParent->pRight = p;
+}
+
+/*************************************************
+ * BST :: REBALANCE
+ * Balance the whole tree, without a buffer
+ ************************************************/
+template <typename T>
+void BST <T> :: rebalance()
+{
+    settle();
+    if (root)
+        rebuildInPlace(root);
+}
+
+/*************************************************
+ * BST :: SET AUTO REBALANCE
+ * Turning it on balances the tree once, so that
+ * the depth bound holds from the start
+ ************************************************/
+template <typename T>
+void BST <T> :: setAutoRebalance(double factor)
+{
+    assert(factor == 0.0 || factor >= 1.0);
+    depthFactor = factor;
+    if (depthFactor == 0.0)
+        return;
+    splay = SPLAY_NONE;
+    alpha = 0.0;
+    rebalance();
+}
+
+/*************************************************
+ * BST :: REBALANCE IF DEEP
+ * If pNew is more than depthFactor * log2(size) down,
+ * climb until the distance from pNew is more than
+ * depthFactor * log2 of the subtree's own size, and
+ * balance that subtree. The root always qualifies,
+ * but a lower one is usually found first, which
+ * keeps the work near the size of the damage.
+ ************************************************/
+template <typename T>
+void BST <T> :: rebalanceIfDeep(BNode * pNew)
+{
+    size_t depth = 0;
+    for (BNode * p = pNew; p->pParent; p = p->pParent)
+        depth++;
+    if ((double)depth <= depthFactor * std::log2((double)numElements))
+        return;
+
+    size_t height = 0;
+    size_t sizeChild = 1;
+    BNode * pChild = pNew;
+    for (BNode * p = pNew->pParent; p; pChild = p, p = p->pParent)
+    {
+        height++;
+        BNode * pSibling = p->isLeftChild(pChild) ? p->pRight : p->pLeft;
+        size_t sizeParent = sizeChild + 1 + countNodes(pSibling);
+        if ((double)height > depthFactor * std::log2((double)sizeParent) || !p->pParent)
+        {
+            rebuildInPlace(p);
+            return;
+        }
+        sizeChild = sizeParent;
+    }
+}
+
+/*************************************************
+ * BST :: REBUILD IN PLACE
+ * Day-Stout-Warren on the subtree under p. First rotate
+ * every left child up until the subtree is a vine of
+ * right children, in order. Then rotate every other
+ * vine node up over the one above it: the first pass
+ * only for the nodes past the largest complete tree
+ * that fits, each later pass halving the vine, until
+ * it is a complete tree with the leftovers at the bottom.
+ * rotateUp keeps the parents and the subtree's place
+ * in the tree; only links change.
+ ************************************************/
+template <typename T>
+void BST <T> :: rebuildInPlace(BNode * p)
+{
+    BNode * pParent = p->pParent;
+    bool fLeft = pParent && pParent->isLeftChild(p);
+    auto top = [this, pParent, fLeft]()
+    {
+        return !pParent ? root : fLeft ? pParent->pLeft : pParent->pRight;
+    };
+
+    // tree to vine
+    size_t num = 0;
+    while (p)
+    {
+        if (p->pLeft)
+        {
+            p = p->pLeft;
+            rotateUp(p);
+        }
+        else
+        {
+            num++;
+            p = p->pRight;
+        }
+    }
+
+    // vine to tree: the largest complete tree is 2^k - 1 nodes
+    size_t numComplete = 1;
+    while (numComplete * 2 + 1 <= num)
+        numComplete = numComplete * 2 + 1;
+    for (size_t numRotate = num - numComplete; ; numRotate = numComplete /= 2)
+    {
+        p = top();
+        for (size_t i = 0; i < numRotate; i++)
+        {
+            BNode * pNext = p->pRight;
+            rotateUp(pNext);
+            p = pNext->pRight;
+        }
+        if (numComplete <= 1)
+            break;
+    }
+}
+
+/*************************************************
+ * BST :: COUNT NODES
+ * Nodes in the subtree under p, with an explicit stack
+ * so a long chain cannot overflow the call stack
+ ************************************************/
+template <typename T>
+size_t BST <T> :: countNodes(const BNode * p)
+{
+    size_t num = 0;
+    std::vector<const BNode *> stack;
+    while (p || !stack.empty())
+    {
+        if (!p)
+        {
+            p = stack.back();
+            stack.pop_back();
+        }
+        num++;
+        if (p->pRight)
+            stack.push_back(p->pRight);
+        p = p->pLeft;
+    }
+    return num;
+}
+
+/*************************************************
+ * BST :: ACCESS
+ * p was just touched. In splay mode, and if this is
+ * the splayPeriod-th access, splay it to the top.
+ ************************************************/
+template <typename T>
+void BST <T> :: access(BNode * p)
+{
+    if (splay == SPLAY_NONE || !p)
+        return;
+    if (++numAccesses < splayPeriod)
+        return;
+    numAccesses = 0;
+    splayUp(p);
+}
+
+/*************************************************
+ * BST :: SPLAY UP
+ * Rotate p to the root two levels at a time:
+ *    zig-zig (p and its parent lean the same way): rotate
+ *       the parent first, then p
+ *    zig-zag (they lean opposite ways): rotate p twice
+ *    zig (p is a child of the root): rotate p once
+ * A semi-splay does only the first rotation of a zig-zig
+ * and carries on from the parent, which about halves the
+ * depth of the path while leaving p where it is.
+ ************************************************/
+template <typename T>
+void BST <T> :: splayUp(BNode * p)
+{
+    while (p->pParent)
+    {
+        BNode * pParent = p->pParent;
+        BNode * pGrand = pParent->pParent;
+        if (!pGrand)
+            rotateUp(p);
+        else if (pParent->isLeftChild(p) == pGrand->isLeftChild(pParent))
+        {
+            rotateUp(pParent);
+            if (splay == SPLAY_SEMI)
+                p = pParent;
+            else
+                rotateUp(p);
+        }
+        else
+        {
+            rotateUp(p);
+            rotateUp(p);
+        }
+    }
+}
+
+/*************************************************
+ * BST :: ROTATE UP
+ * Swap p with its parent, keeping the order:
+ *
+ *            parent              p
+ *          +---+---+         +---+---+
+ *          p       c   =>    a     parent
+ *        +-+-+                   +---+---+
+ *        a   b                   b       c
+ *
+ * Only links change; no data moves.
+ ************************************************/
+template <typename T>
+void BST <T> :: rotateUp(BNode * p)
+{
+    BNode * pParent = p->pParent;
+    assert(pParent);
+    BNode * pGrand = pParent->pParent;
+
+    if (pParent->isLeftChild(p))
+    {
+        pParent->addLeft(p->pRight);
+        p->addRight(pParent);
+    }
+    else
+    {
+        pParent->addRight(p->pLeft);
+        p->addLeft(pParent);
+    }
+
+    p->pParent = pGrand;
+    if (!pGrand)
+        root = p;
+    else if (pGrand->isLeftChild(pParent))
+        pGrand->pLeft = p;
+    else
+        pGrand->pRight = p;
+}
+
+/**************************************************
+ **************************************************
+ ***************                    ***************
+ ***************  BST :: ITERATOR   ***************
+ ***************                    ***************
+ **************************************************
+ **************************************************/
+
+/**************************************************
+ * BST ITERATOR :: INCREMENT PREFIX
+ * advance by one. In multiset mode, first walk through
+ * the copies held in the current node.
+ *************************************************/
+template <typename T>
+typename BST <T> :: iterator & BST <T> :: iterator :: operator ++ ()
+{
+    if (!pNode)
+        return *this;
+
+    if (index + 1 < pNode->count)
+    {
+        index++;
+        return *this;
+    }
+    index = 0;
+
+    // the left-most node of the right subtree is next
+    if (pNode->pRight)
+    {
+        pNode = pNode->pRight;
+        while (pNode->pLeft)
+            pNode = pNode->pLeft;
+        return *this;
+    }
+
+    // otherwise climb until we come up from the left
+    BNode * pSave = pNode;
+    pNode = pNode->pParent;
+    while (pNode && pNode->isRightChild(pSave))
+    {
+        pSave = pNode;
+        pNode = pNode->pParent;
+    }
+    return *this;
+}
+
+/**************************************************
+ * BST ITERATOR :: DECREMENT PREFIX
+ * advance by one
+ *************************************************/
+template <typename T>
+typename BST <T> :: iterator & BST <T> :: iterator :: operator -- ()
+{
+    if (!pNode)
+        return *this;
+
+    if (index > 0)
+    {
+        index--;
+        return *this;
+    }
+
+    // the right-most node of the left subtree is next
+    if (pNode->pLeft)
+    {
+        pNode = pNode->pLeft;
+        while (pNode->pRight)
+            pNode = pNode->pRight;
+    }
+    else
+    {
+        // otherwise climb until we come up from the right
+        BNode * pSave = pNode;
+        pNode = pNode->pParent;
+        while (pNode && pNode->isLeftChild(pSave))
+        {
+            pSave = pNode;
+            pNode = pNode->pParent;
+        }
+    }
+
+    if (pNode)
+        index = pNode->count - 1;
+    return *this;
+}
+
+/******************************************************
+ ******************************************************
+ **********************          **********************
+ **********************  B NODE  **********************
+ **********************          **********************
+ ******************************************************
+ ******************************************************/
+
+/******************************************************
+ * BINARY NODE :: ADD LEFT
+ * Add a node to the left of the current node
+ ******************************************************/
+template <typename T>
+void BST <T> :: BNode :: addLeft (BNode * pNode)
+{
+    if (pNode)
+        pNode->pParent = this;
+    pLeft = pNode;
+}
+
+/******************************************************
+ * BINARY NODE :: ADD RIGHT
+ * Add a node to the right of the current node
+ ******************************************************/
+template <typename T>
+void BST <T> :: BNode :: addRight (BNode * pNode)
+{
+    if (pNode)
+        pNode->pParent = this;
+    pRight = pNode;
+}
+
+/******************************************************
+ * BINARY NODE :: ADD LEFT
+ * Add a node to the left of the current node
+ ******************************************************/
+template <typename T>
+void BST<T> :: BNode :: addLeft (const T & t)
+{
+    addLeft(new BNode(t));
+}
+
+/******************************************************
+ * BINARY NODE :: ADD LEFT
+ * Add a node to the left of the current node
+ ******************************************************/
+template <typename T>
+void BST<T> ::BNode::addLeft(T && t)
+{
+    addLeft(new BNode(std::move(t)));
+}
+
+/******************************************************
+ * BINARY NODE :: ADD RIGHT
+ * Add a node to the right of the current node
+ ******************************************************/
+template <typename T>
+void BST <T> :: BNode :: addRight (const T & t)
+{
+    addRight(new BNode(t));
+}
+
+/******************************************************
+ * BINARY NODE :: ADD RIGHT
+ * Add a node to the right of the current node
+ ******************************************************/
+template <typename T>
+void BST <T> ::BNode::addRight(T && t)
+{
+    addRight(new BNode(std::move(t)));
+}
+
+/**********************************************
+ * assign
+ * copy the values from pSrc onto pDest preserving
+ * as many of the nodes as possible. The pairs still
+ * to copy wait on an explicit stack, so a long chain
+ * cannot overflow the call stack.
+ *********************************************/
+template <typename T>
+void BST<T> ::BNode::assign(BNode * & pDest, const BNode * pSrc)
+{
+   struct Pending
+   {
+      BNode * * ppDest;
+      const BNode * pSrc;
+      BNode * pParent;
+   };
+   std::vector<Pending> stack;
+   stack.push_back({ &pDest, pSrc, nullptr });
+   while (!stack.empty())
+   {
+      Pending next = stack.back();
+      stack.pop_back();
+      BNode * & pNode = *next.ppDest;
+
+      // Source is Empty
+      if (!next.pSrc) {
+         clear(pNode);
+         continue;
+      }
+
+      // Neither the Source nor Destination are Empty
+      if (pNode)
+         pNode->data = next.pSrc->data;
+
+      // Destination is Empty
+      else
+         pNode = new BNode(next.pSrc->data);
+
+      // Setting parent values; the top keeps its own
+      if (next.pParent)
+         pNode->pParent = next.pParent;
+      pNode->count = next.pSrc->count;
+      stack.push_back({ &pNode->pLeft,  next.pSrc->pLeft,  pNode });
+      stack.push_back({ &pNode->pRight, next.pSrc->pRight, pNode });
+   }
+}
+
+/*****************************************************
+ * DELETE BINARY TREE
+ * Delete all the nodes below pThis including pThis.
+ * Each left child is rotated up until there is none,
+ * then the node is deleted and its right child is
+ * next. No recursion and no stack, so the depth of
+ * the tree does not matter.
+ ****************************************************/
+template <class T>
+void BST<T>::BNode::clear(BNode * & pThis)
+{
+   BNode * p = pThis;
+   while (p)
+   {
+      if (p->pLeft)
+      {
+         BNode * pLeft = p->pLeft;
+         p->pLeft = pLeft->pRight;
+         pLeft->pRight = p;
+         p = pLeft;
+      }
+      else
+      {
+         BNode * pRight = p->pRight;
+         delete p;
+         p = pRight;
+      }
+   }
+   pThis = nullptr;
+}
+
+} // namespace custom
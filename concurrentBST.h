@@ -0,0 +1,409 @@
+/***********************************************************************
+ * Header:
+ *    CONCURRENT BST
+ * Summary:
+ *    A binary search tree that any number of threads may use at once.
+ *    find never takes a lock or writes to shared memory; insert and
+ *    erase are lock-free and linearizable. Unlinked nodes are freed
+ *    through epoch-based reclamation.
+ *
+ *    This will contain the class definition of:
+ *        ConcurrentBST        : A lock-free set in the style of
+ *                               Natarajan and Mittal (PPoPP 2014)
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "epoch.h"    // for EpochManager
+#include <atomic>     // for std::atomic
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uintptr_t
+#include <utility>    // for std::swap
+#include <vector>     // for walking unlinked nodes
+
+namespace custom
+{
+
+/*****************************************************************
+ * CONCURRENT BINARY SEARCH TREE
+ * An external tree: values live in the leaves, and the internal
+ * nodes only route searches. An internal node holds a copy of the
+ * smallest value in its right subtree, so values less than it go left.
+ *
+ * Erasing a leaf takes two steps, each a single compare-and-swap:
+ *    1. flag the edge into the leaf, which makes the erase official
+ *    2. tag the edge to its sibling (freezing it), then swing the
+ *       edge above the parent straight to the sibling
+ * Any thread that runs into a flagged or tagged edge finishes step 2
+ * on the eraser's behalf, so no thread ever waits on another.
+ *
+ * Three sentinel keys, larger than any real value, keep the top of
+ * the tree from ever changing shape:
+ *
+ *               R(inf2)
+ *          +------+------+
+ *        S(inf1)       [inf2]
+ *     +----+----+
+ *   [inf0]    [inf1]
+ *****************************************************************/
+template <typename T>
+class ConcurrentBST
+{
+public:
+   //
+   // Construct
+   //
+
+   ConcurrentBST(size_t batchSize = 64, size_t maxPending = 64 * 64);
+   ConcurrentBST(const ConcurrentBST & rhs) = delete;
+   ConcurrentBST & operator = (const ConcurrentBST & rhs) = delete;
+   ~ConcurrentBST();
+
+   //
+   // Access: no locks, no writes
+   //
+
+   bool find(const T & t) const;
+
+   //
+   // Insert and Remove: lock-free. Values are unique.
+   //
+
+   bool insert(const T & t);
+   bool erase(const T & t);
+
+   //
+   // Status: exact when no other thread is changing the tree
+   //
+
+   bool   empty() const noexcept { return size() == 0; }
+   size_t size()  const noexcept { return numElements.load(std::memory_order_relaxed); }
+
+   //
+   // Memory: nodes unlinked by erase but not yet safe to free
+   //
+
+   size_t retiredCount() const noexcept { return epochs.pendingCount(); }
+   size_t retiredBytes() const noexcept { return epochs.pendingBytes(); }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   class CNode;
+
+   // the two low bits of an edge mark it
+   static const uintptr_t FLAG = 1;   // the leaf at the end is being erased
+   static const uintptr_t TAG  = 2;   // the edge is frozen and must not change
+   static CNode * address(uintptr_t edge) { return reinterpret_cast<CNode *>(edge & ~(FLAG | TAG)); }
+   static uintptr_t edge(CNode * p)       { return reinterpret_cast<uintptr_t>(p); }
+
+   // what a descent saw on its way to a leaf
+   struct SeekRecord
+   {
+      CNode * pAncestor;      // last node reached over an untagged edge...
+      CNode * pSuccessor;     // ...and its child on the path
+      CNode * pParent;        // parent of the leaf
+      CNode * pLeaf;          // where the search ended
+   };
+
+   void seek(const T & t, SeekRecord & record) const;
+   bool cleanup(const T & t, const SeekRecord & record);
+   void retire(CNode * pSuccessor, CNode * pKeep);
+
+   CNode * pR;                        // root sentinel, inf2
+   CNode * pS;                        // second sentinel, inf1
+   std::atomic<size_t> numElements;   // number of values in the tree
+   mutable EpochManager epochs;       // frees unlinked nodes once no reader can see them
+};
+
+/*****************************************************************
+ * CONCURRENT NODE
+ * A leaf when both children are null, otherwise a routing node
+ *****************************************************************/
+template <typename T>
+class ConcurrentBST <T> :: CNode
+{
+public:
+   CNode(const T & t, int infinity = 0) : key(t), inf(infinity), left(0), right(0) {}
+
+   // does t belong to the left of this node?
+   bool isGreater(const T & t) const { return inf || t < key; }
+
+   // is this the leaf holding t?
+   bool holds(const T & t) const { return !inf && t == key; }
+
+   // the larger of two keys, for a new routing node
+   bool isLessThan(const CNode & rhs) const
+   {
+      if (inf || rhs.inf)
+         return inf < rhs.inf;
+      return key < rhs.key;
+   }
+
+   const T key;                       // value, or a copy for routing
+   const int inf;                     // 0 for a real key, else which infinity
+   std::atomic<uintptr_t> left;       // left child with FLAG and TAG bits
+   std::atomic<uintptr_t> right;      // right child with FLAG and TAG bits
+};
+
+/*********************************************
+ * CONCURRENT BST :: CONSTRUCTOR
+ * Build the sentinel skeleton
+ ********************************************/
+template <typename T>
+ConcurrentBST <T> :: ConcurrentBST(size_t batchSize, size_t maxPending) :
+   numElements(0),
+   epochs(batchSize, maxPending)
+{
+   pR = new CNode(T(), 3);
+   pS = new CNode(T(), 2);
+   pR->left.store(edge(pS));
+   pR->right.store(edge(new CNode(T(), 3)));
+   pS->left.store(edge(new CNode(T(), 1)));
+   pS->right.store(edge(new CNode(T(), 2)));
+}
+
+/*********************************************
+ * CONCURRENT BST :: DESTRUCTOR
+ * No other thread may be using the tree now
+ ********************************************/
+template <typename T>
+ConcurrentBST <T> :: ~ConcurrentBST()
+{
+   std::vector<CNode *> doomed(1, pR);
+   while (!doomed.empty())
+   {
+      CNode * p = doomed.back();
+      doomed.pop_back();
+      if (CNode * pLeft = address(p->left.load(std::memory_order_relaxed)))
+         doomed.push_back(pLeft);
+      if (CNode * pRight = address(p->right.load(std::memory_order_relaxed)))
+         doomed.push_back(pRight);
+      delete p;
+   }
+   // epochs frees whatever is still retired
+}
+
+/*********************************************
+ * CONCURRENT BST :: SEEK
+ * Walk from the sentinels to the leaf where t is or
+ * would be, remembering the deepest point above any
+ * frozen (tagged) edges for cleanup to splice at.
+ ********************************************/
+template <typename T>
+void ConcurrentBST <T> :: seek(const T & t, SeekRecord & record) const
+{
+   record.pAncestor  = pR;
+   record.pSuccessor = pS;
+   record.pParent    = pS;
+   record.pLeaf      = address(pS->left.load(std::memory_order_acquire));
+
+   uintptr_t parentField  = pS->left.load(std::memory_order_acquire);
+   uintptr_t currentField = record.pLeaf->left.load(std::memory_order_acquire);
+   CNode * pCurrent = address(currentField);
+
+   while (pCurrent)
+   {
+      // only move the splice point down over an untagged edge
+      if (!(parentField & TAG))
+      {
+         record.pAncestor  = record.pParent;
+         record.pSuccessor = record.pLeaf;
+      }
+      record.pParent = record.pLeaf;
+      record.pLeaf   = pCurrent;
+
+      parentField  = currentField;
+      currentField = pCurrent->isGreater(t) ? pCurrent->left.load(std::memory_order_acquire)
+                                            : pCurrent->right.load(std::memory_order_acquire);
+      pCurrent = address(currentField);
+   }
+}
+
+/*********************************************
+ * CONCURRENT BST :: FIND
+ * Is t in the tree? A plain descent with no writes.
+ ********************************************/
+template <typename T>
+bool ConcurrentBST <T> :: find(const T & t) const
+{
+   EpochManager::Guard guard = epochs.pin();
+   const CNode * p = address(pS->left.load(std::memory_order_acquire));
+   while (true)
+   {
+      uintptr_t child = p->isGreater(t) ? p->left.load(std::memory_order_acquire)
+                                        : p->right.load(std::memory_order_acquire);
+      if (!address(child))
+         return p->holds(t);
+      p = address(child);
+   }
+}
+
+/*********************************************
+ * CONCURRENT BST :: INSERT
+ * Replace the leaf where t belongs with a routing node
+ * over that leaf and a new leaf for t
+ ********************************************/
+template <typename T>
+bool ConcurrentBST <T> :: insert(const T & t)
+{
+   EpochManager::Guard guard = epochs.pin();
+   SeekRecord record;
+   CNode * pNewLeaf = nullptr;
+   CNode * pNewInternal = nullptr;
+
+   while (true)
+   {
+      seek(t, record);
+      CNode * pLeaf = record.pLeaf;
+      if (pLeaf->holds(t))
+      {
+         delete pNewLeaf;
+         delete pNewInternal;
+         return false;
+      }
+
+      // build the replacement: the larger key routes, smaller goes left
+      if (!pNewLeaf)
+         pNewLeaf = new CNode(t);
+      delete pNewInternal;
+      if (pNewLeaf->isLessThan(*pLeaf))
+      {
+         pNewInternal = new CNode(pLeaf->key, pLeaf->inf);
+         pNewInternal->left.store(edge(pNewLeaf), std::memory_order_relaxed);
+         pNewInternal->right.store(edge(pLeaf), std::memory_order_relaxed);
+      }
+      else
+      {
+         pNewInternal = new CNode(t);
+         pNewInternal->left.store(edge(pLeaf), std::memory_order_relaxed);
+         pNewInternal->right.store(edge(pNewLeaf), std::memory_order_relaxed);
+      }
+
+      std::atomic<uintptr_t> & child = record.pParent->isGreater(t) ? record.pParent->left
+                                                                     : record.pParent->right;
+      uintptr_t expected = edge(pLeaf);
+      if (child.compare_exchange_strong(expected, edge(pNewInternal),
+                                        std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+         numElements.fetch_add(1, std::memory_order_relaxed);
+         return true;
+      }
+
+      // the edge changed: if an erase has it, help that erase along
+      if (address(expected) == pLeaf && (expected & (FLAG | TAG)))
+         cleanup(t, record);
+   }
+}
+
+/*********************************************
+ * CONCURRENT BST :: ERASE
+ * Flag the edge into t's leaf (the linearization point),
+ * then splice the leaf and its parent out of the tree
+ ********************************************/
+template <typename T>
+bool ConcurrentBST <T> :: erase(const T & t)
+{
+   EpochManager::Guard guard = epochs.pin();
+   SeekRecord record;
+   CNode * pLeaf = nullptr;
+   bool fInjected = false;
+
+   while (true)
+   {
+      seek(t, record);
+      std::atomic<uintptr_t> & child = record.pParent->isGreater(t) ? record.pParent->left
+                                                                     : record.pParent->right;
+
+      if (!fInjected)
+      {
+         pLeaf = record.pLeaf;
+         if (!pLeaf->holds(t))
+            return false;
+
+         uintptr_t expected = edge(pLeaf);
+         if (child.compare_exchange_strong(expected, edge(pLeaf) | FLAG,
+                                           std::memory_order_acq_rel, std::memory_order_acquire))
+         {
+            fInjected = true;
+            numElements.fetch_sub(1, std::memory_order_relaxed);
+            if (cleanup(t, record))
+               return true;
+         }
+         else if (address(expected) == pLeaf && (expected & (FLAG | TAG)))
+            cleanup(t, record);
+      }
+      else
+      {
+         // the erase is already official; make sure the leaf is gone
+         if (record.pLeaf != pLeaf || cleanup(t, record))
+            return true;
+      }
+   }
+}
+
+/*********************************************
+ * CONCURRENT BST :: CLEANUP
+ * Freeze the sibling of the flagged leaf and swing the
+ * ancestor's edge from the successor to that sibling.
+ * Returns true if this thread performed the splice.
+ ********************************************/
+template <typename T>
+bool ConcurrentBST <T> :: cleanup(const T & t, const SeekRecord & record)
+{
+   CNode * pAncestor  = record.pAncestor;
+   CNode * pSuccessor = record.pSuccessor;
+   CNode * pParent    = record.pParent;
+
+   std::atomic<uintptr_t> & successorField = pAncestor->isGreater(t) ? pAncestor->left : pAncestor->right;
+   std::atomic<uintptr_t> * pChildField   = &pParent->left;
+   std::atomic<uintptr_t> * pSiblingField = &pParent->right;
+   if (!pParent->isGreater(t))
+      std::swap(pChildField, pSiblingField);
+
+   // if the edge toward t is not the flagged one, its sibling is being erased
+   if (!(pChildField->load(std::memory_order_acquire) & FLAG))
+      pSiblingField = pChildField;
+
+   // freeze the edge we keep, then move it up, preserving its flag
+   pSiblingField->fetch_or(TAG, std::memory_order_acq_rel);
+   uintptr_t sibling = pSiblingField->load(std::memory_order_acquire);
+
+   uintptr_t expected = edge(pSuccessor);
+   if (!successorField.compare_exchange_strong(expected, sibling & ~TAG,
+                                               std::memory_order_acq_rel, std::memory_order_acquire))
+      return false;
+
+   retire(pSuccessor, address(sibling));
+   return true;
+}
+
+/*********************************************
+ * CONCURRENT BST :: RETIRE
+ * Everything below pSuccessor except the subtree we kept
+ * is now unreachable for new searches. Searches already
+ * inside may still be reading it, so the nodes go to the
+ * epoch manager rather than straight to delete.
+ ********************************************/
+template <typename T>
+void ConcurrentBST <T> :: retire(CNode * pSuccessor, CNode * pKeep)
+{
+   std::vector<CNode *> todo(1, pSuccessor);
+   while (!todo.empty())
+   {
+      CNode * p = todo.back();
+      todo.pop_back();
+      if (!p || p == pKeep)
+         continue;
+      todo.push_back(address(p->left.load(std::memory_order_acquire)));
+      todo.push_back(address(p->right.load(std::memory_order_acquire)));
+      epochs.retire(p);
+   }
+}
+
+} // namespace custom
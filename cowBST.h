@@ -0,0 +1,482 @@
+/***********************************************************************
+ * Header:
+ *    COPY-ON-WRITE BST
+ * Summary:
+ *    A binary search tree whose copies share nodes. A subtree is only
+ *    cloned when one of the trees sharing it first changes something
+ *    inside it, so copying a tree is O(1) and memory only grows with
+ *    what actually changes.
+ *
+ *    This will contain the class definition of:
+ *        CowBST                 : A class that represents a copy-on-write BST
+ *        CowBST::iterator       : An iterator through the CowBST
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <atomic>     // for std::atomic
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <initializer_list>
+#include <utility>    // for std::move
+#include <vector>     // for the iterator and release stacks
+
+namespace custom
+{
+
+/*****************************************************************
+ * COPY-ON-WRITE BINARY SEARCH TREE
+ * Same interface and shape rules as BST. Each node counts how many
+ * parents (or tree roots) point at it; a node with more than one is
+ * shared and is never written to. A change walks down from the root
+ * and clones every shared node on its path before touching it.
+ *
+ * A shared node has several parents, so its pParent cannot be right
+ * for all of them. pParent is therefore only trusted on a node that
+ * this tree owns outright, and it is refreshed on every node the
+ * modifying descent passes through. The iterator keeps its own stack.
+ *****************************************************************/
+template <typename T>
+class CowBST
+{
+public:
+   class CNode;
+   class iterator;
+
+   //
+   // Construct: copying shares the whole tree
+   //
+
+   CowBST() : root(nullptr), numElements(0) {}
+   CowBST(const CowBST &  rhs) : root(CNode::acquire(rhs.root)), numElements(rhs.numElements) {}
+   CowBST(      CowBST && rhs) : root(rhs.root), numElements(rhs.numElements)
+   {
+      rhs.root = nullptr;
+      rhs.numElements = 0;
+   }
+   CowBST(const std::initializer_list<T> & il) : root(nullptr), numElements(0) { *this = il; }
+   ~CowBST() { clear(); }
+
+   //
+   // Assign
+   //
+
+   CowBST & operator = (const CowBST &  rhs);
+   CowBST & operator = (      CowBST && rhs);
+   CowBST & operator = (const std::initializer_list<T> & il);
+   void swap(CowBST & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(root); }
+   iterator end()   const { return iterator();     }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   T *       find(const T & t);
+   size_t    count(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false);
+   bool insert(      T && t, bool keepUnique = false);
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t);
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   CNode * root;              // root node, one reference held
+   size_t numElements;        // number of elements currently in the tree
+
+private:
+   const CNode * findNode(const T & t) const;
+   CNode * own(CNode * & pLink, CNode * pParent);
+   CNode * ownPath(const T & t);
+   template <class U>
+   bool insertValue(U && t, bool keepUnique);
+};
+
+/*****************************************************************
+ * COPY-ON-WRITE NODE
+ * A node in one or more trees
+ *****************************************************************/
+template <typename T>
+class CowBST <T> :: CNode
+{
+public:
+   CNode(const T & t) : data(t),            pLeft(nullptr), pRight(nullptr), pParent(nullptr), refs(1) {}
+   CNode(T && t)      : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr), refs(1) {}
+
+   // take one more reference to p
+   static CNode * acquire(CNode * p)
+   {
+      if (p)
+         p->refs.fetch_add(1, std::memory_order_relaxed);
+      return p;
+   }
+
+   static void release(CNode * p);
+
+   // does some other tree also point here?
+   bool isShared() const { return refs.load(std::memory_order_acquire) > 1; }
+
+   T data;                  // value stored in the node
+   CNode * pLeft;           // left child - smaller
+   CNode * pRight;          // right child - larger
+   CNode * pParent;         // parent, only valid while not shared
+   std::atomic<size_t> refs;// parents and roots pointing here
+};
+
+/**********************************************************
+ * COPY-ON-WRITE BST ITERATOR
+ * In-order walk using a stack of pending ancestors
+ *********************************************************/
+template <typename T>
+class CowBST <T> :: iterator
+{
+public:
+   iterator() {}
+   explicit iterator(const CNode * pRoot) { pushLeft(pRoot); }
+
+   bool operator == (const iterator & rhs) const { return path == rhs.path; }
+   bool operator != (const iterator & rhs) const { return path != rhs.path; }
+
+   const T & operator * () const { assert(!path.empty()); return path.back()->data; }
+
+   iterator & operator ++ ()
+   {
+      assert(!path.empty());
+      const CNode * p = path.back();
+      path.pop_back();
+      pushLeft(p->pRight);
+      return *this;
+   }
+   iterator operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+private:
+   void pushLeft(const CNode * p)
+   {
+      for (; p; p = p->pLeft)
+         path.push_back(p);
+   }
+
+   std::vector<const CNode *> path;  // ancestors still to be visited
+};
+
+/*********************************************
+ * COW BST :: ASSIGNMENT OPERATOR
+ * Share the other tree
+ ********************************************/
+template <typename T>
+CowBST <T> & CowBST <T> :: operator = (const CowBST <T> & rhs)
+{
+   CNode * pOld = root;
+   root = CNode::acquire(rhs.root);
+   numElements = rhs.numElements;
+   CNode::release(pOld);
+   return *this;
+}
+
+/*********************************************
+ * COW BST :: ASSIGN-MOVE OPERATOR
+ * Take the other tree
+ ********************************************/
+template <typename T>
+CowBST <T> & CowBST <T> :: operator = (CowBST <T> && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * COW BST :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+CowBST <T> & CowBST <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * COW BST :: SWAP
+ ********************************************/
+template <typename T>
+void CowBST <T> :: swap(CowBST <T> & rhs)
+{
+   std::swap(root, rhs.root);
+   std::swap(numElements, rhs.numElements);
+}
+
+/****************************************************
+ * COW BST :: FIND NODE
+ * Read-only descent; nothing is cloned
+ ****************************************************/
+template <typename T>
+const typename CowBST <T> :: CNode * CowBST <T> :: findNode(const T & t) const
+{
+   const CNode * p = root;
+   while (p)
+   {
+      if (t == p->data)
+         return p;
+      p = (t < p->data) ? p->pLeft : p->pRight;
+   }
+   return nullptr;
+}
+
+/****************************************************
+ * COW BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * CowBST <T> :: find(const T & t) const
+{
+   const CNode * p = findNode(t);
+   return p ? &p->data : nullptr;
+}
+
+/****************************************************
+ * COW BST :: FIND
+ * The caller may write through the result, so the path
+ * to the value is made private to this tree first
+ ****************************************************/
+template <typename T>
+T * CowBST <T> :: find(const T & t)
+{
+   if (!findNode(t))
+      return nullptr;
+   return &ownPath(t)->data;
+}
+
+/****************************************************
+ * COW BST :: COUNT
+ * How many copies of t are in the tree
+ ****************************************************/
+template <typename T>
+size_t CowBST <T> :: count(const T & t) const
+{
+   // equal values always go right, so they all hang below the first one
+   size_t num = 0;
+   for (const CNode * p = findNode(t); p; p = (t < p->data) ? p->pLeft : p->pRight)
+      if (t == p->data)
+         num++;
+   return num;
+}
+
+/****************************************************
+ * COW BST :: OWN
+ * Make the node at pLink private to this tree, cloning it
+ * if it is shared. The clone takes a reference to each
+ * child, so the children become shared instead.
+ ****************************************************/
+template <typename T>
+typename CowBST <T> :: CNode * CowBST <T> :: own(CNode * & pLink, CNode * pParent)
+{
+   CNode * p = pLink;
+   assert(p);
+   if (p->isShared())
+   {
+      CNode * pClone = new CNode(p->data);
+      pClone->pLeft  = CNode::acquire(p->pLeft);
+      pClone->pRight = CNode::acquire(p->pRight);
+      CNode::release(p);
+      pLink = p = pClone;
+   }
+   p->pParent = pParent;
+   return p;
+}
+
+/****************************************************
+ * COW BST :: OWN PATH
+ * Walk down to the first node holding t, owning every
+ * node on the way. t must be in the tree.
+ ****************************************************/
+template <typename T>
+typename CowBST <T> :: CNode * CowBST <T> :: ownPath(const T & t)
+{
+   CNode * pParent = nullptr;
+   CNode ** ppLink = &root;
+   while (true)
+   {
+      assert(*ppLink);
+      CNode * p = own(*ppLink, pParent);
+      if (t == p->data)
+         return p;
+      ppLink = (t < p->data) ? &p->pLeft : &p->pRight;
+      pParent = p;
+   }
+}
+
+/*****************************************************
+ * COW BST :: INSERT
+ * Insert a node at a given location in the tree
+ ****************************************************/
+template <typename T>
+bool CowBST <T> :: insert(const T & t, bool keepUnique)
+{
+   return insertValue(t, keepUnique);
+}
+
+template <typename T>
+bool CowBST <T> :: insert(T && t, bool keepUnique)
+{
+   return insertValue(std::move(t), keepUnique);
+}
+
+/*****************************************************
+ * COW BST :: INSERT VALUE
+ * Own the path down to the new leaf, then hang it there
+ ****************************************************/
+template <typename T>
+template <class U>
+bool CowBST <T> :: insertValue(U && t, bool keepUnique)
+{
+   if (keepUnique && findNode(t))
+      return false;
+
+   CNode * pParent = nullptr;
+   CNode ** ppLink = &root;
+   while (*ppLink)
+   {
+      pParent = own(*ppLink, pParent);
+      ppLink = (t < pParent->data) ? &pParent->pLeft : &pParent->pRight;
+   }
+
+   *ppLink = new CNode(std::forward<U>(t));
+   (*ppLink)->pParent = pParent;
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * COW BST :: CLEAR
+ * Let go of the tree; shared nodes live on in the others
+ ****************************************************/
+template <typename T>
+void CowBST <T> :: clear() noexcept
+{
+   CNode::release(root);
+   root = nullptr;
+   numElements = 0;
+}
+
+/*************************************************
+ * COW BST :: ERASE
+ * Remove one copy of t. The path to it, and to its
+ * successor when it has two children, is owned first;
+ * the subtrees that merely move stay shared.
+ ************************************************/
+template <typename T>
+bool CowBST <T> :: erase(const T & t)
+{
+   if (!findNode(t))
+      return false;
+
+   CNode * pDelete = ownPath(t);
+   CNode * pReplace;
+
+   if (!pDelete->pLeft)
+      pReplace = pDelete->pRight;
+   else if (!pDelete->pRight)
+      pReplace = pDelete->pLeft;
+   else
+   {
+      // own the path to the successor, the left-most of the right subtree
+      CNode * pParent = pDelete;
+      CNode ** ppLink = &pDelete->pRight;
+      while (true)
+      {
+         pParent = own(*ppLink, pParent);
+         if (!pParent->pLeft)
+            break;
+         ppLink = &pParent->pLeft;
+      }
+      pReplace = pParent;
+
+      // pull the successor out of its current spot
+      if (pReplace->pParent != pDelete)
+      {
+         pReplace->pParent->pLeft = pReplace->pRight;
+         if (pReplace->pRight && !pReplace->pRight->isShared())
+            pReplace->pRight->pParent = pReplace->pParent;
+         pReplace->pRight = pDelete->pRight;
+         pReplace->pRight->pParent = pReplace;
+      }
+      pReplace->pLeft = pDelete->pLeft;
+      if (!pReplace->pLeft->isShared())
+         pReplace->pLeft->pParent = pReplace;
+   }
+
+   // hook the replacement to the parent of the deleted node
+   if (pReplace && !pReplace->isShared())
+      pReplace->pParent = pDelete->pParent;
+   if (!pDelete->pParent)
+      root = pReplace;
+   else if (pDelete->pParent->pLeft == pDelete)
+      pDelete->pParent->pLeft = pReplace;
+   else
+      pDelete->pParent->pRight = pReplace;
+
+   // the children now belong to pReplace, so free only the node itself
+   pDelete->pLeft = pDelete->pRight = nullptr;
+   CNode::release(pDelete);
+   numElements--;
+   return true;
+}
+
+/*****************************************************
+ * COW NODE :: RELEASE
+ * Drop one reference to p, freeing whatever is no longer
+ * reachable from any tree
+ ****************************************************/
+template <typename T>
+void CowBST <T> :: CNode :: release(CNode * p)
+{
+   std::vector<CNode *> doomed;
+   while (p)
+   {
+      if (p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+         if (p->pLeft)
+            doomed.push_back(p->pLeft);
+         if (p->pRight)
+            doomed.push_back(p->pRight);
+         delete p;
+      }
+
+      if (doomed.empty())
+         break;
+      p = doomed.back();
+      doomed.pop_back();
+   }
+}
+
+} // namespace custom
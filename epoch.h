@@ -0,0 +1,396 @@
+/***********************************************************************
+ * Header:
+ *    EPOCH
+ * Summary:
+ *    Epoch-based memory reclamation. Lets lock-free readers keep
+ *    walking nodes that a writer has already unlinked: the writer
+ *    retires the node instead of deleting it, and the node is only
+ *    freed once every thread that could have seen it has moved on.
+ *
+ *    This will contain the class definition of:
+ *        EpochManager         : Tracks epochs and retired memory
+ *        EpochManager::Guard  : Keeps the current thread pinned
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <algorithm>  // for std::binary_search and std::remove_if
+#include <atomic>     // for std::atomic
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t
+#include <mutex>      // for the registry of live managers
+#include <thread>     // for std::this_thread::yield
+#include <utility>    // for std::pair
+#include <vector>     // for the retired batches
+
+namespace custom
+{
+
+/*****************************************************************
+ * EPOCH MANAGER
+ * There is one global epoch. A thread pins itself to the current
+ * epoch while it reads shared nodes. Memory retired during epoch e
+ * can no longer be reached by anyone pinned at e+1 or later, so once
+ * the global epoch reaches e+2 it is freed.
+ *
+ * The epoch only advances when every pinned thread has caught up
+ * with it. Each thread keeps its own retired list, cut into batches
+ * by epoch; a thread tries to advance the epoch and frees its old
+ * batches every time it has retired batchSize more pointers.
+ *
+ * Garbage is bounded: when a thread holds more than maxPending
+ * retired pointers it waits, after it unpins, for the stragglers
+ * to move on so it can free them. A thread that exits leaves its
+ * last few batches behind until the manager itself is destroyed.
+ *****************************************************************/
+class EpochManager
+{
+public:
+   class Guard;
+
+   //
+   // Construct
+   //
+
+   EpochManager(size_t batchSize = 64, size_t maxPending = 64 * 64);
+   EpochManager(const EpochManager & rhs) = delete;
+   EpochManager & operator = (const EpochManager & rhs) = delete;
+   ~EpochManager();
+
+   //
+   // Readers
+   //
+
+   Guard pin();
+
+   //
+   // Writers: hand over memory that is no longer reachable
+   //
+
+   template <class T>
+   void retire(T * p) { retire(p, [](void * pv) { delete static_cast<T *>(pv); }, sizeof(T)); }
+   void retire(void * p, void (*deleter)(void *), size_t numBytes);
+   void collect();
+
+   //
+   // Status
+   //
+
+   uint64_t epoch()        const { return globalEpoch.load(std::memory_order_acquire); }
+   size_t   pendingCount() const { return numPending.load(std::memory_order_relaxed);  }
+   size_t   pendingBytes() const { return numPendingBytes.load(std::memory_order_relaxed); }
+   size_t   freedCount()   const { return numFreed.load(std::memory_order_relaxed);    }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   // a pointer waiting to be freed
+   struct Retired
+   {
+      void * p;
+      void (*deleter)(void *);
+      size_t numBytes;
+   };
+
+   // everything one thread retired during one epoch
+   struct Batch
+   {
+      uint64_t epoch;
+      std::vector<Retired> items;
+   };
+
+   // one per thread that has used this manager
+   struct Record
+   {
+      Record() : localEpoch(IDLE), depth(0), numPending(0), pNext(nullptr) {}
+      std::atomic<uint64_t> localEpoch;  // epoch pinned at, or IDLE
+      int depth;                          // nested pins, owner only
+      std::vector<Batch> batches;         // oldest first, owner only
+      size_t numPending;                  // retired and not freed, owner only
+      Record * pNext;                     // next record in the registry
+   };
+
+   static const uint64_t IDLE = ~(uint64_t)0;
+
+   // the ids of every live manager, so thread caches can drop dead ones
+   struct Registry
+   {
+      Registry() : next(1), numDeaths(0) {}
+      std::mutex lock;
+      std::vector<uint64_t> ids;            // ascending, as they are handed out
+      uint64_t next;                        // the next id, under lock
+      std::atomic<uint64_t> numDeaths;      // managers destroyed so far
+   };
+
+   // one thread's records, by manager id
+   struct Cache
+   {
+      Cache() : numDeaths(0) {}
+      uint64_t numDeaths;                   // registry deaths when last pruned
+      std::vector<std::pair<uint64_t, Record *>> entries;
+   };
+
+   static Registry & registry()   { static Registry r;            return r;     }
+   static Cache & threadCache()   { thread_local Cache cache;     return cache; }
+   static uint64_t enlist();
+   static void prune(Cache & cache, uint64_t numDeaths);
+   Record * record();
+   bool tryAdvance();
+   void freeOld(Record * pRecord);
+   void unpin(Record * pRecord);
+
+   const uint64_t id;                   // tells managers apart in thread caches
+   const size_t batchSize;              // retires between reclamation attempts
+   const size_t maxPending;             // per-thread bound on retired pointers
+   std::atomic<uint64_t> globalEpoch;   // the current epoch
+   std::atomic<Record *> pRecords;      // every thread's record, push only
+   std::atomic<size_t> numPending;      // retired and not freed, all threads
+   std::atomic<size_t> numPendingBytes; // bytes of the above
+   std::atomic<size_t> numFreed;        // freed so far
+};
+
+/*****************************************************************
+ * EPOCH MANAGER GUARD
+ * Pins the current thread to the global epoch for its lifetime.
+ * Guards may nest; only the outermost one matters.
+ *****************************************************************/
+class EpochManager :: Guard
+{
+public:
+   Guard(EpochManager & manager, Record * p) : pManager(&manager), pRecord(p) {}
+   Guard(Guard && rhs) : pManager(rhs.pManager), pRecord(rhs.pRecord) { rhs.pRecord = nullptr; }
+   Guard(const Guard & rhs) = delete;
+   Guard & operator = (const Guard & rhs) = delete;
+   ~Guard()
+   {
+      if (pRecord)
+         pManager->unpin(pRecord);
+   }
+
+private:
+   EpochManager * pManager;
+   Record * pRecord;
+};
+
+/*********************************************
+ * EPOCH MANAGER :: CONSTRUCTOR
+ ********************************************/
+inline EpochManager :: EpochManager(size_t batchSize, size_t maxPending) :
+   id(enlist()),
+   batchSize(batchSize ? batchSize : 1),
+   maxPending(maxPending > batchSize ? maxPending : batchSize + 1),
+   globalEpoch(0),
+   pRecords(nullptr),
+   numPending(0),
+   numPendingBytes(0),
+   numFreed(0)
+{
+}
+
+/*********************************************
+ * EPOCH MANAGER :: DESTRUCTOR
+ * No thread may be pinned now, so everything goes
+ ********************************************/
+inline EpochManager :: ~EpochManager()
+{
+   Record * p = pRecords.load(std::memory_order_acquire);
+   while (p)
+   {
+      assert(p->localEpoch.load() == IDLE);
+      for (Batch & batch : p->batches)
+         for (Retired & r : batch.items)
+            r.deleter(r.p);
+      Record * pNext = p->pNext;
+      delete p;
+      p = pNext;
+   }
+
+   Registry & reg = registry();
+   std::lock_guard<std::mutex> lock(reg.lock);
+   reg.ids.erase(std::lower_bound(reg.ids.begin(), reg.ids.end(), id));
+   reg.numDeaths.fetch_add(1, std::memory_order_release);
+}
+
+/*********************************************
+ * EPOCH MANAGER :: ENLIST
+ * A fresh id, recorded as live
+ ********************************************/
+inline uint64_t EpochManager :: enlist()
+{
+   Registry & reg = registry();
+   std::lock_guard<std::mutex> lock(reg.lock);
+   reg.ids.push_back(reg.next);
+   return reg.next++;
+}
+
+/*********************************************
+ * EPOCH MANAGER :: PRUNE
+ * Drop this thread's records of managers that have
+ * died; their records went with them
+ ********************************************/
+inline void EpochManager :: prune(Cache & cache, uint64_t numDeaths)
+{
+   Registry & reg = registry();
+   std::lock_guard<std::mutex> lock(reg.lock);
+   cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(),
+      [&reg](const std::pair<uint64_t, Record *> & entry)
+      {
+         return !std::binary_search(reg.ids.begin(), reg.ids.end(), entry.first);
+      }), cache.entries.end());
+   cache.numDeaths = numDeaths;
+}
+
+/*********************************************
+ * EPOCH MANAGER :: RECORD
+ * This thread's record, registering it on first use
+ ********************************************/
+inline EpochManager :: Record * EpochManager :: record()
+{
+   // each thread caches its records by manager id, so a new manager
+   // that reuses a dead one's address is never confused with it; once
+   // any manager dies, the next call prunes the cache
+   Cache & cache = threadCache();
+   uint64_t numDeaths = registry().numDeaths.load(std::memory_order_acquire);
+   if (numDeaths != cache.numDeaths)
+      prune(cache, numDeaths);
+   for (auto & entry : cache.entries)
+      if (entry.first == id)
+         return entry.second;
+
+   Record * p = new Record;
+   Record * pHead = pRecords.load(std::memory_order_relaxed);
+   do
+      p->pNext = pHead;
+   while (!pRecords.compare_exchange_weak(pHead, p, std::memory_order_release, std::memory_order_relaxed));
+
+   cache.entries.push_back(std::make_pair(id, p));
+   return p;
+}
+
+/*********************************************
+ * EPOCH MANAGER :: PIN
+ * Announce that this thread is about to read shared nodes
+ ********************************************/
+inline EpochManager :: Guard EpochManager :: pin()
+{
+   Record * p = record();
+   if (p->depth++ == 0)
+   {
+      // publish the epoch before reading any node; the fence keeps the
+      // loads of shared nodes from moving above this store
+      p->localEpoch.store(globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+   }
+   return Guard(*this, p);
+}
+
+/*********************************************
+ * EPOCH MANAGER :: UNPIN
+ * Done reading. If too much garbage has piled up, wait
+ * here (no longer pinned) until some of it can be freed.
+ ********************************************/
+inline void EpochManager :: unpin(Record * p)
+{
+   assert(p->depth > 0);
+   if (--p->depth > 0)
+      return;
+   p->localEpoch.store(IDLE, std::memory_order_release);
+
+   while (p->numPending > maxPending)
+   {
+      tryAdvance();
+      freeOld(p);
+      if (p->numPending > maxPending)
+         std::this_thread::yield();
+   }
+}
+
+/*********************************************
+ * EPOCH MANAGER :: RETIRE
+ * p is unreachable for any thread that pins from now on
+ ********************************************/
+inline void EpochManager :: retire(void * ptr, void (*deleter)(void *), size_t numBytes)
+{
+   Record * p = record();
+   uint64_t e = globalEpoch.load(std::memory_order_acquire);
+   if (p->batches.empty() || p->batches.back().epoch != e)
+   {
+      p->batches.push_back(Batch());
+      p->batches.back().epoch = e;
+   }
+   p->batches.back().items.push_back(Retired{ ptr, deleter, numBytes });
+   p->numPending++;
+   numPending.fetch_add(1, std::memory_order_relaxed);
+   numPendingBytes.fetch_add(numBytes, std::memory_order_relaxed);
+
+   if (p->numPending % batchSize == 0)
+   {
+      tryAdvance();
+      freeOld(p);
+   }
+}
+
+/*********************************************
+ * EPOCH MANAGER :: COLLECT
+ * Free whatever this thread can right now
+ ********************************************/
+inline void EpochManager :: collect()
+{
+   tryAdvance();
+   freeOld(record());
+}
+
+/*********************************************
+ * EPOCH MANAGER :: TRY ADVANCE
+ * Move the global epoch forward if no pinned thread is
+ * still behind it
+ ********************************************/
+inline bool EpochManager :: tryAdvance()
+{
+   uint64_t e = globalEpoch.load(std::memory_order_acquire);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   for (Record * p = pRecords.load(std::memory_order_acquire); p; p = p->pNext)
+   {
+      uint64_t local = p->localEpoch.load(std::memory_order_acquire);
+      if (local != IDLE && local != e)
+         return false;
+   }
+   return globalEpoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+}
+
+/*********************************************
+ * EPOCH MANAGER :: FREE OLD
+ * Free this thread's batches that are two epochs old
+ ********************************************/
+inline void EpochManager :: freeOld(Record * p)
+{
+   uint64_t e = globalEpoch.load(std::memory_order_acquire);
+   size_t numBatches = 0;
+   size_t numItems = 0;
+   size_t numBytes = 0;
+   while (numBatches < p->batches.size() && p->batches[numBatches].epoch + 2 <= e)
+   {
+      for (Retired & r : p->batches[numBatches].items)
+      {
+         r.deleter(r.p);
+         numBytes += r.numBytes;
+      }
+      numItems += p->batches[numBatches].items.size();
+      numBatches++;
+   }
+   if (!numBatches)
+      return;
+
+   p->batches.erase(p->batches.begin(), p->batches.begin() + numBatches);
+   p->numPending -= numItems;
+   numPending.fetch_sub(numItems, std::memory_order_relaxed);
+   numPendingBytes.fetch_sub(numBytes, std::memory_order_relaxed);
+   numFreed.fetch_add(numItems, std::memory_order_relaxed);
+}
+
+} // namespace custom
@@ -0,0 +1,518 @@
+/***********************************************************************
+ * Header:
+ *    INDEXED BST
+ * Summary:
+ *    A binary search tree whose nodes all live in one vector and
+ *    point at each other with 32-bit indices instead of pointers.
+ *    Three links cost 12 bytes instead of 24, neighbouring nodes
+ *    tend to share cache lines, and because no link is an address
+ *    the whole tree can be copied, moved or written out as one
+ *    block of memory.
+ *
+ *    This will contain the class definition of:
+ *        IndexedBST             : A BST stored in a vector
+ *        IndexedBST::iterator   : An iterator through the IndexedBST
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint32_t
+#include <initializer_list>
+#include <utility>    // for std::move
+#include <vector>     // for the node storage
+
+namespace custom
+{
+
+/*****************************************************************
+ * INDEXED BST
+ * Same interface as BST, plus:
+ *    compact()             : renumber the nodes in order, no gaps
+ *    setCompactPeriod(n)   : compact by itself after every n erases
+ *
+ * An erased slot goes on a free list, threaded through its pRight
+ * link, and the next insert reuses it; its value is reset to T() so
+ * it lets go of anything it held. Searches compare exactly as BST
+ * does, and erasing a node with two children relinks its successor
+ * rather than copying data.
+ *****************************************************************/
+template <typename T>
+class IndexedBST
+{
+public:
+   class INode;
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   IndexedBST() : root(NIL), freeHead(NIL), numElements(0), numErased(0), compactPeriod(0) {}
+   IndexedBST(const IndexedBST &  rhs) = default;
+   IndexedBST(      IndexedBST && rhs) : IndexedBST() { swap(rhs); }
+   IndexedBST(const std::initializer_list<T> & il) : IndexedBST() { *this = il; }
+
+   //
+   // Assign
+   //
+
+   IndexedBST & operator = (const IndexedBST &  rhs) = default;
+   IndexedBST & operator = (      IndexedBST && rhs);
+   IndexedBST & operator = (const std::initializer_list<T> & il);
+   void swap(IndexedBST & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const;
+   iterator end()   const { return iterator(this, NIL); }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   T *       find(const T & t);
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false);
+   bool insert(      T && t, bool keepUnique = false);
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t);
+
+   //
+   // Layout
+   //
+
+   void compact();
+   void setCompactPeriod(size_t numErases) noexcept { compactPeriod = numErases; }
+
+   //
+   // Status
+   //
+
+   bool   empty()    const noexcept { return numElements == 0; }
+   size_t size()     const noexcept { return numElements;      }
+   size_t capacity() const noexcept { return nodes.size();     }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   static const uint32_t NIL = 0xffffffff;   // the null link
+
+   std::vector<INode> nodes;     // every slot, in use or free
+   uint32_t root;                // index of the root, or NIL
+   uint32_t freeHead;            // first free slot, or NIL
+   size_t numElements;           // slots in use
+   size_t numErased;             // erases since the last compaction
+   size_t compactPeriod;         // compact after this many erases, or 0
+
+private:
+   uint32_t findNode(const T & t) const;
+   uint32_t eraseSearch(const T & t) const;
+   template <class U>
+   bool     insertValue(U && t, bool keepUnique);
+   template <class U>
+   uint32_t allocate(U && t, uint32_t parent);
+   void     eraseNode(uint32_t iDelete);
+   void     replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild);
+};
+
+// the null link is compared by reference, so it needs a home
+template <typename T>
+const uint32_t IndexedBST <T> :: NIL;
+
+/*****************************************************************
+ * INDEXED BST NODE
+ * A value and three links, each an index into the vector
+ *****************************************************************/
+template <typename T>
+class IndexedBST <T> :: INode
+{
+public:
+   INode(const T & t, uint32_t parent) : data(t),            pLeft(NIL), pRight(NIL), pParent(parent) {}
+   INode(T && t,      uint32_t parent) : data(std::move(t)), pLeft(NIL), pRight(NIL), pParent(parent) {}
+
+   T data;                  // value stored in the node
+   uint32_t pLeft;          // left child - smaller
+   uint32_t pRight;         // right child - larger, or the next free slot
+   uint32_t pParent;        // parent
+};
+
+/**********************************************************
+ * INDEXED BST ITERATOR
+ * Walks the parent links, like the BST iterator. It holds
+ * an index, not an address, so it stays valid when the
+ * vector grows; compact() invalidates it.
+ *********************************************************/
+template <typename T>
+class IndexedBST <T> :: iterator
+{
+   friend class IndexedBST <T>;
+public:
+   iterator() : pTree(nullptr), i(NIL) {}
+
+   bool operator == (const iterator & rhs) const { return i == rhs.i; }
+   bool operator != (const iterator & rhs) const { return i != rhs.i; }
+
+   const T & operator * () const { assert(i != NIL); return pTree->nodes[i].data; }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   iterator(const IndexedBST * pTree, uint32_t i) : pTree(pTree), i(i) {}
+
+   const IndexedBST * pTree;     // the tree being walked
+   uint32_t i;                   // current node, or NIL at the end
+};
+
+/*********************************************
+ * INDEXED BST ITERATOR :: INCREMENT
+ * The left-most node on the right, or else the
+ * first ancestor we come up to from the left
+ ********************************************/
+template <typename T>
+typename IndexedBST <T> :: iterator & IndexedBST <T> :: iterator :: operator ++ ()
+{
+   assert(i != NIL);
+   const std::vector<INode> & nodes = pTree->nodes;
+   if (nodes[i].pRight != NIL)
+   {
+      i = nodes[i].pRight;
+      while (nodes[i].pLeft != NIL)
+         i = nodes[i].pLeft;
+      return *this;
+   }
+   uint32_t child = i;
+   i = nodes[i].pParent;
+   while (i != NIL && nodes[i].pRight == child)
+   {
+      child = i;
+      i = nodes[i].pParent;
+   }
+   return *this;
+}
+
+/*********************************************
+ * INDEXED BST :: ASSIGN-MOVE OPERATOR
+ ********************************************/
+template <typename T>
+IndexedBST <T> & IndexedBST <T> :: operator = (IndexedBST <T> && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * INDEXED BST :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+IndexedBST <T> & IndexedBST <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * INDEXED BST :: SWAP
+ ********************************************/
+template <typename T>
+void IndexedBST <T> :: swap(IndexedBST <T> & rhs)
+{
+   nodes.swap(rhs.nodes);
+   std::swap(root, rhs.root);
+   std::swap(freeHead, rhs.freeHead);
+   std::swap(numElements, rhs.numElements);
+   std::swap(numErased, rhs.numErased);
+   std::swap(compactPeriod, rhs.compactPeriod);
+}
+
+/*********************************************
+ * INDEXED BST :: BEGIN
+ * The left-most node in the tree
+ ********************************************/
+template <typename T>
+typename IndexedBST <T> :: iterator IndexedBST <T> :: begin() const
+{
+   uint32_t i = root;
+   while (i != NIL && nodes[i].pLeft != NIL)
+      i = nodes[i].pLeft;
+   return iterator(this, i);
+}
+
+/****************************************************
+ * INDEXED BST :: FIND NODE
+ * The first node matching t on the way down, NIL otherwise
+ ****************************************************/
+template <typename T>
+uint32_t IndexedBST <T> :: findNode(const T & t) const
+{
+   uint32_t i = root;
+   while (i != NIL)
+   {
+      const INode & node = nodes[i];
+      if (t == node.data)
+         return i;
+      i = (t < node.data) ? node.pLeft : node.pRight;
+   }
+   return NIL;
+}
+
+/****************************************************
+ * INDEXED BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * IndexedBST <T> :: find(const T & t) const
+{
+   uint32_t i = findNode(t);
+   return i == NIL ? nullptr : &nodes[i].data;
+}
+
+template <typename T>
+T * IndexedBST <T> :: find(const T & t)
+{
+   uint32_t i = findNode(t);
+   return i == NIL ? nullptr : &nodes[i].data;
+}
+
+/*****************************************************
+ * INDEXED BST :: INSERT
+ ****************************************************/
+template <typename T>
+bool IndexedBST <T> :: insert(const T & t, bool keepUnique)
+{
+   return insertValue(t, keepUnique);
+}
+
+template <typename T>
+bool IndexedBST <T> :: insert(T && t, bool keepUnique)
+{
+   return insertValue(std::move(t), keepUnique);
+}
+
+/*****************************************************
+ * INDEXED BST :: INSERT VALUE
+ * With keepUnique, each node is checked for equality
+ * before ordering; otherwise only operator< is used and
+ * equal values go to the right
+ ****************************************************/
+template <typename T>
+template <class U>
+bool IndexedBST <T> :: insertValue(U && t, bool keepUnique)
+{
+   uint32_t parent = NIL;
+   bool fLeft = false;
+   for (uint32_t i = root; i != NIL; i = fLeft ? nodes[i].pLeft : nodes[i].pRight)
+   {
+      if (keepUnique && t == nodes[i].data)
+         return false;
+      parent = i;
+      fLeft = t < nodes[i].data;
+   }
+
+   // allocate first: it may grow the vector, so index it afterward
+   uint32_t iNew = allocate(std::forward<U>(t), parent);
+   if (parent == NIL)
+      root = iNew;
+   else if (fLeft)
+      nodes[parent].pLeft = iNew;
+   else
+      nodes[parent].pRight = iNew;
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * INDEXED BST :: ALLOCATE
+ * A slot for a new leaf: the first free one, or a new
+ * one on the end
+ ****************************************************/
+template <typename T>
+template <class U>
+uint32_t IndexedBST <T> :: allocate(U && t, uint32_t parent)
+{
+   if (freeHead != NIL)
+   {
+      uint32_t i = freeHead;
+      INode & node = nodes[i];
+      freeHead = node.pRight;
+      node.data = std::forward<U>(t);
+      node.pLeft = node.pRight = NIL;
+      node.pParent = parent;
+      return i;
+   }
+   assert(nodes.size() < NIL);
+   nodes.emplace_back(std::forward<U>(t), parent);
+   return (uint32_t)(nodes.size() - 1);
+}
+
+/*****************************************************
+ * INDEXED BST :: CLEAR
+ * Every slot goes, not just the values
+ ****************************************************/
+template <typename T>
+void IndexedBST <T> :: clear() noexcept
+{
+   nodes.clear();
+   root = NIL;
+   freeHead = NIL;
+   numElements = 0;
+   numErased = 0;
+}
+
+/*************************************************
+ * INDEXED BST :: ERASE SEARCH
+ * Locate the node to be erased. Every node visited is
+ * checked both for ordering and for equality.
+ ************************************************/
+template <typename T>
+uint32_t IndexedBST <T> :: eraseSearch(const T & t) const
+{
+   uint32_t i = root;
+   while (i != NIL)
+   {
+      const INode & node = nodes[i];
+      bool fLess = t < node.data;
+      if (t == node.data)
+         return i;
+      i = fLess ? node.pLeft : node.pRight;
+   }
+   return NIL;
+}
+
+/*************************************************
+ * INDEXED BST :: ERASE
+ * Remove one copy of t, compacting afterward if the
+ * period has come round
+ ************************************************/
+template <typename T>
+bool IndexedBST <T> :: erase(const T & t)
+{
+   uint32_t iDelete = eraseSearch(t);
+   if (iDelete == NIL)
+      return false;
+
+   eraseNode(iDelete);
+   if (compactPeriod && ++numErased >= compactPeriod)
+      compact();
+   return true;
+}
+
+/*************************************************
+ * INDEXED BST :: REPLACE CHILD
+ * Point whatever pointed at oldChild at newChild
+ ************************************************/
+template <typename T>
+void IndexedBST <T> :: replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+{
+   if (parent == NIL)
+      root = newChild;
+   else if (nodes[parent].pLeft == oldChild)
+      nodes[parent].pLeft = newChild;
+   else
+      nodes[parent].pRight = newChild;
+   if (newChild != NIL)
+      nodes[newChild].pParent = parent;
+}
+
+/*************************************************
+ * INDEXED BST :: ERASE NODE
+ * Unhook a node and put its slot on the free list. A
+ * node with two children is replaced by its in-order
+ * successor; the links move, never the data.
+ ************************************************/
+template <typename T>
+void IndexedBST <T> :: eraseNode(uint32_t iDelete)
+{
+   INode & del = nodes[iDelete];
+   if (del.pLeft == NIL)
+      replaceChild(del.pParent, iDelete, del.pRight);
+   else if (del.pRight == NIL)
+      replaceChild(del.pParent, iDelete, del.pLeft);
+   else
+   {
+      // the successor is the left-most node of the right subtree
+      uint32_t iReplace = del.pRight;
+      while (nodes[iReplace].pLeft != NIL)
+         iReplace = nodes[iReplace].pLeft;
+
+      // pull the successor out of its current spot
+      if (nodes[iReplace].pParent != iDelete)
+      {
+         replaceChild(nodes[iReplace].pParent, iReplace, nodes[iReplace].pRight);
+         nodes[iReplace].pRight = del.pRight;
+         nodes[del.pRight].pParent = iReplace;
+      }
+      nodes[iReplace].pLeft = del.pLeft;
+      nodes[del.pLeft].pParent = iReplace;
+      replaceChild(del.pParent, iDelete, iReplace);
+   }
+
+   del.data = T();
+   del.pLeft = del.pParent = NIL;
+   del.pRight = freeHead;
+   freeHead = iDelete;
+   numElements--;
+}
+
+/*************************************************
+ * INDEXED BST :: COMPACT
+ * Move every node to the slot given by its rank, so the
+ * vector holds the values in order with no free slots.
+ * The shape of the tree does not change, only where
+ * each node sits.
+ ************************************************/
+template <typename T>
+void IndexedBST <T> :: compact()
+{
+   // old index to new index, walking the tree in order
+   std::vector<uint32_t> newIndex(nodes.size(), NIL);
+   std::vector<uint32_t> order;
+   order.reserve(numElements);
+   for (iterator it = begin(); it != end(); ++it)
+   {
+      newIndex[it.i] = (uint32_t)order.size();
+      order.push_back(it.i);
+   }
+
+   std::vector<INode> compacted;
+   compacted.reserve(numElements);
+   for (uint32_t iOld : order)
+   {
+      INode & node = nodes[iOld];
+      compacted.emplace_back(std::move(node.data), node.pParent == NIL ? NIL : newIndex[node.pParent]);
+      compacted.back().pLeft  = node.pLeft  == NIL ? NIL : newIndex[node.pLeft];
+      compacted.back().pRight = node.pRight == NIL ? NIL : newIndex[node.pRight];
+   }
+
+   root = root == NIL ? NIL : newIndex[root];
+   nodes.swap(compacted);
+   freeHead = NIL;
+   numErased = 0;
+}
+
+} // namespace custom
@@ -0,0 +1,554 @@
+/***********************************************************************
+ * Header:
+ *    LSM SET
+ * Summary:
+ *    A log-structured set for loads that are mostly writes. Writes go
+ *    into a small BST, the memtable; when it fills it is frozen into
+ *    a sorted run that never changes again, and a background thread
+ *    merges runs of similar size. A write never walks more than the
+ *    small memtable, however large the set grows.
+ *
+ *    This will contain the class definition of:
+ *        LsmSet               : A set built from a memtable and sorted runs
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"                 // the memtable
+#include "bloom.h"               // one filter per run
+#include <algorithm>             // for std::lower_bound
+#include <condition_variable>    // for std::condition_variable
+#include <cstddef>               // for size_t
+#include <functional>            // for std::hash
+#include <memory>                // for std::shared_ptr
+#include <mutex>                 // for std::mutex and std::unique_lock
+#include <thread>                // for the merging thread
+#include <utility>               // for std::move and std::pair
+#include <vector>                // for the runs
+
+namespace custom
+{
+
+/*****************************************************************
+ * LSM SET
+ * A set of unique values. Every value written lives in exactly one
+ * of three kinds of place:
+ *    memtable   : values inserted since the last freeze
+ *    tombstones : values erased since the last freeze
+ *    runs       : frozen memtables, oldest first; each a sorted
+ *                 vector of entries, some of them tombstones
+ * The newest place that mentions a value decides whether it is in
+ * the set, so find looks in the memtable, then the tombstones, then
+ * the runs newest first, skipping every run whose Bloom filter says
+ * the value is not there.
+ *
+ * Writes are blind: insert and erase never look past the memtable,
+ * so they do not report whether the value was already there.
+ *
+ * A run is in tier k when it holds between FANOUT^k and FANOUT^(k+1)
+ * memtables' worth of entries. Once FANOUT neighbouring runs share a
+ * tier they are merged into one, newest entry winning; a run that
+ * ends up in a lower tier than a newer one is merged with it, so the
+ * tiers only go down from oldest to newest. Tombstones only shadow
+ * older runs, so they are dropped when the merge reaches the oldest
+ * run. Runs never change once built, so the merging thread works on
+ * them without a lock; it only takes one to swap the merged run in.
+ * A writer that gets MAX_RUNS ahead of it waits.
+ *
+ * Every public method is safe to call from several threads.
+ *****************************************************************/
+template <class T, class Hash = std::hash<T> >
+class LsmSet
+{
+public:
+   //
+   // Construct: without a background thread, runs are merged as
+   // soon as they are frozen
+   //
+
+   LsmSet(size_t memtableCapacity = 4096, bool fBackground = true);
+   LsmSet(const LsmSet & rhs) = delete;
+   LsmSet & operator = (const LsmSet & rhs) = delete;
+   ~LsmSet();
+
+   //
+   // Iterator: f sees every value in order, under the lock, so it
+   // must not call back into the set
+   //
+
+   template <class F>
+   void forEach(F f) const;
+
+   //
+   // Access
+   //
+
+   bool find(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   void insert(const T &  t);
+   void insert(      T && t);
+
+   //
+   // Remove
+   //
+
+   void erase(const T & t);
+   void clear();
+
+   //
+   // Runs
+   //
+
+   void   flush();
+   void   waitForMerges();
+   size_t numRuns() const;
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   static const size_t FANOUT = 4;       // runs of one tier merged at once
+   static const size_t MAX_RUNS = 32;    // runs a writer may get ahead by
+
+   struct Entry
+   {
+      T data;
+      bool fTombstone;       // data was erased, shadowing older runs
+   };
+
+   struct Run
+   {
+      std::vector<Entry> entries;   // sorted, one per value
+      BloomFilter bloom;            // every value in entries
+   };
+
+   typedef std::pair<const Entry *, const Entry *> Cursor;
+
+   BST <T> memtable;                            // inserted since the last freeze
+   BST <T> tombstones;                          // erased since the last freeze
+   std::vector<std::shared_ptr<const Run> > runs;// frozen, oldest first
+   const size_t capacity;                       // writes the memtable holds
+   const bool fBackground;                      // merge on the thread, not inline
+   size_t numMerges;                            // runs built by merging
+   bool fMerging;                               // the thread holds a group of runs
+   bool fStop;                                  // the thread should finish
+   mutable std::mutex lock;                     // guards everything above
+   std::condition_variable cvWork;              // a merge may be due, or fStop
+   std::condition_variable cvIdle;              // a merge finished
+   Hash hash;
+   std::thread merger;                          // merges runs, if fBackground
+
+   size_t tier(const Run & run) const;
+
+private:
+   std::vector<Entry> memtableEntries() const;
+   void   freeze(std::unique_lock<std::mutex> & lk);
+   bool   pickMerge(size_t & iBegin, size_t & iEnd) const;
+   void   install(size_t iBegin, size_t iEnd, std::shared_ptr<const Run> pMerged);
+   void   mergeLoop();
+   static std::shared_ptr<const Run> mergeRuns(const std::vector<std::shared_ptr<const Run> > & group,
+                                               bool fDropTombstones);
+   template <class F>
+   static void merge(std::vector<Cursor> & sources, F f);
+};
+
+template <class T, class Hash>
+const size_t LsmSet <T, Hash> :: FANOUT;
+template <class T, class Hash>
+const size_t LsmSet <T, Hash> :: MAX_RUNS;
+
+/*********************************************
+ * LSM SET :: CONSTRUCTOR
+ ********************************************/
+template <class T, class Hash>
+LsmSet <T, Hash> :: LsmSet(size_t memtableCapacity, bool fBackground) :
+   capacity(memtableCapacity ? memtableCapacity : 1), fBackground(fBackground),
+   numMerges(0), fMerging(false), fStop(false)
+{
+   // sorted or monotonic writes would otherwise grow a chain, and every
+   // insert would walk the whole memtable
+   memtable.setAutoRebalance(2.0);
+   tombstones.setAutoRebalance(2.0);
+   if (fBackground)
+      merger = std::thread([this]() { mergeLoop(); });
+}
+
+/*********************************************
+ * LSM SET :: DESTRUCTOR
+ * Let the thread finish the merge it is on
+ ********************************************/
+template <class T, class Hash>
+LsmSet <T, Hash> :: ~LsmSet()
+{
+   {
+      std::unique_lock<std::mutex> lk(lock);
+      fStop = true;
+   }
+   cvWork.notify_all();
+   if (merger.joinable())
+      merger.join();
+}
+
+/*********************************************
+ * LSM SET :: FOR EACH
+ * Merge the memtable and every run, oldest to
+ * newest, and hand f the values still alive
+ ********************************************/
+template <class T, class Hash>
+template <class F>
+void LsmSet <T, Hash> :: forEach(F f) const
+{
+   std::unique_lock<std::mutex> lk(lock);
+   std::vector<Entry> entries = memtableEntries();
+   std::vector<Cursor> sources;
+   for (auto & pRun : runs)
+      sources.push_back(Cursor(pRun->entries.data(), pRun->entries.data() + pRun->entries.size()));
+   sources.push_back(Cursor(entries.data(), entries.data() + entries.size()));
+   merge(sources, [&f](const Entry & entry)
+   {
+      if (!entry.fTombstone)
+         f(entry.data);
+   });
+}
+
+/*********************************************
+ * LSM SET :: FIND
+ * The newest place that mentions t decides
+ ********************************************/
+template <class T, class Hash>
+bool LsmSet <T, Hash> :: find(const T & t) const
+{
+   std::unique_lock<std::mutex> lk(lock);
+   if (memtable.find(t))
+      return true;
+   if (tombstones.find(t))
+      return false;
+
+   size_t h = hash(t);
+   for (size_t i = runs.size(); i-- > 0;)
+   {
+      const Run & run = *runs[i];
+      if (!run.bloom.mayContain(h))
+         continue;
+      auto it = std::lower_bound(run.entries.begin(), run.entries.end(), t,
+                                 [](const Entry & entry, const T & t) { return entry.data < t; });
+      if (it != run.entries.end() && it->data == t)
+         return !it->fTombstone;
+   }
+   return false;
+}
+
+/*********************************************
+ * LSM SET :: INSERT
+ * An insert cancels an erase of the same value
+ * since the last freeze, and the other way around
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: insert(const T & t)
+{
+   std::unique_lock<std::mutex> lk(lock);
+   tombstones.erase(t);
+   memtable.insert(t, true /* keepUnique */);
+   if (memtable.size() + tombstones.size() >= capacity)
+      freeze(lk);
+}
+
+template <class T, class Hash>
+void LsmSet <T, Hash> :: insert(T && t)
+{
+   std::unique_lock<std::mutex> lk(lock);
+   tombstones.erase(t);
+   memtable.insert(std::move(t), true /* keepUnique */);
+   if (memtable.size() + tombstones.size() >= capacity)
+      freeze(lk);
+}
+
+/*********************************************
+ * LSM SET :: ERASE
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: erase(const T & t)
+{
+   std::unique_lock<std::mutex> lk(lock);
+   memtable.erase(t);
+   tombstones.insert(t, true /* keepUnique */);
+   if (memtable.size() + tombstones.size() >= capacity)
+      freeze(lk);
+}
+
+/*********************************************
+ * LSM SET :: CLEAR
+ * Wait for a merge in progress so it does not
+ * put its run back afterwards
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: clear()
+{
+   std::unique_lock<std::mutex> lk(lock);
+   cvIdle.wait(lk, [this]() { return !fMerging; });
+   memtable.clear();
+   tombstones.clear();
+   runs.clear();
+}
+
+/*********************************************
+ * LSM SET :: FLUSH
+ * Freeze the memtable now, even if it is not full
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: flush()
+{
+   std::unique_lock<std::mutex> lk(lock);
+   if (!memtable.empty() || !tombstones.empty())
+      freeze(lk);
+}
+
+/*********************************************
+ * LSM SET :: WAIT FOR MERGES
+ * Return once no tier has FANOUT runs left
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: waitForMerges()
+{
+   std::unique_lock<std::mutex> lk(lock);
+   size_t iBegin;
+   size_t iEnd;
+   cvIdle.wait(lk, [&]() { return !fMerging && !pickMerge(iBegin, iEnd); });
+}
+
+/*********************************************
+ * LSM SET :: NUM RUNS
+ ********************************************/
+template <class T, class Hash>
+size_t LsmSet <T, Hash> :: numRuns() const
+{
+   std::unique_lock<std::mutex> lk(lock);
+   return runs.size();
+}
+
+/*********************************************
+ * LSM SET :: MEMTABLE ENTRIES
+ * The two trees as one sorted list. A value is
+ * never in both, so they interleave cleanly.
+ ********************************************/
+template <class T, class Hash>
+std::vector<typename LsmSet <T, Hash> :: Entry> LsmSet <T, Hash> :: memtableEntries() const
+{
+   std::vector<Entry> entries;
+   entries.reserve(memtable.size() + tombstones.size());
+   auto itLive = memtable.begin();
+   auto itDead = tombstones.begin();
+   while (itLive != memtable.end() || itDead != tombstones.end())
+   {
+      if (itDead == tombstones.end() || (itLive != memtable.end() && *itLive < *itDead))
+         entries.push_back(Entry{ *itLive++, false });
+      else
+         entries.push_back(Entry{ *itDead++, true });
+   }
+   return entries;
+}
+
+/*********************************************
+ * LSM SET :: FREEZE
+ * Turn the memtable into the newest run. Merge
+ * right here without a thread; with one, wake it,
+ * and wait if it has fallen MAX_RUNS behind.
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: freeze(std::unique_lock<std::mutex> & lk)
+{
+   std::shared_ptr<Run> pRun = std::make_shared<Run>();
+   pRun->entries = memtableEntries();
+   pRun->bloom.clear(pRun->entries.size());
+   for (const Entry & entry : pRun->entries)
+      pRun->bloom.add(hash(entry.data));
+   memtable.clear();
+   tombstones.clear();
+   runs.push_back(pRun);
+
+   size_t iBegin;
+   size_t iEnd;
+   if (!fBackground)
+   {
+      while (pickMerge(iBegin, iEnd))
+      {
+         std::vector<std::shared_ptr<const Run> > group(runs.begin() + iBegin, runs.begin() + iEnd);
+         install(iBegin, iEnd, mergeRuns(group, iBegin == 0));
+      }
+      return;
+   }
+
+   cvWork.notify_one();
+   cvIdle.wait(lk, [&]()
+   {
+      return runs.size() < MAX_RUNS || (!fMerging && !pickMerge(iBegin, iEnd));
+   });
+}
+
+/*********************************************
+ * LSM SET :: TIER
+ * Roughly log base FANOUT of how many memtables
+ * went into the run
+ ********************************************/
+template <class T, class Hash>
+size_t LsmSet <T, Hash> :: tier(const Run & run) const
+{
+   size_t numTables = run.entries.size() / capacity;
+   size_t level = 0;
+   while (numTables >= FANOUT)
+   {
+      numTables /= FANOUT;
+      level++;
+   }
+   return level;
+}
+
+/*********************************************
+ * LSM SET :: PICK MERGE
+ * Find runs [iBegin, iEnd) to merge. A merge that
+ * drops duplicates can leave a run in a lower tier
+ * than a newer one; that pair goes first, so tiers
+ * never rise from oldest to newest and each tier's
+ * runs stay side by side. After that, the newest
+ * FANOUT or more runs that share a tier.
+ ********************************************/
+template <class T, class Hash>
+bool LsmSet <T, Hash> :: pickMerge(size_t & iBegin, size_t & iEnd) const
+{
+   for (size_t k = 1; k < runs.size(); k++)
+      if (tier(*runs[k - 1]) < tier(*runs[k]))
+      {
+         iBegin = k - 1;
+         iEnd = k + 1;
+         return true;
+      }
+
+   size_t i = runs.size();
+   while (i > 0)
+   {
+      size_t j = i - 1;
+      size_t level = tier(*runs[j]);
+      while (j > 0 && tier(*runs[j - 1]) == level)
+         j--;
+      if (i - j >= FANOUT)
+      {
+         iBegin = j;
+         iEnd = i;
+         return true;
+      }
+      i = j;
+   }
+   return false;
+}
+
+/*********************************************
+ * LSM SET :: INSTALL
+ * Put the merged run where the group was. Only
+ * freeze adds runs, and only at the end, so the
+ * group has not moved while it was merged.
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: install(size_t iBegin, size_t iEnd, std::shared_ptr<const Run> pMerged)
+{
+   runs.erase(runs.begin() + iBegin + 1, runs.begin() + iEnd);
+   if (pMerged->entries.empty())
+      runs.erase(runs.begin() + iBegin);
+   else
+      runs[iBegin] = std::move(pMerged);
+   numMerges++;
+}
+
+/*********************************************
+ * LSM SET :: MERGE LOOP
+ * The background thread: wait for a tier to fill,
+ * merge it without the lock, then swap it in
+ ********************************************/
+template <class T, class Hash>
+void LsmSet <T, Hash> :: mergeLoop()
+{
+   std::unique_lock<std::mutex> lk(lock);
+   size_t iBegin;
+   size_t iEnd;
+   for (;;)
+   {
+      cvWork.wait(lk, [&]() { return fStop || pickMerge(iBegin, iEnd); });
+      if (fStop)
+         return;
+      std::vector<std::shared_ptr<const Run> > group(runs.begin() + iBegin, runs.begin() + iEnd);
+      fMerging = true;
+      lk.unlock();
+
+      std::shared_ptr<const Run> pMerged = mergeRuns(group, iBegin == 0);
+
+      lk.lock();
+      install(iBegin, iEnd, std::move(pMerged));
+      fMerging = false;
+      cvIdle.notify_all();
+   }
+}
+
+/*********************************************
+ * LSM SET :: MERGE RUNS
+ * One run from a group of them, oldest first
+ ********************************************/
+template <class T, class Hash>
+std::shared_ptr<const typename LsmSet <T, Hash> :: Run>
+   LsmSet <T, Hash> :: mergeRuns(const std::vector<std::shared_ptr<const Run> > & group,
+                                 bool fDropTombstones)
+{
+   std::shared_ptr<Run> pRun = std::make_shared<Run>();
+   std::vector<Cursor> sources;
+   size_t numEntries = 0;
+   for (auto & pSource : group)
+   {
+      sources.push_back(Cursor(pSource->entries.data(), pSource->entries.data() + pSource->entries.size()));
+      numEntries += pSource->entries.size();
+   }
+   pRun->entries.reserve(numEntries);
+   merge(sources, [&](const Entry & entry)
+   {
+      if (!(fDropTombstones && entry.fTombstone))
+         pRun->entries.push_back(entry);
+   });
+
+   Hash hash;
+   pRun->bloom.clear(pRun->entries.size());
+   for (const Entry & entry : pRun->entries)
+      pRun->bloom.add(hash(entry.data));
+   return pRun;
+}
+
+/*********************************************
+ * LSM SET :: MERGE
+ * Call f on the smallest entry at the front of any
+ * source, then step past it everywhere. Sources go
+ * oldest first; the newest of equal entries wins.
+ ********************************************/
+template <class T, class Hash>
+template <class F>
+void LsmSet <T, Hash> :: merge(std::vector<Cursor> & sources, F f)
+{
+   for (;;)
+   {
+      const Entry * pMin = nullptr;
+      for (const Cursor & source : sources)
+         if (source.first != source.second && (!pMin || !(pMin->data < source.first->data)))
+            pMin = source.first;
+      if (!pMin)
+         return;
+
+      f(*pMin);
+      for (Cursor & source : sources)
+         if (source.first != source.second && !(pMin->data < source.first->data))
+            ++source.first;
+   }
+}
+
+} // namespace custom
@@ -0,0 +1,320 @@
+/***********************************************************************
+ * Header:
+ *    MAP
+ * Summary:
+ *    Our custom implementation of a map, layered on our BST
+ *
+ *    This will contain the class definition of:
+ *        map                 : A class that represents a key/value map
+ *        map::iterator       : An iterator through the map
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"       // the tree underneath the map
+#include <cassert>
+#include <functional>  // for std::less
+#include <stdexcept>   // for std::out_of_range
+#include <tuple>       // for std::forward_as_tuple
+#include <utility>     // for std::pair
+
+namespace custom
+{
+
+/*****************************************************************
+ * MAP
+ * A sorted collection of key/value pairs. Only the keys are ever
+ * compared, and looking up a key never builds a V.
+ *****************************************************************/
+template <typename K, typename V, typename Compare = std::less<K>>
+class map
+{
+   class Entry;
+   class KeyRef;
+   typedef typename BST <Entry> :: BNode BNode;
+
+public:
+   typedef std::pair<const K, V> value_type;
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   map() {}
+   map(const map &  rhs) : bst(rhs.bst) {}
+   map(      map && rhs) : bst(std::move(rhs.bst)) {}
+   map(const std::initializer_list<value_type> & il) { *this = il; }
+   ~map() {}
+
+   //
+   // Assign
+   //
+
+   map & operator = (const map &  rhs) { bst = rhs.bst;            return *this; }
+   map & operator = (      map && rhs) { bst = std::move(rhs.bst); return *this; }
+   map & operator = (const std::initializer_list<value_type> & il);
+   void swap(map & rhs) { bst.swap(rhs.bst); }
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(bst.begin()); }
+   iterator end()   const { return iterator(bst.end());   }
+
+   //
+   // Access
+   //
+
+   V &       operator [] (const K &  k) { return try_emplace(k).first->second;            }
+   V &       operator [] (      K && k) { return try_emplace(std::move(k)).first->second; }
+   V &       at(const K & k);
+   const V & at(const K & k) const;
+   iterator  find(const K & k) const { return iterator(bst.findNode(KeyRef(k))); }
+   size_t    count(const K & k) const { return bst.findNode(KeyRef(k)) ? 1 : 0; }
+
+   //
+   // Insert
+   //
+
+   template <class ... Args>
+   std::pair<iterator, bool> try_emplace(const K &  k, Args && ... args);
+   template <class ... Args>
+   std::pair<iterator, bool> try_emplace(      K && k, Args && ... args);
+   template <class M>
+   std::pair<iterator, bool> insert_or_assign(const K &  k, M && m);
+   template <class M>
+   std::pair<iterator, bool> insert_or_assign(      K && k, M && m);
+   std::pair<iterator, bool> insert(const value_type &  kv) { return try_emplace(kv.first, kv.second); }
+   std::pair<iterator, bool> insert(      value_type && kv) { return try_emplace(kv.first, std::move(kv.second)); }
+
+   //
+   // Remove
+   //
+
+   void   clear() noexcept { bst.clear(); }
+   size_t erase(const K & k);
+
+   //
+   // Status
+   //
+
+   bool   empty() const { return bst.empty(); }
+   size_t size()  const { return bst.size();  }
+
+private:
+   template <class KK, class ... Args>
+   std::pair<iterator, bool> emplaceKey(KK && k, Args && ... args);
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#endif
+   BST <Entry> bst;           // the tree holding the entries
+};
+
+/*****************************************************************
+ * MAP ENTRY
+ * What the BST actually stores: a key/value pair that orders
+ * itself on the key alone.
+ *****************************************************************/
+template <typename K, typename V, typename Compare>
+class map <K, V, Compare> :: Entry
+{
+public:
+   Entry(const value_type & rhs) : kv(rhs) {}
+   template <class KeyArgs, class ValueArgs>
+   Entry(std::piecewise_construct_t, KeyArgs && k, ValueArgs && v)
+      : kv(std::piecewise_construct, std::forward<KeyArgs>(k), std::forward<ValueArgs>(v)) {}
+
+   bool operator <  (const Entry & rhs) const { return Compare()(kv.first, rhs.kv.first); }
+   bool operator == (const Entry & rhs) const { return !(*this < rhs) && !(rhs < *this); }
+
+   value_type kv;
+};
+
+/*****************************************************************
+ * MAP KEY REFERENCE
+ * A bare key the BST can search with, so finding an element
+ * does not require constructing an Entry (and thus a V).
+ *****************************************************************/
+template <typename K, typename V, typename Compare>
+class map <K, V, Compare> :: KeyRef
+{
+public:
+   explicit KeyRef(const K & k) : key(k) {}
+
+   friend bool operator <  (const KeyRef & lhs, const Entry & rhs) { return Compare()(lhs.key, rhs.kv.first); }
+   friend bool operator <  (const Entry & lhs, const KeyRef & rhs) { return Compare()(lhs.kv.first, rhs.key); }
+   friend bool operator == (const KeyRef & lhs, const Entry & rhs) { return !(lhs < rhs) && !(rhs < lhs); }
+
+   const K & key;
+};
+
+/**********************************************************
+ * MAP ITERATOR
+ * Forward and reverse iterator through a map. The key must
+ * not be changed through the iterator.
+ *********************************************************/
+template <typename K, typename V, typename Compare>
+class map <K, V, Compare> :: iterator
+{
+   friend class map <K, V, Compare>;
+public:
+   // constructors and assignment
+   iterator() {}
+   iterator(const typename BST <Entry> :: iterator & rhs) : it(rhs) {}
+
+   // compare
+   bool operator == (const iterator & rhs) const { return it == rhs.it; }
+   bool operator != (const iterator & rhs) const { return it != rhs.it; }
+
+   // de-reference
+   value_type & operator *  () const { assert(it.pNode); return it.pNode->data.kv;  }
+   value_type * operator -> () const { assert(it.pNode); return &it.pNode->data.kv; }
+
+   // increment and decrement
+   iterator & operator ++ ()           { ++it; return *this; }
+   iterator   operator ++ (int) { return iterator(it++); }
+   iterator & operator -- ()           { --it; return *this; }
+   iterator   operator -- (int) { return iterator(it--); }
+
+private:
+   typename BST <Entry> :: iterator it;
+};
+
+/*****************************************************
+ * MAP :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ * Later duplicates of a key replace earlier values
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+map <K, V, Compare> & map <K, V, Compare> :: operator = (const std::initializer_list<value_type> & il)
+{
+   clear();
+   for (const value_type & kv : il)
+      insert_or_assign(kv.first, kv.second);
+   return *this;
+}
+
+/*****************************************************
+ * MAP :: AT
+ * Access a value, throwing if the key is not there
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+V & map <K, V, Compare> :: at(const K & k)
+{
+   BNode * p = bst.findNode(KeyRef(k));
+   if (!p)
+      throw std::out_of_range("invalid map<K, T> key");
+   return p->data.kv.second;
+}
+
+template <typename K, typename V, typename Compare>
+const V & map <K, V, Compare> :: at(const K & k) const
+{
+   BNode * p = bst.findNode(KeyRef(k));
+   if (!p)
+      throw std::out_of_range("invalid map<K, T> key");
+   return p->data.kv.second;
+}
+
+/*****************************************************
+ * MAP :: TRY EMPLACE
+ * Insert a value built from args unless the key is
+ * already there, in which case nothing is constructed
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+template <class ... Args>
+std::pair<typename map <K, V, Compare> :: iterator, bool>
+map <K, V, Compare> :: try_emplace(const K & k, Args && ... args)
+{
+   return emplaceKey(k, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, typename Compare>
+template <class ... Args>
+std::pair<typename map <K, V, Compare> :: iterator, bool>
+map <K, V, Compare> :: try_emplace(K && k, Args && ... args)
+{
+   return emplaceKey(std::move(k), std::forward<Args>(args)...);
+}
+
+/*****************************************************
+ * MAP :: INSERT OR ASSIGN
+ * Insert a new value or overwrite the existing one
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+template <class M>
+std::pair<typename map <K, V, Compare> :: iterator, bool>
+map <K, V, Compare> :: insert_or_assign(const K & k, M && m)
+{
+   std::pair<iterator, bool> result = emplaceKey(k, std::forward<M>(m));
+   if (!result.second)
+      result.first->second = std::forward<M>(m);
+   return result;
+}
+
+template <typename K, typename V, typename Compare>
+template <class M>
+std::pair<typename map <K, V, Compare> :: iterator, bool>
+map <K, V, Compare> :: insert_or_assign(K && k, M && m)
+{
+   std::pair<iterator, bool> result = emplaceKey(std::move(k), std::forward<M>(m));
+   if (!result.second)
+      result.first->second = std::forward<M>(m);
+   return result;
+}
+
+/*****************************************************
+ * MAP :: ERASE
+ * Remove the element with key k, returning how many
+ * elements were removed
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+size_t map <K, V, Compare> :: erase(const K & k)
+{
+   BNode * p = bst.findNode(KeyRef(k));
+   if (!p)
+      return 0;
+   bst.eraseNode(p);
+   return 1;
+}
+
+/*****************************************************
+ * MAP :: EMPLACE KEY
+ * One descent both to look for k and to find where it
+ * would go. The arguments are only touched if k is new.
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+template <class KK, class ... Args>
+std::pair<typename map <K, V, Compare> :: iterator, bool>
+map <K, V, Compare> :: emplaceKey(KK && k, Args && ... args)
+{
+   BNode * pParent;
+   bool fLeft;
+   BNode * pSame = bst.findOrParent(KeyRef(k), pParent, fLeft);
+   if (pSame)
+      return std::make_pair(iterator(typename BST <Entry> :: iterator(pSame)), false);
+
+   // the first tag selects BNode's emplace constructor, the second Entry's
+   BNode * pNew = new BNode(std::piecewise_construct,
+                            std::piecewise_construct,
+                            std::forward_as_tuple(std::forward<KK>(k)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+   bst.attach(pNew, pParent, fLeft);
+   return std::make_pair(iterator(typename BST <Entry> :: iterator(pNew)), true);
+}
+
+/*****************************************************
+ * SWAP
+ * Swap two maps
+ ****************************************************/
+template <typename K, typename V, typename Compare>
+void swap(map <K, V, Compare> & lhs, map <K, V, Compare> & rhs)
+{
+   lhs.swap(rhs);
+}
+
+} // namespace custom
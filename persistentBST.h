@@ -0,0 +1,426 @@
+/***********************************************************************
+ * Header:
+ *    PERSISTENT BST
+ * Summary:
+ *    An immutable binary search tree. Every insert and erase returns a
+ *    new version of the tree that shares all untouched subtrees with
+ *    the old one, so holding on to an old version is a free snapshot.
+ *    The tree is kept AVL balanced, so a new version costs O(log n)
+ *    new nodes whatever order the values arrive in.
+ *
+ *    This will contain the class definition of:
+ *        PersistentBST           : A class that represents an immutable BST
+ *        PersistentBST::iterator : An iterator through a version of the tree
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <atomic>     // for std::atomic
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <utility>    // for std::move and std::pair
+#include <vector>     // for the iterator, path, and release stacks
+
+namespace custom
+{
+
+/*****************************************************************
+ * PERSISTENT BINARY SEARCH TREE
+ * Nodes are never modified once they are reachable from a version.
+ * A change copies the nodes on the path from the root to the change
+ * and points the copies at the existing subtrees. Nodes are shared
+ * between versions and freed by reference counting.
+ *
+ * Each node knows its height. As the path is copied back up, any
+ * copy whose subtrees differ in height by two is rotated, and a
+ * rotation is just more copies: the nodes it would move are built
+ * afresh around the shared subtrees. The path is held on an explicit
+ * stack rather than the call stack.
+ *****************************************************************/
+template <typename T>
+class PersistentBST
+{
+public:
+   class PNode;
+   class iterator;
+
+   //
+   // Construct: copying a version is O(1)
+   //
+
+   PersistentBST() : root(nullptr), numElements(0) {}
+   PersistentBST(const PersistentBST &  rhs) : root(PNode::acquire(rhs.root)), numElements(rhs.numElements) {}
+   PersistentBST(      PersistentBST && rhs) : root(rhs.root), numElements(rhs.numElements)
+   {
+      rhs.root = nullptr;
+      rhs.numElements = 0;
+   }
+   ~PersistentBST() { PNode::release(root); }
+
+   //
+   // Assign
+   //
+
+   PersistentBST & operator = (const PersistentBST &  rhs);
+   PersistentBST & operator = (      PersistentBST && rhs);
+   void swap(PersistentBST & rhs);
+   PersistentBST snapshot() const { return *this; }
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(root); }
+   iterator end()   const { return iterator();     }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+
+   //
+   // New versions
+   //
+
+   PersistentBST insert(const T & t, bool keepUnique = false) const;
+   PersistentBST erase(const T & t) const;
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   PersistentBST(PNode * pRoot, size_t num) : root(pRoot), numElements(num) {}
+
+   PNode * root;              // root of this version, one reference held
+   size_t numElements;        // number of elements in this version
+
+private:
+   // a node on the way down, and which way the path went from it
+   typedef std::pair<const PNode *, bool> Step;
+
+   static PNode * insertPath(const PNode * p, const T & t, bool keepUnique);
+   static PNode * erasePath(const PNode * p, const T & t);
+   static PNode * copyPath(const std::vector<Step> & path, PNode * pNew);
+   static PNode * balance(const T & t, PNode * pLeft, PNode * pRight);
+};
+
+/*****************************************************************
+ * PERSISTENT NODE
+ * An immutable node. Children are owned references.
+ *****************************************************************/
+template <typename T>
+class PersistentBST <T> :: PNode
+{
+public:
+   PNode(const T & t, PNode * pL, PNode * pR) :
+      data(t), pLeft(pL), pRight(pR), refs(1),
+      height(1 + (heightOf(pL) > heightOf(pR) ? heightOf(pL) : heightOf(pR))) {}
+
+   static int heightOf(const PNode * p) { return p ? p->height : 0; }
+
+   // take one more reference to p
+   static PNode * acquire(PNode * p)
+   {
+      if (p)
+         p->refs.fetch_add(1, std::memory_order_relaxed);
+      return p;
+   }
+
+   static void release(PNode * p);
+
+   const T data;            // value stored in the node
+   PNode * const pLeft;     // left child - smaller
+   PNode * const pRight;    // right child - larger
+   std::atomic<size_t> refs;// versions and parents pointing here
+   const unsigned char height; // levels in this subtree, 1 for a leaf
+};
+
+/**********************************************************
+ * PERSISTENT BST ITERATOR
+ * Nodes have no parent pointer (a shared node has many
+ * parents), so the iterator keeps the path on a stack.
+ *********************************************************/
+template <typename T>
+class PersistentBST <T> :: iterator
+{
+public:
+   iterator() {}
+   explicit iterator(const PNode * pRoot) { pushLeft(pRoot); }
+
+   bool operator == (const iterator & rhs) const { return path == rhs.path; }
+   bool operator != (const iterator & rhs) const { return path != rhs.path; }
+
+   const T & operator * () const { assert(!path.empty()); return path.back()->data; }
+
+   iterator & operator ++ ()
+   {
+      assert(!path.empty());
+      const PNode * p = path.back();
+      path.pop_back();
+      pushLeft(p->pRight);
+      return *this;
+   }
+   iterator operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+private:
+   void pushLeft(const PNode * p)
+   {
+      for (; p; p = p->pLeft)
+         path.push_back(p);
+   }
+
+   std::vector<const PNode *> path;  // ancestors still to be visited
+};
+
+/*********************************************
+ * PERSISTENT BST :: ASSIGNMENT OPERATOR
+ * Share the other version
+ ********************************************/
+template <typename T>
+PersistentBST <T> & PersistentBST <T> :: operator = (const PersistentBST <T> & rhs)
+{
+   PNode * pOld = root;
+   root = PNode::acquire(rhs.root);
+   numElements = rhs.numElements;
+   PNode::release(pOld);
+   return *this;
+}
+
+/*********************************************
+ * PERSISTENT BST :: ASSIGN-MOVE OPERATOR
+ * Take the other version
+ ********************************************/
+template <typename T>
+PersistentBST <T> & PersistentBST <T> :: operator = (PersistentBST <T> && rhs)
+{
+   PersistentBST <T> temp(std::move(rhs));
+   swap(temp);
+   return *this;
+}
+
+/*********************************************
+ * PERSISTENT BST :: SWAP
+ * Swap two versions
+ ********************************************/
+template <typename T>
+void PersistentBST <T> :: swap(PersistentBST <T> & rhs)
+{
+   std::swap(root, rhs.root);
+   std::swap(numElements, rhs.numElements);
+}
+
+/****************************************************
+ * PERSISTENT BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * PersistentBST <T> :: find(const T & t) const
+{
+   const PNode * p = root;
+   while (p)
+   {
+      if (t == p->data)
+         return &p->data;
+      p = (t < p->data) ? p->pLeft : p->pRight;
+   }
+   return nullptr;
+}
+
+/****************************************************
+ * PERSISTENT BST :: INSERT
+ * A new version with t added. Returns this same version
+ * when keepUnique is set and t is already present.
+ ****************************************************/
+template <typename T>
+PersistentBST <T> PersistentBST <T> :: insert(const T & t, bool keepUnique) const
+{
+   PNode * pRoot = insertPath(root, t, keepUnique);
+   if (!pRoot)
+      return *this;
+   return PersistentBST <T> (pRoot, numElements + 1);
+}
+
+/****************************************************
+ * PERSISTENT BST :: ERASE
+ * A new version with one copy of t removed. Returns this
+ * same version when t is not present.
+ ****************************************************/
+template <typename T>
+PersistentBST <T> PersistentBST <T> :: erase(const T & t) const
+{
+   if (!find(t))
+      return *this;
+   return PersistentBST <T> (erasePath(root, t), numElements - 1);
+}
+
+/****************************************************
+ * PERSISTENT BST :: INSERT PATH
+ * Walk down to where t belongs, then copy the path
+ * back up with a new leaf at the bottom. Equal values
+ * go right, as in BST. Returns nullptr if keepUnique
+ * rejects t.
+ ****************************************************/
+template <typename T>
+typename PersistentBST <T> :: PNode *
+PersistentBST <T> :: insertPath(const PNode * p, const T & t, bool keepUnique)
+{
+   std::vector<Step> path;
+   for (; p; p = path.back().second ? p->pLeft : p->pRight)
+   {
+      if (keepUnique && t == p->data)
+         return nullptr;
+      path.push_back(Step(p, t < p->data));
+   }
+   return copyPath(path, new PNode(t, nullptr, nullptr));
+}
+
+/****************************************************
+ * PERSISTENT BST :: ERASE PATH
+ * Walk down to the first node holding t and splice it
+ * out. A node with two children is replaced by a copy
+ * of its in-order successor, and the successor's own
+ * path is copied without it.
+ ****************************************************/
+template <typename T>
+typename PersistentBST <T> :: PNode *
+PersistentBST <T> :: erasePath(const PNode * p, const T & t)
+{
+   std::vector<Step> path;
+   for (; !(t == p->data); p = path.back().second ? p->pLeft : p->pRight)
+   {
+      path.push_back(Step(p, t < p->data));
+      assert(path.back().second ? p->pLeft : p->pRight);
+   }
+
+   PNode * pNew;
+   if (!p->pLeft)
+      pNew = PNode::acquire(p->pRight);
+   else if (!p->pRight)
+      pNew = PNode::acquire(p->pLeft);
+   else
+   {
+      // the successor is the left-most node of the right subtree
+      std::vector<Step> spine;
+      const PNode * pMin = p->pRight;
+      for (; pMin->pLeft; pMin = pMin->pLeft)
+         spine.push_back(Step(pMin, true /* left */));
+      PNode * pRight = copyPath(spine, PNode::acquire(pMin->pRight));
+      pNew = balance(pMin->data, PNode::acquire(p->pLeft), pRight);
+   }
+   return copyPath(path, pNew);
+}
+
+/****************************************************
+ * PERSISTENT BST :: COPY PATH
+ * Copy the path from the bottom up, hanging pNew where
+ * the last step went and sharing every other subtree.
+ * Takes pNew's reference and returns the new root.
+ ****************************************************/
+template <typename T>
+typename PersistentBST <T> :: PNode *
+PersistentBST <T> :: copyPath(const std::vector<Step> & path, PNode * pNew)
+{
+   for (size_t i = path.size(); i-- > 0; )
+   {
+      const PNode * p = path[i].first;
+      if (path[i].second)
+         pNew = balance(p->data, pNew, PNode::acquire(p->pRight));
+      else
+         pNew = balance(p->data, PNode::acquire(p->pLeft), pNew);
+   }
+   return pNew;
+}
+
+/****************************************************
+ * PERSISTENT BST :: BALANCE
+ * A new node holding t over pLeft and pRight, whose
+ * references it takes. When one side is two levels
+ * taller, the node and the top of that side are built
+ * again rotated, single or double as AVL does, and the
+ * taller side's old top loses the reference given for it.
+ ****************************************************/
+template <typename T>
+typename PersistentBST <T> :: PNode *
+PersistentBST <T> :: balance(const T & t, PNode * pLeft, PNode * pRight)
+{
+   int heightLeft = PNode::heightOf(pLeft);
+   int heightRight = PNode::heightOf(pRight);
+   PNode * pTop;
+
+   if (heightLeft > heightRight + 1)
+   {
+      const PNode * pL = pLeft;
+      if (PNode::heightOf(pL->pLeft) >= PNode::heightOf(pL->pRight))
+         pTop = new PNode(pL->data, PNode::acquire(pL->pLeft),
+                          new PNode(t, PNode::acquire(pL->pRight), pRight));
+      else
+      {
+         const PNode * pLR = pL->pRight;
+         pTop = new PNode(pLR->data,
+                          new PNode(pL->data, PNode::acquire(pL->pLeft), PNode::acquire(pLR->pLeft)),
+                          new PNode(t, PNode::acquire(pLR->pRight), pRight));
+      }
+      PNode::release(pLeft);
+      return pTop;
+   }
+
+   if (heightRight > heightLeft + 1)
+   {
+      const PNode * pR = pRight;
+      if (PNode::heightOf(pR->pRight) >= PNode::heightOf(pR->pLeft))
+         pTop = new PNode(pR->data, new PNode(t, pLeft, PNode::acquire(pR->pLeft)),
+                          PNode::acquire(pR->pRight));
+      else
+      {
+         const PNode * pRL = pR->pLeft;
+         pTop = new PNode(pRL->data,
+                          new PNode(t, pLeft, PNode::acquire(pRL->pLeft)),
+                          new PNode(pR->data, PNode::acquire(pRL->pRight), PNode::acquire(pR->pRight)));
+      }
+      PNode::release(pRight);
+      return pTop;
+   }
+
+   return new PNode(t, pLeft, pRight);
+}
+
+/*****************************************************
+ * PERSISTENT NODE :: RELEASE
+ * Drop one reference to p. When the last one goes the node
+ * is freed and its children lose a reference in turn. An
+ * explicit stack keeps a long chain from blowing the call stack.
+ ****************************************************/
+template <typename T>
+void PersistentBST <T> :: PNode :: release(PNode * p)
+{
+   std::vector<PNode *> doomed;
+   while (p)
+   {
+      if (p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+         if (p->pLeft)
+            doomed.push_back(p->pLeft);
+         if (p->pRight)
+            doomed.push_back(p->pRight);
+         delete p;
+      }
+
+      if (doomed.empty())
+         break;
+      p = doomed.back();
+      doomed.pop_back();
+   }
+}
+
+} // namespace custom
@@ -0,0 +1,1063 @@
+/***********************************************************************
+ * Header:
+ *    RADIX SET
+ * Summary:
+ *    An adaptive radix tree with the same interface as BST. A key is
+ *    turned into bytes that sort the same way the key does, and each
+ *    level of the tree branches on one byte, so a search reads the key
+ *    a byte at a time instead of comparing whole keys at every level.
+ *    Inner nodes come in four sizes (4, 16, 48 and 256 children) and
+ *    grow or shrink as children come and go; a chain of nodes with only
+ *    one child is collapsed into a prefix held by the node below it.
+ *
+ *    OrderedSet<T> picks a RadixSet for keys that can be turned into
+ *    bytes (integers and std::string) and a BST for everything else.
+ *
+ *    This will contain the class definition of:
+ *        RadixKey               : How a key type is turned into bytes
+ *        RadixSet               : A set stored in an adaptive radix tree
+ *        RadixSet::iterator     : An iterator through the RadixSet
+ *        OrderedSet             : RadixSet where possible, BST otherwise
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"      // what OrderedSet falls back to
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint8_t and uint32_t
+#include <initializer_list>
+#include <string>     // for the byte-string keys
+#include <type_traits> // for std::conditional and std::is_integral
+#include <utility>    // for std::move and std::swap
+
+namespace custom
+{
+
+/*****************************************************************
+ * RADIX KEY
+ * The bytes of a key, most significant first, such that comparing
+ * them as unsigned bytes orders keys the way operator< does. A type
+ * without a specialization cannot be put in a RadixSet.
+ *****************************************************************/
+template <class T, class Enable = void>
+struct RadixKey
+{
+   static const bool fEncodable = false;
+};
+
+// integers are written big-endian, with the sign bit flipped so
+// that negative numbers come before positive ones
+template <class T>
+struct RadixKey <T, typename std::enable_if<std::is_integral<T>::value &&
+                                            !std::is_same<T, bool>::value>::type>
+{
+   static const bool fEncodable = true;
+   static size_t size(const T &) { return sizeof(T); }
+   static uint8_t at(const T & t, size_t i)
+   {
+      typedef typename std::make_unsigned<T>::type U;
+      U u = static_cast<U>(t);
+      if (std::is_signed<T>::value)
+         u ^= static_cast<U>(U(1) << (sizeof(T) * 8 - 1));
+      return static_cast<uint8_t>(u >> (8 * (sizeof(T) - 1 - i)));
+   }
+};
+
+// strings are already bytes, and std::string compares them unsigned
+template <>
+struct RadixKey <std::string>
+{
+   static const bool fEncodable = true;
+   static size_t size(const std::string & s) { return s.size(); }
+   static uint8_t at(const std::string & s, size_t i) { return static_cast<uint8_t>(s[i]); }
+};
+
+/*****************************************************************
+ * RADIX SET
+ * Same interface as BST, for keys RadixKey knows how to encode.
+ *
+ * Each inner node has a depth (how many key bytes the nodes above
+ * it have used up), a prefix of bytes every key below it shares, and
+ * then branches on the next byte. A key that ends right there, such
+ * as "ab" under a node branching on the third byte of "abc" and
+ * "abd", is held in the node's pEnd slot, which sorts before every
+ * child. A leaf sits as high as it can: it is only pushed down when
+ * a second key arrives that shares its path, so the bytes below a
+ * leaf are checked by comparing the whole key once at the end.
+ *
+ * Only the first MAX_PREFIX bytes of a prefix are kept in the node.
+ * A search skips the rest and relies on that final comparison; an
+ * insert or erase that needs them reads them from a leaf below.
+ *
+ * Equal values share a leaf and a count, like a BST in multiset mode.
+ *****************************************************************/
+template <typename T>
+class RadixSet
+{
+   typedef RadixKey<T> Key;
+public:
+   class RNode;
+   class Leaf;
+   class Inner;
+   template <int N>
+   class NodeSorted;
+   class Node48;
+   class Node256;
+   class iterator;
+   typedef NodeSorted<4>  Node4;
+   typedef NodeSorted<16> Node16;
+
+   //
+   // Construct
+   //
+
+   RadixSet() : root(nullptr), numElements(0) {}
+   RadixSet(const RadixSet &  rhs) : RadixSet() { *this = rhs; }
+   RadixSet(      RadixSet && rhs) : RadixSet() { swap(rhs); }
+   RadixSet(const std::initializer_list<T> & il) : RadixSet() { *this = il; }
+   ~RadixSet() { clear(); }
+
+   //
+   // Assign
+   //
+
+   RadixSet & operator = (const RadixSet &  rhs);
+   RadixSet & operator = (      RadixSet && rhs);
+   RadixSet & operator = (const std::initializer_list<T> & il);
+   void swap(RadixSet & rhs) noexcept;
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(root ? minLeaf(root) : nullptr); }
+   iterator end()   const { return iterator(nullptr); }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   size_t count(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false) { return insertValue(t, keepUnique); }
+   bool insert(      T && t, bool keepUnique = false) { return insertValue(std::move(t), keepUnique); }
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t, bool eraseAll = false);
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   enum NodeType : uint8_t { LEAF, NODE4, NODE16, NODE48, NODE256 };
+   static const size_t MAX_PREFIX = 8;   // prefix bytes kept in a node
+
+   RNode * root;              // a leaf, an inner node, or nullptr
+   size_t numElements;        // values, counting every copy
+
+   static RNode * nextChild(const Inner * p, int b);
+
+private:
+   Leaf *   findLeaf(const T & t) const;
+   template <class U>
+   bool     insertValue(U && t, bool keepUnique);
+   bool     addCopy(Leaf * pLeaf, bool keepUnique);
+   void     splitPrefix(Inner * p, size_t n, Leaf * pLeaf);
+   void     place(Inner * p, Leaf * pLeaf);
+   void     addChild(Inner * p, uint8_t b, RNode * pChild);
+   void     removeChild(Inner * p, uint8_t b);
+   void     compress(Inner * p);
+   void     replace(RNode * pOld, RNode * pNew);
+   Inner *  resize(Inner * p, NodeType type);
+   RNode ** slotOf(const RNode * p);
+   static size_t   prefixMatch(const Inner * p, const T & t);
+   static uint8_t  prefixByte(const Inner * p, size_t n);
+   static void     refillPrefix(Inner * p);
+   static bool     isFull(const Inner * p);
+   static RNode ** findChild(Inner * p, uint8_t b);
+   static Leaf *   minLeaf(RNode * p);
+   static Leaf *   nextLeaf(RNode * p);
+   static RNode *  clone(const RNode * p, Inner * pParent);
+   static void     destroy(RNode * p) noexcept;
+   static void     freeNode(RNode * p) noexcept;
+};
+
+template <typename T>
+const size_t RadixSet <T> :: MAX_PREFIX;
+
+/*****************************************************************
+ * RADIX SET NODE
+ * What leaves and inner nodes have in common: where they hang
+ *****************************************************************/
+template <typename T>
+class RadixSet <T> :: RNode
+{
+public:
+   RNode(uint8_t type) : type(type), keyByte(0), fEnd(false), pParent(nullptr) {}
+
+   uint8_t type;            // LEAF, NODE4, NODE16, NODE48 or NODE256
+   uint8_t keyByte;         // the byte the parent holds this under
+   bool fEnd;               // held in the parent's pEnd slot instead
+   Inner * pParent;         // parent, or nullptr at the root
+};
+
+/*****************************************************************
+ * RADIX SET LEAF
+ * A value and how many copies of it there are
+ *****************************************************************/
+template <typename T>
+class RadixSet <T> :: Leaf : public RadixSet <T> :: RNode
+{
+public:
+   Leaf(const T & t) : RNode(LEAF), data(t),            count(1) {}
+   Leaf(T && t)      : RNode(LEAF), data(std::move(t)), count(1) {}
+
+   T data;                  // value stored in the leaf
+   size_t count;            // copies of it
+};
+
+/*****************************************************************
+ * RADIX SET INNER NODE
+ * The prefix and end slot every inner node has
+ *****************************************************************/
+template <typename T>
+class RadixSet <T> :: Inner : public RadixSet <T> :: RNode
+{
+public:
+   Inner(uint8_t type) : RNode(type), numChildren(0), depth(0), prefixLen(0), pEnd(nullptr) {}
+
+   uint16_t numChildren;           // children, not counting pEnd
+   uint32_t depth;                 // key bytes used above this node
+   uint32_t prefixLen;             // bytes shared below, then a branch
+   uint8_t prefix[MAX_PREFIX];     // the first of them
+   RNode * pEnd;                   // leaf whose key ends here
+};
+
+/*****************************************************************
+ * RADIX SET NODE 4 and NODE 16
+ * Up to N children, their bytes kept in order
+ *****************************************************************/
+template <typename T>
+template <int N>
+class RadixSet <T> :: NodeSorted : public RadixSet <T> :: Inner
+{
+public:
+   NodeSorted() : Inner(N == 4 ? NODE4 : NODE16) {}
+
+   uint8_t keys[N];         // the byte of each child, ascending
+   RNode * children[N];     // the child under each of those bytes
+};
+
+/*****************************************************************
+ * RADIX SET NODE 48
+ * Up to 48 children, found through a table of all 256 bytes
+ *****************************************************************/
+template <typename T>
+class RadixSet <T> :: Node48 : public RadixSet <T> :: Inner
+{
+public:
+   Node48() : Inner(NODE48), index(), children() {}
+
+   uint8_t index[256];      // one more than the slot for each byte, or 0
+   RNode * children[48];    // the children, in no particular order
+};
+
+/*****************************************************************
+ * RADIX SET NODE 256
+ * A child for every byte
+ *****************************************************************/
+template <typename T>
+class RadixSet <T> :: Node256 : public RadixSet <T> :: Inner
+{
+public:
+   Node256() : Inner(NODE256), children() {}
+
+   RNode * children[256];   // the child under each byte, or nullptr
+};
+
+/**********************************************************
+ * RADIX SET ITERATOR
+ * Visits each leaf in key order, once for every copy
+ *********************************************************/
+template <typename T>
+class RadixSet <T> :: iterator
+{
+   friend class RadixSet <T>;
+public:
+   iterator() : pLeaf(nullptr), index(0) {}
+
+   bool operator == (const iterator & rhs) const { return pLeaf == rhs.pLeaf && index == rhs.index; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   const T & operator * () const { assert(pLeaf); return pLeaf->data; }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   iterator(Leaf * pLeaf) : pLeaf(pLeaf), index(0) {}
+
+   Leaf * pLeaf;            // current leaf, or nullptr at the end
+   size_t index;            // which copy of it
+};
+
+/*********************************************
+ * RADIX SET ITERATOR :: INCREMENT
+ ********************************************/
+template <typename T>
+typename RadixSet <T> :: iterator & RadixSet <T> :: iterator :: operator ++ ()
+{
+   assert(pLeaf);
+   if (++index < pLeaf->count)
+      return *this;
+   index = 0;
+   pLeaf = nextLeaf(pLeaf);
+   return *this;
+}
+
+/*********************************************
+ * RADIX SET :: ASSIGNMENT OPERATOR
+ ********************************************/
+template <typename T>
+RadixSet <T> & RadixSet <T> :: operator = (const RadixSet <T> & rhs)
+{
+   if (this != &rhs)
+   {
+      clear();
+      root = rhs.root ? clone(rhs.root, nullptr) : nullptr;
+      numElements = rhs.numElements;
+   }
+   return *this;
+}
+
+/*********************************************
+ * RADIX SET :: ASSIGN-MOVE OPERATOR
+ ********************************************/
+template <typename T>
+RadixSet <T> & RadixSet <T> :: operator = (RadixSet <T> && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * RADIX SET :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+RadixSet <T> & RadixSet <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * RADIX SET :: SWAP
+ ********************************************/
+template <typename T>
+void RadixSet <T> :: swap(RadixSet <T> & rhs) noexcept
+{
+   std::swap(root, rhs.root);
+   std::swap(numElements, rhs.numElements);
+}
+
+/*********************************************
+ * RADIX SET :: CLEAR
+ ********************************************/
+template <typename T>
+void RadixSet <T> :: clear() noexcept
+{
+   if (root)
+      destroy(root);
+   root = nullptr;
+   numElements = 0;
+}
+
+/****************************************************
+ * RADIX SET :: FIND LEAF
+ * Follow the bytes of t down to the one leaf that could
+ * hold it. Prefix bytes beyond MAX_PREFIX are skipped
+ * rather than checked; the comparison at the leaf
+ * catches a key that differs there.
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: Leaf * RadixSet <T> :: findLeaf(const T & t) const
+{
+   size_t len = Key::size(t);
+   RNode * p = root;
+   while (p && p->type != LEAF)
+   {
+      Inner * pInner = static_cast<Inner *>(p);
+      size_t d = pInner->depth + pInner->prefixLen;
+      if (d > len)
+         return nullptr;
+      size_t numStored = pInner->prefixLen < MAX_PREFIX ? pInner->prefixLen : MAX_PREFIX;
+      for (size_t i = 0; i < numStored; i++)
+         if (pInner->prefix[i] != Key::at(t, pInner->depth + i))
+            return nullptr;
+      if (d == len)
+         p = pInner->pEnd;
+      else
+      {
+         RNode ** pSlot = findChild(pInner, Key::at(t, d));
+         p = pSlot ? *pSlot : nullptr;
+      }
+   }
+   Leaf * pLeaf = static_cast<Leaf *>(p);
+   return pLeaf && pLeaf->data == t ? pLeaf : nullptr;
+}
+
+/****************************************************
+ * RADIX SET :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * RadixSet <T> :: find(const T & t) const
+{
+   Leaf * pLeaf = findLeaf(t);
+   return pLeaf ? &pLeaf->data : nullptr;
+}
+
+/****************************************************
+ * RADIX SET :: COUNT
+ * How many copies of t there are
+ ****************************************************/
+template <typename T>
+size_t RadixSet <T> :: count(const T & t) const
+{
+   Leaf * pLeaf = findLeaf(t);
+   return pLeaf ? pLeaf->count : 0;
+}
+
+/*****************************************************
+ * RADIX SET :: INSERT VALUE
+ * Walk down while the node's prefix matches and it has
+ * a child for the next byte. Where the walk stops there
+ * are three cases: a leaf with a different key, which
+ * becomes a Node4 holding both; a prefix that differs
+ * part way, which is split by a Node4; or a node with
+ * room for one more child.
+ ****************************************************/
+template <typename T>
+template <class U>
+bool RadixSet <T> :: insertValue(U && t, bool keepUnique)
+{
+   size_t len = Key::size(t);
+   RNode ** pSlot = &root;
+   size_t depth = 0;
+   while (*pSlot)
+   {
+      RNode * p = *pSlot;
+      if (p->type == LEAF)
+      {
+         Leaf * pOld = static_cast<Leaf *>(p);
+         if (pOld->data == t)
+            return addCopy(pOld, keepUnique);
+
+         // a Node4 takes the leaf's place, with the bytes both keys share
+         size_t lenOld = Key::size(pOld->data);
+         size_t d = depth;
+         while (d < len && d < lenOld && Key::at(t, d) == Key::at(pOld->data, d))
+            d++;
+         assert(d < len || d < lenOld);
+         Node4 * pNew = new Node4;
+         pNew->depth = static_cast<uint32_t>(depth);
+         pNew->prefixLen = static_cast<uint32_t>(d - depth);
+         for (size_t i = 0; i < pNew->prefixLen && i < MAX_PREFIX; i++)
+            pNew->prefix[i] = Key::at(t, depth + i);
+         pNew->pParent = pOld->pParent;
+         pNew->keyByte = pOld->keyByte;
+         *pSlot = pNew;
+         place(pNew, pOld);
+         place(pNew, new Leaf(std::forward<U>(t)));
+         numElements++;
+         return true;
+      }
+
+      Inner * pInner = static_cast<Inner *>(p);
+      assert(pInner->depth == depth);
+      size_t n = prefixMatch(pInner, t);
+      if (n < pInner->prefixLen)
+      {
+         splitPrefix(pInner, n, new Leaf(std::forward<U>(t)));
+         numElements++;
+         return true;
+      }
+
+      size_t d = depth + pInner->prefixLen;
+      if (d == len && pInner->pEnd)
+         return addCopy(static_cast<Leaf *>(pInner->pEnd), keepUnique);
+      RNode ** pChild = d == len ? nullptr : findChild(pInner, Key::at(t, d));
+      if (!pChild)
+      {
+         place(pInner, new Leaf(std::forward<U>(t)));
+         numElements++;
+         return true;
+      }
+      pSlot = pChild;
+      depth = d + 1;
+   }
+
+   root = new Leaf(std::forward<U>(t));
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * RADIX SET :: ADD COPY
+ * t is already in pLeaf; count it again unless told not to
+ ****************************************************/
+template <typename T>
+bool RadixSet <T> :: addCopy(Leaf * pLeaf, bool keepUnique)
+{
+   if (keepUnique)
+      return false;
+   pLeaf->count++;
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * RADIX SET :: SPLIT PREFIX
+ * pLeaf's key agrees with only the first n bytes of p's
+ * prefix. A Node4 with those n bytes takes p's place, p
+ * keeps what is left after the byte it now hangs under,
+ * and the leaf goes next to it.
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: splitPrefix(Inner * p, size_t n, Leaf * pLeaf)
+{
+   Node4 * pNew = new Node4;
+   pNew->depth = p->depth;
+   pNew->prefixLen = static_cast<uint32_t>(n);
+   for (size_t i = 0; i < n && i < MAX_PREFIX; i++)
+      pNew->prefix[i] = p->prefix[i];
+   uint8_t b = prefixByte(p, n);
+
+   replace(p, pNew);
+   p->depth += static_cast<uint32_t>(n + 1);
+   p->prefixLen -= static_cast<uint32_t>(n + 1);
+   refillPrefix(p);
+   addChild(pNew, b, p);
+   place(pNew, pLeaf);
+}
+
+/*****************************************************
+ * RADIX SET :: PLACE
+ * Hang a leaf from p: in the end slot if its key runs
+ * out here, under its next byte otherwise
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: place(Inner * p, Leaf * pLeaf)
+{
+   size_t d = p->depth + p->prefixLen;
+   if (Key::size(pLeaf->data) == d)
+   {
+      assert(p->pEnd == nullptr);
+      p->pEnd = pLeaf;
+      pLeaf->pParent = p;
+      pLeaf->keyByte = 0;
+      pLeaf->fEnd = true;
+   }
+   else
+      addChild(p, Key::at(pLeaf->data, d), pLeaf);
+}
+
+/*****************************************************
+ * RADIX SET :: ADD CHILD
+ * Hang pChild under byte b, first moving p into the
+ * next size up if it is full
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: addChild(Inner * p, uint8_t b, RNode * pChild)
+{
+   if (isFull(p))
+      p = resize(p, static_cast<NodeType>(p->type + 1));
+
+   pChild->pParent = p;
+   pChild->keyByte = b;
+   pChild->fEnd = false;
+   switch (p->type)
+   {
+      case NODE4:
+      case NODE16:
+      {
+         // the sorted nodes only differ in size, so either layout will do
+         // for the first numChildren entries
+         uint8_t * keys      = p->type == NODE4 ? static_cast<Node4 *>(p)->keys     : static_cast<Node16 *>(p)->keys;
+         RNode ** children   = p->type == NODE4 ? static_cast<Node4 *>(p)->children : static_cast<Node16 *>(p)->children;
+         size_t i = p->numChildren;
+         for (; i > 0 && keys[i - 1] > b; i--)
+         {
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+         }
+         keys[i] = b;
+         children[i] = pChild;
+         break;
+      }
+      case NODE48:
+      {
+         Node48 * pNode = static_cast<Node48 *>(p);
+         size_t slot = 0;
+         while (pNode->children[slot])
+            slot++;
+         pNode->children[slot] = pChild;
+         pNode->index[b] = static_cast<uint8_t>(slot + 1);
+         break;
+      }
+      case NODE256:
+         static_cast<Node256 *>(p)->children[b] = pChild;
+         break;
+   }
+   p->numChildren++;
+}
+
+/*****************************************************
+ * RADIX SET :: REMOVE CHILD
+ * Take the child under byte b out of p
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: removeChild(Inner * p, uint8_t b)
+{
+   switch (p->type)
+   {
+      case NODE4:
+      case NODE16:
+      {
+         uint8_t * keys      = p->type == NODE4 ? static_cast<Node4 *>(p)->keys     : static_cast<Node16 *>(p)->keys;
+         RNode ** children   = p->type == NODE4 ? static_cast<Node4 *>(p)->children : static_cast<Node16 *>(p)->children;
+         size_t i = 0;
+         while (keys[i] != b)
+            i++;
+         for (; i + 1 < p->numChildren; i++)
+         {
+            keys[i] = keys[i + 1];
+            children[i] = children[i + 1];
+         }
+         break;
+      }
+      case NODE48:
+      {
+         Node48 * pNode = static_cast<Node48 *>(p);
+         assert(pNode->index[b]);
+         pNode->children[pNode->index[b] - 1] = nullptr;
+         pNode->index[b] = 0;
+         break;
+      }
+      case NODE256:
+         static_cast<Node256 *>(p)->children[b] = nullptr;
+         break;
+   }
+   p->numChildren--;
+}
+
+/*****************************************************
+ * RADIX SET :: COMPRESS
+ * Something was just taken out of p. A node left with a
+ * single entry is replaced by it; a child inner node
+ * absorbs p's prefix and the byte between them. A node
+ * that has emptied out well below its size moves to a
+ * smaller one. The thresholds sit under the sizes it
+ * grows at, so a node does not flip back and forth.
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: compress(Inner * p)
+{
+   if (p->numChildren == 0)
+   {
+      assert(p->pEnd);
+      RNode * pOnly = p->pEnd;
+      p->pEnd = nullptr;
+      replace(p, pOnly);
+      freeNode(p);
+   }
+   else if (p->numChildren == 1 && !p->pEnd)
+   {
+      RNode * pOnly = nextChild(p, -1);
+      if (pOnly->type != LEAF)
+      {
+         Inner * pChild = static_cast<Inner *>(pOnly);
+         pChild->prefixLen += p->prefixLen + 1;
+         pChild->depth = p->depth;
+         refillPrefix(pChild);
+      }
+      replace(p, pOnly);
+      freeNode(p);
+   }
+   else if (p->type == NODE16 && p->numChildren <= 3)
+      resize(p, NODE4);
+   else if (p->type == NODE48 && p->numChildren <= 12)
+      resize(p, NODE16);
+   else if (p->type == NODE256 && p->numChildren <= 40)
+      resize(p, NODE48);
+}
+
+/*****************************************************
+ * RADIX SET :: REPLACE
+ * Put pNew where pOld hangs. pOld itself is left alone.
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: replace(RNode * pOld, RNode * pNew)
+{
+   *slotOf(pOld) = pNew;
+   pNew->pParent = pOld->pParent;
+   pNew->keyByte = pOld->keyByte;
+   pNew->fEnd    = pOld->fEnd;
+}
+
+/*****************************************************
+ * RADIX SET :: RESIZE
+ * Move p's prefix, end slot and children into a node of
+ * the given type, put that in p's place, and free p
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: Inner * RadixSet <T> :: resize(Inner * p, NodeType type)
+{
+   Inner * pNew;
+   switch (type)
+   {
+      case NODE4:  pNew = new Node4;   break;
+      case NODE16: pNew = new Node16;  break;
+      case NODE48: pNew = new Node48;  break;
+      default:     pNew = new Node256; break;
+   }
+   pNew->depth = p->depth;
+   pNew->prefixLen = p->prefixLen;
+   for (size_t i = 0; i < MAX_PREFIX; i++)
+      pNew->prefix[i] = p->prefix[i];
+   pNew->pEnd = p->pEnd;
+   if (pNew->pEnd)
+      pNew->pEnd->pParent = pNew;
+   for (RNode * pChild = nextChild(p, -1); pChild; pChild = nextChild(p, pChild->keyByte))
+      addChild(pNew, pChild->keyByte, pChild);
+
+   replace(p, pNew);
+   freeNode(p);
+   return pNew;
+}
+
+/*****************************************************
+ * RADIX SET :: SLOT OF
+ * The pointer that points at p
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: RNode ** RadixSet <T> :: slotOf(const RNode * p)
+{
+   if (!p->pParent)
+      return &root;
+   if (p->fEnd)
+      return &p->pParent->pEnd;
+   RNode ** pSlot = findChild(p->pParent, p->keyByte);
+   assert(pSlot && *pSlot == p);
+   return pSlot;
+}
+
+/*****************************************************
+ * RADIX SET :: PREFIX MATCH
+ * How many bytes of p's prefix t agrees with. Unlike a
+ * search, this checks every byte, reading the ones the
+ * node does not keep from the smallest leaf below it.
+ ****************************************************/
+template <typename T>
+size_t RadixSet <T> :: prefixMatch(const Inner * p, const T & t)
+{
+   size_t len = Key::size(t);
+   size_t n = 0;
+   while (n < p->prefixLen && p->depth + n < len &&
+          prefixByte(p, n) == Key::at(t, p->depth + n))
+      n++;
+   return n;
+}
+
+/*****************************************************
+ * RADIX SET :: PREFIX BYTE
+ * The n-th byte of p's prefix, or the byte p branches
+ * on when n is the prefix length
+ ****************************************************/
+template <typename T>
+uint8_t RadixSet <T> :: prefixByte(const Inner * p, size_t n)
+{
+   if (n < p->prefixLen && n < MAX_PREFIX)
+      return p->prefix[n];
+   const Leaf * pMin = minLeaf(const_cast<Inner *>(p));
+   return Key::at(pMin->data, p->depth + n);
+}
+
+/*****************************************************
+ * RADIX SET :: REFILL PREFIX
+ * p's depth or prefix length changed; copy the bytes it
+ * keeps from the smallest leaf below it
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: refillPrefix(Inner * p)
+{
+   const Leaf * pMin = minLeaf(p);
+   for (size_t i = 0; i < p->prefixLen && i < MAX_PREFIX; i++)
+      p->prefix[i] = Key::at(pMin->data, p->depth + i);
+}
+
+/*****************************************************
+ * RADIX SET :: IS FULL
+ * Whether another child needs a bigger node
+ ****************************************************/
+template <typename T>
+bool RadixSet <T> :: isFull(const Inner * p)
+{
+   switch (p->type)
+   {
+      case NODE4:  return p->numChildren == 4;
+      case NODE16: return p->numChildren == 16;
+      case NODE48: return p->numChildren == 48;
+      default:     return false;
+   }
+}
+
+/*****************************************************
+ * RADIX SET :: FIND CHILD
+ * The slot holding the child under byte b, or nullptr.
+ * The sorted nodes stop as soon as they pass b.
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: RNode ** RadixSet <T> :: findChild(Inner * p, uint8_t b)
+{
+   switch (p->type)
+   {
+      case NODE4:
+      case NODE16:
+      {
+         uint8_t * keys      = p->type == NODE4 ? static_cast<Node4 *>(p)->keys     : static_cast<Node16 *>(p)->keys;
+         RNode ** children   = p->type == NODE4 ? static_cast<Node4 *>(p)->children : static_cast<Node16 *>(p)->children;
+         for (size_t i = 0; i < p->numChildren && keys[i] <= b; i++)
+            if (keys[i] == b)
+               return &children[i];
+         return nullptr;
+      }
+      case NODE48:
+      {
+         Node48 * pNode = static_cast<Node48 *>(p);
+         uint8_t slot = pNode->index[b];
+         return slot ? &pNode->children[slot - 1] : nullptr;
+      }
+      default:
+      {
+         Node256 * pNode = static_cast<Node256 *>(p);
+         return pNode->children[b] ? &pNode->children[b] : nullptr;
+      }
+   }
+}
+
+/*****************************************************
+ * RADIX SET :: NEXT CHILD
+ * The child under the smallest byte greater than b, or
+ * nullptr. Pass -1 for the first child.
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: RNode * RadixSet <T> :: nextChild(const Inner * p, int b)
+{
+   switch (p->type)
+   {
+      case NODE4:
+      case NODE16:
+      {
+         const uint8_t * keys    = p->type == NODE4 ? static_cast<const Node4 *>(p)->keys     : static_cast<const Node16 *>(p)->keys;
+         RNode * const * children = p->type == NODE4 ? static_cast<const Node4 *>(p)->children : static_cast<const Node16 *>(p)->children;
+         for (size_t i = 0; i < p->numChildren; i++)
+            if (keys[i] > b)
+               return children[i];
+         return nullptr;
+      }
+      case NODE48:
+      {
+         const Node48 * pNode = static_cast<const Node48 *>(p);
+         for (int c = b + 1; c < 256; c++)
+            if (pNode->index[c])
+               return pNode->children[pNode->index[c] - 1];
+         return nullptr;
+      }
+      default:
+      {
+         const Node256 * pNode = static_cast<const Node256 *>(p);
+         for (int c = b + 1; c < 256; c++)
+            if (pNode->children[c])
+               return pNode->children[c];
+         return nullptr;
+      }
+   }
+}
+
+/*****************************************************
+ * RADIX SET :: MIN LEAF
+ * The leaf with the smallest key at or below p: an end
+ * slot sorts before every child
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: Leaf * RadixSet <T> :: minLeaf(RNode * p)
+{
+   while (p->type != LEAF)
+   {
+      Inner * pInner = static_cast<Inner *>(p);
+      p = pInner->pEnd ? pInner->pEnd : nextChild(pInner, -1);
+   }
+   return static_cast<Leaf *>(p);
+}
+
+/*****************************************************
+ * RADIX SET :: NEXT LEAF
+ * Climb until a parent has something after where we
+ * came from, then take the smallest leaf there
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: Leaf * RadixSet <T> :: nextLeaf(RNode * p)
+{
+   while (p->pParent)
+   {
+      RNode * pNext = nextChild(p->pParent, p->fEnd ? -1 : p->keyByte);
+      if (pNext)
+         return minLeaf(pNext);
+      p = p->pParent;
+   }
+   return nullptr;
+}
+
+/*****************************************************
+ * RADIX SET :: CLONE
+ * A deep copy of p and everything below it
+ ****************************************************/
+template <typename T>
+typename RadixSet <T> :: RNode * RadixSet <T> :: clone(const RNode * p, Inner * pParent)
+{
+   if (p->type == LEAF)
+   {
+      Leaf * pLeaf = new Leaf(*static_cast<const Leaf *>(p));
+      pLeaf->pParent = pParent;
+      return pLeaf;
+   }
+
+   Inner * pNew;
+   switch (p->type)
+   {
+      case NODE4:  pNew = new Node4  (*static_cast<const Node4   *>(p)); break;
+      case NODE16: pNew = new Node16 (*static_cast<const Node16  *>(p)); break;
+      case NODE48: pNew = new Node48 (*static_cast<const Node48  *>(p)); break;
+      default:     pNew = new Node256(*static_cast<const Node256 *>(p)); break;
+   }
+   pNew->pParent = pParent;
+   if (pNew->pEnd)
+      pNew->pEnd = clone(pNew->pEnd, pNew);
+   for (int b = 0; b < 256; b++)
+   {
+      RNode ** pSlot = findChild(pNew, static_cast<uint8_t>(b));
+      if (pSlot)
+         *pSlot = clone(*pSlot, pNew);
+   }
+   return pNew;
+}
+
+/*****************************************************
+ * RADIX SET :: DESTROY
+ * Free p and everything below it
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: destroy(RNode * p) noexcept
+{
+   if (p->type != LEAF)
+   {
+      Inner * pInner = static_cast<Inner *>(p);
+      if (pInner->pEnd)
+         destroy(pInner->pEnd);
+      for (RNode * pChild = nextChild(pInner, -1); pChild; )
+      {
+         RNode * pNext = nextChild(pInner, pChild->keyByte);
+         destroy(pChild);
+         pChild = pNext;
+      }
+   }
+   freeNode(p);
+}
+
+/*****************************************************
+ * RADIX SET :: FREE NODE
+ * Free p alone, as whatever kind of node it is
+ ****************************************************/
+template <typename T>
+void RadixSet <T> :: freeNode(RNode * p) noexcept
+{
+   switch (p->type)
+   {
+      case LEAF:   delete static_cast<Leaf    *>(p); break;
+      case NODE4:  delete static_cast<Node4   *>(p); break;
+      case NODE16: delete static_cast<Node16  *>(p); break;
+      case NODE48: delete static_cast<Node48  *>(p); break;
+      default:     delete static_cast<Node256 *>(p); break;
+   }
+}
+
+/****************************************************
+ * RADIX SET :: ERASE
+ * Remove one copy of t, or every copy with eraseAll.
+ * Removing the last copy takes the leaf out of its
+ * parent, which may then collapse into what is left.
+ ****************************************************/
+template <typename T>
+bool RadixSet <T> :: erase(const T & t, bool eraseAll)
+{
+   Leaf * pLeaf = findLeaf(t);
+   if (!pLeaf)
+      return false;
+   if (!eraseAll && pLeaf->count > 1)
+   {
+      pLeaf->count--;
+      numElements--;
+      return true;
+   }
+
+   numElements -= pLeaf->count;
+   Inner * pParent = pLeaf->pParent;
+   if (!pParent)
+      root = nullptr;
+   else if (pLeaf->fEnd)
+      pParent->pEnd = nullptr;
+   else
+      removeChild(pParent, pLeaf->keyByte);
+   freeNode(pLeaf);
+   if (pParent)
+      compress(pParent);
+   return true;
+}
+
+/*****************************************************************
+ * ORDERED SET
+ * A RadixSet for keys RadixKey can encode, a BST for the rest.
+ * Both have find, insert, erase, count and in-order iteration.
+ *****************************************************************/
+template <typename T>
+using OrderedSet = typename std::conditional<RadixKey<T>::fEncodable, RadixSet<T>, BST<T>>::type;
+
+} // namespace custom
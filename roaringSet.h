@@ -0,0 +1,1046 @@
+/***********************************************************************
+ * Header:
+ *    ROARING SET
+ * Summary:
+ *    An ordered set of unsigned integers stored the way a roaring
+ *    bitmap stores them. Values are grouped by their high bits; the
+ *    low 16 bits of each group go in a container that takes whichever
+ *    of three forms is smallest: a sorted array of up to 4096 values,
+ *    a bitmap of all 65536, or a list of runs. A dense range of IDs
+ *    costs a bit or two per value instead of a 40-byte tree node.
+ *
+ *    Union and intersection work a container at a time; two bitmaps
+ *    are combined 128 bits at a time with SSE2 where it is available.
+ *
+ *    For a handful of scattered values a BST or RadixSet is still the
+ *    better fit: every group pays for a container of its own.
+ *
+ *    This will contain the class definition of:
+ *        RoaringSet             : An ordered set of uint32_t or uint64_t
+ *        RoaringSet::Container  : The low 16 bits of one group
+ *        RoaringSet::iterator   : An iterator through the RoaringSet
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <algorithm>  // for std::lower_bound
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint16_t, uint32_t and uint64_t
+#include <initializer_list>
+#include <type_traits> // for std::is_same
+#include <utility>    // for std::move and std::swap
+#include <vector>     // for the containers and their contents
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h> // for the 128-bit bitmap operations
+#define ROARING_SSE2
+#endif
+
+namespace custom
+{
+
+/*****************************************************************
+ * ROARING SET
+ * Like a BST with keepUnique always on: a value is either there
+ * or not. There is no node to point into, so find() returns an
+ * iterator (end() when missing) rather than a pointer.
+ *
+ * The containers sit in a vector sorted by their high bits, with
+ * the high bits themselves in a vector of their own so a lookup
+ * binary-searches a tight array. An array container turns into a
+ * bitmap when it passes 4096 values and back when it drops to
+ * 4096. Runs are only chosen by runOptimize(); after that a run
+ * container goes back to an array or bitmap by itself if its runs
+ * break up enough to cost more.
+ *****************************************************************/
+template <typename T>
+class RoaringSet
+{
+   static_assert(std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value,
+                 "RoaringSet holds uint32_t or uint64_t");
+public:
+   class Container;
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   RoaringSet() : numElements(0) {}
+   RoaringSet(const RoaringSet &  rhs) = default;
+   RoaringSet(      RoaringSet && rhs) : RoaringSet() { swap(rhs); }
+   RoaringSet(const std::initializer_list<T> & il) : RoaringSet() { *this = il; }
+
+   //
+   // Assign
+   //
+
+   RoaringSet & operator = (const RoaringSet &  rhs) = default;
+   RoaringSet & operator = (      RoaringSet && rhs);
+   RoaringSet & operator = (const std::initializer_list<T> & il);
+   void swap(RoaringSet & rhs) noexcept;
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(this, 0, 0); }
+   iterator end()   const { return iterator(this, containers.size()); }
+
+   //
+   // Access
+   //
+
+   iterator find(const T & t) const;
+   size_t count(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T & t);
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t);
+
+   //
+   // Set operations
+   //
+
+   RoaringSet & operator |= (const RoaringSet & rhs);
+   RoaringSet & operator &= (const RoaringSet & rhs);
+   friend RoaringSet operator | (RoaringSet lhs, const RoaringSet & rhs) { return lhs |= rhs; }
+   friend RoaringSet operator & (RoaringSet lhs, const RoaringSet & rhs) { return lhs &= rhs; }
+
+   //
+   // Layout
+   //
+
+   void runOptimize();
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+   size_t bytes() const noexcept;
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   std::vector<T> highs;                // value >> 16 for each container, ascending
+   std::vector<Container> containers;   // the low 16 bits, one container per high
+   size_t numElements;                  // values in every container
+
+private:
+   size_t lowerBound(T high) const;
+};
+
+/*****************************************************************
+ * ROARING SET CONTAINER
+ * A set of 16-bit values in one of three forms:
+ *    ARRAY  : values holds them sorted, at most MAX_ARRAY
+ *    BITMAP : words holds one bit for each of the 65536
+ *    RUN    : values holds pairs of (start, length - 1)
+ *****************************************************************/
+template <typename T>
+class RoaringSet <T> :: Container
+{
+public:
+   enum Kind : uint8_t { ARRAY, BITMAP, RUN };
+   static const uint32_t MAX_ARRAY = 4096;   // an array this big is a bitmap's size
+   static const size_t   WORDS     = 1024;   // 64-bit words in a bitmap
+
+   Container() : kind(ARRAY), card(0) {}
+
+   bool contains(uint16_t v) const;
+   bool add(uint16_t v);
+   bool remove(uint16_t v);
+   bool nextFrom(uint32_t low, size_t & pos, uint32_t & value) const;
+   template <class F>
+   void forEach(F f) const;
+
+   void   toArray();
+   void   toBitmap();
+   void   toRuns();
+   void   toPlain()  { if (card > MAX_ARRAY) toBitmap(); else toArray(); }
+   void   optimize();
+   size_t numRuns() const;
+   size_t bytes() const { return values.capacity() * sizeof(uint16_t) + words.capacity() * sizeof(uint64_t); }
+
+   static Container unite    (const Container & lhs, const Container & rhs);
+   static Container intersect(const Container & lhs, const Container & rhs);
+
+   Kind kind;                       // which form it is in
+   uint32_t card;                   // how many values it holds
+   std::vector<uint16_t> values;    // ARRAY values or RUN pairs
+   std::vector<uint64_t> words;     // BITMAP bits
+
+private:
+   size_t findRun(uint16_t v) const;
+   void   checkRuns();
+   static uint32_t orWords (const uint64_t * pLhs, const uint64_t * pRhs, uint64_t * pOut);
+   static uint32_t andWords(const uint64_t * pLhs, const uint64_t * pRhs, uint64_t * pOut);
+   static uint32_t popCount(uint64_t w);
+   static uint32_t lowestBit(uint64_t w);
+};
+
+template <typename T>
+const uint32_t RoaringSet <T> :: Container :: MAX_ARRAY;
+template <typename T>
+const size_t RoaringSet <T> :: Container :: WORDS;
+
+/**********************************************************
+ * ROARING SET ITERATOR
+ * A container and a position in it. The value is kept
+ * here since no container holds it as a T.
+ *********************************************************/
+template <typename T>
+class RoaringSet <T> :: iterator
+{
+   friend class RoaringSet <T>;
+public:
+   iterator() : pSet(nullptr), iContainer(0), pos(0), low(0), value(0) {}
+
+   bool operator == (const iterator & rhs) const { return iContainer == rhs.iContainer && low == rhs.low; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   const T & operator * () const { assert(pSet && iContainer < pSet->containers.size()); return value; }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   iterator(const RoaringSet * pSet, size_t iContainer) :
+      pSet(pSet), iContainer(iContainer), pos(0), low(0), value(0) {}
+   iterator(const RoaringSet * pSet, size_t iContainer, uint32_t from);
+   void settle(uint32_t from);
+
+   const RoaringSet * pSet;   // the set being walked
+   size_t iContainer;         // current container, or containers.size() at the end
+   size_t pos;                // where in the container's values
+   uint32_t low;              // the low 16 bits of the current value
+   T value;                   // the current value
+};
+
+/*********************************************
+ * ROARING SET ITERATOR :: CONSTRUCTOR
+ * The first value at or after from in container
+ * iContainer, moving on to later containers
+ ********************************************/
+template <typename T>
+RoaringSet <T> :: iterator :: iterator(const RoaringSet * pSet, size_t iContainer, uint32_t from) :
+   pSet(pSet), iContainer(iContainer), pos(0), low(0), value(0)
+{
+   settle(from);
+}
+
+/*********************************************
+ * ROARING SET ITERATOR :: SETTLE
+ ********************************************/
+template <typename T>
+void RoaringSet <T> :: iterator :: settle(uint32_t from)
+{
+   while (iContainer < pSet->containers.size())
+   {
+      if (from <= 0xffff && pSet->containers[iContainer].nextFrom(from, pos, low))
+      {
+         value = (pSet->highs[iContainer] << 16) | low;
+         return;
+      }
+      iContainer++;
+      pos = 0;
+      from = 0;
+   }
+   low = 0;
+}
+
+/*********************************************
+ * ROARING SET ITERATOR :: INCREMENT
+ ********************************************/
+template <typename T>
+typename RoaringSet <T> :: iterator & RoaringSet <T> :: iterator :: operator ++ ()
+{
+   assert(pSet && iContainer < pSet->containers.size());
+   settle(low + 1);
+   return *this;
+}
+
+/*********************************************
+ * ROARING SET :: ASSIGN-MOVE OPERATOR
+ ********************************************/
+template <typename T>
+RoaringSet <T> & RoaringSet <T> :: operator = (RoaringSet <T> && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * ROARING SET :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+RoaringSet <T> & RoaringSet <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * ROARING SET :: SWAP
+ ********************************************/
+template <typename T>
+void RoaringSet <T> :: swap(RoaringSet <T> & rhs) noexcept
+{
+   highs.swap(rhs.highs);
+   containers.swap(rhs.containers);
+   std::swap(numElements, rhs.numElements);
+}
+
+/*********************************************
+ * ROARING SET :: CLEAR
+ ********************************************/
+template <typename T>
+void RoaringSet <T> :: clear() noexcept
+{
+   highs.clear();
+   containers.clear();
+   numElements = 0;
+}
+
+/*********************************************
+ * ROARING SET :: LOWER BOUND
+ * Index of the first container whose high bits are
+ * not less than high
+ ********************************************/
+template <typename T>
+size_t RoaringSet <T> :: lowerBound(T high) const
+{
+   return std::lower_bound(highs.begin(), highs.end(), high) - highs.begin();
+}
+
+/****************************************************
+ * ROARING SET :: FIND
+ * An iterator to t, or end() if it is not there
+ ****************************************************/
+template <typename T>
+typename RoaringSet <T> :: iterator RoaringSet <T> :: find(const T & t) const
+{
+   size_t i = lowerBound(t >> 16);
+   uint16_t v = static_cast<uint16_t>(t & 0xffff);
+   if (i == highs.size() || highs[i] != (t >> 16) || !containers[i].contains(v))
+      return end();
+   return iterator(this, i, v);
+}
+
+/****************************************************
+ * ROARING SET :: COUNT
+ * 1 if t is there, 0 if not
+ ****************************************************/
+template <typename T>
+size_t RoaringSet <T> :: count(const T & t) const
+{
+   size_t i = lowerBound(t >> 16);
+   return i < highs.size() && highs[i] == (t >> 16) &&
+          containers[i].contains(static_cast<uint16_t>(t & 0xffff)) ? 1 : 0;
+}
+
+/*****************************************************
+ * ROARING SET :: INSERT
+ * Returns false if t was already there
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: insert(const T & t)
+{
+   T high = t >> 16;
+   size_t i = lowerBound(high);
+   if (i == highs.size() || highs[i] != high)
+   {
+      highs.insert(highs.begin() + i, high);
+      containers.insert(containers.begin() + i, Container());
+   }
+   if (!containers[i].add(static_cast<uint16_t>(t & 0xffff)))
+      return false;
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * ROARING SET :: ERASE
+ * Returns false if t was not there. A container that
+ * empties out is removed.
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: erase(const T & t)
+{
+   T high = t >> 16;
+   size_t i = lowerBound(high);
+   if (i == highs.size() || highs[i] != high)
+      return false;
+   if (!containers[i].remove(static_cast<uint16_t>(t & 0xffff)))
+      return false;
+   numElements--;
+   if (containers[i].card == 0)
+   {
+      highs.erase(highs.begin() + i);
+      containers.erase(containers.begin() + i);
+   }
+   return true;
+}
+
+/*****************************************************
+ * ROARING SET :: UNION
+ * Walk both lists of highs together, combining the
+ * containers they share and copying the rest
+ ****************************************************/
+template <typename T>
+RoaringSet <T> & RoaringSet <T> :: operator |= (const RoaringSet <T> & rhs)
+{
+   if (this == &rhs)
+      return *this;
+   std::vector<T> highsNew;
+   std::vector<Container> containersNew;
+   highsNew.reserve(highs.size() + rhs.highs.size());
+   containersNew.reserve(highs.size() + rhs.highs.size());
+   numElements = 0;
+   size_t i = 0;
+   size_t j = 0;
+   while (i < highs.size() || j < rhs.highs.size())
+   {
+      if (j == rhs.highs.size() || (i < highs.size() && highs[i] < rhs.highs[j]))
+      {
+         highsNew.push_back(highs[i]);
+         containersNew.push_back(std::move(containers[i++]));
+      }
+      else if (i == highs.size() || rhs.highs[j] < highs[i])
+      {
+         highsNew.push_back(rhs.highs[j]);
+         containersNew.push_back(rhs.containers[j++]);
+      }
+      else
+      {
+         highsNew.push_back(highs[i]);
+         containersNew.push_back(Container::unite(containers[i++], rhs.containers[j++]));
+      }
+      numElements += containersNew.back().card;
+   }
+   highs.swap(highsNew);
+   containers.swap(containersNew);
+   return *this;
+}
+
+/*****************************************************
+ * ROARING SET :: INTERSECTION
+ * Only highs both sides have can survive; keep the
+ * ones whose containers still share something
+ ****************************************************/
+template <typename T>
+RoaringSet <T> & RoaringSet <T> :: operator &= (const RoaringSet <T> & rhs)
+{
+   if (this == &rhs)
+      return *this;
+   size_t numKept = 0;
+   size_t j = 0;
+   numElements = 0;
+   for (size_t i = 0; i < highs.size(); i++)
+   {
+      while (j < rhs.highs.size() && rhs.highs[j] < highs[i])
+         j++;
+      if (j == rhs.highs.size())
+         break;
+      if (rhs.highs[j] != highs[i])
+         continue;
+      Container c = Container::intersect(containers[i], rhs.containers[j]);
+      if (c.card == 0)
+         continue;
+      numElements += c.card;
+      highs[numKept] = highs[i];
+      containers[numKept++] = std::move(c);
+   }
+   highs.resize(numKept);
+   containers.resize(numKept);
+   return *this;
+}
+
+/*****************************************************
+ * ROARING SET :: RUN OPTIMIZE
+ * Put every container in whichever form is smallest
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: runOptimize()
+{
+   for (Container & c : containers)
+      c.optimize();
+}
+
+/*****************************************************
+ * ROARING SET :: BYTES
+ * Memory held by the set and all its containers
+ ****************************************************/
+template <typename T>
+size_t RoaringSet <T> :: bytes() const noexcept
+{
+   size_t num = sizeof(*this) + highs.capacity() * sizeof(T) + containers.capacity() * sizeof(Container);
+   for (const Container & c : containers)
+      num += c.bytes();
+   return num;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: CONTAINS
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: Container :: contains(uint16_t v) const
+{
+   switch (kind)
+   {
+      case ARRAY:
+         return std::binary_search(values.begin(), values.end(), v);
+      case BITMAP:
+         return (words[v >> 6] >> (v & 63)) & 1;
+      default:
+      {
+         size_t r = findRun(v);
+         return r < values.size() && v - values[r] <= values[r + 1];
+      }
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: FIND RUN
+ * Index of the pair for the last run starting at or
+ * before v, or values.size() if there is none
+ ****************************************************/
+template <typename T>
+size_t RoaringSet <T> :: Container :: findRun(uint16_t v) const
+{
+   size_t iBegin = 0;
+   size_t iEnd = values.size() / 2;     // runs, not entries
+   while (iBegin < iEnd)
+   {
+      size_t iMiddle = (iBegin + iEnd) / 2;
+      if (values[iMiddle * 2] <= v)
+         iBegin = iMiddle + 1;
+      else
+         iEnd = iMiddle;
+   }
+   return iBegin == 0 ? values.size() : (iBegin - 1) * 2;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: ADD
+ * Returns false if v was already there
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: Container :: add(uint16_t v)
+{
+   switch (kind)
+   {
+      case ARRAY:
+      {
+         auto it = std::lower_bound(values.begin(), values.end(), v);
+         if (it != values.end() && *it == v)
+            return false;
+         values.insert(it, v);
+         if (++card > MAX_ARRAY)
+            toBitmap();
+         return true;
+      }
+      case BITMAP:
+      {
+         uint64_t bit = uint64_t(1) << (v & 63);
+         if (words[v >> 6] & bit)
+            return false;
+         words[v >> 6] |= bit;
+         card++;
+         return true;
+      }
+      default:
+      {
+         size_t r = findRun(v);
+         if (r < values.size() && v - values[r] <= values[r + 1])
+            return false;
+         size_t next = r < values.size() ? r + 2 : 0;     // the run after v
+         bool fJoinPrev = r < values.size() && values[r] + values[r + 1] + 1 == v;
+         bool fJoinNext = next < values.size() && values[next] == v + 1;
+         if (fJoinPrev && fJoinNext)
+         {
+            values[r + 1] += values[next + 1] + 2;
+            values.erase(values.begin() + next, values.begin() + next + 2);
+         }
+         else if (fJoinPrev)
+            values[r + 1]++;
+         else if (fJoinNext)
+         {
+            values[next] = v;
+            values[next + 1]++;
+         }
+         else
+         {
+            uint16_t run[2] = { v, 0 };
+            values.insert(values.begin() + next, run, run + 2);
+         }
+         card++;
+         checkRuns();
+         return true;
+      }
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: REMOVE
+ * Returns false if v was not there
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: Container :: remove(uint16_t v)
+{
+   switch (kind)
+   {
+      case ARRAY:
+      {
+         auto it = std::lower_bound(values.begin(), values.end(), v);
+         if (it == values.end() || *it != v)
+            return false;
+         values.erase(it);
+         card--;
+         return true;
+      }
+      case BITMAP:
+      {
+         uint64_t bit = uint64_t(1) << (v & 63);
+         if (!(words[v >> 6] & bit))
+            return false;
+         words[v >> 6] &= ~bit;
+         if (--card <= MAX_ARRAY)
+            toArray();
+         return true;
+      }
+      default:
+      {
+         size_t r = findRun(v);
+         if (r == values.size() || v - values[r] > values[r + 1])
+            return false;
+         uint16_t start = values[r];
+         uint16_t last = static_cast<uint16_t>(start + values[r + 1]);
+         if (start == last)
+            values.erase(values.begin() + r, values.begin() + r + 2);
+         else if (v == start)
+         {
+            values[r]++;
+            values[r + 1]--;
+         }
+         else if (v == last)
+            values[r + 1]--;
+         else
+         {
+            // split in two around v
+            values[r + 1] = static_cast<uint16_t>(v - start - 1);
+            uint16_t run[2] = { static_cast<uint16_t>(v + 1), static_cast<uint16_t>(last - v - 1) };
+            values.insert(values.begin() + r + 2, run, run + 2);
+         }
+         card--;
+         checkRuns();
+         return true;
+      }
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: CHECK RUNS
+ * A run container whose runs have broken up until an
+ * array or bitmap would be smaller becomes one
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: Container :: checkRuns()
+{
+   size_t bytesPlain = card > MAX_ARRAY ? WORDS * sizeof(uint64_t) : card * sizeof(uint16_t);
+   if (values.size() * sizeof(uint16_t) > bytesPlain)
+      toPlain();
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: NEXT FROM
+ * The smallest value at or after low. pos is where the
+ * last one was found, so walking forward costs little.
+ ****************************************************/
+template <typename T>
+bool RoaringSet <T> :: Container :: nextFrom(uint32_t low, size_t & pos, uint32_t & value) const
+{
+   switch (kind)
+   {
+      case ARRAY:
+         if (pos >= values.size() || values[pos] < low)
+            pos = std::lower_bound(values.begin() + (pos < values.size() ? pos : 0), values.end(),
+                                   low) - values.begin();
+         if (pos == values.size())
+            return false;
+         value = values[pos];
+         return true;
+      case BITMAP:
+      {
+         size_t w = low >> 6;
+         uint64_t bits = words[w] & (~uint64_t(0) << (low & 63));
+         while (!bits)
+         {
+            if (++w == WORDS)
+               return false;
+            bits = words[w];
+         }
+         value = static_cast<uint32_t>(w * 64 + lowestBit(bits));
+         return true;
+      }
+      default:
+         while (pos < values.size() && values[pos] + values[pos + 1] < low)
+            pos += 2;
+         if (pos == values.size())
+            return false;
+         value = low > values[pos] ? low : values[pos];
+         return true;
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: FOR EACH
+ * Call f with every value, in order
+ ****************************************************/
+template <typename T>
+template <class F>
+void RoaringSet <T> :: Container :: forEach(F f) const
+{
+   switch (kind)
+   {
+      case ARRAY:
+         for (uint16_t v : values)
+            f(v);
+         break;
+      case BITMAP:
+         for (size_t w = 0; w < WORDS; w++)
+            for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+               f(static_cast<uint16_t>(w * 64 + lowestBit(bits)));
+         break;
+      default:
+         for (size_t r = 0; r < values.size(); r += 2)
+            for (uint32_t v = values[r]; v <= uint32_t(values[r]) + values[r + 1]; v++)
+               f(static_cast<uint16_t>(v));
+         break;
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: TO ARRAY
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: Container :: toArray()
+{
+   if (kind == ARRAY)
+      return;
+   std::vector<uint16_t> array;
+   array.reserve(card);
+   forEach([&array](uint16_t v) { array.push_back(v); });
+   values.swap(array);
+   std::vector<uint64_t>().swap(words);
+   kind = ARRAY;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: TO BITMAP
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: Container :: toBitmap()
+{
+   if (kind == BITMAP)
+      return;
+   std::vector<uint64_t> bitmap(WORDS, 0);
+   forEach([&bitmap](uint16_t v) { bitmap[v >> 6] |= uint64_t(1) << (v & 63); });
+   words.swap(bitmap);
+   std::vector<uint16_t>().swap(values);
+   kind = BITMAP;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: TO RUNS
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: Container :: toRuns()
+{
+   if (kind == RUN)
+      return;
+   std::vector<uint16_t> runs;
+   runs.reserve(numRuns() * 2);
+   forEach([&runs](uint16_t v)
+   {
+      if (!runs.empty() && runs[runs.size() - 2] + runs.back() + 1 == v)
+         runs.back()++;
+      else
+      {
+         runs.push_back(v);
+         runs.push_back(0);
+      }
+   });
+   values.swap(runs);
+   std::vector<uint64_t>().swap(words);
+   kind = RUN;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: OPTIMIZE
+ * Runs cost four bytes each, an array two bytes a
+ * value, a bitmap 8K; take the smallest
+ ****************************************************/
+template <typename T>
+void RoaringSet <T> :: Container :: optimize()
+{
+   size_t bytesPlain = card > MAX_ARRAY ? WORDS * sizeof(uint64_t) : card * sizeof(uint16_t);
+   if (numRuns() * 2 * sizeof(uint16_t) < bytesPlain)
+      toRuns();
+   else
+      toPlain();
+   values.shrink_to_fit();
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: NUM RUNS
+ * How many runs of consecutive values there are
+ ****************************************************/
+template <typename T>
+size_t RoaringSet <T> :: Container :: numRuns() const
+{
+   switch (kind)
+   {
+      case ARRAY:
+      {
+         size_t num = values.empty() ? 0 : 1;
+         for (size_t i = 1; i < values.size(); i++)
+            num += values[i] != values[i - 1] + 1;
+         return num;
+      }
+      case BITMAP:
+      {
+         // a run starts at every set bit whose lower neighbour is clear
+         size_t num = 0;
+         uint64_t carry = 0;
+         for (size_t w = 0; w < WORDS; w++)
+         {
+            num += popCount(words[w] & ~((words[w] << 1) | carry));
+            carry = words[w] >> 63;
+         }
+         return num;
+      }
+      default:
+         return values.size() / 2;
+   }
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: UNITE
+ * A run container is first put in its plain form, so
+ * there are three cases: two arrays merge, an array
+ * sets its bits in a copy of a bitmap, and two bitmaps
+ * OR their words together
+ ****************************************************/
+template <typename T>
+typename RoaringSet <T> :: Container RoaringSet <T> :: Container :: unite(const Container & lhs, const Container & rhs)
+{
+   Container lhsPlain;
+   Container rhsPlain;
+   const Container * pLhs = &lhs;
+   const Container * pRhs = &rhs;
+   if (lhs.kind == RUN)
+   {
+      lhsPlain = lhs;
+      lhsPlain.toPlain();
+      pLhs = &lhsPlain;
+   }
+   if (rhs.kind == RUN)
+   {
+      rhsPlain = rhs;
+      rhsPlain.toPlain();
+      pRhs = &rhsPlain;
+   }
+   if (pLhs->kind == ARRAY && pRhs->kind == BITMAP)
+      std::swap(pLhs, pRhs);
+
+   Container out;
+   if (pLhs->kind == BITMAP && pRhs->kind == BITMAP)
+   {
+      out.kind = BITMAP;
+      out.words.resize(WORDS);
+      out.card = orWords(pLhs->words.data(), pRhs->words.data(), out.words.data());
+   }
+   else if (pLhs->kind == BITMAP)
+   {
+      out = *pLhs;
+      for (uint16_t v : pRhs->values)
+      {
+         uint64_t bit = uint64_t(1) << (v & 63);
+         out.card += (out.words[v >> 6] & bit) ? 0 : 1;
+         out.words[v >> 6] |= bit;
+      }
+   }
+   else
+   {
+      out.values.resize(pLhs->values.size() + pRhs->values.size());
+      auto itEnd = std::set_union(pLhs->values.begin(), pLhs->values.end(),
+                                  pRhs->values.begin(), pRhs->values.end(), out.values.begin());
+      out.values.erase(itEnd, out.values.end());
+      out.card = static_cast<uint32_t>(out.values.size());
+      if (out.card > MAX_ARRAY)
+         out.toBitmap();
+   }
+   return out;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: INTERSECT
+ * The same three cases: two arrays merge, an array
+ * keeps the values whose bits are set, and two bitmaps
+ * AND their words together
+ ****************************************************/
+template <typename T>
+typename RoaringSet <T> :: Container RoaringSet <T> :: Container :: intersect(const Container & lhs, const Container & rhs)
+{
+   Container lhsPlain;
+   Container rhsPlain;
+   const Container * pLhs = &lhs;
+   const Container * pRhs = &rhs;
+   if (lhs.kind == RUN)
+   {
+      lhsPlain = lhs;
+      lhsPlain.toPlain();
+      pLhs = &lhsPlain;
+   }
+   if (rhs.kind == RUN)
+   {
+      rhsPlain = rhs;
+      rhsPlain.toPlain();
+      pRhs = &rhsPlain;
+   }
+   if (pLhs->kind == ARRAY && pRhs->kind == BITMAP)
+      std::swap(pLhs, pRhs);
+
+   Container out;
+   if (pLhs->kind == BITMAP && pRhs->kind == BITMAP)
+   {
+      out.kind = BITMAP;
+      out.words.resize(WORDS);
+      out.card = andWords(pLhs->words.data(), pRhs->words.data(), out.words.data());
+      if (out.card <= MAX_ARRAY)
+         out.toArray();
+   }
+   else if (pLhs->kind == BITMAP)
+   {
+      for (uint16_t v : pRhs->values)
+         if ((pLhs->words[v >> 6] >> (v & 63)) & 1)
+            out.values.push_back(v);
+      out.card = static_cast<uint32_t>(out.values.size());
+   }
+   else
+   {
+      out.values.resize(pLhs->values.size() < pRhs->values.size() ? pLhs->values.size() : pRhs->values.size());
+      auto itEnd = std::set_intersection(pLhs->values.begin(), pLhs->values.end(),
+                                         pRhs->values.begin(), pRhs->values.end(), out.values.begin());
+      out.values.erase(itEnd, out.values.end());
+      out.card = static_cast<uint32_t>(out.values.size());
+   }
+   return out;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: OR WORDS
+ * pOut = pLhs | pRhs over a whole bitmap, returning
+ * how many bits are set
+ ****************************************************/
+template <typename T>
+uint32_t RoaringSet <T> :: Container :: orWords(const uint64_t * pLhs, const uint64_t * pRhs, uint64_t * pOut)
+{
+#ifdef ROARING_SSE2
+   for (size_t w = 0; w < WORDS; w += 2)
+   {
+      __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pLhs + w));
+      __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRhs + w));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + w), _mm_or_si128(lhs, rhs));
+   }
+#else
+   for (size_t w = 0; w < WORDS; w++)
+      pOut[w] = pLhs[w] | pRhs[w];
+#endif
+   uint32_t num = 0;
+   for (size_t w = 0; w < WORDS; w++)
+      num += popCount(pOut[w]);
+   return num;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: AND WORDS
+ * pOut = pLhs & pRhs over a whole bitmap, returning
+ * how many bits are set
+ ****************************************************/
+template <typename T>
+uint32_t RoaringSet <T> :: Container :: andWords(const uint64_t * pLhs, const uint64_t * pRhs, uint64_t * pOut)
+{
+#ifdef ROARING_SSE2
+   for (size_t w = 0; w < WORDS; w += 2)
+   {
+      __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pLhs + w));
+      __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRhs + w));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + w), _mm_and_si128(lhs, rhs));
+   }
+#else
+   for (size_t w = 0; w < WORDS; w++)
+      pOut[w] = pLhs[w] & pRhs[w];
+#endif
+   uint32_t num = 0;
+   for (size_t w = 0; w < WORDS; w++)
+      num += popCount(pOut[w]);
+   return num;
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: POP COUNT
+ * Number of bits set in w
+ ****************************************************/
+template <typename T>
+uint32_t RoaringSet <T> :: Container :: popCount(uint64_t w)
+{
+#ifdef __GNUC__
+   return static_cast<uint32_t>(__builtin_popcountll(w));
+#else
+   w = w - ((w >> 1) & 0x5555555555555555ull);
+   w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+   w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+   return static_cast<uint32_t>((w * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/*****************************************************
+ * ROARING SET CONTAINER :: LOWEST BIT
+ * Position of the lowest bit set in w, which is not 0
+ ****************************************************/
+template <typename T>
+uint32_t RoaringSet <T> :: Container :: lowestBit(uint64_t w)
+{
+   assert(w);
+#ifdef __GNUC__
+   return static_cast<uint32_t>(__builtin_ctzll(w));
+#else
+   return popCount((w & (0 - w)) - 1);
+#endif
+}
+
+} // namespace custom
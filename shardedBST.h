@@ -0,0 +1,664 @@
+/***********************************************************************
+ * Header:
+ *    SHARDED BST
+ * Summary:
+ *    A set that many threads may use at once, built from ordinary
+ *    BSTs. Values are spread over a number of shards, each behind its
+ *    own reader-writer lock, so threads working in different shards
+ *    never wait on each other.
+ *
+ *    This will contain the class definition of:
+ *        ShardedBST           : A set partitioned over locked BSTs
+ *        ShardedBST::iterator : Visits every value in order
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"
+#include "epoch.h"
+#include <algorithm>     // for std::upper_bound
+#include <atomic>        // for std::atomic
+#include <cassert>
+#include <cstddef>       // for size_t
+#include <cstdint>       // for uint64_t
+#include <functional>    // for std::hash
+#include <memory>        // for std::unique_ptr
+#include <mutex>         // for std::unique_lock
+#include <shared_mutex>  // for std::shared_timed_mutex
+#include <utility>       // for std::move
+#include <vector>        // for the shards
+
+namespace custom
+{
+
+/*****************************************************************
+ * SHARDED BINARY SEARCH TREE
+ * A value is routed to exactly one shard, either:
+ *    BY_HASH  : by its hash. Spreads any workload evenly, but the
+ *               shards are unordered so iteration has to merge them.
+ *    BY_RANGE : by comparing it with a sorted list of splitters,
+ *               so shard i holds [splitters[i-1], splitters[i]).
+ *
+ * Range routing starts with one shard and splits a shard in half,
+ * at its median value, whenever it takes rebalancePeriod writes.
+ * Once all numShards are in use, a shard that takes more than
+ * hotFactor times its share of the writes is still split, and the
+ * two coldest neighbouring shards are merged to make room.
+ *
+ * The shards and splitters form an immutable directory published
+ * through an atomic pointer, so routing takes no shared lock. A
+ * split or merge builds a new directory while holding the affected
+ * shards exclusively, publishes it, and retires the old one through
+ * an EpochManager. A thread that locked a shard through a directory
+ * that has since been replaced lets go and routes again.
+ *****************************************************************/
+template <class T, class Hash = std::hash<T> >
+class ShardedBST
+{
+public:
+   enum Routing { BY_HASH, BY_RANGE };
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   ShardedBST(size_t numShards = 16, Routing routing = BY_HASH);
+   ShardedBST(const ShardedBST & rhs) = delete;
+   ShardedBST & operator = (const ShardedBST & rhs) = delete;
+   ~ShardedBST();
+
+   //
+   // Iterator: not safe while another thread is writing
+   //
+
+   iterator begin() const;
+   iterator end()   const { return iterator(); }
+
+   template <class F>
+   void forEach(F f) const;
+
+   //
+   // Access
+   //
+
+   bool find(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T & t);
+
+   //
+   // Remove
+   //
+
+   bool erase(const T & t);
+   void clear();
+
+   //
+   // Status
+   //
+
+   bool   empty() const { return size() == 0; }
+   size_t size()  const;
+   Routing routing() const noexcept { return mode; }
+
+   //
+   // Rebalance: range routing only. A period of zero turns it off.
+   //
+
+   void setRebalancePeriod(size_t numWrites) { rebalancePeriod = numWrites; }
+   void rebalance();
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+
+   // one BST and its lock, padded so neighbouring locks don't share a cache line
+   struct Shard
+   {
+      Shard() : numElements(0), numWrites(0) {}
+      mutable std::shared_timed_mutex lock;
+      BST <T> bst;
+      std::atomic<size_t> numElements;  // bst.size(), readable without the lock
+      std::atomic<size_t> numWrites;    // writes since the last rebalance
+      char padding[64];
+   };
+
+   // which shards there are and where the ranges break. Never changed
+   // once published; the shards themselves outlive any one directory.
+   struct Directory
+   {
+      std::vector<Shard *> shards;  // in key order when BY_RANGE
+      std::vector<T> splitters;     // shards[i] holds values < splitters[i]
+   };
+
+   const Directory & directory() const { return *pDirectory.load(std::memory_order_acquire); }
+
+   template <class Lock, class F>
+   auto   withShard(const T & t, F f) const;
+   size_t route(const Directory & dir, const T & t) const;
+   bool   write(const T & t, bool fInsert);
+   iterator first(const Directory & dir) const;
+   void   rebalance(const Shard * pHot);
+   void   split(size_t i);
+   void   merge(size_t i);
+   void   publish(Directory * pNew);
+
+   static std::vector<T> drain(Shard & shard);
+   static void fill(Shard & shard, std::vector<T> & values, size_t iBegin, size_t iEnd);
+   static void fillBalanced(BST <T> & bst, std::vector<T> & values, size_t iBegin, size_t iEnd);
+
+   const Routing mode;                         // how values find their shard
+   const size_t maxShards;                     // shards to use at most
+   std::atomic<Directory *> pDirectory;        // the current shards and splitters
+   std::mutex lockRebalance;                   // one split, merge, or clear at a time
+   mutable EpochManager epochs;                // frees replaced directories and shards
+   size_t rebalancePeriod;                     // writes to a shard between checks
+   size_t hotFactor;                           // how far over its share a hot shard is
+};
+
+/*****************************************************************
+ * SHARDED BST ITERATOR
+ * Merges the shards: each shard keeps a cursor, and the
+ * iterator always stands on the smallest of them.
+ *****************************************************************/
+template <class T, class Hash>
+class ShardedBST <T, Hash> :: iterator
+{
+   friend class ShardedBST <T, Hash>;
+public:
+   iterator() : iCurrent(0) {}
+
+   bool operator == (const iterator & rhs) const { return cursors.empty() == rhs.cursors.empty() && (cursors.empty() || current() == rhs.current()); }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   const T & operator * () const { assert(!cursors.empty()); return *current(); }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   typedef typename BST <T> :: iterator Cursor;
+
+   const Cursor & current() const { return cursors[iCurrent].first; }
+   void findSmallest();
+
+   std::vector<std::pair<Cursor, Cursor> > cursors;  // position and end of each unfinished shard
+   size_t iCurrent;                                  // the cursor holding the smallest value
+};
+
+/*********************************************
+ * SHARDED BST :: CONSTRUCTOR
+ * Hash routing uses every shard from the start;
+ * range routing starts with one and splits as it fills
+ ********************************************/
+template <class T, class Hash>
+ShardedBST <T, Hash> :: ShardedBST(size_t numShards, Routing routing) :
+   mode(routing),
+   maxShards(numShards ? numShards : 1),
+   pDirectory(nullptr),
+   rebalancePeriod(1024),
+   hotFactor(2)
+{
+   std::unique_ptr<Directory> pDir(new Directory);
+   size_t num = (mode == BY_HASH) ? maxShards : 1;
+   pDir->shards.reserve(num);
+   for (size_t i = 0; i < num; i++)
+   {
+      std::unique_ptr<Shard> pShard(new Shard);
+      pDir->shards.push_back(pShard.release());
+   }
+   pDirectory.store(pDir.release(), std::memory_order_release);
+}
+
+/*********************************************
+ * SHARDED BST :: DESTRUCTOR
+ * The current directory owns whatever shards are left;
+ * epochs frees everything that was retired before it
+ ********************************************/
+template <class T, class Hash>
+ShardedBST <T, Hash> :: ~ShardedBST()
+{
+   Directory * pDir = pDirectory.load(std::memory_order_relaxed);
+   for (Shard * pShard : pDir->shards)
+      delete pShard;
+   delete pDir;
+}
+
+/*********************************************
+ * SHARDED BST :: WITH SHARD
+ * Call f on the shard holding t, under a Lock on that shard.
+ * Range routing retries when the directory it routed through
+ * was replaced before the lock was granted, and stays pinned
+ * so that neither the directory nor the shard is freed meanwhile.
+ ********************************************/
+template <class T, class Hash>
+template <class Lock, class F>
+auto ShardedBST <T, Hash> :: withShard(const T & t, F f) const
+{
+   if (mode == BY_HASH)
+   {
+      // the hash directory is never replaced
+      const Directory & dir = directory();
+      Shard & shard = *dir.shards[route(dir, t)];
+      Lock lock(shard.lock);
+      return f(shard);
+   }
+
+   EpochManager::Guard guard = epochs.pin();
+   for (;;)
+   {
+      const Directory * pDir = pDirectory.load(std::memory_order_acquire);
+      Shard & shard = *pDir->shards[route(*pDir, t)];
+      Lock lock(shard.lock);
+      if (pDirectory.load(std::memory_order_acquire) == pDir)
+         return f(shard);
+   }
+}
+
+/*********************************************
+ * SHARDED BST :: ROUTE
+ * Which shard of dir holds t
+ ********************************************/
+template <class T, class Hash>
+size_t ShardedBST <T, Hash> :: route(const Directory & dir, const T & t) const
+{
+   if (mode == BY_RANGE)
+      return std::upper_bound(dir.splitters.begin(), dir.splitters.end(), t) - dir.splitters.begin();
+
+   // finish the hash so that identity hashes of small integers still spread
+   uint64_t h = (uint64_t)Hash()(t);
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdull;
+   h ^= h >> 33;
+   return (size_t)(h % dir.shards.size());
+}
+
+/*********************************************
+ * SHARDED BST :: FIND
+ * Is t in the set?
+ ********************************************/
+template <class T, class Hash>
+bool ShardedBST <T, Hash> :: find(const T & t) const
+{
+   return withShard<std::shared_lock<std::shared_timed_mutex> >(t, [&t](const Shard & shard)
+   {
+      return shard.bst.find(t) != nullptr;
+   });
+}
+
+/*********************************************
+ * SHARDED BST :: INSERT
+ * Add t unless it is already there
+ ********************************************/
+template <class T, class Hash>
+bool ShardedBST <T, Hash> :: insert(const T & t)
+{
+   return write(t, true /*fInsert*/);
+}
+
+/*********************************************
+ * SHARDED BST :: ERASE
+ * Remove t if it is there
+ ********************************************/
+template <class T, class Hash>
+bool ShardedBST <T, Hash> :: erase(const T & t)
+{
+   return write(t, false /*fInsert*/);
+}
+
+/*********************************************
+ * SHARDED BST :: WRITE
+ * Insert or erase under the shard's exclusive lock, then,
+ * with every lock released, see whether the shard got hot
+ ********************************************/
+template <class T, class Hash>
+bool ShardedBST <T, Hash> :: write(const T & t, bool fInsert)
+{
+   bool fCheck = false;
+   const Shard * pShard = nullptr;
+   bool fChanged = withShard<std::unique_lock<std::shared_timed_mutex> >(t, [&](Shard & shard)
+   {
+      bool fChanged = fInsert ? shard.bst.insert(t, true /*keepUnique*/) : shard.bst.erase(t);
+      shard.numElements.store(shard.bst.size(), std::memory_order_relaxed);
+
+      size_t numWrites = shard.numWrites.fetch_add(1, std::memory_order_relaxed) + 1;
+      fCheck = mode == BY_RANGE && rebalancePeriod && numWrites % rebalancePeriod == 0;
+      pShard = &shard;
+      return fChanged;
+   });
+
+   // pShard may be retired by now; rebalance only compares the address
+   if (fCheck)
+      rebalance(pShard);
+   return fChanged;
+}
+
+/*********************************************
+ * SHARDED BST :: CLEAR
+ * Empty every shard. Range routing goes back to one shard.
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: clear()
+{
+   std::lock_guard<std::mutex> lockRebal(lockRebalance);
+   Directory * pOld = pDirectory.load(std::memory_order_relaxed);
+
+   std::unique_ptr<Directory> pNew;
+   if (mode == BY_RANGE && pOld->shards.size() > 1)
+   {
+      pNew.reset(new Directory);
+      pNew->shards.push_back(pOld->shards[0]);
+   }
+
+   std::vector<std::unique_lock<std::shared_timed_mutex> > locks;
+   for (Shard * pShard : pOld->shards)
+   {
+      locks.emplace_back(pShard->lock);
+      pShard->bst.clear();
+      pShard->numElements = 0;
+      pShard->numWrites = 0;
+   }
+
+   if (pNew)
+   {
+      publish(pNew.release());
+      locks.clear();
+      for (size_t i = 1; i < pOld->shards.size(); i++)
+         epochs.retire(pOld->shards[i]);
+   }
+}
+
+/*********************************************
+ * SHARDED BST :: SIZE
+ * The sum of the shards; only exact when no one is writing
+ ********************************************/
+template <class T, class Hash>
+size_t ShardedBST <T, Hash> :: size() const
+{
+   EpochManager::Guard guard = epochs.pin();
+   size_t num = 0;
+   for (const Shard * pShard : directory().shards)
+      num += pShard->numElements.load(std::memory_order_relaxed);
+   return num;
+}
+
+/*********************************************
+ * SHARDED BST :: BEGIN
+ * Start at the smallest value of the current directory
+ ********************************************/
+template <class T, class Hash>
+typename ShardedBST <T, Hash> :: iterator ShardedBST <T, Hash> :: begin() const
+{
+   return first(directory());
+}
+
+/*********************************************
+ * SHARDED BST :: FIRST
+ * Start a cursor in every shard of dir that has anything
+ ********************************************/
+template <class T, class Hash>
+typename ShardedBST <T, Hash> :: iterator ShardedBST <T, Hash> :: first(const Directory & dir) const
+{
+   iterator it;
+   for (const Shard * pShard : dir.shards)
+      if (!pShard->bst.empty())
+         it.cursors.push_back(std::make_pair(pShard->bst.begin(), pShard->bst.end()));
+   it.findSmallest();
+   return it;
+}
+
+/*********************************************
+ * SHARDED BST :: FOR EACH
+ * Call f on every value in order, holding every shard's
+ * read lock (always taken in shard order) for the duration.
+ * A directory replaced while the locks were being taken
+ * is let go and the next one tried.
+ ********************************************/
+template <class T, class Hash>
+template <class F>
+void ShardedBST <T, Hash> :: forEach(F f) const
+{
+   EpochManager::Guard guard = epochs.pin();
+   for (;;)
+   {
+      const Directory * pDir = pDirectory.load(std::memory_order_acquire);
+      std::vector<std::shared_lock<std::shared_timed_mutex> > locks;
+      for (const Shard * pShard : pDir->shards)
+         locks.emplace_back(pShard->lock);
+      if (pDirectory.load(std::memory_order_acquire) != pDir)
+         continue;
+
+      for (iterator it = first(*pDir); it != end(); ++it)
+         f(*it);
+      return;
+   }
+}
+
+/*********************************************
+ * SHARDED BST :: REBALANCE
+ * Split whichever shard took the most writes
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: rebalance()
+{
+   if (mode != BY_RANGE)
+      return;
+
+   const Shard * pHot = nullptr;
+   {
+      EpochManager::Guard guard = epochs.pin();
+      for (const Shard * pShard : directory().shards)
+         if (!pHot || pShard->numWrites > pHot->numWrites)
+            pHot = pShard;
+   }
+   rebalance(pHot);
+}
+
+/*********************************************
+ * SHARDED BST :: REBALANCE
+ * pHot just took another rebalancePeriod writes. While there is
+ * room, split it; once every shard is in use, only split it if it
+ * is hot, and merge the coldest neighbours to make room.
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: rebalance(const Shard * pHot)
+{
+   // only this thread replaces the directory until we return
+   std::lock_guard<std::mutex> lockRebal(lockRebalance);
+   const std::vector<Shard *> & shards = directory().shards;
+
+   // another thread may already have merged pHot away
+   size_t iHot = 0;
+   while (iHot < shards.size() && shards[iHot] != pHot)
+      iHot++;
+   if (iHot == shards.size() || pHot->numElements < 2)
+      return;
+
+   if (shards.size() < maxShards)
+      split(iHot);
+   else
+   {
+      size_t numTotal = 0;
+      for (const Shard * pShard : shards)
+         numTotal += pShard->numWrites;
+      if (shards.size() < 3 || pHot->numWrites * shards.size() <= hotFactor * numTotal)
+         return;
+
+      // the coldest neighbouring pair that does not include the hot shard
+      size_t iCold = shards.size();
+      size_t numCold = 0;
+      for (size_t i = 0; i + 1 < shards.size(); i++)
+      {
+         if (i == iHot || i + 1 == iHot)
+            continue;
+         size_t num = shards[i]->numWrites + shards[i + 1]->numWrites;
+         if (iCold == shards.size() || num < numCold)
+         {
+            iCold = i;
+            numCold = num;
+         }
+      }
+      if (iCold == shards.size())
+         return;                     // every pair includes the hot shard
+      merge(iCold);
+      split(iCold < iHot ? iHot - 1 : iHot);
+   }
+
+   for (Shard * pShard : directory().shards)
+      pShard->numWrites = 0;
+}
+
+/*********************************************
+ * SHARDED BST :: SPLIT
+ * Shard i keeps the smaller half of its values and
+ * a new shard after it takes the larger half. Readers
+ * keep using shard i until the new directory is out.
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: split(size_t i)
+{
+   const Directory & old = directory();
+   Shard & shard = *old.shards[i];
+
+   std::unique_ptr<Directory> pNew(new Directory(old));
+   pNew->shards.reserve(old.shards.size() + 1);
+   pNew->splitters.reserve(old.splitters.size() + 1);
+   std::unique_ptr<Shard> pUpper(new Shard);
+
+   std::unique_lock<std::shared_timed_mutex> lock(shard.lock);
+   std::vector<T> values = drain(shard);
+   size_t iMiddle = values.size() / 2;
+
+   pNew->splitters.insert(pNew->splitters.begin() + i, values[iMiddle]);
+   fill(shard, values, 0, iMiddle);
+   fill(*pUpper, values, iMiddle, values.size());
+   pNew->shards.insert(pNew->shards.begin() + i + 1, pUpper.release());
+   publish(pNew.release());
+}
+
+/*********************************************
+ * SHARDED BST :: MERGE
+ * Shard i absorbs shard i+1, which is retired
+ * once the new directory is out
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: merge(size_t i)
+{
+   const Directory & old = directory();
+   Shard & lower = *old.shards[i];
+   Shard * pUpper = old.shards[i + 1];
+
+   std::unique_ptr<Directory> pNew(new Directory(old));
+   pNew->shards.erase(pNew->shards.begin() + i + 1);
+   pNew->splitters.erase(pNew->splitters.begin() + i);
+
+   {
+      std::unique_lock<std::shared_timed_mutex> lockLower(lower.lock);
+      std::unique_lock<std::shared_timed_mutex> lockUpper(pUpper->lock);
+      std::vector<T> values = drain(lower);
+      std::vector<T> upper = drain(*pUpper);
+      values.insert(values.end(), upper.begin(), upper.end());
+
+      fill(lower, values, 0, values.size());
+      publish(pNew.release());
+   }
+   epochs.retire(pUpper);
+}
+
+/*********************************************
+ * SHARDED BST :: PUBLISH
+ * Make pNew the directory every new lookup routes through.
+ * The caller holds lockRebalance and the exclusive lock of
+ * every shard whose range changed.
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: publish(Directory * pNew)
+{
+   Directory * pOld = pDirectory.exchange(pNew, std::memory_order_acq_rel);
+   epochs.retire(pOld);
+}
+
+/*********************************************
+ * SHARDED BST :: DRAIN
+ * Take every value out of a shard, in order
+ ********************************************/
+template <class T, class Hash>
+std::vector<T> ShardedBST <T, Hash> :: drain(Shard & shard)
+{
+   std::vector<T> values;
+   values.reserve(shard.bst.size());
+   for (auto it = shard.bst.begin(); it != shard.bst.end(); ++it)
+      values.push_back(*it);
+   shard.bst.clear();
+   shard.numElements = 0;
+   return values;
+}
+
+/*********************************************
+ * SHARDED BST :: FILL
+ * Put values[iBegin, iEnd) into an empty shard
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: fill(Shard & shard, std::vector<T> & values, size_t iBegin, size_t iEnd)
+{
+   assert(shard.bst.empty());
+   fillBalanced(shard.bst, values, iBegin, iEnd);
+   shard.numElements = shard.bst.size();
+}
+
+/*********************************************
+ * SHARDED BST :: FILL BALANCED
+ * The values are sorted, so inserting them in order would
+ * build a list. Insert each middle first instead.
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: fillBalanced(BST <T> & bst, std::vector<T> & values, size_t iBegin, size_t iEnd)
+{
+   if (iBegin >= iEnd)
+      return;
+   size_t iMiddle = iBegin + (iEnd - iBegin) / 2;
+   bst.insert(std::move(values[iMiddle]));
+   fillBalanced(bst, values, iBegin, iMiddle);
+   fillBalanced(bst, values, iMiddle + 1, iEnd);
+}
+
+/*********************************************
+ * SHARDED BST ITERATOR :: INCREMENT
+ * Advance the smallest cursor, dropping it when its shard runs out
+ ********************************************/
+template <class T, class Hash>
+typename ShardedBST <T, Hash> :: iterator & ShardedBST <T, Hash> :: iterator :: operator ++ ()
+{
+   assert(!cursors.empty());
+   if (++cursors[iCurrent].first == cursors[iCurrent].second)
+      cursors.erase(cursors.begin() + iCurrent);
+   findSmallest();
+   return *this;
+}
+
+/*********************************************
+ * SHARDED BST ITERATOR :: FIND SMALLEST
+ * Stand on the cursor holding the smallest value
+ ********************************************/
+template <class T, class Hash>
+void ShardedBST <T, Hash> :: iterator :: findSmallest()
+{
+   iCurrent = 0;
+   for (size_t i = 1; i < cursors.size(); i++)
+      if (*cursors[i].first < *cursors[iCurrent].first)
+         iCurrent = i;
+}
+
+} // namespace custom
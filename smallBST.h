@@ -0,0 +1,432 @@
+/***********************************************************************
+ * Header:
+ *    SMALL BST
+ * Summary:
+ *    A BST that keeps its first few values in a sorted array inside
+ *    the object itself and only builds nodes once it outgrows it.
+ *    Most sets in practice are tiny, and a set of a dozen values
+ *    should not cost a dozen trips to the allocator.
+ *
+ *    This will contain the class definition of:
+ *        SmallBST               : A BST with inline storage for N values
+ *        SmallBST::iterator     : An iterator through the SmallBST
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include "bst.h"      // where the values go once there are too many
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <initializer_list>
+#include <new>        // for placement new
+#include <type_traits> // for std::aligned_storage and std::is_arithmetic
+#include <utility>    // for std::move and std::forward
+
+namespace custom
+{
+
+/*****************************************************************
+ * SMALL BST
+ * Same interface as BST, for up to N values without a single
+ * allocation.
+ *
+ * While there are at most N values they sit in buffer, sorted,
+ * equal values side by side. The (N+1)-th insert moves them all
+ * into tree, middle first so the tree starts out balanced, and
+ * from then on tree holds everything until it empties again. It
+ * does not move back as soon as it shrinks to N, so a set that
+ * hovers around N does not build and tear down its tree over and
+ * over.
+ *
+ * The buffer is searched front to back, which for N around 16 is
+ * about as fast as a binary search and friendlier to the branch
+ * predictor. For numbers it counts how many values are less than
+ * the key without branching, a loop the compiler turns into
+ * vector compares.
+ *
+ * The empty tree is a member, not a pointer, so the object is the
+ * buffer plus a whole BST: SmallBST<int> is 224 bytes where the
+ * buffer alone is 64.
+ *****************************************************************/
+template <typename T, size_t N = 16>
+class SmallBST
+{
+   static_assert(N > 0, "SmallBST needs room for at least one value");
+public:
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   SmallBST() : numInline(0) {}
+   SmallBST(const SmallBST &  rhs) : numInline(0) { *this = rhs; }
+   SmallBST(      SmallBST && rhs) : numInline(0) { *this = std::move(rhs); }
+   SmallBST(const std::initializer_list<T> & il) : numInline(0) { *this = il; }
+   ~SmallBST() { clearInline(); }
+
+   //
+   // Assign
+   //
+
+   SmallBST & operator = (const SmallBST &  rhs);
+   SmallBST & operator = (      SmallBST && rhs);
+   SmallBST & operator = (const std::initializer_list<T> & il);
+   void swap(SmallBST & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const;
+   iterator end()   const { return iterator(); }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   size_t count(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false) { return insertValue(t, keepUnique); }
+   bool insert(      T && t, bool keepUnique = false) { return insertValue(std::move(t), keepUnique); }
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept { clearInline(); tree.clear(); }
+   bool erase(const T & t, bool eraseAll = false);
+
+   //
+   // Status
+   //
+
+   bool   empty()    const { return size() == 0; }
+   size_t size()     const { return isInline() ? numInline : tree.size(); }
+   bool   isInline() const { return tree.empty(); }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   typename std::aligned_storage<sizeof(T), alignof(T)>::type buffer[N];   // the inline values
+   size_t numInline;          // values in buffer, 0 once tree has them
+   BST <T> tree;              // every value, once there were more than N
+
+private:
+   T *       data()       { return reinterpret_cast<T *>(buffer);       }
+   const T * data() const { return reinterpret_cast<const T *>(buffer); }
+   size_t lowerBound(const T & t) const { return lowerBound(t, std::is_arithmetic<T>()); }
+   size_t lowerBound(const T & t, std::false_type) const;
+   size_t lowerBound(const T & t, std::true_type) const;
+   template <class U>
+   bool   insertValue(U && t, bool keepUnique);
+   void   eraseInline(size_t i);
+   void   clearInline() noexcept;
+   void   moveToTree(size_t iBegin, size_t iEnd);
+};
+
+/**********************************************************
+ * SMALL BST ITERATOR
+ * A pointer into the buffer while the values are inline,
+ * the tree's own iterator after that
+ *********************************************************/
+template <typename T, size_t N>
+class SmallBST <T, N> :: iterator
+{
+   friend class SmallBST <T, N>;
+public:
+   iterator() : p(nullptr), pEnd(nullptr) {}
+
+   bool operator == (const iterator & rhs) const { return p == rhs.p && it == rhs.it; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   const T & operator * () const { return p ? *p : *it; }
+
+   iterator & operator ++ ();
+   iterator   operator ++ (int) { iterator itOld(*this); ++(*this); return itOld; }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   iterator(const T * p, const T * pEnd) : p(p), pEnd(pEnd) {}
+   iterator(typename BST <T> :: iterator it) : p(nullptr), pEnd(nullptr), it(it) {}
+
+   const T * p;                       // current inline value, or nullptr
+   const T * pEnd;                    // one past the last inline value
+   typename BST <T> :: iterator it;   // current node once in the tree
+};
+
+/*********************************************
+ * SMALL BST ITERATOR :: INCREMENT
+ ********************************************/
+template <typename T, size_t N>
+typename SmallBST <T, N> :: iterator & SmallBST <T, N> :: iterator :: operator ++ ()
+{
+   if (p)
+   {
+      if (++p == pEnd)
+         p = pEnd = nullptr;
+   }
+   else
+      ++it;
+   return *this;
+}
+
+/*********************************************
+ * SMALL BST :: ASSIGNMENT OPERATOR
+ ********************************************/
+template <typename T, size_t N>
+SmallBST <T, N> & SmallBST <T, N> :: operator = (const SmallBST <T, N> & rhs)
+{
+   if (this == &rhs)
+      return *this;
+   clear();
+   if (rhs.isInline())
+   {
+      for (size_t i = 0; i < rhs.numInline; i++)
+         new (data() + i) T(rhs.data()[i]);
+      numInline = rhs.numInline;
+   }
+   else
+      tree = rhs.tree;
+   return *this;
+}
+
+/*********************************************
+ * SMALL BST :: ASSIGN-MOVE OPERATOR
+ * A tree changes hands; inline values are moved
+ * one at a time, at most N of them
+ ********************************************/
+template <typename T, size_t N>
+SmallBST <T, N> & SmallBST <T, N> :: operator = (SmallBST <T, N> && rhs)
+{
+   if (this == &rhs)
+      return *this;
+   clear();
+   if (rhs.isInline())
+   {
+      for (size_t i = 0; i < rhs.numInline; i++)
+         new (data() + i) T(std::move(rhs.data()[i]));
+      numInline = rhs.numInline;
+      rhs.clearInline();
+   }
+   else
+      tree = std::move(rhs.tree);
+   return *this;
+}
+
+/*********************************************
+ * SMALL BST :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T, size_t N>
+SmallBST <T, N> & SmallBST <T, N> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * SMALL BST :: SWAP
+ * Two trees swap pointers. Otherwise the inline
+ * values go through a third set, a move each way.
+ ********************************************/
+template <typename T, size_t N>
+void SmallBST <T, N> :: swap(SmallBST <T, N> & rhs)
+{
+   if (!isInline() && !rhs.isInline())
+   {
+      tree.swap(rhs.tree);
+      return;
+   }
+   SmallBST <T, N> temp(std::move(rhs));
+   rhs = std::move(*this);
+   *this = std::move(temp);
+}
+
+/*********************************************
+ * SMALL BST :: BEGIN
+ ********************************************/
+template <typename T, size_t N>
+typename SmallBST <T, N> :: iterator SmallBST <T, N> :: begin() const
+{
+   if (!isInline())
+      return iterator(tree.begin());
+   return numInline ? iterator(data(), data() + numInline) : end();
+}
+
+/****************************************************
+ * SMALL BST :: LOWER BOUND
+ * Index of the first inline value not less than t.
+ * Values of class type are compared until one is not
+ * less, using only operator< as the BST does.
+ ****************************************************/
+template <typename T, size_t N>
+size_t SmallBST <T, N> :: lowerBound(const T & t, std::false_type) const
+{
+   const T * a = data();
+   size_t i = 0;
+   while (i < numInline && a[i] < t)
+      i++;
+   return i;
+}
+
+/****************************************************
+ * SMALL BST :: LOWER BOUND
+ * Numbers are all compared: since the buffer is
+ * sorted, how many are less than t is where t goes
+ ****************************************************/
+template <typename T, size_t N>
+size_t SmallBST <T, N> :: lowerBound(const T & t, std::true_type) const
+{
+   const T * a = data();
+   size_t i = 0;
+   for (size_t k = 0; k < numInline; k++)
+      i += a[k] < t ? 1 : 0;
+   return i;
+}
+
+/****************************************************
+ * SMALL BST :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T, size_t N>
+const T * SmallBST <T, N> :: find(const T & t) const
+{
+   if (!isInline())
+      return tree.find(t);
+   size_t i = lowerBound(t);
+   return i < numInline && data()[i] == t ? data() + i : nullptr;
+}
+
+/****************************************************
+ * SMALL BST :: COUNT
+ * How many copies of t there are
+ ****************************************************/
+template <typename T, size_t N>
+size_t SmallBST <T, N> :: count(const T & t) const
+{
+   if (!isInline())
+      return tree.count(t);
+   size_t num = 0;
+   for (size_t i = lowerBound(t); i < numInline && data()[i] == t; i++)
+      num++;
+   return num;
+}
+
+/*****************************************************
+ * SMALL BST :: INSERT VALUE
+ * Slide the larger values up one to make room. With
+ * the buffer full, everything moves to the tree first.
+ ****************************************************/
+template <typename T, size_t N>
+template <class U>
+bool SmallBST <T, N> :: insertValue(U && t, bool keepUnique)
+{
+   if (!isInline())
+      return tree.insert(std::forward<U>(t), keepUnique);
+
+   T * a = data();
+   if (&t >= a && &t < a + numInline)
+      return insertValue(T(t), keepUnique);     // t is about to be slid over
+
+   size_t i = lowerBound(t);
+   if (keepUnique && i < numInline && a[i] == t)
+      return false;
+   if (numInline == N)
+   {
+      moveToTree(0, numInline);
+      clearInline();
+      return tree.insert(std::forward<U>(t));
+   }
+
+   if (i == numInline)
+      new (a + i) T(std::forward<U>(t));
+   else
+   {
+      new (a + numInline) T(std::move(a[numInline - 1]));
+      for (size_t k = numInline - 1; k > i; k--)
+         a[k] = std::move(a[k - 1]);
+      a[i] = std::forward<U>(t);
+   }
+   numInline++;
+   return true;
+}
+
+/*****************************************************
+ * SMALL BST :: MOVE TO TREE
+ * Insert the middle of the range, then each half the
+ * same way, so the tree comes out balanced
+ ****************************************************/
+template <typename T, size_t N>
+void SmallBST <T, N> :: moveToTree(size_t iBegin, size_t iEnd)
+{
+   if (iBegin == iEnd)
+      return;
+   size_t iMiddle = iBegin + (iEnd - iBegin) / 2;
+   tree.insert(std::move(data()[iMiddle]));
+   moveToTree(iBegin, iMiddle);
+   moveToTree(iMiddle + 1, iEnd);
+}
+
+/****************************************************
+ * SMALL BST :: ERASE
+ * Remove one copy of t, or every copy with eraseAll
+ ****************************************************/
+template <typename T, size_t N>
+bool SmallBST <T, N> :: erase(const T & t, bool eraseAll)
+{
+   if (!isInline())
+      return tree.erase(t, eraseAll);
+
+   T * a = data();
+   if (eraseAll && &t >= a && &t < a + numInline)
+      return erase(T(t), eraseAll);             // t is about to be slid over
+
+   size_t i = lowerBound(t);
+   if (i == numInline || !(a[i] == t))
+      return false;
+   do
+      eraseInline(i);
+   while (eraseAll && i < numInline && a[i] == t);
+   return true;
+}
+
+/*****************************************************
+ * SMALL BST :: ERASE INLINE
+ * Slide the larger values down over slot i
+ ****************************************************/
+template <typename T, size_t N>
+void SmallBST <T, N> :: eraseInline(size_t i)
+{
+   T * a = data();
+   for (; i + 1 < numInline; i++)
+      a[i] = std::move(a[i + 1]);
+   a[numInline - 1].~T();
+   numInline--;
+}
+
+/*****************************************************
+ * SMALL BST :: CLEAR INLINE
+ ****************************************************/
+template <typename T, size_t N>
+void SmallBST <T, N> :: clearInline() noexcept
+{
+   for (size_t i = 0; i < numInline; i++)
+      data()[i].~T();
+   numInline = 0;
+}
+
+} // namespace custom
@@ -0,0 +1,561 @@
+/***********************************************************************
+ * Header:
+ *    STRING BST
+ * Summary:
+ *    A binary search tree of strings that rarely reads the strings.
+ *    Each node remembers how much of its key it shares with its
+ *    parent and keeps the next eight bytes after that inside the
+ *    node. A search tracks how much of the key it has matched so
+ *    far, so shared prefixes are never compared twice, and most
+ *    steps are settled by those two numbers alone. URL and path
+ *    sets, where long prefixes repeat everywhere, gain the most.
+ *
+ *    This will contain the class definition of:
+ *        StringBST              : A BST of std::string
+ *        StringBST::iterator    : An iterator through the StringBST
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t
+#include <initializer_list>
+#include <string>     // for std::string
+#include <utility>    // for std::move
+#include <vector>     // for the copy's work list
+
+namespace custom
+{
+
+/*****************************************************************
+ * STRING BST
+ * Same interface as BST, for std::string only.
+ *
+ * How a step is settled. Say the search has matched l bytes of the
+ * parent p, and the node x shares offset bytes with p:
+ *    l < offset : x agrees with p where the key leaves p, so the key
+ *                 goes the same way at x as it did at p
+ *    l > offset : the key agrees with p where x leaves p, so the key
+ *                 goes the way p does from x
+ *    l == offset: compare from offset on, first with the eight bytes
+ *                 cached in x, and only if those tie with x's string
+ * Only the last case touches the node's string, and only after the
+ * part both already share. Short keys fit inside std::string itself,
+ * so for them even that read stays in the node.
+ *****************************************************************/
+class StringBST
+{
+public:
+   class SNode;
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   StringBST() : root(nullptr), numElements(0), numStringReads(0) {}
+   StringBST(const StringBST &  rhs) : StringBST() { *this = rhs; }
+   StringBST(      StringBST && rhs) : StringBST() { swap(rhs); }
+   StringBST(const std::initializer_list<std::string> & il) : StringBST() { *this = il; }
+   ~StringBST() { clear(); }
+
+   //
+   // Assign
+   //
+
+   StringBST & operator = (const StringBST &  rhs);
+   StringBST & operator = (      StringBST && rhs);
+   StringBST & operator = (const std::initializer_list<std::string> & il);
+   void swap(StringBST & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const;
+   iterator end()   const;
+
+   //
+   // Access
+   //
+
+   const std::string * find(const std::string & s) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const std::string &  s, bool keepUnique = false);
+   bool insert(      std::string && s, bool keepUnique = false);
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const std::string & s);
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   SNode * root;                    // root node of the tree
+   size_t numElements;              // number of strings in the tree
+   mutable size_t numStringReads;   // steps that had to read a node's string
+
+   static uint64_t pack(const std::string & s, size_t offset);
+   static size_t   commonPrefix(const std::string & a, const std::string & b);
+
+private:
+   SNode * descend(const std::string & s, bool fStopOnEqual, SNode * & pParent, bool & fLeft) const;
+   int     compareFrom(const std::string & s, const SNode * p, size_t & lcp) const;
+   template <class U>
+   bool    insertValue(U && s, bool keepUnique);
+   void    eraseNode(SNode * pDelete);
+   void    replaceChild(SNode * pParent, SNode * pOld, SNode * pNew);
+
+   static void     setParent(SNode * p, SNode * pParent);
+   static SNode *  copy(const SNode * pSrc, SNode * pParent);
+   static void     clear(SNode * & p);
+};
+
+/*****************************************************************
+ * STRING BST NODE
+ * The string, plus how it relates to its parent's string. The
+ * offset and key8 must be refreshed whenever the parent changes.
+ *****************************************************************/
+class StringBST :: SNode
+{
+public:
+   SNode(const std::string & s) : data(s),            key8(0), offset(0), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}
+   SNode(std::string && s)      : data(std::move(s)), key8(0), offset(0), pLeft(nullptr), pRight(nullptr), pParent(nullptr) {}
+
+   bool isLeftChild(const SNode * p) const { return pLeft == p; }
+
+   std::string data;        // the key; a short one is held inside the string itself
+   uint64_t key8;           // data's eight bytes from offset on, big-endian, zero-padded
+   size_t offset;           // bytes of data shared with the parent's data
+   SNode * pLeft;           // left child - smaller
+   SNode * pRight;          // right child - larger
+   SNode * pParent;         // parent
+};
+
+/**********************************************************
+ * STRING BST ITERATOR
+ * Walks the parent links, like the BST iterator
+ *********************************************************/
+class StringBST :: iterator
+{
+public:
+   iterator(const SNode * p = nullptr) : pNode(p) {}
+
+   bool operator == (const iterator & rhs) const { return pNode == rhs.pNode; }
+   bool operator != (const iterator & rhs) const { return pNode != rhs.pNode; }
+
+   const std::string & operator * () const { assert(pNode); return pNode->data; }
+
+   iterator & operator ++ ()
+   {
+      assert(pNode);
+      if (pNode->pRight)
+      {
+         pNode = pNode->pRight;
+         while (pNode->pLeft)
+            pNode = pNode->pLeft;
+         return *this;
+      }
+      const SNode * pChild = pNode;
+      pNode = pNode->pParent;
+      while (pNode && pNode->pRight == pChild)
+      {
+         pChild = pNode;
+         pNode = pNode->pParent;
+      }
+      return *this;
+   }
+   iterator operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+private:
+   const SNode * pNode;     // current node
+};
+
+/*********************************************
+ * STRING BST :: ASSIGNMENT OPERATOR
+ * Same shape, so the offsets carry over
+ ********************************************/
+inline StringBST & StringBST :: operator = (const StringBST & rhs)
+{
+   if (this == &rhs)
+      return *this;
+   clear();
+   root = copy(rhs.root, nullptr);
+   numElements = rhs.numElements;
+   return *this;
+}
+
+/*********************************************
+ * STRING BST :: ASSIGN-MOVE OPERATOR
+ ********************************************/
+inline StringBST & StringBST :: operator = (StringBST && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * STRING BST :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+inline StringBST & StringBST :: operator = (const std::initializer_list<std::string> & il)
+{
+   clear();
+   for (const std::string & s : il)
+      insert(s);
+   return *this;
+}
+
+/*********************************************
+ * STRING BST :: SWAP
+ ********************************************/
+inline void StringBST :: swap(StringBST & rhs)
+{
+   std::swap(root, rhs.root);
+   std::swap(numElements, rhs.numElements);
+   std::swap(numStringReads, rhs.numStringReads);
+}
+
+/*********************************************
+ * STRING BST :: BEGIN and END
+ ********************************************/
+inline StringBST :: iterator StringBST :: begin() const
+{
+   const SNode * p = root;
+   while (p && p->pLeft)
+      p = p->pLeft;
+   return iterator(p);
+}
+
+inline StringBST :: iterator StringBST :: end() const
+{
+   return iterator(nullptr);
+}
+
+/*********************************************
+ * STRING BST :: PACK
+ * Eight bytes of s from offset on, the first in the
+ * high byte, so comparing two packs as numbers compares
+ * the bytes in order. Bytes past the end read as zero.
+ ********************************************/
+inline uint64_t StringBST :: pack(const std::string & s, size_t offset)
+{
+   uint64_t key = 0;
+   for (size_t i = offset; i < offset + 8; i++)
+      key = (key << 8) | (i < s.size() ? (unsigned char)s[i] : 0);
+   return key;
+}
+
+/*********************************************
+ * STRING BST :: COMMON PREFIX
+ * How many leading bytes a and b share
+ ********************************************/
+inline size_t StringBST :: commonPrefix(const std::string & a, const std::string & b)
+{
+   size_t n = a.size() < b.size() ? a.size() : b.size();
+   size_t i = 0;
+   while (i < n && a[i] == b[i])
+      i++;
+   return i;
+}
+
+/*********************************************
+ * STRING BST :: SET PARENT
+ * Hang p from pParent and refresh what p caches
+ * about the prefix it shares with it
+ ********************************************/
+inline void StringBST :: setParent(SNode * p, SNode * pParent)
+{
+   if (!p)
+      return;
+   p->pParent = pParent;
+   p->offset = pParent ? commonPrefix(p->data, pParent->data) : 0;
+   p->key8 = pack(p->data, p->offset);
+}
+
+/*********************************************
+ * STRING BST :: COMPARE FROM
+ * Order s against p's string, given that they agree on
+ * the first p->offset bytes. lcp is set to how many they
+ * really share. A prefix sorts before what it prefixes.
+ * The padding past the end of a string is not a byte it
+ * holds, so a difference found there means the shorter
+ * string is a prefix of the other, whatever its last
+ * bytes are: zero bytes are as real as any other.
+ ********************************************/
+inline int StringBST :: compareFrom(const std::string & s, const SNode * p, size_t & lcp) const
+{
+   // the cached bytes settle it unless they tie
+   uint64_t key = pack(s, p->offset);
+   if (key != p->key8)
+   {
+      uint64_t diff = key ^ p->key8;
+      size_t numSame = 0;
+      while (!(diff & 0xff00000000000000ull))
+      {
+         diff <<= 8;
+         numSame++;
+      }
+      const std::string & t = p->data;
+      lcp = p->offset + numSame;
+      if (lcp > s.size())
+         lcp = s.size();
+      if (lcp > t.size())
+         lcp = t.size();
+      return key < p->key8 ? -1 : 1;
+   }
+
+   // a tie may hide a zero byte against the end of a string, so read on
+   numStringReads++;
+   const std::string & t = p->data;
+   size_t i = p->offset;
+   size_t n = s.size() < t.size() ? s.size() : t.size();
+   while (i < n && s[i] == t[i])
+      i++;
+   lcp = i;
+   if (i < n)
+      return (unsigned char)s[i] < (unsigned char)t[i] ? -1 : 1;
+   return s.size() == t.size() ? 0 : (s.size() < t.size() ? -1 : 1);
+}
+
+/*********************************************
+ * STRING BST :: DESCEND
+ * Walk down toward s. With fStopOnEqual the first node
+ * equal to s is returned; otherwise equal strings go right.
+ * pParent and fLeft say where s would be attached.
+ ********************************************/
+inline StringBST :: SNode * StringBST :: descend(const std::string & s, bool fStopOnEqual,
+                                                SNode * & pParent, bool & fLeft) const
+{
+   pParent = nullptr;
+   fLeft = false;
+   size_t lcp = 0;                    // bytes s shares with pParent
+   SNode * p = root;
+   while (p)
+   {
+      int cmp;
+      if (lcp < p->offset)
+         cmp = fLeft ? -1 : 1;
+      else if (lcp > p->offset)
+      {
+         cmp = fLeft ? 1 : -1;
+         lcp = p->offset;
+      }
+      else
+         cmp = compareFrom(s, p, lcp);
+
+      if (cmp == 0 && fStopOnEqual)
+         return p;
+      pParent = p;
+      fLeft = cmp < 0;
+      p = fLeft ? p->pLeft : p->pRight;
+   }
+   return nullptr;
+}
+
+/****************************************************
+ * STRING BST :: FIND
+ * Return a pointer to the string if it exists, nullptr otherwise
+ ****************************************************/
+inline const std::string * StringBST :: find(const std::string & s) const
+{
+   SNode * pParent;
+   bool fLeft;
+   SNode * p = descend(s, true /* fStopOnEqual */, pParent, fLeft);
+   return p ? &p->data : nullptr;
+}
+
+/*****************************************************
+ * STRING BST :: INSERT
+ ****************************************************/
+inline bool StringBST :: insert(const std::string & s, bool keepUnique)
+{
+   return insertValue(s, keepUnique);
+}
+
+inline bool StringBST :: insert(std::string && s, bool keepUnique)
+{
+   return insertValue(std::move(s), keepUnique);
+}
+
+/*****************************************************
+ * STRING BST :: INSERT VALUE
+ * Shared by the copy and move versions of insert
+ ****************************************************/
+template <class U>
+bool StringBST :: insertValue(U && s, bool keepUnique)
+{
+   SNode * pParent;
+   bool fLeft;
+   if (descend(s, keepUnique, pParent, fLeft))
+      return false;
+
+   SNode * pNew = new SNode(std::forward<U>(s));
+   setParent(pNew, pParent);
+   if (!pParent)
+      root = pNew;
+   else if (fLeft)
+      pParent->pLeft = pNew;
+   else
+      pParent->pRight = pNew;
+   numElements++;
+   return true;
+}
+
+/*****************************************************
+ * STRING BST :: CLEAR
+ ****************************************************/
+inline void StringBST :: clear() noexcept
+{
+   clear(root);
+   numElements = 0;
+}
+
+/*****************************************************
+ * STRING BST :: CLEAR SUBTREE
+ * Sorted input makes a chain, so rather than recurse,
+ * rotate each left child up until there is none, then
+ * free the node and go on to its right child
+ ****************************************************/
+inline void StringBST :: clear(SNode * & pThis)
+{
+   SNode * p = pThis;
+   while (p)
+   {
+      if (p->pLeft)
+      {
+         SNode * pLeft = p->pLeft;
+         p->pLeft = pLeft->pRight;
+         pLeft->pRight = p;
+         p = pLeft;
+      }
+      else
+      {
+         SNode * pRight = p->pRight;
+         delete p;
+         p = pRight;
+      }
+   }
+   pThis = nullptr;
+}
+
+/*************************************************
+ * STRING BST :: ERASE
+ * Remove one copy of s
+ ************************************************/
+inline bool StringBST :: erase(const std::string & s)
+{
+   SNode * pParent;
+   bool fLeft;
+   SNode * pDelete = descend(s, true /* fStopOnEqual */, pParent, fLeft);
+   if (!pDelete)
+      return false;
+   eraseNode(pDelete);
+   return true;
+}
+
+/*************************************************
+ * STRING BST :: REPLACE CHILD
+ * Point whatever pointed at pOld at pNew
+ ************************************************/
+inline void StringBST :: replaceChild(SNode * pParent, SNode * pOld, SNode * pNew)
+{
+   if (!pParent)
+      root = pNew;
+   else if (pParent->isLeftChild(pOld))
+      pParent->pLeft = pNew;
+   else
+      pParent->pRight = pNew;
+   setParent(pNew, pParent);
+}
+
+/*************************************************
+ * STRING BST :: ERASE NODE
+ * Unhook a node and free it. A node with two children is
+ * replaced by its in-order successor. Every node that
+ * gets a new parent has its offset and key8 refreshed.
+ ************************************************/
+inline void StringBST :: eraseNode(SNode * pDelete)
+{
+   if (!pDelete->pLeft)
+      replaceChild(pDelete->pParent, pDelete, pDelete->pRight);
+   else if (!pDelete->pRight)
+      replaceChild(pDelete->pParent, pDelete, pDelete->pLeft);
+   else
+   {
+      // the successor is the left-most node of the right subtree
+      SNode * pReplace = pDelete->pRight;
+      while (pReplace->pLeft)
+         pReplace = pReplace->pLeft;
+
+      // pull the successor out of its current spot
+      if (pReplace->pParent != pDelete)
+      {
+         replaceChild(pReplace->pParent, pReplace, pReplace->pRight);
+         pReplace->pRight = pDelete->pRight;
+      }
+      pReplace->pLeft = pDelete->pLeft;
+      replaceChild(pDelete->pParent, pDelete, pReplace);
+      setParent(pReplace->pLeft, pReplace);
+      setParent(pReplace->pRight, pReplace);
+   }
+
+   delete pDelete;
+   numElements--;
+}
+
+/*************************************************
+ * STRING BST :: COPY
+ * A node for node copy, cached prefixes and all. The
+ * nodes still to copy wait on an explicit stack, so a
+ * chain from sorted input cannot overflow the call stack.
+ ************************************************/
+inline StringBST :: SNode * StringBST :: copy(const SNode * pSrc, SNode * pParent)
+{
+   struct Pending
+   {
+      SNode * * ppDest;
+      const SNode * pSrc;
+      SNode * pParent;
+   };
+   SNode * pRoot = nullptr;
+   std::vector<Pending> stack;
+   if (pSrc)
+      stack.push_back({ &pRoot, pSrc, pParent });
+   while (!stack.empty())
+   {
+      Pending next = stack.back();
+      stack.pop_back();
+      SNode * p = new SNode(next.pSrc->data);
+      p->key8 = next.pSrc->key8;
+      p->offset = next.pSrc->offset;
+      p->pParent = next.pParent;
+      *next.ppDest = p;
+      if (next.pSrc->pRight)
+         stack.push_back({ &p->pRight, next.pSrc->pRight, p });
+      if (next.pSrc->pLeft)
+         stack.push_back({ &p->pLeft, next.pSrc->pLeft, p });
+   }
+   return pRoot;
+}
+
+} // namespace custom
@@ -0,0 +1,329 @@
+/***********************************************************************
+ * Header:
+ *    TEST ADAPTIVE SET
+ * Summary:
+ *    Unit tests for the set that switches between a tree and an array
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "adaptiveSet.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <set>
+#include <vector>
+
+ /***********************************************
+  * TEST ADAPTIVE SET
+  * Unit tests for the AdaptiveSet class
+  ***********************************************/
+class TestAdaptiveSet : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_startsAsTree();
+      test_find_readsMoveToArray();
+      test_find_constNeverMoves();
+      test_insert_appendStaysArray();
+      test_insert_slidingMovesToTree();
+      test_mixed_doesNotFlap();
+      test_erase_array();
+      test_constructCopy_bothForms();
+      test_random_matchesStdSet();
+
+      report("AdaptiveSet");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a set that is only written stays a tree
+   void test_insert_startsAsTree()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         set.insert((i * 37) % 1000);
+      // verify
+      assertUnit(!set.isArray());
+      assertUnit(set.numMigrations == 0);
+      assertUnit(set.array.empty());
+      assertUnit(set.size() == 1000);
+      assertUnit(inOrder(set) == range(0, 1000));
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // a window of nothing but finds moves every value, without a copy, into the array;
+   // the window the inserts ended in has to run out first
+   void test_find_readsMoveToArray()
+   {  // setup
+      custom::AdaptiveSet <Spy> set;
+      for (int i = 0; i < 100; i++)
+         set.insert(Spy((i * 37) % 100));
+      Spy s(42);
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 163; i++)
+         set.find(s);
+      bool fArrayBefore = set.isArray();
+      const Spy * p = set.find(s);
+      // verify
+      assertUnit(fArrayBefore == false);
+      assertUnit(set.isArray());
+      assertUnit(set.numMigrations == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(set.tree.root == nullptr);
+      assertUnit(set.array.size() == 100);
+      assertUnit(p == &set.array[42]);
+      assertUnit(inOrder(set) == range(0, 100));
+   }  // teardown
+
+   // through a const reference nothing is counted and nothing moves
+   void test_find_constNeverMoves()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      for (int i = 0; i < 100; i++)
+         set.insert(i);
+      const custom::AdaptiveSet <int> & setConst = set;
+      // exercise
+      size_t numFound = 0;
+      for (int i = 0; i < 1000; i++)
+         numFound += setConst.find(i % 200) != nullptr;
+      // verify
+      assertUnit(numFound == 500);
+      assertUnit(!set.isArray());
+      assertUnit(set.numReads == 0);
+      assertUnit(set.numMigrations == 0);
+   }  // teardown
+
+   /***************************************
+    * INSERT into the ARRAY
+    ***************************************/
+
+   // values added past the end slide nothing, so a sorted load stays in the array
+   void test_insert_appendStaysArray()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      readOnly(set, 100);
+      assertUnit(set.isArray());
+      // exercise
+      for (int i = 100; i < 10000; i++)
+         set.insert(i);
+      // verify
+      assertUnit(set.isArray());
+      assertUnit(set.numMigrations == 1);
+      assertUnit(inOrder(set) == range(0, 10000));
+   }  // teardown
+
+   // values added at the front slide everything; past the budget the tree takes over
+   void test_insert_slidingMovesToTree()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      readOnly(set, 1000);
+      assertUnit(set.isArray());
+      // exercise
+      int numInserted = 0;
+      while (set.isArray() && numInserted < 100)
+         set.insert(-++numInserted);
+      // verify
+      assertUnit(numInserted == 9);                // 9 slides of 1000 or more
+      assertUnit(set.numMigrations == 2);
+      assertUnit(set.array.empty());
+      assertUnit(set.array.capacity() == 0);
+      assertUnit(set.tree.root != nullptr);
+      assertUnit(depth(set.tree.root) == 10);     // 1009 values, rebuilt balanced
+      assertUnit(inOrder(set) == range(-9, 1000));
+   }  // teardown
+
+   /***************************************
+    * MIXED
+    ***************************************/
+
+   // a steady mix picks one form and keeps it
+   void test_mixed_doesNotFlap()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      for (int i = 0; i < 1000; i++)
+         set.insert(i * 2);
+      unsigned int seed = 7;
+      // exercise
+      for (int i = 0; i < 20000; i++)          // one write in a hundred
+         mixedOp(set, seed, 100);
+      bool fArrayWhileWriting = set.isArray();
+      size_t numMigrationsWhileWriting = set.numMigrations;
+      for (int i = 0; i < 20000; i++)          // one write in five thousand
+         mixedOp(set, seed, 5000);
+      // verify
+      assertUnit(fArrayWhileWriting == false);
+      assertUnit(numMigrationsWhileWriting == 0);
+      assertUnit(set.isArray());
+      assertUnit(set.numMigrations == 1);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase one copy, then all of them, straight out of the array
+   void test_erase_array()
+   {  // setup
+      custom::AdaptiveSet <int> set{ 20, 40, 40, 40, 60 };
+      for (int i = 0; i < 64; i++)
+         set.find(0);
+      assertUnit(set.isArray());
+      // exercise
+      bool fReturn1 = set.erase(40);
+      bool fReturn2 = set.erase(40, true /* eraseAll */);
+      bool fReturn3 = set.erase(40);
+      bool fReturn4 = set.insert(60, true /* keepUnique */);
+      bool fReturn5 = set.insert(60);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      assertUnit(fReturn4 == false);
+      assertUnit(fReturn5 == true);
+      assertUnit(set.isArray());
+      assertUnit(set.count(60) == 2);
+      assertUnit(inOrder(set) == std::vector<int>({ 20, 60, 60 }));
+   }  // teardown
+
+   /***************************************
+    * COPY and SWAP
+    ***************************************/
+
+   // copies and swaps carry the form along with the values
+   void test_constructCopy_bothForms()
+   {  // setup
+      custom::AdaptiveSet <int> setTree{ 3, 1, 2 };
+      custom::AdaptiveSet <int> setArray;
+      readOnly(setArray, 5);
+      // exercise
+      custom::AdaptiveSet <int> setTreeCopy(setTree);
+      custom::AdaptiveSet <int> setArrayCopy(setArray);
+      setTreeCopy.insert(9);
+      setArrayCopy.erase(0);
+      setTree.swap(setArray);
+      // verify
+      assertUnit(!setTreeCopy.isArray());
+      assertUnit(inOrder(setTreeCopy) == std::vector<int>({ 1, 2, 3, 9 }));
+      assertUnit(setArrayCopy.isArray());
+      assertUnit(inOrder(setArrayCopy) == std::vector<int>({ 1, 2, 3, 4 }));
+      assertUnit(setTree.isArray());
+      assertUnit(inOrder(setTree) == range(0, 5));
+      assertUnit(!setArray.isArray());
+      assertUnit(inOrder(setArray) == std::vector<int>({ 1, 2, 3 }));
+   }  // teardown
+
+   /***************************************
+    * RANDOM
+    ***************************************/
+
+   // inserts, erases, and finds agree with std::multiset through
+   // write-heavy and read-heavy phases, in both forms
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::AdaptiveSet <int> set;
+      std::multiset<int> reference;
+      unsigned int seed = 99;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 40000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int value = (int)((seed >> 8) % 300);
+         bool fWriting = (i / 5000) % 2 == 0;      // mostly writes, then mostly finds
+         unsigned int dice = (seed >> 4) % 10000;
+         if (dice < (fWriting ? 4000u : 1u))
+         {
+            set.insert(value);
+            reference.insert(value);
+         }
+         else if (dice < (fWriting ? 7000u : 2u))
+         {
+            auto it = reference.find(value);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += set.erase(value) != fFound;
+         }
+         else
+            numDifferent += set.count(value) != reference.count(value);
+         numDifferent += set.size() != reference.size();
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(set.numMigrations >= 4);
+      assertUnit(inOrder(set) == std::vector<int>(reference.begin(), reference.end()));
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // fill with 0 .. n-1, then find until the set moves to the array
+   static void readOnly(custom::AdaptiveSet <int> & set, int n)
+   {
+      for (int i = 0; i < n; i++)
+         set.insert(i);
+      for (int i = 0; !set.isArray() && i < 10 * n + 1000; i++)
+         set.find(i % n);
+   }
+
+   // one random find, or once in a while a random insert or erase
+   static void mixedOp(custom::AdaptiveSet <int> & set, unsigned int & seed, unsigned int every)
+   {
+      seed = seed * 1103515245 + 12345;
+      int value = (int)((seed >> 8) % 2000);
+      if ((seed >> 4) % every != 0)
+         set.find(value);
+      else if (!set.erase(value))
+         set.insert(value);
+   }
+
+   // every value, in the order the iterator gives them
+   template <class T>
+   static std::vector<int> inOrder(const custom::AdaptiveSet <T> & set)
+   {
+      std::vector<int> values;
+      for (auto it = set.begin(); it != set.end(); ++it)
+         values.push_back(valueOf(*it));
+      return values;
+   }
+   static int valueOf(int i)         { return i;       }
+   static int valueOf(const Spy & s) { return s.get(); }
+
+   // iBegin .. iEnd-1
+   static std::vector<int> range(int iBegin, int iEnd)
+   {
+      std::vector<int> values;
+      for (int i = iBegin; i < iEnd; i++)
+         values.push_back(i);
+      return values;
+   }
+
+   // levels in the tree below p
+   static int depth(const custom::BST <int>::BNode * p)
+   {
+      if (!p)
+         return 0;
+      int depthLeft = depth(p->pLeft);
+      int depthRight = depth(p->pRight);
+      return 1 + (depthLeft > depthRight ? depthLeft : depthRight);
+   }
+};
+
+#endif // DEBUG
@@ -13,6 +13,21 @@
 
 #include "testBST.h"        // for the BST unit tests
 #include "testSpy.h"        // for the spy unit tests
+#include "testMap.h"        // for the map unit tests
+#include "testPersistentBST.h" // for the persistent bst unit tests
+#include "testCowBST.h"     // for the copy-on-write bst unit tests
+#include "testConcurrentBST.h" // for the concurrent bst unit tests
+#include "testEpoch.h"      // for the epoch unit tests
+#include "testShardedBST.h" // for the sharded bst unit tests
+#include "testTreap.h"      // for the treap unit tests
+#include "testBloom.h"      // for the bloom filter unit tests
+#include "testIndexedBST.h" // for the indexed bst unit tests
+#include "testStringBST.h"  // for the string bst unit tests
+#include "testRadixSet.h"   // for the radix set unit tests
+#include "testRoaringSet.h" // for the roaring set unit tests
+#include "testSmallBST.h"   // for the small bst unit tests
+#include "testAdaptiveSet.h" // for the adaptive set unit tests
+#include "testLsmSet.h"     // for the lsm set unit tests
 int Spy::counters[] = {};
 
 /**********************************************************************
@@ -25,6 +40,21 @@ int main()
    // unit tests
    TestSpy().run();
    TestBST().run();
+   TestMap().run();
+   TestPersistentBST().run();
+   TestCowBST().run();
+   TestConcurrentBST().run();
+   TestEpoch().run();
+   TestShardedBST().run();
+   TestTreap().run();
+   TestBloom().run();
+   TestIndexedBST().run();
+   TestStringBST().run();
+   TestRadixSet().run();
+   TestRoaringSet().run();
+   TestSmallBST().run();
+   TestAdaptiveSet().run();
+   TestLsmSet().run();
 #endif // DEBUG
    
    return 0;
@@ -16,10 +16,14 @@
 #include "spy.h"
 
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <memory>
 #include <iostream>
 #include <string>
+#include <thread>     // for readers sharing a const tree
 #include <functional> // for std::less and std::greater
+#include <vector>
 
  /***********************************************
   * TEST BST
@@ -65,6 +69,9 @@ public:
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_findBatch_empty();
+      test_findBatch_standard();
+      test_findBatch_large();
 
       // Insert
       test_insert_oneLeft();
@@ -84,6 +91,7 @@ public:
       test_erase_twoChildren();
       test_clear_empty();
       test_clear_standard();
+      test_clear_deepChain();
 
       // Status
       test_empty_empty();
@@ -91,6 +99,81 @@ public:
       test_size_empty();
       test_size_standard();
 
+      // Multiset
+      test_multiset_insert();
+      test_multiset_erase();
+      test_multiset_eraseAll();
+      test_multiset_iterate();
+      test_count_duplicates();
+      test_erase_allOwnData();
+
+      // Batch
+      test_applyBatch_walk();
+      test_applyBatch_sharesPath();
+      test_applyBatch_rebuild();
+      test_applyBatch_duplicates();
+      test_applyBatch_multiset();
+      test_applyBatch_appendStaysAtEnd();
+
+      // Splay
+      test_splay_findZigZig();
+      test_splay_findZigZag();
+      test_splay_findMissing();
+      test_splay_semi();
+      test_splay_period();
+      test_splay_insertErase();
+
+      // Scapegoat
+      test_node_noColor();
+      test_scapegoat_sortedInsert();
+      test_scapegoat_enableRebuilds();
+      test_scapegoat_eraseRebuilds();
+      test_scapegoat_mixed();
+
+      // Finger
+      test_lowerBound_finger();
+      test_find_fingerNearby();
+      test_insert_fingerChain();
+      test_finger_lastPosition();
+      test_finger_eraseMovesFinger();
+      test_finger_sortedInsertSteps();
+      test_finger_matchesRoot();
+
+      // Buffered
+      test_buffered_insertQueues();
+      test_buffered_fullQueueApplies();
+      test_buffered_sameValueInOrder();
+      test_buffered_constFindSees();
+      test_buffered_keepUniqueApplies();
+      test_buffered_eraseAllApplies();
+      test_buffered_fingerDropped();
+      test_buffered_largeBurst();
+
+      // Ends
+      test_minMax_standard();
+      test_minMax_insertKeepsEnds();
+      test_popMin_inOrder();
+      test_popMin_noSearch();
+      test_popMax_multiset();
+      test_ends_swapMoveClear();
+      test_ends_copyReadersShare();
+      test_ends_splayAndBatch();
+
+      // Bulk removal
+      test_eraseIf_keepsNodes();
+      test_eraseIf_noneAndAll();
+      test_eraseIf_multiset();
+      test_eraseIf_bloom();
+      test_eraseIf_throwLeavesTree();
+      test_partition_movesNodes();
+
+      // Rebalance
+      test_rebalance_vine();
+      test_rebalance_complete();
+      test_autoRebalance_subtree();
+      test_autoRebalance_sortedInsert();
+      test_autoRebalance_excludesOthers();
+
       report("BST");
    }
    
@@ -144,7 +227,7 @@ public:
       //            (50)
       custom::BST <Spy> bstSrc;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bstSrc.root = p50;
+      bstSrc.root = bstSrc.pMin = bstSrc.pMax = p50;
       bstSrc.numElements = 1;
       Spy::reset();
       // exercise
@@ -264,7 +347,7 @@ public:
       //            (50) 
       custom::BST <Spy> bstSrc;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bstSrc.root = p50;
+      bstSrc.root = bstSrc.pMin = bstSrc.pMax = p50;
       bstSrc.numElements = 1;
       Spy::reset();
       // exercise
@@ -560,7 +643,7 @@ public:
       //                (99) = bstDest
       custom::BST <Spy> bstDest;
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
-      bstDest.root = p99;
+      bstDest.root = bstDest.pMin = bstDest.pMax = p99;
       bstDest.numElements = 1;
       Spy::reset();
       // exercise
@@ -601,7 +684,7 @@ public:
       //                (99) = bstSrc
       custom::BST <Spy> bstSrc;
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
-      bstSrc.root = p99;
+      bstSrc.root = bstSrc.pMin = bstSrc.pMax = p99;
       bstSrc.numElements = 1;
       //                (50) = bstDest
       //          +-------+-------+
@@ -802,7 +885,7 @@ public:
       //                (99) = bstDest
       custom::BST <Spy> bstDest;
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
-      bstDest.root = p99;
+      bstDest.root = bstDest.pMin = bstDest.pMax = p99;
       bstDest.numElements = 1;
       Spy::reset();
       // exercise
@@ -836,7 +919,7 @@ public:
       //                (99) = bstSrc
       custom::BST <Spy> bstSrc;
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
-      bstSrc.root = p99;
+      bstSrc.root = bstSrc.pMin = bstSrc.pMax = p99;
       bstSrc.numElements = 1;
       //                (50) = bstDest
       //          +-------+-------+
@@ -1108,6 +1191,33 @@ public:
       assertEmptyFixture(bst);
    }  // teardown
 
+   // a chain far deeper than the call stack copies, reuses, and clears
+   void test_clear_deepChain()
+   {  // setup
+      const int num = 1000000;
+      custom::BST <int> bst;
+      custom::BST <int> :: iterator it = bst.end();
+      for (int i = 0; i < num; i++)
+         it = bst.insert(it, i);
+      custom::BST <int> bstShort{ 5, 3, 8 };
+      // exercise
+      custom::BST <int> bstCopy(bst);
+      bstShort = bst;
+      bst = bstCopy;                              // every node reused
+      // verify
+      int numWrong = 0;
+      int i = 0;
+      for (const custom::BST<int>::BNode * p = bstShort.root; p; p = p->pRight, i++)
+         numWrong += p->data != i || p->pLeft || (p->pRight && p->pRight->pParent != p);
+      assertUnit(i == num);
+      assertUnit(numWrong == 0);
+      assertUnit(bst.size() == (size_t)num);
+      assertUnit(bstShort.max() == num - 1);
+      bstCopy.clear();
+      assertUnit(bstCopy.root == nullptr);
+      assertUnit(bstCopy.empty());
+   }  // teardown
+
    /***************************************
     * Erase
     *    BST::erase(it)
@@ -1228,6 +1338,8 @@ public:
       auto p60 = new custom::BST<int>::BNode(60);
       auto p50 = new custom::BST<int>::BNode(50);
       bst.root = p10->pParent = p60->pParent = p50;
+      bst.pMin = p10;
+      bst.pMax = p60;
       p50->pLeft = p30->pParent = p10;
       p50->pRight = p60;
       p10->pRight = p20->pParent = p40->pParent = p30;
@@ -1289,6 +1401,8 @@ public:
       auto p70 = new custom::BST<int>::BNode(70);
       auto p80 = new custom::BST<int>::BNode(80);
       bst.root = p20->pParent = p80->pParent = p70;
+      bst.pMin = p10;
+      bst.pMax = p80;
       p10->pParent = p50->pParent = p70->pLeft = p20;
       p70->pRight = p80;
       p20->pLeft = p10;
@@ -1481,6 +1595,81 @@ public:
       teardownStandardFixture(bst);
    }
 
+   // a batch of lookups in an empty BST
+   void test_findBatch_empty()
+   {  // setup
+      custom::BST<Spy> bst;
+      std::vector<Spy> keys = { Spy(50), Spy(20) };
+      std::vector<const Spy *> out;
+      Spy::reset();
+      // exercise
+      bst.find_batch(keys, out);
+      // verify
+      assertUnit(Spy::numLessthan() == 0);    // does not look at any element
+      assertUnit(Spy::numEquals() == 0);      // does not look at any element
+      assertUnit(out.size() == 2);
+      assertUnit(out[0] == nullptr);
+      assertUnit(out[1] == nullptr);
+      assertEmptyFixture(bst);
+   }  // teardown
+
+   // a batch compares exactly what the single finds would
+   void test_findBatch_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      std::vector<Spy> keys = { Spy(20), Spy(80), Spy(42), Spy(50) };
+      std::vector<const Spy *> out;
+      Spy::reset();
+      // exercise
+      bst.find_batch(keys, out);
+      // verify
+      assertUnit(Spy::numEquals() == 10);     // 3 + 3 + 3 + 1
+      assertUnit(Spy::numLessthan() == 7);    // 2 + 2 + 3 + 0
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(out.size() == 4);
+      assertUnit(out[0] == &bst.root->pLeft->pLeft->data);
+      assertUnit(out[1] == &bst.root->pRight->pRight->data);
+      assertUnit(out[2] == nullptr);
+      assertUnit(out[3] == &bst.root->data);
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // many more keys than the batch runs at once, reporting the speedup
+   void test_findBatch_large()
+   {  // setup
+      custom::BST <int> bst;
+      const int numNodes = 1 << 18;
+      for (int i = 0; i < numNodes; i++)
+         bst.insert((int)(((unsigned int)i * 2654435761u) >> 1));
+      std::vector<int> keys;
+      for (int i = 0; i < numNodes; i++)
+         keys.push_back((int)(((unsigned int)(i * 7) * 2654435761u) >> 1) + (i & 1));
+      std::vector<const int *> out;
+      // exercise
+      auto start = std::chrono::steady_clock::now();
+      bst.find_batch(keys, out);
+      auto middle = std::chrono::steady_clock::now();
+      int numWrong = 0;
+      for (size_t i = 0; i < keys.size(); i++)
+         numWrong += (out[i] == bst.find(keys[i])) ? 0 : 1;
+      auto finish = std::chrono::steady_clock::now();
+      // verify
+      assertUnit(out.size() == keys.size());
+      assertUnit(numWrong == 0);
+      std::cerr << "\tBST find_batch speedup over find: "
+                << std::chrono::duration<double>(finish - middle).count() /
+                   std::chrono::duration<double>(middle - start).count() << "x\n";
+   }  // teardown
+
 
    /***************************************
     * Insert
@@ -1493,7 +1682,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(60);
       Spy::reset();
@@ -1549,7 +1738,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(40);
       Spy::reset();
@@ -1608,7 +1797,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(50);
       Spy::reset();
@@ -1709,7 +1898,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(60);
       Spy::reset();
@@ -1765,7 +1954,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(40);
       Spy::reset();
@@ -1825,7 +2014,7 @@ public:
       //            (50) 
       custom::BST <Spy> bst;
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
-      bst.root = p50;
+      bst.root = bst.pMin = bst.pMax = p50;
       bst.numElements = 1;
       Spy s(50);
       Spy::reset();
@@ -1917,6 +2106,1407 @@ public:
    }
 
 
+   /***************************************
+    * MULTISET
+    *    BST::setMultiset(true)
+    ***************************************/
+
+   // duplicates bump the count of the existing node
+   void test_multiset_insert()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setMultiset(true);
+      bst.insert(Spy(50));
+      Spy s(50);
+      Spy::reset();
+      // exercise
+      bool fReturn1 = bst.insert(s);
+      bool fReturn2 = bst.insert(s);
+      bool fReturn3 = bst.insert(s, true /* keepUnique */);
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      //            (50 x3)
+      assertUnit(bst.size() == 3);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(50));
+         assertUnit(bst.root->count == 3);
+         assertUnit(bst.root->pLeft == nullptr);
+         assertUnit(bst.root->pRight == nullptr);
+      }
+      assertUnit(bst.count(s) == 3);
+      assertUnit(bst.count(Spy(99)) == 0);
+   }  // teardown
+
+   // erase takes one copy at a time until the node is gone
+   void test_multiset_erase()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      bst.insert(50);
+      bst.insert(30);
+      bst.insert(30);
+      // exercise
+      bool fReturn1 = bst.erase(30);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(bst.size() == 2);
+      assertUnit(bst.count(30) == 1);
+      assertUnit(bst.root->pLeft != nullptr);
+      // exercise
+      bool fReturn2 = bst.erase(30);
+      bool fReturn3 = bst.erase(30);
+      // verify
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      assertUnit(bst.size() == 1);
+      assertUnit(bst.count(30) == 0);
+      assertUnit(bst.root->pLeft == nullptr);
+   }  // teardown
+
+   // erase all copies at once
+   void test_multiset_eraseAll()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i % 3);
+      // exercise
+      bool fReturn = bst.erase(1, true /* eraseAll */);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bst.size() == 667);
+      assertUnit(bst.count(0) == 334);
+      assertUnit(bst.count(1) == 0);
+      assertUnit(bst.count(2) == 333);
+   }  // teardown
+
+   // iteration expands every node to the number of copies
+   void test_multiset_iterate()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      for (int i : { 40, 20, 40, 60, 20, 40 })
+         bst.insert(i);
+      // exercise
+      int values[6] = {};
+      int num = 0;
+      for (auto it = bst.begin(); it != bst.end() && num < 6; ++it)
+         values[num++] = *it;
+      // verify
+      assertUnit(num == 6);
+      assertUnit(values[0] == 20);
+      assertUnit(values[1] == 20);
+      assertUnit(values[2] == 40);
+      assertUnit(values[3] == 40);
+      assertUnit(values[4] == 40);
+      assertUnit(values[5] == 60);
+   }  // teardown
+
+   // count walks every duplicate node when not in multiset mode
+   void test_count_duplicates()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 50, 70, 50, 30 })
+         bst.insert(i);
+      // exercise
+      size_t num50 = bst.count(50);
+      size_t num30 = bst.count(30);
+      size_t num99 = bst.count(99);
+      bst.erase(50, true /* eraseAll */);
+      // verify
+      assertUnit(num50 == 3);
+      assertUnit(num30 == 2);
+      assertUnit(num99 == 0);
+      assertUnit(bst.size() == 3);
+      assertUnit(bst.count(50) == 0);
+   }  // teardown
+
+   // eraseAll by a reference to a value inside the tree itself
+   void test_erase_allOwnData()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 50, 70, 50, 30, 20 })
+         bst.insert(i);
+      custom::BST <int> bstOne{ 1, 2, 3, 4 };
+      // exercise
+      bool fReturn = bst.erase(*bst.find(50), true /* eraseAll */);
+      bst.erase(*++bst.begin(), true /* eraseAll */);
+      bstOne.erase(*bstOne.begin(), true /* eraseAll */);
+      // verify
+      assertUnit(fReturn);
+      assertUnit(bst.size() == 2);
+      assertUnit(bst.count(50) == 0);
+      assertUnit(bst.count(30) == 0);
+      assertUnit(bst.min() == 20 && bst.max() == 70);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      assertUnit(bstOne.size() == 3);
+      assertUnit(bstOne.min() == 2);
+   }  // teardown
+
+   /***************************************
+    * BATCH
+    *    BST::apply_batch(ops)
+    ***************************************/
+
+   // a small batch is walked into the tree in place
+   void test_applyBatch_walk()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert((i * 37) % 100 * 2);   // the even numbers below 200
+      custom::BST <int> :: BNode * pRoot = bst.root;
+      // exercise
+      std::vector<bool> results = bst.apply_batch({
+         { 11, true }, { 12, false }, { 13, false }, { 90, true }, { 198, false } });
+      // verify
+      assertUnit(results.size() == 5);
+      assertUnit(results == std::vector<bool>({ true, true, false, true, true }));
+      assertUnit(bst.root == pRoot);               // not rebuilt
+      assertUnit(bst.size() == 100);
+      assertUnit(bst.find(11) && bst.find(90));
+      assertUnit(!bst.find(12) && !bst.find(198));
+      assertUnit(bst.count(90) == 2);
+   }  // teardown
+
+   // neighbouring values share their path from the root
+   void test_applyBatch_sharesPath()
+   {  // setup
+      custom::BST <Spy> bstOne;
+      for (int i = 0; i < 100; i++)
+         bstOne.insert(Spy((i * 37) % 100 * 10));
+      custom::BST <Spy> bstBatch(bstOne);
+      std::vector<custom::BST<Spy>::BatchOp> ops;
+      for (int i = 501; i < 590; i += 20)
+         ops.push_back({ Spy(i), true });
+      // exercise
+      Spy::reset();
+      for (auto & op : ops)
+         bstOne.insert(op.data);
+      int numOne = Spy::numLessthan();
+      Spy::reset();
+      std::vector<bool> results = bstBatch.apply_batch(ops);
+      int numBatch = Spy::numLessthan();
+      // verify
+      assertUnit(results == std::vector<bool>(5, true));
+      assertUnit(numBatch < numOne);
+      assertUnit(bstBatch.size() == 105);
+   }  // teardown
+
+   // a sorted batch past the largest value never goes back to the root
+   void test_applyBatch_appendStaysAtEnd()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 0; i < 1023; i++)
+         bst.insert(Spy(i));
+      bst.rebalance();
+      std::vector<custom::BST<Spy>::BatchOp> ops;
+      for (int i = 2000; i < 2100; i++)
+         ops.push_back({ Spy(i), true });
+      // exercise
+      Spy::reset();
+      std::vector<bool> results = bst.apply_batch(ops);
+      // verify
+      assertUnit(results == std::vector<bool>(100, true));
+      assertUnit(Spy::numLessthan() <= 10 + 100 * 3);   // one walk down, then three a value
+      assertUnit(bst.max() == Spy(2099));
+      assertUnit(bst.size() == 1123);
+   }  // teardown
+
+   // a large batch is merged and the tree rebuilt balanced
+   //                   8
+   //          +--------+--------+
+   //          4                 12
+   //     +----+----+       +----+----+
+   //     2         6      10        14
+   //   +-+-+     +-+-+   +-+-+    +-+-+
+   //   1   3     5   7   9  11   13  15
+   void test_applyBatch_rebuild()
+   {  // setup
+      custom::BST <int> bst;
+      std::vector<custom::BST<int>::BatchOp> ops;
+      for (int i = 1; i <= 15; i++)
+         ops.push_back({ i, true });
+      // exercise
+      std::vector<bool> results = bst.apply_batch(ops);
+      // verify
+      assertUnit(results == std::vector<bool>(15, true));
+      assertUnit(bst.size() == 15);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == 8);
+         assertUnit(bst.root->pParent == nullptr);
+         assertUnit(bst.root->pLeft->data == 4);
+         assertUnit(bst.root->pLeft->pParent == bst.root);
+         assertUnit(bst.root->pRight->pLeft->data == 10);
+         assertUnit(bst.root->pRight->pRight->pRight->data == 15);
+         assertUnit(bst.root->pRight->pRight->pRight->pRight == nullptr);
+      }
+   }  // teardown
+
+   // ops on the same value see each other, whichever way the batch goes
+   void test_applyBatch_duplicates()
+   {
+      for (int numExisting : { 0, 200 })
+      {  // setup
+         custom::BST <int> bst;
+         for (int i = 0; i < numExisting; i++)
+            bst.insert(1000 + i);
+         bst.insert(30);
+         // exercise
+         std::vector<bool> results = bst.apply_batch({
+            { 20, true }, { 20, true }, { 20, false }, { 20, false },
+            { 30, true }, { 30, false }, { 30, false } }, true /* keepUnique */);
+         // verify
+         assertUnit(results == std::vector<bool>({ true, false, true, false, false, true, false }));
+         assertUnit(bst.size() == (size_t)numExisting);
+         assertUnit(!bst.find(20));
+         assertUnit(!bst.find(30));
+      }  // teardown
+   }
+
+   // in multiset mode a batch bumps and drops counts
+   void test_applyBatch_multiset()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      bst.insert(40);
+      bst.insert(40);
+      // exercise
+      std::vector<bool> results = bst.apply_batch({
+         { 40, false }, { 40, true }, { 40, true }, { 50, true }, { 50, false }, { 50, false } });
+      // verify
+      assertUnit(results == std::vector<bool>({ true, true, true, true, true, false }));
+      assertUnit(bst.size() == 3);
+      assertUnit(bst.count(40) == 3);
+      assertUnit(bst.count(50) == 0);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+         assertUnit(bst.root->count == 3);
+   }  // teardown
+
+   /***************************************
+    * SPLAY
+    *    BST::setSplay(mode, period)
+    ***************************************/
+
+   // a found node two levels down in a line comes up by zig-zig
+   void test_splay_findZigZig()
+   {  // setup
+      //                 50
+      //          +-------+-------+
+      //         30              70
+      //     +----+----+     +----+----+
+      //    20        40    60        80
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.setSplay(custom::BST<Spy>::SPLAY_FULL);
+      Spy s(20);
+      Spy::reset();
+      // exercise
+      Spy * p = bst.find(s);
+      // verify
+      assertUnit(Spy::numEquals() == 3);      // check [50][30][20]
+      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      //    20
+      //     +----+
+      //         30
+      //          +----+
+      //              50
+      //          +----+----+
+      //         40        70
+      //                 +--+--+
+      //                60     80
+      assertUnit(p != nullptr);
+      assertUnit(bst.root != nullptr);
+      if (bst.root && p)
+      {
+         assertUnit(p == &bst.root->data);
+         assertUnit(bst.root->data == Spy(20));
+         assertUnit(bst.root->pParent == nullptr);
+         assertUnit(bst.root->pLeft == nullptr);
+         assertUnit(bst.root->pRight->data == Spy(30));
+         assertUnit(bst.root->pRight->pParent == bst.root);
+         assertUnit(bst.root->pRight->pLeft == nullptr);
+         assertUnit(bst.root->pRight->pRight->data == Spy(50));
+         assertUnit(bst.root->pRight->pRight->pLeft->data == Spy(40));
+         assertUnit(bst.root->pRight->pRight->pLeft->pParent == bst.root->pRight->pRight);
+         assertUnit(bst.root->pRight->pRight->pRight->data == Spy(70));
+      }
+      assertUnit(bst.size() == 7);
+   }  // teardown
+
+   // a found node that zig-zags comes up between its ancestors
+   void test_splay_findZigZag()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.setSplay(custom::BST<Spy>::SPLAY_FULL);
+      // exercise
+      bst.find(Spy(40));
+      // verify
+      //            40
+      //       +----+----+
+      //      30        50
+      //    +--+         +--+
+      //   20              70
+      //                 +--+--+
+      //                60     80
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(40));
+         assertUnit(bst.root->pLeft->data == Spy(30));
+         assertUnit(bst.root->pLeft->pLeft->data == Spy(20));
+         assertUnit(bst.root->pLeft->pRight == nullptr);
+         assertUnit(bst.root->pRight->data == Spy(50));
+         assertUnit(bst.root->pRight->pParent == bst.root);
+         assertUnit(bst.root->pRight->pLeft == nullptr);
+         assertUnit(bst.root->pRight->pRight->data == Spy(70));
+      }
+   }  // teardown
+
+   // a miss splays the last node looked at
+   void test_splay_findMissing()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.setSplay(custom::BST<Spy>::SPLAY_FULL);
+      // exercise
+      Spy * p = bst.find(Spy(42));
+      // verify
+      assertUnit(p == nullptr);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+         assertUnit(bst.root->data == Spy(40));
+   }  // teardown
+
+   // a semi-splay stops a zig-zig after the first rotation
+   void test_splay_semi()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.setSplay(custom::BST<Spy>::SPLAY_SEMI);
+      // exercise
+      bst.find(Spy(20));
+      // verify
+      //            30
+      //       +----+----+
+      //      20        50
+      //             +---+---+
+      //            40       70
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(30));
+         assertUnit(bst.root->pLeft->data == Spy(20));
+         assertUnit(bst.root->pLeft->pParent == bst.root);
+         assertUnit(bst.root->pRight->data == Spy(50));
+         assertUnit(bst.root->pRight->pLeft->data == Spy(40));
+      }
+   }  // teardown
+
+   // splaying every third access leaves the first two alone
+   void test_splay_period()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.setSplay(custom::BST<Spy>::SPLAY_FULL, 3);
+      custom::BST <Spy> :: BNode * pRoot = bst.root;
+      // exercise
+      bst.find(Spy(20));
+      bst.find(Spy(20));
+      bool fUnchanged = bst.root == pRoot;
+      bst.find(Spy(20));
+      // verify
+      assertUnit(fUnchanged);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+         assertUnit(bst.root->data == Spy(20));
+   }  // teardown
+
+   // insert splays the new node and erase splays the parent
+   void test_splay_insertErase()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setSplay(custom::BST<int>::SPLAY_FULL);
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      // exercise
+      bst.insert(45);
+      int rootAfterInsert = bst.root->data;
+      custom::BST <int> :: BNode * p = bst.root;
+      while (p && p->data != 60)
+         p = (60 < p->data) ? p->pLeft : p->pRight;
+      custom::BST <int> :: BNode * pParent = p ? p->pParent : nullptr;
+      bst.erase(60);
+      // verify
+      assertUnit(rootAfterInsert == 45);
+      assertUnit(pParent != nullptr);
+      assertUnit(bst.root == pParent);
+      int values[7] = {};
+      int num = 0;
+      for (auto it = bst.begin(); it != bst.end() && num < 7; ++it)
+         values[num++] = *it;
+      assertUnit(num == 7);
+      assertUnit(values[0] == 20 && values[3] == 45 && values[4] == 50 && values[6] == 80);
+   }  // teardown
+
+   /***************************************
+    * SCAPEGOAT
+    *    BST::setScapegoat(alpha)
+    ***************************************/
+
+   // a node holds its data, its count, and three links: nothing else
+   void test_node_noColor()
+   {  // setup
+      size_t sizeBare = sizeof(int) + sizeof(unsigned int) + 3 * sizeof(void *);
+      // exercise
+      size_t sizeNode = sizeof(custom::BST<int>::BNode);
+      // verify
+      assertUnit(sizeNode <= sizeBare);
+   }  // teardown
+
+   // sorted inserts would make a list without rebuilding
+   void test_scapegoat_sortedInsert()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setScapegoat(0.7);
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         bst.insert(Spy(i));
+      // verify
+      assertUnit(Spy::numCopy() == 0);        // rebuilds relink, never copy
+      assertUnit(bst.size() == 1000);
+      assertUnit(depth(bst.root) <= 21);      // log base 1/0.7 of 1000, plus one
+      assertUnit(isLinked(bst.root, (custom::BST<Spy>::BNode *)nullptr));
+      int num = 0;
+      for (auto it = bst.begin(); it != bst.end(); ++it, num++)
+         assertUnit(*it == Spy(num));
+      assertUnit(num == 1000);
+   }  // teardown
+
+   // turning the mode on rebuilds a tree that is already a list
+   void test_scapegoat_enableRebuilds()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      assertUnit(depth(bst.root) == 100);
+      // exercise
+      bst.setScapegoat(0.6);
+      // verify
+      assertUnit(depth(bst.root) == 7);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      bst.setSplay(custom::BST<int>::SPLAY_FULL);
+      assertUnit(bst.scapegoatAlpha() == 0.0);
+   }  // teardown
+
+   // erasing enough since the last rebuild rebuilds the whole tree
+   void test_scapegoat_eraseRebuilds()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setScapegoat(0.75);
+      for (int i = 0; i < 64; i++)
+         bst.insert(i);
+      // exercise: leave a long thin left edge
+      for (int i = 63; i >= 16; i--)
+         bst.erase(i);
+      // verify
+      assertUnit(bst.size() == 16);
+      assertUnit(bst.maxElements < 64);
+      assertUnit(depth(bst.root) <= 5);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+   }  // teardown
+
+   // random inserts and erases, with batches and duplicates, stay bounded
+   void test_scapegoat_mixed()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setScapegoat(0.65);
+      unsigned int seed = 2024;
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int key = (seed >> 8) % 2000;
+         if (seed & 0x80000000)
+            bst.erase(key);
+         else
+            bst.insert(key);
+      }
+      std::vector<custom::BST<int>::BatchOp> ops;
+      for (int i = 0; i < 100; i++)
+         ops.push_back({ i * 20, true });
+      bst.apply_batch(std::move(ops), true /* keepUnique */);
+      // verify
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      double bound = std::log((double)bst.size()) / std::log(1.0 / 0.65) + 1.0;
+      assertUnit(depth(bst.root) <= (int)bound + 1);
+      int prev = -1;
+      bool fOrdered = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+      {
+         fOrdered = fOrdered && prev <= *it;
+         prev = *it;
+      }
+      assertUnit(fOrdered);
+   }  // teardown
+
+   /***************************************
+    * FINGER
+    *    BST::lower_bound(t, finger)
+    *    BST::find(t, finger)
+    *    BST::insert(finger, t)
+    *    BST::setFinger(f)
+    ***************************************/
+
+   // every finger gives the answer a search from the root would
+   void test_lowerBound_finger()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      custom::BST <Spy> :: iterator it20(bst.root->pLeft->pLeft);
+      custom::BST <Spy> :: iterator it60(bst.root->pRight->pLeft);
+      custom::BST <Spy> :: iterator it80(bst.root->pRight->pRight);
+      // exercise
+      custom::BST <Spy> :: iterator it35 = bst.lower_bound(Spy(35), it20);
+      custom::BST <Spy> :: iterator it85 = bst.lower_bound(Spy(85), it60);
+      custom::BST <Spy> :: iterator it55 = bst.lower_bound(Spy(55), it80);
+      custom::BST <Spy> :: iterator it10 = bst.lower_bound(Spy(10), it80);
+      custom::BST <Spy> :: iterator it50 = bst.lower_bound(Spy(50), it20);
+      // verify
+      assertUnit(it35 != bst.end() && *it35 == Spy(40));
+      assertUnit(it85 == bst.end());
+      assertUnit(it55 != bst.end() && *it55 == Spy(60));
+      assertUnit(it10 != bst.end() && *it10 == Spy(20));
+      assertUnit(it50 != bst.end() && *it50 == Spy(50));
+      assertUnit(bst.lower_bound(Spy(45)) == bst.lower_bound(Spy(45), bst.end()));
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // a search for a neighbour touches a few nodes, not a whole path
+   void test_find_fingerNearby()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setScapegoat(0.6);
+      for (int i = 0; i < 4096; i++)
+         bst.insert(Spy(i * 2));
+      custom::BST <Spy> :: iterator finger = bst.begin();
+      // exercise
+      Spy::reset();
+      int numMissing = 0;
+      for (int i = 0; i < 4096; i++)
+      {
+         custom::BST <Spy> :: iterator it = bst.find(Spy(i * 2), finger);
+         if (it == bst.end())
+            numMissing++;
+         else
+            finger = it;
+      }
+      int numCompareFinger = Spy::numEquals() + Spy::numLessthan();
+      Spy::reset();
+      for (int i = 0; i < 4096; i++)
+         bst.find(Spy(i * 2));
+      int numCompareRoot = Spy::numEquals() + Spy::numLessthan();
+      // verify
+      assertUnit(numMissing == 0);
+      assertUnit(numCompareFinger * 3 < numCompareRoot);
+      assertUnit(bst.find(Spy(7), finger) == bst.end());
+   }  // teardown
+
+   // each insert starts from the last one
+   void test_insert_fingerChain()
+   {  // setup
+      custom::BST <int> bst;
+      custom::BST <int> :: iterator it = bst.end();
+      // exercise
+      for (int i : { 10, 20, 30, 25, 27, 5, 40 })
+         it = bst.insert(it, i);
+      custom::BST <int> :: iterator itSame = bst.insert(it, 25, true /* keepUnique */);
+      // verify
+      assertUnit(bst.size() == 7);
+      assertUnit(itSame != bst.end() && *itSame == 25);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      int values[7] = {};
+      int num = 0;
+      for (auto itValue = bst.begin(); itValue != bst.end() && num < 7; ++itValue)
+         values[num++] = *itValue;
+      assertUnit(num == 7);
+      assertUnit(values[0] == 5 && values[3] == 25 && values[4] == 27 && values[6] == 40);
+   }  // teardown
+
+   // with the finger on, a random mix behaves exactly like a plain tree
+   void test_finger_lastPosition()
+   {  // setup
+      custom::BST <int> bstFinger;
+      custom::BST <int> bstPlain;
+      bstFinger.setFinger(true);
+      bstFinger.setMultiset(true);
+      bstPlain.setMultiset(true);
+      unsigned int seed = 99;
+      int numDifferent = 0;
+      // exercise: a random walk, so each value is near the last
+      int key = 500;
+      for (int i = 0; i < 20000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         key += (int)((seed >> 16) % 21) - 10;
+         if (seed & 0x80000000)
+            numDifferent += bstFinger.insert(key) != bstPlain.insert(key);
+         else if (seed & 0x40000000)
+            numDifferent += bstFinger.erase(key) != bstPlain.erase(key);
+         else
+            numDifferent += (bstFinger.find(key) == nullptr) != (bstPlain.find(key) == nullptr);
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(bstFinger.size() == bstPlain.size());
+      assertUnit(bstFinger.pLast != nullptr);
+      assertUnit(isLinked(bstFinger.root, (custom::BST<int>::BNode *)nullptr));
+      auto itPlain = bstPlain.begin();
+      for (auto it = bstFinger.begin(); it != bstFinger.end(); ++it, ++itPlain)
+         numDifferent += *it != *itPlain;
+      assertUnit(numDifferent == 0);
+   }  // teardown
+
+   // erasing the finger's node moves the finger; freeing nodes drops it
+   void test_finger_eraseMovesFinger()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setFinger(true);
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      bst.find(40);
+      custom::BST <int> :: BNode * p30 = bst.root->pLeft;
+      // exercise
+      bool fErased = bst.erase(40);
+      custom::BST <int> :: BNode * pAfterErase = bst.pLast;
+      bst.apply_batch({ { 1, true }, { 2, true }, { 3, true }, { 4, true } });
+      // verify
+      assertUnit(fErased);
+      assertUnit(pAfterErase == p30);
+      assertUnit(bst.pLast == nullptr);
+      assertUnit(bst.find(60) != nullptr);
+      assertUnit(bst.pLast != nullptr && bst.pLast->data == 60);
+      bst.clear();
+      assertUnit(bst.pLast == nullptr);
+   }  // teardown
+
+   // ascending inserts from the last one start where it is, even down
+   // a chain: a search that climbed to the root first would be quadratic
+   void test_finger_sortedInsertSteps()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setFinger(true);
+      custom::BST <Spy> bstBalanced;
+      for (int i = 0; i < 1023; i++)
+         bstBalanced.insert(Spy(i));
+      bstBalanced.rebalance();
+      custom::BST <Spy> :: iterator itMax = bstBalanced.find(Spy(1022), bstBalanced.end());
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 20000; i++)
+         bst.insert(Spy(i));
+      int numCompareChain = Spy::numLessthan();
+      Spy::reset();
+      custom::BST <Spy> :: iterator it = itMax;
+      for (int i = 1023; i < 1100; i++)
+         it = bstBalanced.insert(it, Spy(i));
+      int numCompareBalanced = Spy::numLessthan();
+      // verify
+      assertUnit(numCompareChain <= 20000 * 3);
+      assertUnit(numCompareBalanced <= 77 * 3);
+      assertUnit(bst.size() == 20000);
+      assertUnit(bstBalanced.max() == Spy(1099));
+   }  // teardown
+
+   // from any finger, with duplicates above and below, every search
+   // lands where a search from the root would
+   void test_finger_matchesRoot()
+   {  // setup
+      custom::BST <int> bst;
+      unsigned int seed = 7;
+      for (int i = 0; i < 150; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         bst.insert((int)((seed >> 8) % 50));
+      }
+      int numDifferent = 0;
+      // exercise
+      for (auto finger = bst.begin(); finger != bst.end(); ++finger)
+         for (int t = -1; t <= 50; t++)
+         {
+            numDifferent += bst.lower_bound(t, finger) != bst.lower_bound(t);
+            numDifferent += (bst.find(t, finger) == bst.end()) != (bst.find(t) == nullptr);
+         }
+      custom::BST <int> :: iterator finger = bst.begin();
+      for (int i = 0; i < 15; i++)
+         ++finger;
+      for (int t = -1; t <= 50; t += 3)
+         finger = bst.insert(finger, t);
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(bst.size() == 168);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      int prev = -1;
+      bool fOrdered = true;
+      for (auto itValue = bst.begin(); itValue != bst.end(); ++itValue)
+      {
+         fOrdered = fOrdered && prev <= *itValue;
+         prev = *itValue;
+      }
+      assertUnit(fOrdered);
+   }  // teardown
+
+   /***************************************
+    * BUFFERED
+    *    BST::setBuffered(capacity)
+    *    BST::flush()
+    ***************************************/
+
+   // inserts wait in the queue until something reads the tree
+   void test_buffered_insertQueues()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setBuffered(8);
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40 })
+         bst.insert(i);
+      bool fRootBefore = bst.root != nullptr;
+      size_t numPendingBefore = bst.pending.size();
+      size_t numElementsBefore = bst.numElements;
+      size_t size = bst.size();
+      // verify
+      assertUnit(fRootBefore == false);
+      assertUnit(numPendingBefore == 5);
+      assertUnit(numElementsBefore == 0);
+      assertUnit(size == 5);
+      assertUnit(bst.pending.empty());
+      assertUnit(bst.root != nullptr && bst.root->data == 40);  // built from the sorted batch
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+   }  // teardown
+
+   // the op that fills the queue applies it, sorted, in one batch
+   void test_buffered_fullQueueApplies()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setBuffered(4);
+      for (int i : { 50, 30, 70 })
+         bst.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      bst.insert(Spy(20));
+      // verify
+      assertUnit(bst.pending.empty());
+      assertUnit(bst.pending.capacity() >= 4);
+      assertUnit(bst.numElements == 4);
+      assertUnit(Spy::numCopy() == 0);             // moved from the queue into nodes
+      std::vector<int> values;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         values.push_back((*it).get());
+      assertUnit(values == std::vector<int>({ 20, 30, 50, 70 }));
+   }  // teardown
+
+   // ops on one value happen in the order they were queued
+   void test_buffered_sameValueInOrder()
+   {  // setup
+      custom::BST <int> bst{ 7, 8 };
+      bst.setBuffered(16);
+      // exercise
+      bool fReturn1 = bst.erase(7);
+      bool fReturn2 = bst.insert(7);
+      bool fReturn3 = bst.erase(7);
+      bool fReturn4 = bst.erase(9);
+      bst.insert(8);
+      bst.erase(8);
+      bst.insert(3);
+      // verify
+      assertUnit(fReturn1 && fReturn2 && fReturn3 && fReturn4);   // queued, not yet known
+      assertUnit(bst.pending.size() == 7);
+      assertUnit(bst.count(7) == 0);
+      assertUnit(bst.count(8) == 1);
+      assertUnit(bst.count(9) == 0);
+      assertUnit(bst.find(3) != nullptr);
+      assertUnit(bst.size() == 2);
+   }  // teardown
+
+   // a find through a const reference still sees every queued op
+   void test_buffered_constFindSees()
+   {  // setup
+      custom::BST <int> bst{ 10, 20, 30 };
+      bst.setBuffered(64);
+      bst.insert(25);
+      bst.erase(20);
+      const custom::BST <int> & bstConst = bst;
+      // exercise
+      const int * p25 = bstConst.find(25);
+      const int * p20 = bstConst.find(20);
+      // verify
+      assertUnit(p25 != nullptr && *p25 == 25);
+      assertUnit(p20 == nullptr);
+      assertUnit(bst.pending.empty());
+   }  // teardown
+
+   // a batch shares one keepUnique, so switching it applies the queue so far
+   void test_buffered_keepUniqueApplies()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setBuffered(16);
+      bst.insert(5);
+      bst.insert(5);
+      // exercise
+      bst.insert(5, true /* keepUnique */);
+      size_t numPending = bst.pending.size();
+      size_t numElements = bst.numElements;
+      bst.insert(6, true /* keepUnique */);
+      // verify
+      assertUnit(numPending == 1);
+      assertUnit(numElements == 2);
+      assertUnit(bst.count(5) == 2);
+      assertUnit(bst.count(6) == 1);
+   }  // teardown
+
+   // eraseAll is applied at once and says whether it found anything
+   void test_buffered_eraseAllApplies()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setBuffered(16);
+      for (int i : { 4, 4, 4, 2 })
+         bst.insert(i);
+      // exercise
+      bool fReturn1 = bst.erase(4, true /* eraseAll */);
+      bool fReturn2 = bst.erase(4, true /* eraseAll */);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(bst.pending.empty());
+      assertUnit(bst.size() == 1);
+      bst.setBuffered(0);
+      assertUnit(bst.erase(2) == true);
+      assertUnit(bst.erase(2) == false);
+   }  // teardown
+
+   // a finger taken before a queued erase may be gone once it is applied
+   void test_buffered_fingerDropped()
+   {  // setup
+      custom::BST <int> bst{ 50, 30, 70, 20, 40, 60, 80 };
+      bst.setBuffered(16);
+      custom::BST <int> :: iterator finger40 = bst.lower_bound(40);
+      bst.erase(40);
+      // exercise
+      custom::BST <int> :: iterator it = bst.lower_bound(45, finger40);
+      custom::BST <int> :: iterator finger60 = bst.lower_bound(60);
+      bst.erase(60);
+      custom::BST <int> :: iterator itNew = bst.insert(finger60, 45);
+      // verify
+      assertUnit(it != bst.end() && *it == 50);
+      assertUnit(itNew != bst.end() && *itNew == 45);
+      assertUnit(bst.find(40) == nullptr);
+      assertUnit(bst.find(60) == nullptr);
+      assertUnit(bst.size() == 6);
+   }  // teardown
+
+   // a burst of writes into a large tree ends up the same either way,
+   // reporting the speedup of queueing it
+   void test_buffered_largeBurst()
+   {  // setup
+      const int numNodes = 1 << 18;
+      const int numBurst = 1 << 16;
+      custom::BST <int> bstPlain;
+      for (int i = 0; i < numNodes; i++)
+         bstPlain.insert((int)(((unsigned int)i * 2654435761u) >> 1));
+      custom::BST <int> bstBuffered(bstPlain);
+      bstBuffered.setBuffered(numBurst / 2);
+      // exercise
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < numBurst; i++)
+         bstPlain.insert((int)(((unsigned int)(i * 7) * 2654435761u) >> 1) + 1);
+      auto middle = std::chrono::steady_clock::now();
+      for (int i = 0; i < numBurst; i++)
+         bstBuffered.insert((int)(((unsigned int)(i * 7) * 2654435761u) >> 1) + 1);
+      bstBuffered.flush();
+      auto finish = std::chrono::steady_clock::now();
+      // verify
+      assertUnit(bstBuffered.size() == bstPlain.size());
+      int numWrong = 0;
+      auto itBuffered = bstBuffered.begin();
+      for (auto it = bstPlain.begin(); it != bstPlain.end(); ++it, ++itBuffered)
+         numWrong += (itBuffered != bstBuffered.end() && *itBuffered == *it) ? 0 : 1;
+      assertUnit(numWrong == 0);
+      std::cerr << "\tBST buffered insert speedup: "
+                << std::chrono::duration<double>(middle - start).count() /
+                   std::chrono::duration<double>(finish - middle).count() << "x\n";
+   }  // teardown
+
+   /***************************************
+    * ENDS
+    *    BST::min()
+    *    BST::max()
+    *    BST::pop_min()
+    *    BST::pop_max()
+    ***************************************/
+
+   // the ends are kept, so min and max read them without a search
+   void test_minMax_standard()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      // exercise
+      Spy min = bst.min();
+      Spy max = bst.max();
+      // verify
+      assertUnit(min == Spy(20));
+      assertUnit(max == Spy(80));
+      assertUnit(bst.pMin == bst.root->pLeft->pLeft);
+      assertUnit(bst.pMax == bst.root->pRight->pRight);
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // a new smallest or largest value becomes the end as it is attached
+   void test_minMax_insertKeepsEnds()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(i);
+      // exercise
+      bst.insert(10);
+      bst.insert(60);
+      bst.insert(90);
+      // verify
+      assertUnit(bst.pMin != nullptr && bst.pMin->data == 10);
+      assertUnit(bst.pMin == bst.root->pLeft->pLeft);
+      assertUnit(bst.pMax != nullptr && bst.pMax->data == 90);
+      assertUnit(bst.pMax == bst.root->pRight->pRight);
+      assertUnit(bst.min() == 10);
+      assertUnit(bst.max() == 90);
+      assertUnit(bst.begin().pNode == bst.pMin);
+   }  // teardown
+
+   // popping the smallest over and over drains the tree in order
+   void test_popMin_inOrder()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert((i * 37) % 100);
+      // exercise
+      std::vector<int> values;
+      while (!bst.empty())
+         values.push_back(bst.pop_min());
+      // verify
+      bool fSorted = values.size() == 100;
+      for (int i = 0; fSorted && i < 100; i++)
+         fSorted = values[i] == i;
+      assertUnit(fSorted);
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.pMin == nullptr);
+      assertUnit(bst.pMax == nullptr);
+   }  // teardown
+
+   // no value is compared to find the end, and the value is moved out
+   void test_popMin_noSearch()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(Spy((i * 37) % 100));
+      bst.min();
+      Spy::reset();
+      // exercise
+      Spy s0 = bst.pop_min();
+      Spy s99 = bst.pop_max();
+      Spy s1 = bst.pop_min();
+      // verify
+      assertUnit(s0 == Spy(0));
+      assertUnit(s99 == Spy(99));
+      assertUnit(s1 == Spy(1));
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(bst.size() == 97);
+      assertUnit(bst.min() == Spy(2));
+      assertUnit(bst.max() == Spy(98));
+   }  // teardown
+
+   // a counted node gives up one copy at a time before it goes
+   void test_popMax_multiset()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      for (int i : { 5, 9, 9, 1, 9 })
+         bst.insert(i);
+      custom::BST <int> :: BNode * p9 = bst.pMax;
+      // exercise
+      int first = bst.pop_max();
+      int second = bst.pop_max();
+      bool fSameNode = bst.pMax == p9;
+      int third = bst.pop_max();
+      // verify
+      assertUnit(first == 9 && second == 9 && third == 9);
+      assertUnit(fSameNode);
+      assertUnit(bst.max() == 5);
+      assertUnit(bst.min() == 1);
+      assertUnit(bst.size() == 2);
+   }  // teardown
+
+   // a copy knows its ends at once, so const readers on two threads only read
+   void test_ends_copyReadersShare()
+   {  // setup
+      custom::BST <int> bstSrc{ 50, 30, 70, 20, 80 };
+      custom::BST <int> bstAssign{ 1 };
+      // exercise
+      const custom::BST <int> bstCopy(bstSrc);
+      bstAssign = bstSrc;
+      int first[2] = {};
+      std::thread t0([&]() { first[0] = *bstCopy.begin(); });
+      std::thread t1([&]() { first[1] = *bstCopy.begin(); });
+      t0.join();
+      t1.join();
+      // verify
+      assertUnit(bstCopy.pMin != nullptr && bstCopy.pMin->data == 20);
+      assertUnit(bstCopy.pMax != nullptr && bstCopy.pMax->data == 80);
+      assertUnit(bstAssign.pMin != nullptr && bstAssign.pMin->data == 20);
+      assertUnit(bstAssign.pMax != nullptr && bstAssign.pMax->data == 80);
+      assertUnit(first[0] == 20 && first[1] == 20);
+   }  // teardown
+
+   // the ends travel with the nodes
+   void test_ends_swapMoveClear()
+   {  // setup
+      custom::BST <int> bst1{ 5, 3, 8 };
+      custom::BST <int> bst2{ 50, 30 };
+      custom::BST <int> :: BNode * pMin1 = bst1.pMin;
+      // exercise
+      bst1.swap(bst2);
+      custom::BST <int> bst3(std::move(bst2));
+      custom::BST <int> bst4(bst3);
+      bst1.clear();
+      // verify
+      assertUnit(bst1.pMin == nullptr && bst1.pMax == nullptr);
+      assertUnit(bst2.pMin == nullptr && bst2.pMax == nullptr);
+      assertUnit(bst3.pMin == pMin1);
+      assertUnit(bst3.min() == 3 && bst3.max() == 8);
+      assertUnit(bst4.min() == 3 && bst4.max() == 8);
+      assertUnit(bst4.pMin != pMin1);
+   }  // teardown
+
+   // rotations move nodes but not the ends; a rebuilt tree gets new ones
+   void test_ends_splayAndBatch()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setSplay(custom::BST <int> :: SPLAY_FULL);
+      for (int i = 0; i < 50; i++)
+         bst.insert((i * 7) % 50 * 2);
+      custom::BST <int> :: BNode * pMin = bst.pMin;
+      // exercise
+      bst.find(0);
+      bst.find(98);
+      bst.find(50);
+      bool fKept = bst.pMin == pMin;
+      bst.apply_batch({ { -1, true }, { 99, true }, { 100, true } });
+      // verify
+      assertUnit(fKept);
+      assertUnit(bst.pMin != nullptr && bst.pMin->data == -1);
+      assertUnit(bst.pMax != nullptr && bst.pMax->data == 100);
+      assertUnit(bst.pMin->pLeft == nullptr);
+      assertUnit(bst.pMax->pRight == nullptr);
+      assertUnit(bst.pop_min() == -1 && bst.pop_min() == 0);
+      assertUnit(bst.pop_max() == 100 && bst.pop_max() == 99);
+   }  // teardown
+
+   /***************************************
+    * BULK REMOVAL
+    *    BST::erase_if(pred)
+    *    BST::partition(pred)
+    ***************************************/
+
+   // the survivors keep their nodes and end up balanced
+   void test_eraseIf_keepsNodes()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 1; i <= 45; i++)
+         bst.insert(Spy(i));                     // a vine: 45 levels deep
+      const Spy * p29 = bst.find(Spy(29));
+      Spy::reset();
+      // exercise
+      size_t numErased = bst.erase_if([](const Spy & s) { return s.get() % 3 == 0; });
+      // verify
+      assertUnit(numErased == 15);
+      assertUnit(Spy::numDestructor() == 15);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(bst.size() == 30);
+      assertUnit(depth(bst.root) == 5);
+      assertUnit(isLinked(bst.root, (custom::BST<Spy>::BNode *)nullptr));
+      assertUnit(bst.min() == Spy(1) && bst.max() == Spy(44));
+      assertUnit(bst.find(Spy(29)) == p29);
+      assertUnit(bst.find(Spy(30)) == nullptr);
+   }  // teardown
+
+   // nothing to erase leaves the tree untouched; everything leaves it empty
+   void test_eraseIf_noneAndAll()
+   {  // setup
+      custom::BST <int> bst{ 50, 30, 70, 20 };
+      custom::BST <int> :: BNode * pRoot = bst.root;
+      // exercise
+      size_t numNone = bst.erase_if([](int) { return false; });
+      custom::BST <int> :: BNode * pRootAfterNone = bst.root;
+      size_t numAll = bst.erase_if([](int) { return true; });
+      // verify
+      assertUnit(numNone == 0);
+      assertUnit(pRootAfterNone == pRoot);
+      assertUnit(numAll == 4);
+      assertUnit(bst.empty());
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.begin() == bst.end());
+   }  // teardown
+
+   // a counted node is asked once and goes with every copy
+   void test_eraseIf_multiset()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      for (int i : { 4, 4, 4, 2, 6, 6 })
+         bst.insert(i);
+      int numAsked = 0;
+      // exercise
+      size_t numErased = bst.erase_if([&numAsked](int i) { numAsked++; return i == 4; });
+      // verify
+      assertUnit(numAsked == 3);
+      assertUnit(numErased == 3);
+      assertUnit(bst.size() == 3);
+      assertUnit(bst.count(6) == 2);
+      assertUnit(bst.count(4) == 0);
+   }  // teardown
+
+   // the filter forgets the erased values
+   void test_eraseIf_bloom()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert((i * 37) % 1000);
+      bst.setBloom();
+      // exercise
+      bst.erase_if([](int i) { return i >= 500; });
+      // verify
+      assertUnit(bst.size() == 500);
+      assertUnit(bst.bloom() != nullptr && bst.bloom()->size() == 500);
+      assertUnit(bst.numErased == 0);
+      int numFound = 0;
+      for (int i = 0; i < 1000; i++)
+         numFound += bst.find(i) != nullptr;
+      assertUnit(numFound == 500);
+   }  // teardown
+
+   // a pred that throws partway leaves every node, count, and link as it was
+   void test_eraseIf_throwLeavesTree()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setMultiset(true);
+      for (int i : { 50, 30, 70, 30, 20, 80, 80 })
+         bst.insert(i);
+      custom::BST <int> :: BNode * pRoot = bst.root;
+      int numAsked = 0;
+      bool fThrown = false;
+      // exercise
+      try
+      {
+         bst.erase_if([&numAsked](int i) { if (++numAsked == 4) throw i; return true; });
+      }
+      catch (int)
+      {
+         fThrown = true;
+      }
+      custom::BST <int> :: BNode * pRootAfterThrow = bst.root;
+      size_t numErased = bst.erase_if([](int i) { return i == 30; });
+      // verify
+      assertUnit(fThrown);
+      assertUnit(pRootAfterThrow == pRoot);
+      assertUnit(numErased == 2);
+      assertUnit(bst.size() == 5);
+      assertUnit(bst.count(80) == 2);
+      assertUnit(bst.count(20) == 1);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+   }  // teardown
+
+   // every node goes to one part or the other, and the modes go to both
+   void test_partition_movesNodes()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setFinger(true);
+      for (int i = 0; i < 20; i++)
+         bst.insert(i);
+      const int * p7 = bst.find(7);
+      const int * p8 = bst.find(8);
+      // exercise
+      std::pair<custom::BST <int>, custom::BST <int> > parts =
+         bst.partition([](int i) { return i % 2 == 1; });
+      // verify
+      assertUnit(bst.empty());
+      assertUnit(bst.root == nullptr);
+      assertUnit(parts.first.size() == 10);
+      assertUnit(parts.second.size() == 10);
+      assertUnit(parts.first.find(7) == p7);
+      assertUnit(parts.second.find(8) == p8);
+      assertUnit(parts.first.find(8) == nullptr);
+      assertUnit(parts.first.usesFinger() && parts.second.usesFinger());
+      assertUnit(depth(parts.first.root) == 4);
+      assertUnit(parts.first.min() == 1 && parts.first.max() == 19);
+      assertUnit(parts.second.min() == 0 && parts.second.max() == 18);
+   }  // teardown
+
+   /***************************************
+    * REBALANCE
+    *    BST::rebalance()
+    *    BST::setAutoRebalance(factor)
+    ***************************************/
+
+   // a chain becomes a balanced tree of the same nodes, by rotation alone
+   void test_rebalance_vine()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert(Spy(i));
+      const Spy * p42 = bst.find(Spy(42));
+      assertUnit(depth(bst.root) == 100);
+      Spy::reset();
+      // exercise
+      bst.rebalance();
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(depth(bst.root) == 7);
+      assertUnit(isLinked(bst.root, (custom::BST<Spy>::BNode *)nullptr));
+      assertUnit(bst.find(Spy(42)) == p42);
+      assertUnit(bst.min() == Spy(0) && bst.max() == Spy(99));
+      int num = 0;
+      for (auto it = bst.begin(); it != bst.end(); ++it, num++)
+         assertUnit(*it == Spy(num));
+      assertUnit(num == 100);
+   }  // teardown
+
+   // 2^k - 1 nodes come out perfect; an empty tree is left alone
+   void test_rebalance_complete()
+   {  // setup
+      custom::BST <int> bst;
+      custom::BST <int> bstEmpty;
+      for (int i = 15; i >= 1; i--)
+         bst.insert(i);
+      // exercise
+      bst.rebalance();
+      bstEmpty.rebalance();
+      // verify
+      assertUnit(bst.root->data == 8);
+      assertUnit(bst.root->pLeft->data == 4);
+      assertUnit(bst.root->pRight->data == 12);
+      assertUnit(bst.root->pLeft->pLeft->pLeft->data == 1);
+      assertUnit(bst.root->pRight->pRight->pRight->data == 15);
+      assertUnit(depth(bst.root) == 4);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      assertUnit(bstEmpty.root == nullptr);
+   }  // teardown
+
+   // a node landing too deep balances the lowest subtree at fault, where it hangs
+   void test_autoRebalance_subtree()
+   {  // setup
+      custom::BST <int> bst{ 50, 30, 70 };
+      bst.setAutoRebalance(2.0);
+      custom::BST <int> :: BNode * pRoot = bst.root;
+      for (int i = 71; i < 76; i++)
+         bst.insert(i);
+      int depthBefore = depth(bst.root);
+      // exercise
+      bst.insert(76);                             // 7 deep, past 2 * log2(9)
+      // verify
+      assertUnit(depthBefore == 7);
+      assertUnit(bst.root == pRoot);
+      assertUnit(bst.root->pLeft->data == 30);
+      assertUnit(bst.root->pRight->data == 73);
+      assertUnit(depth(bst.root->pRight) == 3);
+      assertUnit(isLinked(bst.root, (custom::BST<int>::BNode *)nullptr));
+      assertUnit(bst.size() == 9);
+      assertUnit(bst.max() == 76);
+   }  // teardown
+
+   // sorted inserts stay within the bound and only rotate, never copy
+   void test_autoRebalance_sortedInsert()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.setAutoRebalance(2.0);
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 4000; i++)
+         bst.insert(Spy(i));
+      for (int i = -1; i > -1000; i--)
+         bst.insert(Spy(i));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(bst.size() == 4999);
+      assertUnit(depth(bst.root) <= 26);      // twice log2 of 4999, plus one
+      assertUnit(isLinked(bst.root, (custom::BST<Spy>::BNode *)nullptr));
+      assertUnit(bst.min() == Spy(-999) && bst.max() == Spy(3999));
+      int num = -999;
+      for (auto it = bst.begin(); it != bst.end(); ++it, num++)
+         assertUnit(*it == Spy(num));
+      assertUnit(num == 4000);
+   }  // teardown
+
+   // turning it on balances what is there; splay and scapegoat turn it off
+   void test_autoRebalance_excludesOthers()
+   {  // setup
+      custom::BST <int> bst;
+      custom::BST <int> bstScapegoat;
+      for (int i = 0; i < 31; i++)
+         bst.insert(i);
+      bstScapegoat.setScapegoat(0.7);
+      // exercise
+      bst.setAutoRebalance(1.5);
+      bstScapegoat.setAutoRebalance(1.5);
+      custom::BST <int> bstCopy(bst);
+      int depthOn = depth(bst.root);
+      bst.setScapegoat(0.7);
+      bstCopy.setSplay(custom::BST<int>::SPLAY_SEMI);
+      // verify
+      assertUnit(depthOn == 5);
+      assertUnit(bstScapegoat.scapegoatAlpha() == 0.0);
+      assertUnit(bstScapegoat.autoRebalanceFactor() == 1.5);
+      assertUnit(bst.autoRebalanceFactor() == 0.0);
+      assertUnit(bstCopy.autoRebalanceFactor() == 0.0);
+      assertUnit(bstCopy.splayMode() == custom::BST<int>::SPLAY_SEMI);
+   }  // teardown
+
+   // nodes on the longest path
+   template <class Node>
+   static int depth(const Node * p)
+   {
+      if (!p)
+         return 0;
+      int left = depth(p->pLeft);
+      int right = depth(p->pRight);
+      return 1 + (left > right ? left : right);
+   }
+
+   // every child points back at its parent
+   template <class Node>
+   static bool isLinked(const Node * p, const Node * pParent)
+   {
+      if (!p)
+         return true;
+      return p->pParent == pParent && isLinked(p->pLeft, p) && isLinked(p->pRight, p);
+   }
+
    /**************************************************************
     * SETUP STANDARD FIXTURE
     *                (50) 
@@ -1955,6 +3545,8 @@ public:
 
       // now assign everything to the bst
       bst.root = p50;
+      bst.pMin = p20;
+      bst.pMax = p80;
       bst.numElements = 7;
    }
 
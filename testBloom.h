@@ -0,0 +1,278 @@
+/***********************************************************************
+ * Header:
+ *    TEST BLOOM
+ * Summary:
+ *    Unit tests for the blocked Bloom filter and the BST's use of it
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "bloom.h"
+#include "bst.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <cstdint>
+#include <vector>
+
+ /***********************************************
+  * TEST BLOOM
+  * Unit tests for the BloomFilter class
+  ***********************************************/
+class TestBloom : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Filter
+      test_filter_noFalseNegatives();
+      test_filter_falsePositiveRate();
+      test_filter_blocksAligned();
+      test_filter_clear();
+      test_filter_copyRealigns();
+
+      // In front of a BST
+      test_bst_missTouchesNothing();
+      test_bst_growsAndRefills();
+      test_bst_eraseRefills();
+      test_bst_copySwap();
+      test_bst_copyFindsAll();
+
+      report("Bloom");
+   }
+
+   /***************************************
+    * FILTER
+    ***************************************/
+
+   // everything added is always let through
+   void test_filter_noFalseNegatives()
+   {  // setup
+      custom::BloomFilter filter(10000);
+      // exercise
+      for (size_t i = 0; i < 10000; i++)
+         filter.add(i * 7);
+      // verify
+      int numMissing = 0;
+      for (size_t i = 0; i < 10000; i++)
+         numMissing += filter.mayContain(i * 7) ? 0 : 1;
+      assertUnit(numMissing == 0);
+      assertUnit(filter.size() == 10000);
+      assertUnit(filter.numProbes() == 7);
+   }  // teardown
+
+   // at ten bits a key about one absent key in a hundred gets through,
+   // and the estimate from how full the blocks are agrees
+   void test_filter_falsePositiveRate()
+   {  // setup
+      custom::BloomFilter filter(10000);
+      for (size_t i = 0; i < 10000; i++)
+         filter.add(i);
+      // exercise
+      int numFalse = 0;
+      for (size_t i = 10000; i < 110000; i++)
+         numFalse += filter.mayContain(i) ? 1 : 0;
+      double measured = numFalse / 100000.0;
+      double estimate = filter.falsePositiveRate();
+      // verify
+      assertUnit(measured < 0.02);
+      assertUnit(estimate < 0.02);
+      assertUnit(measured < estimate * 2.0 && estimate < measured * 2.0);
+      assertUnit(filter.bytes() <= 10000 * 10 / 8 + 64);
+   }  // teardown
+
+   // every block is one cache line
+   void test_filter_blocksAligned()
+   {  // setup
+      custom::BloomFilter filter(1000, 16);
+      // exercise
+      uintptr_t address = reinterpret_cast<uintptr_t>(filter.blocks());
+      // verify
+      assertUnit(address % 64 == 0);
+      assertUnit(filter.numBlocks == (1000 * 16 + 511) / 512);
+      assertUnit(filter.bytes() == filter.numBlocks * 64);
+      assertUnit(filter.blocks() + filter.numBlocks * 8 <= filter.words.data() + filter.words.size());
+   }  // teardown
+
+   // clear forgets everything
+   void test_filter_clear()
+   {  // setup
+      custom::BloomFilter filter(100);
+      for (size_t i = 0; i < 100; i++)
+         filter.add(i);
+      // exercise
+      filter.clear(200);
+      // verify
+      assertUnit(filter.size() == 0);
+      assertUnit(filter.capacity() == 200);
+      assertUnit(filter.falsePositiveRate() == 0.0);
+      int numThrough = 0;
+      for (size_t i = 0; i < 100; i++)
+         numThrough += filter.mayContain(i) ? 1 : 0;
+      assertUnit(numThrough == 0);
+   }  // teardown
+
+   // a copy lands wherever its buffer does, but keeps every key
+   void test_filter_copyRealigns()
+   {  // setup
+      custom::BloomFilter filter(5000);
+      for (size_t i = 0; i < 5000; i++)
+         filter.add(i);
+      // exercise
+      std::vector<custom::BloomFilter> copies;
+      std::vector<std::vector<uint64_t> > pads;
+      copies.reserve(9);
+      for (int i = 0; i < 8; i++)
+      {
+         copies.push_back(filter);
+         pads.emplace_back(i + 1);             // shift where the next buffer lands
+      }
+      custom::BloomFilter assigned(10);
+      assigned = filter;
+      copies.push_back(assigned);
+      // verify
+      int numMissing = 0;
+      for (const custom::BloomFilter & copy : copies)
+      {
+         assertUnit(reinterpret_cast<uintptr_t>(copy.blocks()) % 64 == 0);
+         for (size_t i = 0; i < 5000; i++)
+            numMissing += copy.mayContain(i) ? 0 : 1;
+      }
+      assertUnit(numMissing == 0);
+      assertUnit(assigned.size() == 5000);
+      assertUnit(assigned.capacity() == 5000);
+   }  // teardown
+
+   /***************************************
+    * IN FRONT OF A BST
+    ***************************************/
+
+   // a miss is turned away before a single comparison
+   void test_bst_missTouchesNothing()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(Spy(i));
+      bst.setBloom<SpyHash>();
+      Spy s25(25);
+      Spy s40(40);
+      Spy::reset();
+      // exercise
+      const Spy * pMissing = bst.find(s25);
+      int numCompareMiss = Spy::numEquals() + Spy::numLessthan();
+      const Spy * pFound = bst.find(s40);
+      // verify
+      assertUnit(pMissing == nullptr);
+      assertUnit(numCompareMiss == 0);
+      assertUnit(pFound != nullptr && *pFound == s40);
+      assertUnit(bst.erase(s25) == false);
+      assertUnit(bst.count(s25) == 0);
+      assertUnit(Spy::numAlloc() == 0);
+   }  // teardown
+
+   // the filter doubles as the tree outgrows it and finds stay exact
+   void test_bst_growsAndRefills()
+   {  // setup
+      custom::BST <int> bst;
+      bst.setBloom();
+      assertUnit(bst.bloom() != nullptr);
+      // exercise
+      for (int i = 0; i < 5000; i++)
+         bst.insert(i * 3);
+      // verify
+      assertUnit(bst.bloom()->capacity() >= 5000);
+      assertUnit(bst.bloom()->size() == 5000);
+      assertUnit(bst.bloom()->falsePositiveRate() < 0.02);
+      int numWrong = 0;
+      for (int i = 0; i < 15000; i++)
+         numWrong += (bst.find(i) != nullptr) != (i % 3 == 0);
+      assertUnit(numWrong == 0);
+      std::vector<int> keys;
+      for (int i = 0; i < 300; i++)
+         keys.push_back(i);
+      std::vector<const int *> out;
+      bst.find_batch(keys, out);
+      for (int i = 0; i < 300; i++)
+         numWrong += (out[i] != nullptr) != (i % 3 == 0);
+      assertUnit(numWrong == 0);
+   }  // teardown
+
+   // once the erases reach half of what is left, the filter starts over
+   void test_bst_eraseRefills()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      bst.setBloom();
+      // exercise
+      for (int i = 0; i < 333; i++)
+         bst.erase(i);
+      size_t numBefore = bst.bloom()->size();
+      bst.erase(333);                          // 334 erased, 666 left
+      // verify
+      assertUnit(numBefore == 1000);
+      assertUnit(bst.bloom()->size() == 666);
+      assertUnit(bst.numErased == 0);
+      assertUnit(bst.find(100) == nullptr);
+      assertUnit(bst.find(999) != nullptr);
+      bst.apply_batch({ { 5000, true } });
+      assertUnit(bst.bloom()->size() == 667);
+   }  // teardown
+
+   // a copy gets its own filter; swap trades them
+   void test_bst_copySwap()
+   {  // setup
+      custom::BST <int> bst1;
+      custom::BST <int> bst2;
+      for (int i = 0; i < 100; i++)
+         bst1.insert(i);
+      bst1.setBloom();
+      // exercise
+      custom::BST <int> bst3(bst1);
+      bst2.swap(bst1);
+      // verify
+      assertUnit(bst1.bloom() == nullptr);
+      assertUnit(bst2.bloom() != nullptr);
+      assertUnit(bst3.bloom() != nullptr && bst3.bloom() != bst2.bloom());
+      assertUnit(bst3.find(42) != nullptr);
+      assertUnit(bst3.find(142) == nullptr);
+      bst3 = bst1;
+      assertUnit(bst3.bloom() == nullptr);
+      assertUnit(bst3.empty());
+   }  // teardown
+
+   // a copied or assigned tree finds every key it holds
+   void test_bst_copyFindsAll()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 5000; i++)
+         bst.insert((i * 37) % 5000);
+      bst.setBloom();
+      custom::BST <int> bstAssigned;
+      bstAssigned.setBloom();
+      // exercise
+      custom::BST <int> bstCopy(bst);
+      bstAssigned = bst;
+      // verify
+      int numMissing = 0;
+      for (int i = 0; i < 5000; i++)
+         numMissing += (bstCopy.find(i) == nullptr) + (bstAssigned.find(i) == nullptr);
+      assertUnit(numMissing == 0);
+      assertUnit(bstCopy.bloom() != nullptr && bstAssigned.bloom() != nullptr);
+   }  // teardown
+
+   // a Spy hashes to the value it holds
+   struct SpyHash
+   {
+      size_t operator()(const Spy & s) const { return s.empty() ? 0 : (size_t)s.get(); }
+   };
+};
+
+#endif // DEBUG
@@ -0,0 +1,298 @@
+/***********************************************************************
+ * Header:
+ *    TEST CONCURRENT BST
+ * Summary:
+ *    Unit, stress, and throughput tests for the concurrent bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "concurrentBST.h"
+#include "unitTest.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+ /***********************************************
+  * TEST CONCURRENT BST
+  * Unit tests for the ConcurrentBST class. Spy keeps
+  * its counters in plain ints, so these use int keys.
+  ***********************************************/
+class TestConcurrentBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Single thread
+      test_construct_default();
+      test_insert_unique();
+      test_erase_leafAndSibling();
+      test_erase_missing();
+
+      // Many threads
+      test_insert_disjoint();
+      test_insert_sameKeys();
+      test_erase_sameKeys();
+      test_stress_mixed();
+      test_throughput();
+
+      report("ConcurrentBST");
+   }
+
+   /***************************************
+    * SINGLE THREAD
+    ***************************************/
+
+   // an empty tree is just the sentinels
+   void test_construct_default()
+   {  // exercise
+      custom::ConcurrentBST <int> bst;
+      // verify
+      assertUnit(bst.empty());
+      assertUnit(bst.size() == 0);
+      assertUnit(bst.find(0) == false);
+      assertUnit(bst.pR->inf == 3);
+      assertUnit(bst.pS->inf == 2);
+   }  // teardown
+
+   // values are unique
+   void test_insert_unique()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      // exercise
+      bool fReturn1 = bst.insert(50);
+      bool fReturn2 = bst.insert(30);
+      bool fReturn3 = bst.insert(50);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      assertUnit(bst.size() == 2);
+      assertUnit(bst.find(50));
+      assertUnit(bst.find(30));
+      assertUnit(!bst.find(40));
+   }  // teardown
+
+   // erasing a leaf pulls its sibling up
+   void test_erase_leafAndSibling()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(i);
+      // exercise
+      bool fReturn = bst.erase(30);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bst.size() == 6);
+      assertUnit(!bst.find(30));
+      for (int i : { 50, 70, 20, 40, 60, 80 })
+         assertUnit(bst.find(i));
+      assertUnit(bst.epochs.pendingCount() + bst.epochs.freedCount() == 2);  // the leaf and its parent
+   }  // teardown
+
+   // erasing a value that is not there
+   void test_erase_missing()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      bst.insert(50);
+      // exercise
+      bool fReturn = bst.erase(99);
+      // verify
+      assertUnit(fReturn == false);
+      assertUnit(bst.size() == 1);
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // every thread inserts its own range
+   void test_insert_disjoint()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      const int numThreads = 4;
+      const int numPer = 5000;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < numThreads; t++)
+         threads.emplace_back([&bst, t, numPer]()
+         {
+            for (int i = 0; i < numPer; i++)
+               bst.insert(scramble(i * numThreads + t));
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(bst.size() == numThreads * numPer);
+      int numMissing = 0;
+      for (int i = 0; i < numThreads * numPer; i++)
+         numMissing += bst.find(scramble(i)) ? 0 : 1;
+      assertUnit(numMissing == 0);
+   }  // teardown
+
+   // racing inserts of the same value: exactly one wins
+   void test_insert_sameKeys()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      const int numKeys = 5000;
+      std::atomic<int> numWon(0);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&bst, &numWon, numKeys]()
+         {
+            for (int i = 0; i < numKeys; i++)
+               if (bst.insert(scramble(i)))
+                  numWon++;
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(numWon == numKeys);
+      assertUnit(bst.size() == numKeys);
+   }  // teardown
+
+   // racing erases of the same value: exactly one wins
+   void test_erase_sameKeys()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      const int numKeys = 5000;
+      for (int i = 0; i < numKeys; i++)
+         bst.insert(scramble(i));
+      std::atomic<int> numWon(0);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&bst, &numWon, numKeys]()
+         {
+            for (int i = 0; i < numKeys; i++)
+               if (bst.erase(scramble(i)))
+                  numWon++;
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(numWon == numKeys);
+      assertUnit(bst.empty());
+      for (int i = 0; i < numKeys; i += 97)
+         assertUnit(!bst.find(scramble(i)));
+   }  // teardown
+
+   // writers churn a small range while readers search it. Every
+   // successful insert and erase is tallied per key, so afterward
+   // each key must be present exactly when its tally is one.
+   void test_stress_mixed()
+   {  // setup
+      custom::ConcurrentBST <int> bst;
+      const int numKeys = 256;
+      std::vector<std::atomic<int>> tally(numKeys);
+      for (auto & n : tally)
+         n = 0;
+      std::atomic<bool> fDone(false);
+      std::atomic<int> numBad(0);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&, t]()
+         {
+            unsigned int seed = 12345 + t;
+            for (int i = 0; i < 40000; i++)
+            {
+               seed = seed * 1103515245 + 12345;
+               int key = (seed >> 8) % numKeys;
+               if (seed & 0x10000)
+               {
+                  if (bst.insert(key))
+                     tally[key]++;
+               }
+               else if (bst.erase(key))
+                  tally[key]--;
+            }
+         });
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&]()
+         {
+            while (!fDone)
+               for (int key = 0; key < numKeys; key++)
+                  if (bst.find(key + numKeys))   // never inserted
+                     numBad++;
+         });
+      for (int t = 0; t < 4; t++)
+         threads[t].join();
+      fDone = true;
+      for (size_t t = 4; t < threads.size(); t++)
+         threads[t].join();
+      // verify
+      int numWrong = 0;
+      size_t numPresent = 0;
+      for (int key = 0; key < numKeys; key++)
+      {
+         int n = tally[key];
+         if ((n != 0 && n != 1) || bst.find(key) != (n == 1))
+            numWrong++;
+         numPresent += n;
+      }
+      assertUnit(numWrong == 0);
+      assertUnit(numBad == 0);
+      assertUnit(bst.size() == numPresent);
+   }  // teardown
+
+   // report how well a read-mostly mix scales with threads
+   void test_throughput()
+   {
+      const int numKeys = 1 << 16;
+      const int numOps = 200000;
+      for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+      {
+         // setup: half the keys present
+         custom::ConcurrentBST <int> bst;
+         for (int i = 0; i < numKeys; i += 2)
+            bst.insert(scramble(i));
+         std::vector<std::thread> threads;
+         // exercise: 90% find, 5% insert, 5% erase
+         auto start = std::chrono::steady_clock::now();
+         for (int t = 0; t < numThreads; t++)
+            threads.emplace_back([&bst, t, numOps, numThreads, numKeys]()
+            {
+               unsigned int seed = 777 + t;
+               for (int i = 0; i < numOps / numThreads; i++)
+               {
+                  seed = seed * 1103515245 + 12345;
+                  int key = scramble((seed >> 8) % numKeys);
+                  unsigned int mix = seed % 100;
+                  if (mix < 90)
+                     bst.find(key);
+                  else if (mix < 95)
+                     bst.insert(key);
+                  else
+                     bst.erase(key);
+               }
+            });
+         for (auto & thread : threads)
+            thread.join();
+         double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         // verify
+         std::cerr << "\tConcurrentBST " << numThreads << " thread(s): "
+                   << (numOps / seconds / 1.0e6) << " Mops/s\n";
+         assertUnit(bst.size() <= (size_t)numKeys);
+      }
+   }
+
+   // spread consecutive integers over the key space
+   static int scramble(int i)
+   {
+      return (int)(((unsigned int)i * 2654435761u) >> 1);
+   }
+};
+
+#endif // DEBUG
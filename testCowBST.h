@@ -0,0 +1,234 @@
+/***********************************************************************
+ * Header:
+ *    TEST COW BST
+ * Summary:
+ *    Unit tests for the copy-on-write bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "cowBST.h"
+#include "unitTest.h"
+#include "spy.h"
+
+ /***********************************************
+  * TEST COW BST
+  * Unit tests for the CowBST class
+  ***********************************************/
+class TestCowBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_constructCopy_shares();
+      test_insert_clonesPath();
+      test_insert_unshared();
+      test_erase_twoChildren();
+      test_erase_sourceUnchanged();
+      test_findMutable_clones();
+      test_clear_keepsCopy();
+      test_count_duplicates();
+
+      report("CowBST");
+   }
+
+   /***************************************
+    * COPY CONSTRUCTOR
+    ***************************************/
+
+   // a copy shares every node and copies no data
+   void test_constructCopy_shares()
+   {  // setup
+      custom::CowBST <Spy> bstSrc;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bstSrc.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::CowBST <Spy> bstDest(bstSrc);
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(bstDest.root == bstSrc.root);
+      assertUnit(bstDest.size() == 7);
+      if (bstSrc.root)
+         assertUnit(bstSrc.root->refs == 2);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // inserting into a copy clones just the path
+   //                 50
+   //          +-------+-------+
+   //         30              70
+   //     +----+----+     +----+----+
+   //    20        40    60        80
+   //                            +--+
+   //                          [75]
+   void test_insert_clonesPath()
+   {  // setup
+      custom::CowBST <Spy> bstSrc;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bstSrc.insert(Spy(i));
+      custom::CowBST <Spy> bstDest(bstSrc);
+      Spy::reset();
+      // exercise
+      bstDest.insert(Spy(75));
+      // verify
+      assertUnit(Spy::numCopy() == 3);      // clone [50][70][80]
+      assertUnit(bstSrc.size() == 7);
+      assertUnit(bstDest.size() == 8);
+      assertUnit(bstSrc.find(Spy(75)) == nullptr);
+      assertUnit(bstDest.find(Spy(75)) != nullptr);
+      assertUnit(bstSrc.root != bstDest.root);
+      if (bstSrc.root && bstDest.root)
+      {
+         assertUnit(bstSrc.root->pLeft == bstDest.root->pLeft);
+         assertUnit(bstDest.root->pRight->pParent == bstDest.root);
+         assertUnit(bstDest.root->pRight->pRight->pParent == bstDest.root->pRight);
+         assertUnit(bstSrc.root->pRight->pParent == bstSrc.root);
+      }
+   }  // teardown
+
+   // once the source is gone nothing is shared and nothing is cloned
+   void test_insert_unshared()
+   {  // setup
+      custom::CowBST <Spy> bstDest;
+      {
+         custom::CowBST <Spy> bstSrc;
+         for (int i : { 50, 30, 70 })
+            bstSrc.insert(Spy(i));
+         bstDest = bstSrc;
+      }
+      Spy::reset();
+      // exercise
+      bstDest.insert(Spy(20));
+      // verify
+      assertUnit(Spy::numCopy() == 0);      // nothing is cloned
+      assertUnit(Spy::numCopyMove() == 1);  // move the new [20] in
+      assertUnit(bstDest.root != nullptr);
+      if (bstDest.root)
+      {
+         assertUnit(bstDest.root->refs == 1);
+         assertUnit(bstDest.root->pLeft->pLeft->pParent == bstDest.root->pLeft);
+      }
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase a node with two children from a copy
+   void test_erase_twoChildren()
+   {  // setup
+      custom::CowBST <int> bstSrc = { 50, 30, 70, 20, 40, 60, 80, 65 };
+      custom::CowBST <int> bstDest(bstSrc);
+      // exercise
+      bool fReturn = bstDest.erase(50);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bstDest.size() == 7);
+      assertUnit(bstDest.root != nullptr);
+      if (bstDest.root && bstSrc.root)
+      {
+         assertUnit(bstDest.root->data == 60);
+         assertUnit(bstDest.root->pParent == nullptr);
+         assertUnit(bstDest.root->pLeft == bstSrc.root->pLeft);
+         assertUnit(bstDest.root->pRight->data == 70);
+         assertUnit(bstDest.root->pRight->pParent == bstDest.root);
+         assertUnit(bstDest.root->pRight->pLeft->data == 65);
+      }
+      int values[7] = {};
+      int num = 0;
+      for (auto it = bstDest.begin(); it != bstDest.end() && num < 7; ++it)
+         values[num++] = *it;
+      assertUnit(num == 7);
+      assertUnit(values[2] == 40);
+      assertUnit(values[3] == 60);
+      assertUnit(values[4] == 65);
+   }  // teardown
+
+   // the source keeps its copy of the erased value
+   void test_erase_sourceUnchanged()
+   {  // setup
+      custom::CowBST <int> bstSrc = { 50, 30, 70 };
+      custom::CowBST <int> bstDest(bstSrc);
+      // exercise
+      bool fReturn1 = bstDest.erase(30);
+      bool fReturn2 = bstDest.erase(99);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(bstSrc.find(30) != nullptr);
+      assertUnit(bstDest.find(30) == nullptr);
+      assertUnit(bstSrc.size() == 3);
+      assertUnit(bstDest.size() == 2);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // writing through find does not leak into the other tree
+   void test_findMutable_clones()
+   {  // setup
+      custom::CowBST <int> bstSrc = { 50, 30, 70 };
+      custom::CowBST <int> bstDest(bstSrc);
+      // exercise
+      int * p = bstDest.find(70);
+      // verify
+      assertUnit(p != nullptr);
+      assertUnit(p != bstSrc.find(70));
+      assertUnit(bstSrc.root->pLeft == bstDest.root->pLeft);
+   }  // teardown
+
+   /***************************************
+    * CLEAR
+    ***************************************/
+
+   // clearing one tree leaves the copy intact and frees nothing shared
+   void test_clear_keepsCopy()
+   {  // setup
+      Spy::reset();
+      {
+         custom::CowBST <Spy> bstSrc;
+         for (int i : { 50, 30, 70 })
+            bstSrc.insert(Spy(i));
+         custom::CowBST <Spy> bstDest(bstSrc);
+         int numDeleteBefore = Spy::numDelete();
+         // exercise
+         bstSrc.clear();
+         // verify
+         assertUnit(Spy::numDelete() == numDeleteBefore);
+         assertUnit(bstDest.size() == 3);
+         assertUnit(bstDest.root->refs == 1);
+      }
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * COUNT
+    ***************************************/
+
+   // duplicates are all found below the first one
+   void test_count_duplicates()
+   {  // setup
+      custom::CowBST <int> bst = { 50, 30, 50, 70, 60, 50 };
+      // exercise
+      size_t num = bst.count(50);
+      // verify
+      assertUnit(num == 3);
+      assertUnit(bst.count(30) == 1);
+      assertUnit(bst.count(99) == 0);
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,247 @@
+/***********************************************************************
+ * Header:
+ *    TEST EPOCH
+ * Summary:
+ *    Unit tests for epoch-based reclamation
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "epoch.h"
+#include "concurrentBST.h"
+#include "unitTest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+ /***********************************************
+  * TEST EPOCH
+  * Unit tests for the EpochManager class
+  ***********************************************/
+class TestEpoch : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Single thread
+      test_retire_freedAfterTwoEpochs();
+      test_retire_byteCount();
+      test_pin_nested();
+      test_destructor_freesPending();
+      test_cache_dropsDeadManagers();
+
+      // Many threads
+      test_pin_blocksReclaim();
+      test_maxPending_bounded();
+      test_concurrentBST_churn();
+
+      report("Epoch");
+   }
+
+   /***************************************
+    * SINGLE THREAD
+    ***************************************/
+
+   // memory retired at epoch e is freed once the epoch reaches e+2
+   void test_retire_freedAfterTwoEpochs()
+   {  // setup
+      custom::EpochManager epochs;
+      {
+         custom::EpochManager::Guard guard = epochs.pin();
+         epochs.retire(new int(99));
+      }
+      // exercise
+      epochs.collect();
+      size_t numAfterOne = epochs.freedCount();
+      epochs.collect();
+      // verify
+      assertUnit(numAfterOne == 0);
+      assertUnit(epochs.epoch() == 2);
+      assertUnit(epochs.freedCount() == 1);
+      assertUnit(epochs.pendingCount() == 0);
+   }  // teardown
+
+   // retired bytes are tracked until freed
+   void test_retire_byteCount()
+   {  // setup
+      custom::EpochManager epochs;
+      // exercise
+      epochs.retire(new double(1.0));
+      epochs.retire(new double(2.0));
+      // verify
+      assertUnit(epochs.pendingCount() == 2);
+      assertUnit(epochs.pendingBytes() == 2 * sizeof(double));
+      epochs.collect();
+      epochs.collect();
+      assertUnit(epochs.pendingBytes() == 0);
+   }  // teardown
+
+   // only the outermost guard unpins
+   void test_pin_nested()
+   {  // setup
+      custom::EpochManager epochs;
+      custom::EpochManager::Record * p = nullptr;
+      // exercise
+      {
+         custom::EpochManager::Guard outer = epochs.pin();
+         p = epochs.record();
+         {
+            custom::EpochManager::Guard inner = epochs.pin();
+            assertUnit(p->depth == 2);
+         }
+         // verify
+         assertUnit(p->depth == 1);
+         assertUnit(p->localEpoch == 0);
+      }
+      assertUnit(p->depth == 0);
+      assertUnit(p->localEpoch == custom::EpochManager::IDLE);
+   }  // teardown
+
+   // whatever is still pending goes with the manager
+   void test_destructor_freesPending()
+   {  // setup
+      std::atomic<int> numDeleted(0);
+      struct Counted
+      {
+         std::atomic<int> * pNum;
+         ~Counted() { (*pNum)++; }
+      };
+      // exercise
+      {
+         custom::EpochManager epochs;
+         for (int i = 0; i < 5; i++)
+            epochs.retire(new Counted{ &numDeleted });
+         assertUnit(numDeleted == 0);
+      }
+      // verify
+      assertUnit(numDeleted == 5);
+   }  // teardown
+
+   // a thread that outlives many trees does not keep their records
+   void test_cache_dropsDeadManagers()
+   {  // setup
+      custom::EpochManager epochsLive;
+      epochsLive.pin();
+      size_t numBefore = custom::EpochManager::threadCache().entries.size();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         custom::ConcurrentBST <int> bst;
+         bst.insert(i);
+         bst.find(i);
+      }
+      custom::EpochManager::Guard guard = epochsLive.pin();
+      // verify
+      assertUnit(custom::EpochManager::threadCache().entries.size() == numBefore);
+      assertUnit(custom::EpochManager::threadCache().entries.back().first == epochsLive.id);
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // a reader pinned at an old epoch keeps the epoch from advancing
+   void test_pin_blocksReclaim()
+   {  // setup
+      custom::EpochManager epochs;
+      std::atomic<int> stage(0);
+      std::thread reader([&]()
+      {
+         custom::EpochManager::Guard guard = epochs.pin();
+         stage = 1;
+         while (stage != 2)
+            std::this_thread::yield();
+      });
+      while (stage != 1)
+         std::this_thread::yield();
+      epochs.retire(new int(7));
+      // exercise
+      for (int i = 0; i < 4; i++)
+         epochs.collect();
+      size_t numWhilePinned = epochs.freedCount();
+      stage = 2;
+      reader.join();
+      epochs.collect();
+      epochs.collect();
+      // verify
+      assertUnit(numWhilePinned == 0);
+      assertUnit(epochs.freedCount() == 1);
+   }  // teardown
+
+   // a writer never holds more than maxPending once it unpins
+   void test_maxPending_bounded()
+   {  // setup
+      custom::EpochManager epochs(4, 16);
+      std::atomic<bool> fDone(false);
+      std::atomic<bool> fOver(false);
+      std::thread reader([&]()
+      {
+         while (!fDone)
+         {
+            custom::EpochManager::Guard guard = epochs.pin();
+         }
+      });
+      // exercise
+      for (int i = 0; i < 2000; i++)
+      {
+         {
+            custom::EpochManager::Guard guard = epochs.pin();
+            epochs.retire(new int(i));
+         }
+         if (epochs.record()->numPending > 16)
+            fOver = true;
+      }
+      fDone = true;
+      reader.join();
+      // verify
+      assertUnit(fOver == false);
+      assertUnit(epochs.freedCount() + epochs.pendingCount() == 2000);
+      assertUnit(epochs.freedCount() >= 2000 - 16);
+   }  // teardown
+
+   // erase-heavy churn on a ConcurrentBST keeps its garbage bounded
+   void test_concurrentBST_churn()
+   {  // setup
+      const int numThreads = 4;
+      const size_t maxPending = 256;
+      custom::ConcurrentBST <int> bst(32, maxPending);
+      std::atomic<size_t> maxSeen(0);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < numThreads; t++)
+         threads.emplace_back([&, t]()
+         {
+            unsigned int seed = 4242 + t;
+            for (int i = 0; i < 20000; i++)
+            {
+               seed = seed * 1103515245 + 12345;
+               int key = (seed >> 8) % 256;
+               if (seed & 0x10000)
+                  bst.insert(key);
+               else
+                  bst.erase(key);
+               size_t num = bst.retiredCount();
+               size_t seen = maxSeen;
+               while (num > seen && !maxSeen.compare_exchange_weak(seen, num))
+                  ;
+            }
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify: an erase retires up to two nodes while pinned, so a
+      // thread can sit just over its bound until it unpins and waits
+      assertUnit(maxSeen <= numThreads * (maxPending + 2));
+      assertUnit(bst.epochs.freedCount() > 0);
+      assertUnit(bst.retiredBytes() == bst.retiredCount() * sizeof(custom::ConcurrentBST<int>::CNode));
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,283 @@
+/***********************************************************************
+ * Header:
+ *    TEST INDEXED BST
+ * Summary:
+ *    Unit tests for the vector-backed bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "indexedBST.h"
+#include "bst.h"
+#include "unitTest.h"
+#include "spy.h"
+
+ /***********************************************
+  * TEST INDEXED BST
+  * Unit tests for the IndexedBST class
+  ***********************************************/
+class TestIndexedBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_node_smallerThanBST();
+      test_insert_inOrder();
+      test_insert_keepUnique();
+      test_find_standard();
+      test_erase_twoChildren();
+      test_erase_reusesSlot();
+      test_compact_inOrder();
+      test_compact_periodic();
+      test_constructCopy_exact();
+      test_clear_standard();
+
+      report("IndexedBST");
+   }
+
+   /***************************************
+    * NODE
+    ***************************************/
+
+   // three 32-bit links instead of three pointers
+   void test_node_smallerThanBST()
+   {  // setup
+      size_t sizeIndexed = sizeof(custom::IndexedBST<int>::INode);
+      // exercise
+      size_t sizeLinks = sizeIndexed - sizeof(int);
+      // verify
+      assertUnit(sizeLinks == 3 * sizeof(uint32_t));
+      assertUnit(sizeIndexed <= sizeof(custom::BST<int>::BNode));
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // values come back in order and the links agree with each other
+   void test_insert_inOrder()
+   {  // setup
+      custom::IndexedBST <Spy> bst;
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40, 60, 80, 40 })
+         bst.insert(Spy(i));
+      // verify
+      assertUnit(bst.size() == 8);
+      assertUnit(bst.capacity() == 8);
+      assertUnit(bst.root == 0);
+      assertUnit(isLinked(bst, bst.root, custom::IndexedBST<Spy>::NIL));
+      int values[8] = {};
+      int num = 0;
+      for (auto it = bst.begin(); it != bst.end() && num < 8; ++it)
+         values[num++] = (*it).get();
+      assertUnit(num == 8);
+      assertUnit(values[0] == 20 && values[2] == 40 && values[3] == 40 && values[7] == 80);
+   }  // teardown
+
+   // keepUnique turns away a value already there
+   void test_insert_keepUnique()
+   {  // setup
+      custom::IndexedBST <Spy> bst{ Spy(50), Spy(30), Spy(70) };
+      // exercise
+      bool fReturn1 = bst.insert(Spy(30), true /* keepUnique */);
+      bool fReturn2 = bst.insert(Spy(35), true /* keepUnique */);
+      // verify
+      assertUnit(fReturn1 == false);
+      assertUnit(fReturn2 == true);
+      assertUnit(bst.size() == 4);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // find compares exactly as the BST does
+   void test_find_standard()
+   {  // setup
+      custom::IndexedBST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy s60(60);
+      Spy s65(65);
+      Spy::reset();
+      // exercise
+      const Spy * p60 = bst.find(s60);
+      int numEquals60 = Spy::numEquals();
+      int numLess60 = Spy::numLessthan();
+      const Spy * p65 = bst.find(s65);
+      // verify
+      assertUnit(p60 != nullptr && *p60 == s60);
+      assertUnit(numEquals60 == 3);
+      assertUnit(numLess60 == 2);
+      assertUnit(p65 == nullptr);
+      assertUnit(Spy::numCopy() == 0);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // the successor's slot takes the erased node's place in the tree
+   void test_erase_twoChildren()
+   {  // setup
+      custom::IndexedBST <Spy> bst;
+      setupStandardFixture(bst);
+      uint32_t i60 = bst.nodes[bst.root].pRight;
+      i60 = bst.nodes[i60].pLeft;
+      // exercise
+      bool fReturn = bst.erase(Spy(50));
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bst.size() == 6);
+      assertUnit(bst.root == i60);
+      assertUnit(bst.nodes[i60].data == Spy(60));
+      assertUnit(bst.freeHead == 0);          // where 50 was
+      assertUnit(bst.nodes[0].data.empty());  // and its value is gone
+      assertUnit(isLinked(bst, bst.root, custom::IndexedBST<Spy>::NIL));
+      assertUnit(bst.find(Spy(50)) == nullptr);
+   }  // teardown
+
+   // erased slots are reused before the vector grows
+   void test_erase_reusesSlot()
+   {  // setup
+      custom::IndexedBST <int> bst;
+      for (int i = 0; i < 100; i++)
+         bst.insert((i * 37) % 100);
+      // exercise
+      for (int i = 0; i < 100; i += 2)
+         bst.erase(i);
+      for (int i = 0; i < 50; i++)
+         bst.insert(1000 + i);
+      // verify
+      assertUnit(bst.size() == 100);
+      assertUnit(bst.capacity() == 100);
+      assertUnit(bst.freeHead == custom::IndexedBST<int>::NIL);
+      assertUnit(isLinked(bst, bst.root, custom::IndexedBST<int>::NIL));
+   }  // teardown
+
+   /***************************************
+    * COMPACT
+    ***************************************/
+
+   // compaction lays the nodes out in order with no gaps
+   void test_compact_inOrder()
+   {  // setup
+      custom::IndexedBST <Spy> bst;
+      for (int i = 0; i < 50; i++)
+         bst.insert(Spy((i * 17) % 50));
+      for (int i = 0; i < 50; i += 3)
+         bst.erase(Spy(i));
+      size_t numLeft = bst.size();
+      Spy::reset();
+      // exercise
+      bst.compact();
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(bst.size() == numLeft);
+      assertUnit(bst.capacity() == numLeft);
+      assertUnit(bst.freeHead == custom::IndexedBST<Spy>::NIL);
+      assertUnit(isLinked(bst, bst.root, custom::IndexedBST<Spy>::NIL));
+      bool fOrdered = true;
+      for (size_t i = 1; i < bst.nodes.size(); i++)
+         fOrdered = fOrdered && bst.nodes[i - 1].data < bst.nodes[i].data;
+      assertUnit(fOrdered);
+      assertUnit(bst.find(Spy(1)) != nullptr);
+      assertUnit(bst.find(Spy(3)) == nullptr);
+   }  // teardown
+
+   // with a period set, every n-th erase compacts
+   void test_compact_periodic()
+   {  // setup
+      custom::IndexedBST <int> bst;
+      bst.setCompactPeriod(10);
+      for (int i = 0; i < 100; i++)
+         bst.insert((i * 37) % 100);
+      // exercise
+      for (int i = 0; i < 9; i++)
+         bst.erase(i);
+      size_t capacityBefore = bst.capacity();
+      bst.erase(9);
+      // verify
+      assertUnit(capacityBefore == 100);
+      assertUnit(bst.capacity() == 90);
+      assertUnit(bst.numErased == 0);
+      assertUnit(bst.nodes[0].data == 10);
+   }  // teardown
+
+   /***************************************
+    * COPY
+    ***************************************/
+
+   // a copy is the same vector: same slots, same links, same free list
+   void test_constructCopy_exact()
+   {  // setup
+      custom::IndexedBST <Spy> bstSrc;
+      setupStandardFixture(bstSrc);
+      bstSrc.erase(Spy(20));
+      Spy::reset();
+      // exercise
+      custom::IndexedBST <Spy> bstDest(bstSrc);
+      // verify
+      assertUnit(Spy::numCopy() == 7);        // the free slot too
+      assertUnit(bstDest.size() == 6);
+      assertUnit(bstDest.root == bstSrc.root);
+      assertUnit(bstDest.freeHead == bstSrc.freeHead);
+      bstDest.insert(Spy(25));
+      assertUnit(bstDest.capacity() == 7);
+      assertUnit(bstSrc.find(Spy(25)) == nullptr);
+   }  // teardown
+
+   /***************************************
+    * CLEAR
+    ***************************************/
+
+   // clear lets go of every slot
+   void test_clear_standard()
+   {  // setup
+      custom::IndexedBST <Spy> bst;
+      setupStandardFixture(bst);
+      Spy::reset();
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(Spy::numDestructor() == 7);
+      assertUnit(bst.empty());
+      assertUnit(bst.capacity() == 0);
+      assertUnit(bst.begin() == bst.end());
+   }  // teardown
+
+   /**************************************************************
+    * SETUP STANDARD FIXTURE
+    *                (50)
+    *          +-------+-------+
+    *        (30)            (70)
+    *     +----+----+     +----+----+
+    *   (20)      (40)  (60)      (80)
+    * stored in the vector in insertion order:
+    *   50 30 70 20 40 60 80
+    *************************************************************/
+   void setupStandardFixture(custom::IndexedBST <Spy> & bst)
+   {
+      assertUnit(bst.empty());
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(Spy(i));
+   }
+
+   // every child points back at its parent
+   template <class T>
+   static bool isLinked(const custom::IndexedBST <T> & bst, uint32_t i, uint32_t parent)
+   {
+      if (i == custom::IndexedBST<T>::NIL)
+         return true;
+      const auto & node = bst.nodes[i];
+      return node.pParent == parent && isLinked(bst, node.pLeft, i) && isLinked(bst, node.pRight, i);
+   }
+};
+
+#endif // DEBUG
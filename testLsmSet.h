@@ -0,0 +1,316 @@
+/***********************************************************************
+ * Header:
+ *    TEST LSM SET
+ * Summary:
+ *    Unit tests for the log-structured set
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "lsmSet.h"
+#include "unitTest.h"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+ /***********************************************
+  * TEST LSM SET
+  * Unit tests for the LsmSet class
+  ***********************************************/
+class TestLsmSet : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_staysInMemtable();
+      test_insert_fullMemtableFreezes();
+      test_insert_sortedStaysShallow();
+      test_erase_tombstoneShadowsOlder();
+      test_insert_cancelsErase();
+      test_merge_sameTier();
+      test_merge_dropsTombstonesAtOldest();
+      test_forEach_newestWins();
+      test_clear();
+      test_background_matchesStdSet();
+
+      report("LsmSet");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // until it fills, the memtable is all there is
+   void test_insert_staysInMemtable()
+   {  // setup
+      custom::LsmSet <int> set(8, false /* fBackground */);
+      // exercise
+      for (int i : { 50, 30, 70, 30, 20 })
+         set.insert(i);
+      // verify
+      assertUnit(set.numRuns() == 0);
+      assertUnit(set.memtable.size() == 4);
+      assertUnit(set.find(30));
+      assertUnit(!set.find(40));
+   }  // teardown
+
+   // a full memtable becomes a sorted run with a filter over every value
+   void test_insert_fullMemtableFreezes()
+   {  // setup
+      custom::LsmSet <int> set(4, false /* fBackground */);
+      // exercise
+      for (int i : { 40, 10, 30, 20 })
+         set.insert(i);
+      // verify
+      assertUnit(set.numRuns() == 1);
+      assertUnit(set.memtable.empty());
+      assertUnit(entries(*set.runs[0]) == std::vector<int>({ 10, 20, 30, 40 }));
+      assertUnit(set.runs[0]->bloom.size() == 4);
+      assertUnit(set.find(10));
+      assertUnit(set.find(40));
+      assertUnit(!set.find(25));
+   }  // teardown
+
+   // sorted writes do not grow the memtable or the tombstones into a chain,
+   // before or after a freeze
+   void test_insert_sortedStaysShallow()
+   {  // setup
+      custom::LsmSet <int> set(1024, false /* fBackground */);
+      for (int i = 0; i < 1024; i++)
+         set.insert(i);
+      // exercise
+      for (int i = 1024; i < 1924; i++)
+         set.insert(i);
+      for (int i = 0; i < 100; i++)
+         set.erase(i);
+      // verify
+      assertUnit(set.numRuns() == 1);
+      assertUnit(set.memtable.size() == 900);
+      assertUnit(set.tombstones.size() == 100);
+      assertUnit(depth(set.memtable.root) <= 20);    // 2 * log2(900)
+      assertUnit(depth(set.tombstones.root) <= 14);  // 2 * log2(100)
+      assertUnit(set.find(1923));
+      assertUnit(!set.find(99));
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // an erase hides a value in an older run, first from the memtable, then from a run of its own
+   void test_erase_tombstoneShadowsOlder()
+   {  // setup
+      custom::LsmSet <int> set(4, false /* fBackground */);
+      for (int i : { 1, 2, 3, 4 })
+         set.insert(i);
+      // exercise
+      set.erase(2);
+      bool fFoundInMemtable = set.find(2);
+      set.flush();
+      // verify
+      assertUnit(fFoundInMemtable == false);
+      assertUnit(set.numRuns() == 2);
+      assertUnit(set.runs[1]->entries.size() == 1);
+      assertUnit(set.runs[1]->entries[0].data == 2);
+      assertUnit(set.runs[1]->entries[0].fTombstone);
+      assertUnit(!set.find(2));
+      assertUnit(set.find(3));
+   }  // teardown
+
+   // putting a value back drops its tombstone
+   void test_insert_cancelsErase()
+   {  // setup
+      custom::LsmSet <int> set(8, false /* fBackground */);
+      set.insert(5);
+      set.flush();
+      set.erase(5);
+      // exercise
+      set.insert(5);
+      // verify
+      assertUnit(set.tombstones.empty());
+      assertUnit(set.memtable.size() == 1);
+      assertUnit(set.find(5));
+   }  // teardown
+
+   /***************************************
+    * MERGE
+    ***************************************/
+
+   // FANOUT runs of one tier become one run of the next
+   void test_merge_sameTier()
+   {  // setup
+      custom::LsmSet <int> set(4, false /* fBackground */);
+      // exercise
+      for (int i = 0; i < 12; i++)
+         set.insert(i);
+      size_t numRunsBefore = set.numRuns();
+      for (int i = 12; i < 16; i++)
+         set.insert(i);
+      // verify
+      assertUnit(numRunsBefore == 3);
+      assertUnit(set.numRuns() == 1);
+      assertUnit(set.numMerges == 1);
+      assertUnit(set.tier(*set.runs[0]) == 1);
+      assertUnit(entries(*set.runs[0]) == range(0, 16));
+      assertUnit(set.runs[0]->bloom.size() == 16);
+   }  // teardown
+
+   // tombstones shadow nothing once they reach the oldest run, so they go
+   void test_merge_dropsTombstonesAtOldest()
+   {  // setup
+      custom::LsmSet <int> set(4, false /* fBackground */);
+      for (int i : { 1, 2, 3, 4 })
+         set.insert(i);
+      // exercise
+      for (int i : { 1, 3, 9 })
+         set.erase(i);
+      set.insert(5);
+      for (int i : { 2, 6, 7, 8 })
+         set.erase(i);
+      for (int i : { 9, 10, 11, 12 })
+         set.insert(i);
+      // verify
+      assertUnit(set.numMerges == 1);
+      assertUnit(set.numRuns() == 1);
+      assertUnit(entries(*set.runs[0]) == std::vector<int>({ 4, 5, 9, 10, 11, 12 }));
+      assertUnit(live(set) == std::vector<int>({ 4, 5, 9, 10, 11, 12 }));
+   }  // teardown
+
+   /***************************************
+    * FOR EACH
+    ***************************************/
+
+   // values from the memtable and every run come out once, in order
+   void test_forEach_newestWins()
+   {  // setup
+      custom::LsmSet <int> set(4, false /* fBackground */);
+      for (int i : { 10, 20, 30, 40 })
+         set.insert(i);
+      for (int i : { 20, 50, 30, 35 })
+      {
+         set.erase(i);
+         set.insert(i + 1);
+      }
+      // exercise
+      set.erase(10);
+      set.insert(30);
+      std::vector<int> values = live(set);
+      // verify
+      assertUnit(set.numRuns() == 3);
+      assertUnit(values == std::vector<int>({ 21, 30, 31, 36, 40, 51 }));
+   }  // teardown
+
+   /***************************************
+    * CLEAR
+    ***************************************/
+
+   // clear empties the memtable and drops every run
+   void test_clear()
+   {  // setup
+      custom::LsmSet <int> set(4);
+      for (int i = 0; i < 100; i++)
+         set.insert(i);
+      // exercise
+      set.clear();
+      // verify
+      assertUnit(set.numRuns() == 0);
+      assertUnit(set.memtable.empty());
+      assertUnit(!set.find(50));
+      assertUnit(live(set).empty());
+   }  // teardown
+
+   /***************************************
+    * BACKGROUND
+    ***************************************/
+
+   // a writer and a reader run while the thread merges behind them;
+   // afterwards the set matches std::set and every tier is short
+   void test_background_matchesStdSet()
+   {  // setup
+      custom::LsmSet <int> set(64);
+      std::set<int> reference;
+      unsigned int seed = 42;
+      // exercise
+      std::thread reader([&set]()
+      {
+         for (int i = 0; i < 5000; i++)
+            set.find(i % 1000);
+      });
+      for (int i = 0; i < 50000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int value = (int)((seed >> 8) % 5000);
+         if ((seed >> 4) % 4 == 0)
+         {
+            set.erase(value);
+            reference.erase(value);
+         }
+         else
+         {
+            set.insert(value);
+            reference.insert(value);
+         }
+      }
+      reader.join();
+      set.waitForMerges();
+      // verify
+      assertUnit(set.numMerges > 0);
+      assertUnit(set.numRuns() < 4 * custom::LsmSet <int>::FANOUT);
+      assertUnit(live(set) == std::vector<int>(reference.begin(), reference.end()));
+      int numDifferent = 0;
+      for (int i = 0; i < 5000; i++)
+         numDifferent += set.find(i) != (reference.count(i) == 1);
+      assertUnit(numDifferent == 0);
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // every value in a run, tombstones included
+   static std::vector<int> entries(const custom::LsmSet <int>::Run & run)
+   {
+      std::vector<int> values;
+      for (auto & entry : run.entries)
+         values.push_back(entry.data);
+      return values;
+   }
+
+   // every value still in the set
+   static std::vector<int> live(const custom::LsmSet <int> & set)
+   {
+      std::vector<int> values;
+      set.forEach([&values](int i) { values.push_back(i); });
+      return values;
+   }
+
+   // nodes on the longest path
+   template <class Node>
+   static int depth(const Node * p)
+   {
+      if (!p)
+         return 0;
+      int left = depth(p->pLeft);
+      int right = depth(p->pRight);
+      return 1 + (left > right ? left : right);
+   }
+
+   // iBegin .. iEnd-1
+   static std::vector<int> range(int iBegin, int iEnd)
+   {
+      std::vector<int> values;
+      for (int i = iBegin; i < iEnd; i++)
+         values.push_back(i);
+      return values;
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,279 @@
+/***********************************************************************
+ * Header:
+ *    TEST MAP
+ * Summary:
+ *    Unit tests for map
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "map.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <stdexcept>
+#include <string>
+#include <type_traits> // for std::is_const
+#include <functional> // for std::greater
+
+ /***********************************************
+  * TEST MAP
+  * Unit tests for the map class
+  ***********************************************/
+class TestMap : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Access
+      test_find_noValueBuilt();
+      test_find_missing();
+      test_at_present();
+      test_at_missing();
+      test_squareBracket_new();
+      test_squareBracket_existing();
+
+      // Insert
+      test_tryEmplace_new();
+      test_tryEmplace_existing();
+      test_insertOrAssign();
+      test_compare_greater();
+      test_iterator_constKey();
+
+      // Remove
+      test_erase();
+
+      report("Map");
+   }
+
+   /***************************************
+    * FIND
+    *    map::find(const K &)
+    ***************************************/
+
+   // looking up a key never creates or copies a value
+   void test_find_noValueBuilt()
+   {  // setup
+      custom::map <int, Spy> m;
+      m.try_emplace(50, 500);
+      m.try_emplace(30, 300);
+      m.try_emplace(70, 700);
+      Spy::reset();
+      // exercise
+      auto it = m.find(30);
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(it != m.end());
+      if (it != m.end())
+      {
+         assertUnit((*it).first == 30);
+         assertUnit(it->second.get() == 300);
+      }
+   }  // teardown
+
+   // find a key that is not there
+   void test_find_missing()
+   {  // setup
+      custom::map <int, int> m = { {50, 5}, {30, 3}, {70, 7} };
+      // exercise
+      auto it = m.find(40);
+      // verify
+      assertUnit(it == m.end());
+      assertUnit(m.count(40) == 0);
+      assertUnit(m.count(70) == 1);
+   }  // teardown
+
+   /***************************************
+    * AT
+    *    map::at(const K &)
+    ***************************************/
+
+   // at() on a key that is there
+   void test_at_present()
+   {  // setup
+      custom::map <std::string, int> m = { {"b", 2}, {"a", 1}, {"c", 3} };
+      // exercise
+      m.at("c") = 33;
+      // verify
+      assertUnit(m.at("a") == 1);
+      assertUnit(m.at("b") == 2);
+      assertUnit(m.at("c") == 33);
+      assertUnit(m.size() == 3);
+   }  // teardown
+
+   // at() on a missing key throws and does not insert
+   void test_at_missing()
+   {  // setup
+      custom::map <int, int> m = { {1, 10} };
+      bool fThrown = false;
+      // exercise
+      try
+      {
+         m.at(2);
+      }
+      catch (const std::out_of_range &)
+      {
+         fThrown = true;
+      }
+      // verify
+      assertUnit(fThrown == true);
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   /***************************************
+    * SQUARE BRACKET
+    *    map::operator[](const K &)
+    ***************************************/
+
+   // operator[] on a new key default-constructs exactly one value
+   void test_squareBracket_new()
+   {  // setup
+      custom::map <int, Spy> m;
+      Spy::reset();
+      // exercise
+      Spy & s = m[50];
+      // verify
+      assertUnit(Spy::numDefault() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(s.empty());
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   // operator[] on an existing key builds nothing
+   void test_squareBracket_existing()
+   {  // setup
+      custom::map <int, Spy> m;
+      m.try_emplace(50, 500);
+      Spy::reset();
+      // exercise
+      Spy & s = m[50];
+      // verify
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(s.get() == 500);
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   /***************************************
+    * TRY EMPLACE
+    *    map::try_emplace(const K &, Args...)
+    ***************************************/
+
+   // the value is built in place
+   void test_tryEmplace_new()
+   {  // setup
+      custom::map <int, Spy> m;
+      Spy::reset();
+      // exercise
+      auto result = m.try_emplace(50, 500);
+      // verify
+      assertUnit(Spy::numNondefault() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(result.second == true);
+      assertUnit(result.first->first == 50);
+      assertUnit(result.first->second.get() == 500);
+   }  // teardown
+
+   // arguments are left alone when the key exists
+   void test_tryEmplace_existing()
+   {  // setup
+      custom::map <int, Spy> m;
+      m.try_emplace(50, 500);
+      Spy s(999);
+      Spy::reset();
+      // exercise
+      auto result = m.try_emplace(50, std::move(s));
+      // verify
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(s.empty() == false);
+      assertUnit(result.second == false);
+      assertUnit(result.first->second.get() == 500);
+   }  // teardown
+
+   // insert_or_assign overwrites
+   void test_insertOrAssign()
+   {  // setup
+      custom::map <int, int> m = { {50, 5}, {30, 3} };
+      // exercise
+      auto result1 = m.insert_or_assign(50, 55);
+      auto result2 = m.insert_or_assign(70, 7);
+      // verify
+      assertUnit(result1.second == false);
+      assertUnit(result2.second == true);
+      assertUnit(m.at(50) == 55);
+      assertUnit(m.at(70) == 7);
+      assertUnit(m.size() == 3);
+   }  // teardown
+
+   // a custom comparator orders the keys
+   void test_compare_greater()
+   {  // setup
+      custom::map <int, int, std::greater<int>> m;
+      for (int i = 1; i <= 5; i++)
+         m[i] = i * 10;
+      // exercise
+      int keys[5] = {};
+      int num = 0;
+      for (auto it = m.begin(); it != m.end() && num < 5; ++it)
+         keys[num++] = it->first;
+      // verify
+      assertUnit(num == 5);
+      assertUnit(keys[0] == 5);
+      assertUnit(keys[4] == 1);
+   }  // teardown
+
+   // the key cannot be changed through an iterator, the value can
+   void test_iterator_constKey()
+   {  // setup
+      custom::map <int, int> m = { {50, 5}, {30, 3}, {70, 7} };
+      custom::map <int, int> :: iterator it = m.find(30);
+      // exercise
+      it->second = 33;
+      // verify
+      assertUnit((std::is_const<decltype(it->first)>::value));
+      assertUnit((std::is_same<custom::map <int, int> :: value_type, std::pair<const int, int>>::value));
+      assertUnit(m.at(30) == 33);
+      assertUnit(m.begin()->first == 30);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    *    map::erase(const K &)
+    ***************************************/
+
+   // erase by key
+   void test_erase()
+   {  // setup
+      custom::map <int, int> m = { {50, 5}, {30, 3}, {70, 7}, {60, 6} };
+      // exercise
+      size_t num1 = m.erase(50);
+      size_t num2 = m.erase(50);
+      // verify
+      assertUnit(num1 == 1);
+      assertUnit(num2 == 0);
+      assertUnit(m.size() == 3);
+      assertUnit(m.find(50) == m.end());
+      assertUnit(m.at(60) == 6);
+      assertUnit(m.bst.root != nullptr);
+      if (m.bst.root)
+         assertUnit(m.bst.root->pParent == nullptr);
+   }  // teardown
+};
+
+#endif // DEBUG
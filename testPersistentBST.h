@@ -0,0 +1,308 @@
+/***********************************************************************
+ * Header:
+ *    TEST PERSISTENT BST
+ * Summary:
+ *    Unit tests for the persistent bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "persistentBST.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <set>
+#include <vector>
+
+ /***********************************************
+  * TEST PERSISTENT BST
+  * Unit tests for the PersistentBST class
+  ***********************************************/
+class TestPersistentBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_snapshot_noCopy();
+      test_insert_oldVersionUnchanged();
+      test_insert_sharesSubtrees();
+      test_insert_keepUnique();
+      test_insert_sortedStaysBalanced();
+      test_erase_twoChildren();
+      test_erase_missing();
+      test_release_freesOnce();
+      test_iterate_sorted();
+      test_random_matchesMultiset();
+
+      report("PersistentBST");
+   }
+
+   /***************************************
+    * SNAPSHOT
+    ***************************************/
+
+   // taking a snapshot copies no data
+   void test_snapshot_noCopy()
+   {  // setup
+      custom::PersistentBST <Spy> v;
+      v = v.insert(Spy(50)).insert(Spy(30)).insert(Spy(70));
+      Spy::reset();
+      // exercise
+      custom::PersistentBST <Spy> snap = v.snapshot();
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(snap.root == v.root);
+      assertUnit(snap.size() == 3);
+      if (v.root)
+         assertUnit(v.root->refs == 2);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // the old version does not see the new element
+   void test_insert_oldVersionUnchanged()
+   {  // setup
+      custom::PersistentBST <int> v1 = custom::PersistentBST <int>().insert(50).insert(30);
+      // exercise
+      custom::PersistentBST <int> v2 = v1.insert(40);
+      // verify
+      assertUnit(v1.size() == 2);
+      assertUnit(v2.size() == 3);
+      assertUnit(v1.find(40) == nullptr);
+      assertUnit(v2.find(40) != nullptr);
+      assertUnit(v2.find(50) != nullptr);
+   }  // teardown
+
+   // only the path to the change is copied
+   //                 50
+   //          +-------+-------+
+   //         30              70
+   //     +----+----+
+   //    20        40
+   void test_insert_sharesSubtrees()
+   {  // setup
+      custom::PersistentBST <Spy> v1;
+      for (int i : { 50, 30, 70, 20, 40 })
+         v1 = v1.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::PersistentBST <Spy> v2 = v1.insert(Spy(60));
+      // verify
+      assertUnit(Spy::numCopy() == 3);      // copy [50][70] and the new [60]
+      assertUnit(v1.root != v2.root);
+      if (v1.root && v2.root)
+      {
+         assertUnit(v1.root->pLeft == v2.root->pLeft);   // [30] subtree is shared
+         assertUnit(v1.root->pRight != v2.root->pRight);
+         assertUnit(v1.root->pLeft->refs == 2);
+      }
+   }  // teardown
+
+   // no new version when the value is already there
+   void test_insert_keepUnique()
+   {  // setup
+      custom::PersistentBST <int> v1 = custom::PersistentBST <int>().insert(50).insert(30);
+      // exercise
+      custom::PersistentBST <int> v2 = v1.insert(30, true /* keepUnique */);
+      // verify
+      assertUnit(v2.root == v1.root);
+      assertUnit(v2.size() == 2);
+   }  // teardown
+
+   // sorted input does not make a chain, so a version copies only a short path
+   void test_insert_sortedStaysBalanced()
+   {  // setup
+      custom::PersistentBST <Spy> v;
+      for (int i = 0; i < 4096; i++)
+         v = v.insert(Spy(i));
+      int heightBefore = v.root->height;
+      Spy::reset();
+      // exercise
+      custom::PersistentBST <Spy> v2 = v.insert(Spy(4096));
+      int numInsertCopies = Spy::numCopy();
+      Spy::reset();
+      custom::PersistentBST <Spy> v3 = v2.erase(Spy(0));
+      int numEraseCopies = Spy::numCopy();
+      // verify
+      assertUnit(heightBefore <= 17);                   // 1.44 * log2(4096)
+      assertUnit(numInsertCopies <= heightBefore + 3);  // the path, a rotation, the new value
+      assertUnit(numEraseCopies <= heightBefore + 3);
+      assertUnit(isBalanced(v2.root));
+      assertUnit(isBalanced(v3.root));
+      assertUnit(v.size() == 4096 && v2.size() == 4097 && v3.size() == 4096);
+      assertUnit(v3.find(Spy(0)) == nullptr && v2.find(Spy(0)) != nullptr);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase a node with two children in the new version only
+   void test_erase_twoChildren()
+   {  // setup
+      custom::PersistentBST <int> v1;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         v1 = v1.insert(i);
+      // exercise
+      custom::PersistentBST <int> v2 = v1.erase(50);
+      // verify
+      assertUnit(v2.size() == 6);
+      assertUnit(v2.find(50) == nullptr);
+      assertUnit(v1.find(50) != nullptr);
+      assertUnit(v2.root != nullptr);
+      if (v2.root && v1.root)
+      {
+         assertUnit(v2.root->data == 60);
+         assertUnit(v2.root->pLeft == v1.root->pLeft);
+      }
+      int values[6] = {};
+      int num = 0;
+      for (auto it = v2.begin(); it != v2.end() && num < 6; ++it)
+         values[num++] = *it;
+      assertUnit(num == 6);
+      assertUnit(values[0] == 20);
+      assertUnit(values[3] == 60);
+      assertUnit(values[5] == 80);
+   }  // teardown
+
+   // erasing a missing value shares the whole version
+   void test_erase_missing()
+   {  // setup
+      custom::PersistentBST <int> v1 = custom::PersistentBST <int>().insert(50);
+      // exercise
+      custom::PersistentBST <int> v2 = v1.erase(99);
+      // verify
+      assertUnit(v2.root == v1.root);
+      assertUnit(v2.size() == 1);
+   }  // teardown
+
+   /***************************************
+    * RELEASE
+    ***************************************/
+
+   // each node is destroyed once, when its last version goes away
+   void test_release_freesOnce()
+   {  // setup
+      Spy::reset();
+      {
+         custom::PersistentBST <Spy> v1;
+         for (int i : { 50, 30, 70 })
+            v1 = v1.insert(Spy(i));
+         custom::PersistentBST <Spy> v2 = v1.insert(Spy(80));
+         int numDeleteBefore = Spy::numDelete();
+         // exercise
+         v1 = custom::PersistentBST <Spy>();
+         // verify: only [50][70] of v1 were unique to it
+         assertUnit(Spy::numDelete() - numDeleteBefore == 2);
+         assertUnit(v2.size() == 4);
+         assertUnit(v2.find(Spy(30)) != nullptr);
+      }
+      // every allocation has been freed
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * ITERATOR
+    ***************************************/
+
+   // walk a version in order
+   void test_iterate_sorted()
+   {  // setup
+      custom::PersistentBST <int> v;
+      for (int i : { 4, 2, 6, 1, 3, 5, 7, 3 })
+         v = v.insert(i);
+      // exercise
+      int values[8] = {};
+      int num = 0;
+      for (auto it = v.begin(); it != v.end() && num < 8; ++it)
+         values[num++] = *it;
+      // verify
+      assertUnit(num == 8);
+      bool fSorted = true;
+      for (int i = 1; i < num; i++)
+         fSorted = fSorted && values[i - 1] <= values[i];
+      assertUnit(fSorted);
+   }  // teardown
+
+   /***************************************
+    * RANDOM
+    ***************************************/
+
+   // inserts and erases, duplicates included, agree with std::multiset in
+   // every version kept along the way, and each version stays balanced
+   void test_random_matchesMultiset()
+   {  // setup
+      custom::PersistentBST <int> v;
+      std::multiset <int> reference;
+      std::vector<custom::PersistentBST <int> > versions;
+      std::vector<std::multiset <int> > references;
+      unsigned int seed = 1;
+      // exercise
+      for (int i = 0; i < 3000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int key = (int)((seed >> 16) % 200);
+         if (seed & 0x80000000)
+         {
+            v = v.insert(key);
+            reference.insert(key);
+         }
+         else
+         {
+            v = v.erase(key);
+            if (reference.count(key))
+               reference.erase(reference.find(key));
+         }
+         if (i % 500 == 0)
+         {
+            versions.push_back(v);
+            references.push_back(reference);
+         }
+      }
+      versions.push_back(v);
+      references.push_back(reference);
+      // verify
+      int numDifferent = 0;
+      int numUnbalanced = 0;
+      for (size_t i = 0; i < versions.size(); i++)
+      {
+         numUnbalanced += !isBalanced(versions[i].root);
+         numDifferent += versions[i].size() != references[i].size();
+         std::vector<int> values;
+         for (auto it = versions[i].begin(); it != versions[i].end(); ++it)
+            values.push_back(*it);
+         numDifferent += values != std::vector<int>(references[i].begin(), references[i].end());
+      }
+      assertUnit(numDifferent == 0);
+      assertUnit(numUnbalanced == 0);
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // every node knows its height and no two siblings differ by more than one
+   template <class Node>
+   static bool isBalanced(const Node * p)
+   {
+      if (!p)
+         return true;
+      int left = Node::heightOf(p->pLeft);
+      int right = Node::heightOf(p->pRight);
+      return p->height == 1 + (left > right ? left : right) &&
+             left - right <= 1 && right - left <= 1 &&
+             isBalanced(p->pLeft) && isBalanced(p->pRight);
+   }
+};
+
+#endif // DEBUG
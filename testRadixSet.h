@@ -0,0 +1,670 @@
+/***********************************************************************
+ * Header:
+ *    TEST RADIX SET
+ * Summary:
+ *    Unit tests for the adaptive radix tree set. The first sections are
+ *    the BST tests that only use the public interface, run against a
+ *    RadixSet; the rest cover the nodes themselves.
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "radixSet.h"
+#include "bst.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+ /***********************************************
+  * TEST RADIX SET
+  * Unit tests for the RadixSet class
+  ***********************************************/
+class TestRadixSet : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Ported from the BST tests
+      test_construct_default();
+      test_constructCopy_standard();
+      test_constructMove_standard();
+      test_assign_standardToStandard();
+      test_swap_standardToEmpty();
+      test_find_standard();
+      test_find_standardMissing();
+      test_insert_duplicate();
+      test_insert_keepUnique();
+      test_erase_standardMissing();
+      test_erase_standard();
+      test_clear_standard();
+      test_multiset_erase();
+      test_multiset_eraseAll();
+      test_multiset_iterate();
+      test_count_duplicates();
+
+      // Nodes
+      test_node_grows();
+      test_node_shrinks();
+      test_prefix_compressed();
+      test_prefix_split();
+      test_key_signedOrder();
+      test_key_stringPrefixes();
+      test_key_longPrefix();
+      test_random_matchesStdSet();
+      test_random_strings();
+      test_orderedSet_selects();
+
+      report("RadixSet");
+   }
+
+   /***************************************
+    * CONSTRUCTOR, ASSIGN, SWAP
+    ***************************************/
+
+   // default constructor
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::RadixSet <int> set;
+      // verify
+      assertUnit(set.root == nullptr);
+      assertUnit(set.numElements == 0);
+      assertUnit(set.begin() == set.end());
+   }  // teardown
+
+   // copy constructor of the standard fixture
+   void test_constructCopy_standard()
+   {  // setup
+      custom::RadixSet <int> setSrc;
+      setupStandardFixture(setSrc);
+      // exercise
+      custom::RadixSet <int> setDest(setSrc);
+      // verify
+      assertUnit(setSrc.root != setDest.root);
+      assertUnit(isLinked(setDest));
+      assertStandardFixture(setSrc);
+      assertStandardFixture(setDest);
+      setDest.erase(50);
+      assertUnit(setSrc.find(50) != nullptr);
+   }  // teardown
+
+   // move constructor of the standard fixture
+   void test_constructMove_standard()
+   {  // setup
+      custom::RadixSet <int> setSrc;
+      setupStandardFixture(setSrc);
+      custom::RadixSet <int>::RNode * pRoot = setSrc.root;
+      // exercise
+      custom::RadixSet <int> setDest(std::move(setSrc));
+      // verify
+      assertUnit(setDest.root == pRoot);
+      assertUnit(setSrc.root == nullptr);
+      assertUnit(setSrc.empty());
+      assertStandardFixture(setDest);
+   }  // teardown
+
+   // assign the standard fixture over different values
+   void test_assign_standardToStandard()
+   {  // setup
+      custom::RadixSet <int> setSrc;
+      setupStandardFixture(setSrc);
+      custom::RadixSet <int> setDest{ 1, 2, 300000, -4 };
+      // exercise
+      setDest = setSrc;
+      // verify
+      assertStandardFixture(setSrc);
+      assertStandardFixture(setDest);
+      assertUnit(setDest.find(300000) == nullptr);
+   }  // teardown
+
+   // swap: standard.swap(empty)
+   void test_swap_standardToEmpty()
+   {  // setup
+      custom::RadixSet <int> set1;
+      setupStandardFixture(set1);
+      custom::RadixSet <int> set2;
+      // exercise
+      set1.swap(set2);
+      // verify
+      assertUnit(set1.empty());
+      assertUnit(set1.root == nullptr);
+      assertStandardFixture(set2);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // find the smallest and largest values
+   void test_find_standard()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      const int * p20 = set.find(20);
+      const int * p80 = set.find(80);
+      // verify
+      assertUnit(p20 != nullptr && *p20 == 20);
+      assertUnit(p80 != nullptr && *p80 == 80);
+      assertStandardFixture(set);
+   }  // teardown
+
+   // values that are not there, including ones that share every byte but one
+   void test_find_standardMissing()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      const int * p42 = set.find(42);
+      // verify
+      assertUnit(p42 == nullptr);
+      assertUnit(set.find(50 + 256) == nullptr);
+      assertUnit(set.find(-50) == nullptr);
+      assertUnit(custom::RadixSet<int>().find(50) == nullptr);
+      assertStandardFixture(set);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a duplicate adds to the count of the value already there
+   void test_insert_duplicate()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      bool fReturn = set.insert(40);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(set.size() == 8);
+      assertUnit(set.count(40) == 2);
+      assertUnit(inOrder(set) == std::vector<int>({ 20, 30, 40, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // keepUnique turns a duplicate away
+   void test_insert_keepUnique()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      bool fReturn1 = set.insert(40, true /* keepUnique */);
+      bool fReturn2 = set.insert(45, true /* keepUnique */);
+      // verify
+      assertUnit(fReturn1 == false);
+      assertUnit(fReturn2 == true);
+      assertUnit(set.size() == 8);
+      assertUnit(set.count(40) == 1);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase a value that is not there
+   void test_erase_standardMissing()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      bool fReturn = set.erase(42);
+      // verify
+      assertUnit(fReturn == false);
+      assertStandardFixture(set);
+   }  // teardown
+
+   // erase the middle, the smallest and the largest
+   void test_erase_standard()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      bool fReturn1 = set.erase(50);
+      bool fReturn2 = set.erase(20);
+      bool fReturn3 = set.erase(80);
+      // verify
+      assertUnit(fReturn1 && fReturn2 && fReturn3);
+      assertUnit(set.size() == 4);
+      assertUnit(inOrder(set) == std::vector<int>({ 30, 40, 60, 70 }));
+      assertUnit(isLinked(set));
+   }  // teardown
+
+   // clear the standard fixture
+   void test_clear_standard()
+   {  // setup
+      custom::RadixSet <int> set;
+      setupStandardFixture(set);
+      // exercise
+      set.clear();
+      // verify
+      assertUnit(set.root == nullptr);
+      assertUnit(set.empty());
+      assertUnit(set.size() == 0);
+      assertUnit(set.begin() == set.end());
+   }  // teardown
+
+   /***************************************
+    * MULTISET
+    ***************************************/
+
+   // erase takes one copy at a time until the leaf is gone
+   void test_multiset_erase()
+   {  // setup
+      custom::RadixSet <int> set;
+      set.insert(50);
+      set.insert(30);
+      set.insert(30);
+      // exercise
+      bool fReturn1 = set.erase(30);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(set.size() == 2);
+      assertUnit(set.count(30) == 1);
+      assertUnit(set.root->type != custom::RadixSet<int>::LEAF);
+      // exercise
+      bool fReturn2 = set.erase(30);
+      bool fReturn3 = set.erase(30);
+      // verify
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      assertUnit(set.size() == 1);
+      assertUnit(set.count(30) == 0);
+      assertUnit(set.root->type == custom::RadixSet<int>::LEAF);
+   }  // teardown
+
+   // erase all copies at once
+   void test_multiset_eraseAll()
+   {  // setup
+      custom::RadixSet <int> set;
+      for (int i = 0; i < 1000; i++)
+         set.insert(i % 3);
+      // exercise
+      bool fReturn = set.erase(1, true /* eraseAll */);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(set.size() == 667);
+      assertUnit(set.count(0) == 334);
+      assertUnit(set.count(1) == 0);
+      assertUnit(set.count(2) == 333);
+   }  // teardown
+
+   // iteration expands every leaf to the number of copies
+   void test_multiset_iterate()
+   {  // setup
+      custom::RadixSet <int> set;
+      for (int i : { 40, 20, 40, 60, 20, 40 })
+         set.insert(i);
+      // exercise
+      std::vector<int> values = inOrder(set);
+      // verify
+      assertUnit(values == std::vector<int>({ 20, 20, 40, 40, 40, 60 }));
+   }  // teardown
+
+   // count reports every copy
+   void test_count_duplicates()
+   {  // setup
+      custom::RadixSet <int> set;
+      for (int i : { 50, 30, 50, 70, 50, 30 })
+         set.insert(i);
+      // exercise
+      size_t num50 = set.count(50);
+      size_t num30 = set.count(30);
+      size_t num99 = set.count(99);
+      set.erase(50, true /* eraseAll */);
+      // verify
+      assertUnit(num50 == 3);
+      assertUnit(num30 == 2);
+      assertUnit(num99 == 0);
+      assertUnit(set.size() == 3);
+      assertUnit(set.count(50) == 0);
+   }  // teardown
+
+   /***************************************
+    * NODES
+    ***************************************/
+
+   // the root moves up a size on the 5th, 17th and 49th child
+   void test_node_grows()
+   {  // setup
+      custom::RadixSet <uint32_t> set;
+      std::vector<int> types;
+      // exercise
+      for (uint32_t i = 0; i < 256; i++)
+      {
+         set.insert(0xabcd0000 + i * 0x100);
+         types.push_back(set.root->type);
+      }
+      // verify
+      typedef custom::RadixSet<uint32_t> R;
+      assertUnit(types[0] == R::LEAF);
+      assertUnit(types[3] == R::NODE4 && types[4] == R::NODE16);
+      assertUnit(types[15] == R::NODE16 && types[16] == R::NODE48);
+      assertUnit(types[47] == R::NODE48 && types[48] == R::NODE256);
+      R::Inner * pRoot = static_cast<R::Inner *>(set.root);
+      assertUnit(pRoot->numChildren == 256);
+      assertUnit(pRoot->depth == 0 && pRoot->prefixLen == 2);
+      assertUnit(isLinked(set));
+      assertUnit(set.find(0xabcd7700) != nullptr);
+      assertUnit(set.find(0xabcd7701) == nullptr);
+   }  // teardown
+
+   // and back down, a little later than it went up, to a single leaf
+   void test_node_shrinks()
+   {  // setup
+      custom::RadixSet <uint32_t> set;
+      for (uint32_t i = 0; i < 256; i++)
+         set.insert(0xabcd0000 + i * 0x100);
+      std::vector<int> types(256);
+      // exercise
+      for (uint32_t i = 255; i > 0; i--)
+      {
+         set.erase(0xabcd0000 + i * 0x100);
+         types[i] = set.root->type;        // i children left
+      }
+      // verify
+      typedef custom::RadixSet<uint32_t> R;
+      assertUnit(types[41] == R::NODE256 && types[40] == R::NODE48);
+      assertUnit(types[13] == R::NODE48  && types[12] == R::NODE16);
+      assertUnit(types[4]  == R::NODE16  && types[3]  == R::NODE4);
+      assertUnit(types[2]  == R::NODE4   && types[1]  == R::LEAF);
+      assertUnit(set.size() == 1);
+      assertUnit(set.root->pParent == nullptr);
+      assertUnit(*set.begin() == 0xabcd0000);
+   }  // teardown
+
+   // keys sharing three bytes hang off one node holding those bytes
+   void test_prefix_compressed()
+   {  // setup
+      custom::RadixSet <uint32_t> set;
+      // exercise
+      for (uint32_t i : { 0x12345601, 0x12345602, 0x12345603 })
+         set.insert(i);
+      // verify
+      typedef custom::RadixSet<uint32_t> R;
+      assertUnit(set.root->type == R::NODE4);
+      R::Inner * pRoot = static_cast<R::Inner *>(set.root);
+      assertUnit(pRoot->depth == 0 && pRoot->prefixLen == 3);
+      assertUnit(pRoot->prefix[0] == 0x12 && pRoot->prefix[1] == 0x34 && pRoot->prefix[2] == 0x56);
+      assertUnit(pRoot->numChildren == 3);
+   }  // teardown
+
+   // a key that leaves the prefix part way splits it, and erasing it joins it back
+   void test_prefix_split()
+   {  // setup
+      custom::RadixSet <uint32_t> set;
+      for (uint32_t i : { 0x12345601, 0x12345602, 0x12345603 })
+         set.insert(i);
+      typedef custom::RadixSet<uint32_t> R;
+      R::Inner * pOld = static_cast<R::Inner *>(set.root);
+      // exercise
+      set.insert(0x12990000);
+      // verify
+      R::Inner * pRoot = static_cast<R::Inner *>(set.root);
+      assertUnit(pRoot != pOld);
+      assertUnit(pRoot->prefixLen == 1 && pRoot->prefix[0] == 0x12);
+      assertUnit(pOld->pParent == pRoot && pOld->keyByte == 0x34);
+      assertUnit(pOld->depth == 2 && pOld->prefixLen == 1 && pOld->prefix[0] == 0x56);
+      assertUnit(isLinked(set));
+      // exercise
+      set.erase(0x12990000);
+      // verify
+      assertUnit(set.root == pOld);
+      assertUnit(pOld->pParent == nullptr);
+      assertUnit(pOld->depth == 0 && pOld->prefixLen == 3 && pOld->prefix[1] == 0x34);
+      assertUnit(set.find(0x12345602) != nullptr);
+   }  // teardown
+
+   /***************************************
+    * KEYS
+    ***************************************/
+
+   // negative numbers come first, and the byte order agrees with operator<
+   void test_key_signedOrder()
+   {  // setup
+      custom::RadixSet <int> set;
+      // exercise
+      for (int i : { 5, -1, 0, -2147483647 - 1, 2147483647, -256, 255, 256 })
+         set.insert(i);
+      // verify
+      assertUnit(inOrder(set) ==
+                 std::vector<int>({ -2147483647 - 1, -256, -1, 0, 5, 255, 256, 2147483647 }));
+      assertUnit(set.find(-1) != nullptr);
+      assertUnit(set.find(1) == nullptr);
+   }  // teardown
+
+   // a string that ends where others go on is kept in the end slot, first
+   void test_key_stringPrefixes()
+   {  // setup
+      custom::RadixSet <std::string> set;
+      // exercise
+      for (const char * s : { "abc", "ab", "b", "", "abcd", "a", "ab", "abd" })
+         set.insert(s);
+      set.insert(std::string("ab\0", 3));
+      // verify
+      std::vector<std::string> expected = { "", "a", "ab", "ab", std::string("ab\0", 3),
+                                            "abc", "abcd", "abd", "b" };
+      assertUnit(inOrder(set) == expected);
+      assertUnit(set.find("ab") != nullptr);
+      assertUnit(set.count("ab") == 2);
+      assertUnit(set.find("abcde") == nullptr);
+      assertUnit(set.find("aa") == nullptr);
+      assertUnit(isLinked(set));
+      // exercise
+      set.erase("ab", true /* eraseAll */);
+      set.erase("");
+      // verify
+      assertUnit(inOrder(set) == std::vector<std::string>({ "a", std::string("ab\0", 3),
+                                                            "abc", "abcd", "abd", "b" }));
+      assertUnit(isLinked(set));
+   }  // teardown
+
+   // prefixes longer than the node keeps are checked at the leaf
+   void test_key_longPrefix()
+   {  // setup
+      custom::RadixSet <std::string> set;
+      std::string shared = "https://www.example.com/";
+      set.insert(shared + "a");
+      set.insert(shared + "b");
+      // exercise
+      set.insert("https://www.exXmple.com/c");
+      // verify
+      typedef custom::RadixSet<std::string> R;
+      R::Inner * pRoot = static_cast<R::Inner *>(set.root);
+      assertUnit(pRoot->prefixLen == 14);            // "https://www.ex"
+      assertUnit(pRoot->numChildren == 2);
+      assertUnit(set.find(shared + "a") != nullptr);
+      assertUnit(set.find("https://www.example.comXa") == nullptr);   // differs past what is kept
+      assertUnit(set.find("https://www.exXmple.com/c") != nullptr);
+      assertUnit(set.find("https://www.exXmple.com/") == nullptr);
+      assertUnit(inOrder(set) == std::vector<std::string>({ "https://www.exXmple.com/c",
+                                                            shared + "a", shared + "b" }));
+      // exercise
+      set.erase("https://www.exXmple.com/c");
+      // verify
+      pRoot = static_cast<R::Inner *>(set.root);
+      assertUnit(pRoot->prefixLen == shared.size());
+      assertUnit(pRoot->prefix[7] == shared[7]);     // the last byte the node keeps
+      assertUnit(isLinked(set));
+   }  // teardown
+
+   /***************************************
+    * RANDOM
+    ***************************************/
+
+   // random inserts and erases agree with std::multiset throughout
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::RadixSet <int> set;
+      std::multiset<int> reference;
+      unsigned int seed = 4242;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int value = (int)((seed >> 8) % 3000) - 1500;
+         if (seed % 5 == 0)
+            value *= 65537;                   // spread some over the high bytes
+         if (seed & 0x80000000)
+         {
+            set.insert(value);
+            reference.insert(value);
+         }
+         else
+         {
+            auto it = reference.find(value);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += set.erase(value) != fFound;
+         }
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(set.size() == reference.size());
+      assertUnit(isLinked(set));
+      assertUnit(inOrder(set) == std::vector<int>(reference.begin(), reference.end()));
+      custom::RadixSet <int> setCopy(set);
+      assertUnit(inOrder(setCopy) == inOrder(set));
+   }  // teardown
+
+   // the same for short strings over a small alphabet
+   void test_random_strings()
+   {  // setup
+      custom::RadixSet <std::string> set;
+      std::multiset<std::string> reference;
+      unsigned int seed = 31337;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 5000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         std::string s;
+         for (unsigned int n = (seed >> 8) % 12, r = seed >> 12; n > 0; n--, r /= 3)
+            s += (char)('a' + r % 3);
+         if (seed & 0x80000000)
+         {
+            set.insert(s);
+            reference.insert(s);
+         }
+         else
+         {
+            auto it = reference.find(s);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += set.erase(s) != fFound;
+         }
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(set.size() == reference.size());
+      assertUnit(isLinked(set));
+      assertUnit(inOrder(set) == std::vector<std::string>(reference.begin(), reference.end()));
+   }  // teardown
+
+   /***************************************
+    * ORDERED SET
+    ***************************************/
+
+   // integers and strings get a radix tree, anything else a BST
+   void test_orderedSet_selects()
+   {  // setup
+      // exercise
+      custom::OrderedSet <long> set{ 3, 1, 2 };
+      // verify
+      assertUnit((std::is_same<custom::OrderedSet<int>,         custom::RadixSet<int>>::value));
+      assertUnit((std::is_same<custom::OrderedSet<uint8_t>,     custom::RadixSet<uint8_t>>::value));
+      assertUnit((std::is_same<custom::OrderedSet<std::string>, custom::RadixSet<std::string>>::value));
+      assertUnit((std::is_same<custom::OrderedSet<Spy>,         custom::BST<Spy>>::value));
+      assertUnit((std::is_same<custom::OrderedSet<double>,      custom::BST<double>>::value));
+      assertUnit(*set.begin() == 1);
+   }  // teardown
+
+   /****************************************************************
+    * SETUP STANDARD FIXTURE
+    * The BST tests' values: 50 30 70 20 40 60 80. All seven share
+    * their first three bytes, so they hang off one Node16.
+    ****************************************************************/
+   void setupStandardFixture(custom::RadixSet <int> & set)
+   {
+      assertUnit(set.empty());
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         set.insert(i);
+   }
+
+   /****************************************************************
+    * VERIFY STANDARD FIXTURE
+    ****************************************************************/
+   void assertStandardFixtureParameters(const custom::RadixSet <int> & set, int line, const char * function)
+   {
+      assertIndirect(set.numElements == 7);
+      assertIndirect(!set.empty());
+      assertIndirect(set.root != nullptr);
+      assertIndirect(set.root->type == custom::RadixSet<int>::NODE16);
+      assertIndirect(inOrder(set) == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+      assertIndirect(isLinked(set));
+   }
+
+   /****************************************************************
+    * HELPERS
+    ****************************************************************/
+
+   // every value, in the order the iterator gives them
+   template <class T>
+   static std::vector<T> inOrder(const custom::RadixSet <T> & set)
+   {
+      std::vector<T> values;
+      for (auto it = set.begin(); it != set.end(); ++it)
+         values.push_back(*it);
+      return values;
+   }
+
+   // every child points back at its parent under the right byte, every
+   // inner node has at least two entries, and the depths add up
+   template <class T>
+   static bool isLinked(const custom::RadixSet <T> & set)
+   {
+      return isLinked<T>(set.root, nullptr);
+   }
+
+   template <class T>
+   static bool isLinked(const typename custom::RadixSet <T>::RNode * p,
+                        const typename custom::RadixSet <T>::Inner * pParent)
+   {
+      typedef custom::RadixSet <T> R;
+      if (!p)
+         return true;
+      if (p->pParent != pParent)
+         return false;
+      if (pParent && !p->fEnd && R::nextChild(pParent, p->keyByte - 1) != p)
+         return false;
+      if (p->type == R::LEAF)
+         return true;
+      const typename R::Inner * pInner = static_cast<const typename R::Inner *>(p);
+      if (pParent && pInner->depth != pParent->depth + pParent->prefixLen + 1)
+         return false;
+      if (pInner->numChildren + (pInner->pEnd ? 1 : 0) < 2)
+         return false;
+      if (!isLinked<T>(pInner->pEnd, pInner))
+         return false;
+      for (auto pChild = R::nextChild(pInner, -1); pChild; pChild = R::nextChild(pInner, pChild->keyByte))
+         if (!isLinked<T>(pChild, pInner))
+            return false;
+      return true;
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,376 @@
+/***********************************************************************
+ * Header:
+ *    TEST ROARING SET
+ * Summary:
+ *    Unit tests for the compressed integer set
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "roaringSet.h"
+#include "bst.h"
+#include "unitTest.h"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+ /***********************************************
+  * TEST ROARING SET
+  * Unit tests for the RoaringSet class
+  ***********************************************/
+class TestRoaringSet : public UnitTest
+{
+   typedef custom::RoaringSet<uint32_t>::Container Container;
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_arrayInOrder();
+      test_insert_becomesBitmap();
+      test_find_acrossContainers();
+      test_erase_dropsContainer();
+      test_runOptimize_denseRange();
+      test_run_splitAndJoin();
+      test_run_breaksUp();
+      test_union_everyForm();
+      test_intersection_everyForm();
+      test_random_matchesStdSet();
+      test_bytes_denseIds();
+
+      report("RoaringSet");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a few values share one sorted array; a repeat is turned away
+   void test_insert_arrayInOrder()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      // exercise
+      bool fReturn1 = false;
+      for (uint32_t v : { 50, 30, 70, 20, 40, 60, 80 })
+         fReturn1 = set.insert(v);
+      bool fReturn2 = set.insert(40);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(set.size() == 7);
+      assertUnit(set.containers.size() == 1);
+      assertUnit(set.containers[0].kind == Container::ARRAY);
+      assertUnit(inOrder(set) == std::vector<uint32_t>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // past 4096 values an array becomes a bitmap, and comes back on the way down
+   void test_insert_becomesBitmap()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      for (uint32_t i = 0; i < 4096; i++)
+         set.insert(i * 16);
+      Container::Kind kindBefore = set.containers[0].kind;
+      // exercise
+      set.insert(1);
+      // verify
+      assertUnit(kindBefore == Container::ARRAY);
+      assertUnit(set.containers[0].kind == Container::BITMAP);
+      assertUnit(set.containers[0].card == 4097);
+      assertUnit(set.count(1) == 1 && set.count(16) == 1 && set.count(17) == 0);
+      assertUnit(*++set.begin() == 1);
+      // exercise
+      set.erase(16);
+      // verify
+      assertUnit(set.containers[0].kind == Container::ARRAY);
+      assertUnit(set.size() == 4096);
+      assertUnit(set.count(16) == 0 && set.count(32) == 1);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // the high bits pick the container; iteration carries on into the next
+   void test_find_acrossContainers()
+   {  // setup
+      custom::RoaringSet <uint32_t> set{ 0x00010005, 0x00030001, 0x0001ffff, 0xffffffff, 7 };
+      // exercise
+      auto it = set.find(0x0001ffff);
+      // verify
+      assertUnit(set.highs == std::vector<uint32_t>({ 0x0000, 0x0001, 0x0003, 0xffff }));
+      assertUnit(it != set.end() && *it == 0x0001ffff);
+      ++it;
+      assertUnit(it != set.end() && *it == 0x00030001);
+      ++it;
+      assertUnit(*it == 0xffffffff);
+      ++it;
+      assertUnit(it == set.end());
+      assertUnit(set.find(0x00020005) == set.end());
+      assertUnit(set.find(0x00010006) == set.end());
+      assertUnit(set.count(7) == 1);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // a container with nothing left in it goes away
+   void test_erase_dropsContainer()
+   {  // setup
+      custom::RoaringSet <uint32_t> set{ 5, 0x00020005, 0x00020006 };
+      // exercise
+      bool fReturn1 = set.erase(0x00020005);
+      bool fReturn2 = set.erase(0x00020005);
+      bool fReturn3 = set.erase(0x00020006);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(fReturn3 == true);
+      assertUnit(set.size() == 1);
+      assertUnit(set.highs == std::vector<uint32_t>({ 0 }));
+      assertUnit(set.containers.size() == 1);
+      assertUnit(set.erase(0x00090000) == false);
+   }  // teardown
+
+   /***************************************
+    * RUNS
+    ***************************************/
+
+   // a dense range collapses to one run per container
+   void test_runOptimize_denseRange()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      for (uint32_t i = 1000; i < 200000; i++)
+         set.insert(i);
+      size_t bytesBefore = set.bytes();
+      // exercise
+      set.runOptimize();
+      // verify
+      assertUnit(set.containers.size() == 4);
+      bool fAllRuns = true;
+      for (const Container & c : set.containers)
+         fAllRuns = fAllRuns && c.kind == Container::RUN && c.values.size() == 2;
+      assertUnit(fAllRuns);
+      assertUnit(set.bytes() < 1000);
+      assertUnit(bytesBefore > 30000);
+      assertUnit(set.size() == 199000);
+      assertUnit(set.count(999) == 0 && set.count(1000) == 1 && set.count(199999) == 1);
+      assertUnit(set.count(65535) == 1 && set.count(65536) == 1 && set.count(200000) == 0);
+      size_t num = 0;
+      uint32_t expected = 1000;
+      bool fOrdered = true;
+      for (auto it = set.begin(); it != set.end(); ++it, num++)
+         fOrdered = fOrdered && *it == expected++;
+      assertUnit(fOrdered);
+      assertUnit(num == 199000);
+   }  // teardown
+
+   // erasing inside a run splits it, putting the value back joins it again
+   void test_run_splitAndJoin()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      for (uint32_t i = 100; i < 200; i++)
+         set.insert(i);
+      set.runOptimize();
+      Container & c = set.containers[0];
+      // exercise
+      set.erase(150);
+      // verify
+      assertUnit(c.kind == Container::RUN);
+      assertUnit(c.values == std::vector<uint16_t>({ 100, 49, 151, 48 }));
+      // exercise
+      set.erase(100);
+      set.insert(99);
+      set.insert(200);
+      set.insert(150);
+      // verify
+      assertUnit(c.values == std::vector<uint16_t>({ 99, 0, 101, 99 }));
+      assertUnit(set.size() == 101);
+      set.insert(100);
+      assertUnit(c.values == std::vector<uint16_t>({ 99, 101 }));
+      assertUnit(c.card == 102);
+   }  // teardown
+
+   // once the runs cost more than an array would, it turns back into one
+   void test_run_breaksUp()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      for (uint32_t i = 0; i < 1000; i++)
+         set.insert(i);
+      set.runOptimize();
+      // exercise
+      for (uint32_t i = 1; i < 1000; i += 2)
+         set.erase(i);
+      // verify
+      assertUnit(set.containers[0].kind == Container::ARRAY);
+      assertUnit(set.size() == 500);
+      assertUnit(set.count(998) == 1 && set.count(999) == 0);
+   }  // teardown
+
+   /***************************************
+    * SET OPERATIONS
+    ***************************************/
+
+   // arrays, bitmaps and runs on either side, and highs only one side has
+   void test_union_everyForm()
+   {  // setup
+      custom::RoaringSet <uint32_t> lhs;
+      custom::RoaringSet <uint32_t> rhs;
+      std::set<uint32_t> expected;
+      fillEveryForm(lhs, rhs, expected, true /* fUnion */);
+      // exercise
+      custom::RoaringSet <uint32_t> result = lhs | rhs;
+      // verify
+      assertUnit(result.size() == expected.size());
+      assertUnit(inOrder(result) == std::vector<uint32_t>(expected.begin(), expected.end()));
+      assertUnit(lhs.containers[4].kind == Container::RUN);
+      assertUnit(lhs.containers[5].kind == Container::RUN);
+      assertUnit(result.containers[1].kind == Container::BITMAP);   // two arrays over 4096
+      // exercise
+      size_t sizeBefore = lhs.size();
+      lhs |= lhs;
+      // verify
+      assertUnit(lhs.size() == sizeBefore);
+   }  // teardown
+
+   // the same pairs, intersected
+   void test_intersection_everyForm()
+   {  // setup
+      custom::RoaringSet <uint32_t> lhs;
+      custom::RoaringSet <uint32_t> rhs;
+      std::set<uint32_t> expected;
+      fillEveryForm(lhs, rhs, expected, false /* fUnion */);
+      // exercise
+      custom::RoaringSet <uint32_t> result = lhs & rhs;
+      // verify
+      assertUnit(result.size() == expected.size());
+      assertUnit(inOrder(result) == std::vector<uint32_t>(expected.begin(), expected.end()));
+      bool fNoneEmpty = true;
+      for (const Container & c : result.containers)
+         fNoneEmpty = fNoneEmpty && c.card > 0;
+      assertUnit(fNoneEmpty);
+   }  // teardown
+
+   /***************************************
+    * RANDOM
+    ***************************************/
+
+   // 64-bit values, clustered and scattered, agree with std::set throughout
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::RoaringSet <uint64_t> set;
+      std::set<uint64_t> reference;
+      uint64_t seed = 77;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 60000; i++)
+      {
+         seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+         uint64_t value = (seed >> 40) % 20000;                // dense
+         if (seed % 7 == 0)
+            value = seed >> 3;                                  // anywhere at all
+         if (i == 30000)
+            set.runOptimize();
+         if ((seed >> 20) % 3)
+         {
+            numDifferent += set.insert(value) != reference.insert(value).second;
+         }
+         else
+            numDifferent += set.erase(value) != (reference.erase(value) == 1);
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(set.size() == reference.size());
+      std::vector<uint64_t> values;
+      for (auto it = set.begin(); it != set.end(); ++it)
+         values.push_back(*it);
+      assertUnit(values == std::vector<uint64_t>(reference.begin(), reference.end()));
+   }  // teardown
+
+   /***************************************
+    * MEMORY
+    ***************************************/
+
+   // a million consecutive IDs fit in well under a byte each; a BST needs 40
+   void test_bytes_denseIds()
+   {  // setup
+      custom::RoaringSet <uint32_t> set;
+      // exercise
+      for (uint32_t i = 0; i < 1000000; i++)
+         set.insert(5000000 + i * 2);
+      size_t bytesBitmap = set.bytes();
+      set.runOptimize();
+      // verify
+      assertUnit(bytesBitmap < 32 * 8192 + 4096);          // 31 bitmaps, two bits a value
+      assertUnit(set.bytes() == bytesBitmap);              // every other value: no runs
+      assertUnit(sizeof(custom::BST<uint32_t>::BNode) * 1000000 > bytesBitmap * 100);
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // every value, in the order the iterator gives them
+   static std::vector<uint32_t> inOrder(const custom::RoaringSet <uint32_t> & set)
+   {
+      std::vector<uint32_t> values;
+      for (auto it = set.begin(); it != set.end(); ++it)
+         values.push_back(*it);
+      return values;
+   }
+
+   // high 0: array & array      high 1: arrays that union past 4096
+   // high 2: bitmap & bitmap    high 3: array & bitmap
+   // high 4: run & bitmap       high 5: run & array
+   // high 6: only on the left   high 7: only on the right
+   static void fillEveryForm(custom::RoaringSet <uint32_t> & lhs, custom::RoaringSet <uint32_t> & rhs,
+                             std::set<uint32_t> & expected, bool fUnion)
+   {
+      std::set<uint32_t> setLhs;
+      std::set<uint32_t> setRhs;
+      auto add = [](custom::RoaringSet <uint32_t> & set, std::set<uint32_t> & reference, uint32_t v)
+      {
+         set.insert(v);
+         reference.insert(v);
+      };
+      for (uint32_t i = 0; i < 3000; i++)
+      {
+         add(lhs, setLhs, 0x00000 + i * 3);
+         add(rhs, setRhs, 0x00000 + i * 5);
+         add(lhs, setLhs, 0x10000 + i * 2);
+         add(rhs, setRhs, 0x10000 + i * 2 + 1);
+         add(lhs, setLhs, 0x50000 + 20000 + i);
+         add(rhs, setRhs, 0x50000 + i * 11);
+      }
+      for (uint32_t i = 0; i < 30000; i++)
+      {
+         add(lhs, setLhs, 0x20000 + i * 2);
+         add(rhs, setRhs, 0x20000 + i * 2 + (i % 3 == 0 ? 0 : 1));
+         add(rhs, setRhs, 0x30000 + i * 2);
+         add(lhs, setLhs, 0x40000 + 1000 + i);
+         add(rhs, setRhs, 0x40000 + i * 2);
+      }
+      for (uint32_t i = 0; i < 100; i++)
+      {
+         add(lhs, setLhs, 0x30000 + i * 7);
+         add(lhs, setLhs, 0x60000 + i);
+         add(rhs, setRhs, 0x70000 + i);
+      }
+      lhs.runOptimize();        // turns highs 4 and 5 on the left into runs
+
+      expected.clear();
+      for (uint32_t v : setLhs)
+         if (fUnion || setRhs.count(v))
+            expected.insert(v);
+      if (fUnion)
+         expected.insert(setRhs.begin(), setRhs.end());
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,426 @@
+/***********************************************************************
+ * Header:
+ *    TEST SHARDED BST
+ * Summary:
+ *    Unit, stress, and throughput tests for the sharded bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "shardedBST.h"
+#include "unitTest.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+ /***********************************************
+  * TEST SHARDED BST
+  * Unit tests for the ShardedBST class
+  ***********************************************/
+class TestShardedBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      // Hash routing
+      test_hash_insertFindErase();
+      test_hash_iterateInOrder();
+
+      // Range routing
+      test_range_splitsAsItFills();
+      test_range_hotShardSplits();
+      test_range_hotMiddleOfThree();
+      test_range_forEach();
+      test_range_noGlobalLockToRoute();
+      test_clear();
+
+      // Many threads
+      test_insert_disjoint();
+      test_stress_mixed();
+      test_stress_readersDuringSplits();
+      test_throughput();
+
+      report("ShardedBST");
+   }
+
+   /***************************************
+    * HASH ROUTING
+    ***************************************/
+
+   // values land in different shards but behave like one set
+   void test_hash_insertFindErase()
+   {  // setup
+      custom::ShardedBST <int> bst(4);
+      // exercise
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      bool fDuplicate = bst.insert(42);
+      bool fErased = bst.erase(42);
+      bool fMissing = bst.erase(42);
+      // verify
+      assertUnit(fDuplicate == false);
+      assertUnit(fErased == true);
+      assertUnit(fMissing == false);
+      assertUnit(bst.size() == 99);
+      assertUnit(bst.find(41));
+      assertUnit(!bst.find(42));
+      assertUnit(bst.directory().shards.size() == 4);
+      for (auto & pShard : bst.directory().shards)
+         assertUnit(pShard->bst.size() > 10);   // none is left empty
+   }  // teardown
+
+   // the iterator merges the shards back into order
+   void test_hash_iterateInOrder()
+   {  // setup
+      custom::ShardedBST <int> bst(4);
+      for (int i : { 50, 30, 70, 20, 40, 60, 80, 10, 90 })
+         bst.insert(i);
+      int values[9] = {};
+      int num = 0;
+      // exercise
+      for (auto it = bst.begin(); it != bst.end() && num < 9; ++it)
+         values[num++] = *it;
+      // verify
+      assertUnit(num == 9);
+      for (int i = 0; i < 9; i++)
+         assertUnit(values[i] == (i + 1) * 10);
+   }  // teardown
+
+   /***************************************
+    * RANGE ROUTING
+    ***************************************/
+
+   // range routing starts with one shard and splits at the median
+   void test_range_splitsAsItFills()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(64);
+      assertUnit(bst.directory().shards.size() == 1);
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         bst.insert(scramble(i));
+      // verify
+      assertUnit(bst.size() == 1000);
+      assertUnit(bst.directory().shards.size() == 4);
+      assertUnit(bst.directory().splitters.size() == 3);
+      for (size_t i = 0; i < bst.directory().shards.size(); i++)
+      {
+         const auto & shard = bst.directory().shards[i]->bst;
+         assertUnit(shard.size() > 100);
+         if (i > 0)
+            assertUnit(!(*shard.begin() < bst.directory().splitters[i - 1]));
+         if (i < bst.directory().splitters.size())
+            for (auto it = shard.begin(); it != shard.end(); ++it)
+               assertUnit(*it < bst.directory().splitters[i]);
+      }
+   }  // teardown
+
+   // a hot range is split and the coldest neighbours are merged
+   void test_range_hotShardSplits()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(64);
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i * 2);
+      int splitterBefore = bst.directory().splitters[0];
+      // exercise: churn the bottom of the first shard
+      for (int round = 0; round < 50; round++)
+         for (int i = 1; i < 40; i += 2)
+         {
+            bst.insert(i);
+            bst.erase(i);
+         }
+      // verify
+      assertUnit(bst.directory().shards.size() == 4);
+      assertUnit(bst.directory().splitters[0] < splitterBefore);
+      assertUnit(bst.size() == 1000);
+      int num = 0;
+      int prev = -1;
+      bool fOrdered = true;
+      for (auto it = bst.begin(); it != bst.end(); ++it, num++)
+      {
+         fOrdered = fOrdered && prev < *it;
+         prev = *it;
+      }
+      assertUnit(num == 1000);
+      assertUnit(fOrdered);
+   }  // teardown
+
+   // with three shards and the middle one hot, every neighbouring pair
+   // includes it, so there is nothing to merge and nothing changes
+   void test_range_hotMiddleOfThree()
+   {  // setup
+      custom::ShardedBST <int> bst(3, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(64);
+      for (int i = 0; i < 900; i++)
+         bst.insert(scramble(i) & ~1);          // even, so the churn never collides
+      assertUnit(bst.directory().shards.size() == 3);
+      std::vector<int> splittersBefore = bst.directory().splitters;
+      int middle = bst.directory().splitters[0] + 1;
+      // exercise: churn just above the first splitter
+      for (int round = 0; round < 50; round++)
+         for (int i = middle; i < middle + 40; i += 2)
+         {
+            bst.insert(i);
+            bst.erase(i);
+         }
+      // verify
+      assertUnit(bst.directory().shards.size() == 3);
+      assertUnit(bst.directory().splitters == splittersBefore);
+      assertUnit(bst.size() == 900);
+   }  // teardown
+
+   // forEach visits every value in order under the locks
+   void test_range_forEach()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(16);
+      for (int i = 0; i < 200; i++)
+         bst.insert(scramble(i));
+      std::vector<int> values;
+      // exercise
+      bst.forEach([&values](int i) { values.push_back(i); });
+      // verify
+      assertUnit(values.size() == 200);
+      bool fOrdered = true;
+      for (size_t i = 1; i < values.size(); i++)
+         fOrdered = fOrdered && values[i - 1] < values[i];
+      assertUnit(fOrdered);
+   }  // teardown
+
+   // finds and writes route through the published directory, so they
+   // still go through while a rebalance holds its lock
+   void test_range_noGlobalLockToRoute()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(0);
+      for (int i = 0; i < 100; i++)
+         bst.insert(i);
+      bst.rebalance();
+      std::lock_guard<std::mutex> lockRebal(bst.lockRebalance);
+      // exercise
+      bool fFound = false;
+      bool fInserted = false;
+      std::thread([&]()
+      {
+         fFound = bst.find(10);
+         fInserted = bst.insert(1000);
+      }).join();
+      // verify
+      assertUnit(fFound);
+      assertUnit(fInserted);
+      assertUnit(bst.size() == 101);
+      assertUnit(bst.directory().shards.size() == 2);
+   }  // teardown
+
+   // clear empties every shard and range routing starts over
+   void test_clear()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(16);
+      for (int i = 0; i < 200; i++)
+         bst.insert(i);
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(bst.empty());
+      assertUnit(bst.directory().shards.size() == 1);
+      assertUnit(bst.directory().splitters.empty());
+      assertUnit(bst.begin() == bst.end());
+      assertUnit(bst.insert(5));
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // every thread inserts its own range, in both routing modes
+   void test_insert_disjoint()
+   {
+      for (auto routing : { custom::ShardedBST<int>::BY_HASH, custom::ShardedBST<int>::BY_RANGE })
+      {  // setup
+         custom::ShardedBST <int> bst(8, routing);
+         bst.setRebalancePeriod(256);
+         const int numThreads = 4;
+         const int numPer = 5000;
+         std::vector<std::thread> threads;
+         // exercise
+         for (int t = 0; t < numThreads; t++)
+            threads.emplace_back([&bst, t, numPer]()
+            {
+               for (int i = 0; i < numPer; i++)
+                  bst.insert(scramble(i * numThreads + t));
+            });
+         for (auto & thread : threads)
+            thread.join();
+         // verify
+         assertUnit(bst.size() == numThreads * numPer);
+         int numMissing = 0;
+         for (int i = 0; i < numThreads * numPer; i++)
+            numMissing += bst.find(scramble(i)) ? 0 : 1;
+         assertUnit(numMissing == 0);
+      }  // teardown
+   }
+
+   // writers churn a small range while the shards rebalance. Every
+   // successful insert and erase is tallied per key, so afterward
+   // each key must be present exactly when its tally is one.
+   void test_stress_mixed()
+   {  // setup
+      custom::ShardedBST <int> bst(8, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(128);
+      const int numKeys = 256;
+      std::vector<std::atomic<int>> tally(numKeys);
+      for (auto & n : tally)
+         n = 0;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&, t]()
+         {
+            unsigned int seed = 12345 + t;
+            for (int i = 0; i < 20000; i++)
+            {
+               seed = seed * 1103515245 + 12345;
+               int key = (seed >> 8) % numKeys;
+               if (seed & 0x10000)
+               {
+                  if (bst.insert(key))
+                     tally[key]++;
+               }
+               else if (bst.erase(key))
+                  tally[key]--;
+               if (i % 1000 == 0)
+                  bst.find(key);
+            }
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      int numWrong = 0;
+      size_t numPresent = 0;
+      for (int key = 0; key < numKeys; key++)
+      {
+         int n = tally[key];
+         if ((n != 0 && n != 1) || bst.find(key) != (n == 1))
+            numWrong++;
+         numPresent += n;
+      }
+      assertUnit(numWrong == 0);
+      assertUnit(bst.size() == numPresent);
+   }  // teardown
+
+   // the even keys never change while writers churn the odd ones hard
+   // enough to keep splitting and merging shards. A reader must always
+   // see every even key, even when its shard was just split or merged.
+   void test_stress_readersDuringSplits()
+   {  // setup
+      custom::ShardedBST <int> bst(4, custom::ShardedBST<int>::BY_RANGE);
+      bst.setRebalancePeriod(64);
+      const int numKeys = 2048;
+      for (int key = 0; key < numKeys; key += 2)
+         bst.insert(key);
+      std::atomic<bool> fDone(false);
+      std::atomic<int> numMissed(0);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&, t]()
+         {
+            unsigned int seed = 999 + t;
+            while (!fDone)
+            {
+               seed = seed * 1103515245 + 12345;
+               int key = (int)((seed >> 8) % numKeys) & ~1;
+               if (!bst.find(key))
+                  numMissed++;
+            }
+         });
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&, t]()
+         {
+            unsigned int seed = 4321 + t;
+            for (int i = 0; i < 20000; i++)
+            {
+               // hammer one end, then the other, so the hot shard moves
+               seed = seed * 1103515245 + 12345;
+               int base = (i / 2000) % 2 ? numKeys - 256 : 0;
+               int key = (base + (int)((seed >> 8) % 256)) | 1;
+               if (seed & 0x10000)
+                  bst.insert(key);
+               else
+                  bst.erase(key);
+            }
+         });
+      threads[3].join();
+      threads[2].join();
+      fDone = true;
+      threads[1].join();
+      threads[0].join();
+      // verify
+      assertUnit(numMissed == 0);
+      int numEven = 0;
+      bst.forEach([&numEven](int key) { numEven += key % 2 == 0; });
+      assertUnit(numEven == numKeys / 2);
+   }  // teardown
+
+   // report how well a write-heavy mix scales with threads
+   void test_throughput()
+   {
+      const int numKeys = 1 << 16;
+      const int numOps = 200000;
+      for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+      {
+         // setup: half the keys present
+         custom::ShardedBST <int> bst(16);
+         for (int i = 0; i < numKeys; i += 2)
+            bst.insert(scramble(i));
+         std::vector<std::thread> threads;
+         // exercise: 50% find, 25% insert, 25% erase
+         auto start = std::chrono::steady_clock::now();
+         for (int t = 0; t < numThreads; t++)
+            threads.emplace_back([&bst, t, numOps, numThreads, numKeys]()
+            {
+               unsigned int seed = 777 + t;
+               for (int i = 0; i < numOps / numThreads; i++)
+               {
+                  seed = seed * 1103515245 + 12345;
+                  int key = scramble((seed >> 8) % numKeys);
+                  unsigned int mix = seed % 100;
+                  if (mix < 50)
+                     bst.find(key);
+                  else if (mix < 75)
+                     bst.insert(key);
+                  else
+                     bst.erase(key);
+               }
+            });
+         for (auto & thread : threads)
+            thread.join();
+         double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         // verify
+         std::cerr << "\tShardedBST " << numThreads << " thread(s): "
+                   << (numOps / seconds / 1.0e6) << " Mops/s\n";
+         assertUnit(bst.size() <= (size_t)numKeys);
+      }
+   }
+
+   // spread consecutive integers over the key space
+   static int scramble(int i)
+   {
+      return (int)(((unsigned int)i * 2654435761u) >> 1);
+   }
+};
+
+#endif // DEBUG
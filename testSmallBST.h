@@ -0,0 +1,304 @@
+/***********************************************************************
+ * Header:
+ *    TEST SMALL BST
+ * Summary:
+ *    Unit tests for the bst with inline storage
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "smallBST.h"
+#include "unitTest.h"
+#include "spy.h"
+
+#include <set>
+#include <vector>
+
+ /***********************************************
+  * TEST SMALL BST
+  * Unit tests for the SmallBST class
+  ***********************************************/
+class TestSmallBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_staysInline();
+      test_insert_movesToTree();
+      test_insert_duplicates();
+      test_find_linear();
+      test_erase_inline();
+      test_erase_ownData();
+      test_constructCopy_inlineAndTree();
+      test_swap_inlineAndTree();
+      test_clear_destroysInline();
+      test_random_matchesStdSet();
+
+      report("SmallBST");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // up to N values go in the buffer, in order, with no nodes at all
+   void test_insert_staysInline()
+   {  // setup
+      custom::SmallBST <Spy, 8> bst;
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40, 60, 80, 10 })
+         bst.insert(Spy(i));
+      // verify
+      assertUnit(bst.isInline());
+      assertUnit(bst.tree.root == nullptr);
+      assertUnit(bst.numInline == 8);
+      assertUnit(bst.size() == 8);
+      assertUnit(inOrder(bst) == std::vector<int>({ 10, 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // one more builds a balanced tree, moving every value rather than copying
+   void test_insert_movesToTree()
+   {  // setup
+      custom::SmallBST <Spy, 8> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80, 10 })
+         bst.insert(Spy(i));
+      Spy s(90);
+      Spy::reset();
+      // exercise
+      bool fReturn = bst.insert(s);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(Spy::numCopy() == 1);            // only the new value
+      assertUnit(!bst.isInline());
+      assertUnit(bst.numInline == 0);
+      assertUnit(bst.size() == 9);
+      assertUnit(bst.tree.root != nullptr && bst.tree.root->data == Spy(50));
+      assertUnit(depth(bst.tree.root) == 4);
+      assertUnit(inOrder(bst) == std::vector<int>({ 10, 20, 30, 40, 50, 60, 70, 80, 90 }));
+      assertUnit(bst.find(Spy(20)) != nullptr);
+   }  // teardown
+
+   // equal values sit side by side unless keepUnique turns them away
+   void test_insert_duplicates()
+   {  // setup
+      custom::SmallBST <int, 8> bst{ 5, 3, 5 };
+      // exercise
+      bool fReturn1 = bst.insert(5, true /* keepUnique */);
+      bool fReturn2 = bst.insert(3);
+      bool fReturn3 = bst.insert(*bst.begin());
+      // verify
+      assertUnit(fReturn1 == false);
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == true);
+      assertUnit(inOrder(bst) == std::vector<int>({ 3, 3, 3, 5, 5 }));
+      assertUnit(bst.count(3) == 3);
+      assertUnit(bst.count(5) == 2);
+      assertUnit(bst.count(4) == 0);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // a class-type key is compared only until the first value not less than it
+   void test_find_linear()
+   {  // setup
+      custom::SmallBST <Spy> bst;
+      for (int i : { 50, 30, 70, 20, 40, 60, 80 })
+         bst.insert(Spy(i));
+      Spy s40(40);
+      Spy s45(45);
+      Spy::reset();
+      // exercise
+      const Spy * p40 = bst.find(s40);
+      int numLess40 = Spy::numLessthan();
+      const Spy * p45 = bst.find(s45);
+      // verify
+      assertUnit(p40 != nullptr && *p40 == s40);
+      assertUnit(numLess40 == 3);                 // [20][30][40]
+      assertUnit(p45 == nullptr);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase one copy, then all of them, sliding the rest down
+   void test_erase_inline()
+   {  // setup
+      custom::SmallBST <Spy, 8> bst;
+      for (int i : { 20, 40, 40, 40, 60 })
+         bst.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      bool fReturn1 = bst.erase(Spy(40));
+      bool fReturn2 = bst.erase(Spy(40), true /* eraseAll */);
+      bool fReturn3 = bst.erase(Spy(40));
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == true);
+      assertUnit(fReturn3 == false);
+      assertUnit(Spy::numDestructor() == 3 + 3);  // three values, three keys
+      assertUnit(bst.size() == 2);
+      assertUnit(inOrder(bst) == std::vector<int>({ 20, 60 }));
+   }  // teardown
+
+   // eraseAll by a reference into the buffer removes only that value
+   void test_erase_ownData()
+   {  // setup
+      custom::SmallBST <int> bst{ 1, 2, 3, 4 };
+      custom::SmallBST <int> bstDup{ 5, 5, 5, 7, 9 };
+      // exercise
+      bool fReturn = bst.erase(*bst.begin(), true /* eraseAll */);
+      bstDup.erase(*bstDup.begin(), true /* eraseAll */);
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bst.size() == 3);
+      assertUnit(inOrder(bst) == std::vector<int>({ 2, 3, 4 }));
+      assertUnit(inOrder(bstDup) == std::vector<int>({ 7, 9 }));
+   }  // teardown
+
+   /***************************************
+    * COPY and SWAP
+    ***************************************/
+
+   // a copy is independent whichever form the source is in
+   void test_constructCopy_inlineAndTree()
+   {  // setup
+      custom::SmallBST <int, 4> bstSmall{ 3, 1, 2 };
+      custom::SmallBST <int, 4> bstLarge{ 5, 4, 3, 2, 1, 0 };
+      // exercise
+      custom::SmallBST <int, 4> bstSmallCopy(bstSmall);
+      custom::SmallBST <int, 4> bstLargeCopy(bstLarge);
+      custom::SmallBST <int, 4> bstMoved(std::move(bstLarge));
+      bstSmallCopy.insert(9);
+      bstLargeCopy.erase(0);
+      // verify
+      assertUnit(inOrder(bstSmall) == std::vector<int>({ 1, 2, 3 }));
+      assertUnit(inOrder(bstSmallCopy) == std::vector<int>({ 1, 2, 3, 9 }));
+      assertUnit(bstSmallCopy.isInline());
+      assertUnit(inOrder(bstLargeCopy) == std::vector<int>({ 1, 2, 3, 4, 5 }));
+      assertUnit(!bstLargeCopy.isInline());
+      assertUnit(inOrder(bstMoved) == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+      assertUnit(bstLarge.empty());
+   }  // teardown
+
+   // two trees trade pointers; a tree and a buffer trade places
+   void test_swap_inlineAndTree()
+   {  // setup
+      custom::SmallBST <int, 4> bst1{ 1, 2 };
+      custom::SmallBST <int, 4> bst2{ 10, 20, 30, 40, 50 };
+      custom::SmallBST <int, 4> bst3{ 7, 8, 9, 6, 5 };
+      const custom::BST<int>::BNode * pRoot2 = bst2.tree.root;
+      const custom::BST<int>::BNode * pRoot3 = bst3.tree.root;
+      // exercise
+      bst1.swap(bst2);
+      bst2.swap(bst3);
+      // verify
+      assertUnit(bst1.tree.root == pRoot2);
+      assertUnit(bst2.tree.root == pRoot3);
+      assertUnit(bst3.isInline());
+      assertUnit(inOrder(bst1) == std::vector<int>({ 10, 20, 30, 40, 50 }));
+      assertUnit(inOrder(bst2) == std::vector<int>({ 5, 6, 7, 8, 9 }));
+      assertUnit(inOrder(bst3) == std::vector<int>({ 1, 2 }));
+   }  // teardown
+
+   /***************************************
+    * CLEAR
+    ***************************************/
+
+   // clear destroys the inline values
+   void test_clear_destroysInline()
+   {  // setup
+      custom::SmallBST <Spy> bst;
+      for (int i : { 50, 30, 70 })
+         bst.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(Spy::numDestructor() == 3);
+      assertUnit(bst.empty());
+      assertUnit(bst.begin() == bst.end());
+      assertUnit(bst.find(Spy(50)) == nullptr);
+   }  // teardown
+
+   /***************************************
+    * RANDOM
+    ***************************************/
+
+   // inserts and erases agree with std::multiset while the set grows past N
+   // and shrinks back to nothing, over and over
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::SmallBST <int, 8> bst;
+      std::multiset<int> reference;
+      unsigned int seed = 99;
+      int numDifferent = 0;
+      int numWentInline = 0;
+      // exercise
+      for (int i = 0; i < 20000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         int value = (int)((seed >> 8) % 20);
+         bool fWasInline = bst.isInline();
+         bool fGrowing = (i / 2000) % 2 == 0;      // mostly inserts, then mostly erases
+         if ((seed >> 4) % 10 < (fGrowing ? 7u : 1u))
+         {
+            bst.insert(value);
+            reference.insert(value);
+         }
+         else
+         {
+            auto it = reference.find(value);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += bst.erase(value) != fFound;
+         }
+         numWentInline += !fWasInline && bst.isInline();
+         numDifferent += bst.size() != reference.size();
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(numWentInline > 0);
+      assertUnit(inOrder(bst) == std::vector<int>(reference.begin(), reference.end()));
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // every value, in the order the iterator gives them
+   template <class T, size_t N>
+   static std::vector<int> inOrder(const custom::SmallBST <T, N> & bst)
+   {
+      std::vector<int> values;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         values.push_back(valueOf(*it));
+      return values;
+   }
+   static int valueOf(int i)         { return i;       }
+   static int valueOf(const Spy & s) { return s.get(); }
+
+   // levels in the tree below p
+   static int depth(const custom::BST <Spy>::BNode * p)
+   {
+      if (!p)
+         return 0;
+      int depthLeft = depth(p->pLeft);
+      int depthRight = depth(p->pRight);
+      return 1 + (depthLeft > depthRight ? depthLeft : depthRight);
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,344 @@
+/***********************************************************************
+ * Header:
+ *    TEST STRING BST
+ * Summary:
+ *    Unit tests for the prefix-aware string bst
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "stringBST.h"
+#include "unitTest.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+ /***********************************************
+  * TEST STRING BST
+  * Unit tests for the StringBST class
+  ***********************************************/
+class TestStringBST : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_cachesSuffix();
+      test_insert_prefixesInOrder();
+      test_insert_duplicates();
+      test_find_prefixRelations();
+      test_find_embeddedNul();
+      test_erase_twoChildren();
+      test_random_matchesStdSet();
+      test_random_embeddedNul();
+      test_find_urlsRarelyRead();
+      test_constructCopy_independent();
+      test_constructCopy_deepChain();
+
+      report("StringBST");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // a child caches the bytes that follow what it shares with its parent
+   void test_insert_cachesSuffix()
+   {  // setup
+      custom::StringBST bst;
+      // exercise
+      bst.insert("https://example.com/alpha");
+      bst.insert("https://example.com/beta");
+      // verify
+      assertUnit(bst.root != nullptr);
+      assertUnit(bst.root->offset == 0);
+      assertUnit(bst.root->key8 == custom::StringBST::pack("https://", 0));
+      custom::StringBST::SNode * p = bst.root->pRight;
+      assertUnit(p != nullptr);
+      assertUnit(p->offset == 20);
+      assertUnit(p->key8 == custom::StringBST::pack("beta", 0));
+   }  // teardown
+
+   // a prefix sorts before the strings it begins, and the empty string first
+   void test_insert_prefixesInOrder()
+   {  // setup
+      custom::StringBST bst;
+      // exercise
+      for (const char * s : { "abc", "ab", "b", "", "abcd", "a", "ab", "abd" })
+         bst.insert(s);
+      bst.insert(std::string("ab\0", 3));
+      // verify
+      std::vector<std::string> values = inOrder(bst);
+      std::vector<std::string> expected = { "", "a", "ab", "ab", std::string("ab\0", 3),
+                                            "abc", "abcd", "abd", "b" };
+      assertUnit(values == expected);
+      assertUnit(isCached(bst.root, nullptr));
+   }  // teardown
+
+   // equal strings go right unless keepUnique turns them away
+   void test_insert_duplicates()
+   {  // setup
+      custom::StringBST bst{ "path/a", "path/b" };
+      // exercise
+      bool fReturn1 = bst.insert("path/a");
+      bool fReturn2 = bst.insert("path/a", true /* keepUnique */);
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(bst.size() == 3);
+      custom::StringBST::SNode * pSame = bst.root->pRight ? bst.root->pRight->pLeft : nullptr;
+      assertUnit(pSame != nullptr && pSame->data == "path/a");
+      assertUnit(pSame->offset == 5);
+   }  // teardown
+
+   /***************************************
+    * FIND
+    ***************************************/
+
+   // a key that is a prefix of, or extends, a stored key is not that key
+   void test_find_prefixRelations()
+   {  // setup
+      custom::StringBST bst{ "/usr/local/bin", "/usr/local", "/usr/lib", "/var" };
+      // exercise
+      const std::string * pFound = bst.find("/usr/local");
+      // verify
+      assertUnit(pFound != nullptr && *pFound == "/usr/local");
+      assertUnit(bst.find("/usr/loca") == nullptr);
+      assertUnit(bst.find("/usr/local/bin/") == nullptr);
+      assertUnit(bst.find("/usr/lib") != nullptr);
+      assertUnit(bst.find("") == nullptr);
+      assertUnit(bst.find("/var") != nullptr);
+   }  // teardown
+
+   // a zero byte is a byte like any other, not the end of the string
+   void test_find_embeddedNul()
+   {  // setup
+      using namespace std::string_literals;
+      custom::StringBST bst;
+      // exercise
+      for (const std::string & s : { "ab\0x"s, "ab"s, "ab\0"s, "abc"s })
+         bst.insert(s);
+      // verify
+      assertUnit(bst.find("ab"s) != nullptr && *bst.find("ab"s) == "ab"s);
+      assertUnit(bst.find("ab\0"s) != nullptr && bst.find("ab\0"s)->size() == 3);
+      assertUnit(bst.find("ab\0x"s) != nullptr);
+      assertUnit(bst.find("abc"s) != nullptr);
+      assertUnit(bst.find("ab\0\0"s) == nullptr);
+      assertUnit(bst.find("a"s) == nullptr);
+      assertUnit(inOrder(bst) == std::vector<std::string>({ "ab"s, "ab\0"s, "ab\0x"s, "abc"s }));
+      assertUnit(isCached(bst.root, nullptr));
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // every node that gets a new parent gets a fresh offset
+   void test_erase_twoChildren()
+   {  // setup
+      custom::StringBST bst;
+      for (const char * s : { "m", "f", "t", "c", "h", "p", "w", "n", "q" })
+         bst.insert(std::string("shared/prefix/") + s);
+      // exercise
+      bool fReturn = bst.erase("shared/prefix/m");
+      // verify
+      assertUnit(fReturn == true);
+      assertUnit(bst.size() == 8);
+      assertUnit(bst.root->data == "shared/prefix/n");
+      assertUnit(bst.root->offset == 0);
+      assertUnit(isCached(bst.root, nullptr));
+      assertUnit(bst.find("shared/prefix/m") == nullptr);
+      assertUnit(bst.find("shared/prefix/q") != nullptr);
+   }  // teardown
+
+   // random inserts and erases agree with std::multiset throughout
+   void test_random_matchesStdSet()
+   {  // setup
+      custom::StringBST bst;
+      std::multiset<std::string> reference;
+      unsigned int seed = 31337;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 5000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         std::string s = key(seed >> 8);
+         if (seed & 0x80000000)
+         {
+            bst.insert(s);
+            reference.insert(s);
+         }
+         else
+         {
+            auto it = reference.find(s);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += bst.erase(s) != fFound;
+         }
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(bst.size() == reference.size());
+      assertUnit(isCached(bst.root, nullptr));
+      std::vector<std::string> values = inOrder(bst);
+      assertUnit(values == std::vector<std::string>(reference.begin(), reference.end()));
+   }  // teardown
+
+   // the same with zero bytes mixed in, which the padding in key8 must not match
+   void test_random_embeddedNul()
+   {  // setup
+      custom::StringBST bst;
+      std::multiset<std::string> reference;
+      unsigned int seed = 4242;
+      int numDifferent = 0;
+      // exercise
+      for (int i = 0; i < 5000; i++)
+      {
+         seed = seed * 1103515245 + 12345;
+         std::string s = key(seed >> 8, '\0');
+         if (seed & 0x80000000)
+         {
+            bst.insert(s);
+            reference.insert(s);
+         }
+         else
+         {
+            auto it = reference.find(s);
+            bool fFound = it != reference.end();
+            if (fFound)
+               reference.erase(it);
+            numDifferent += bst.erase(s) != fFound;
+         }
+         numDifferent += (bst.find(s) != nullptr) != (reference.count(s) != 0);
+      }
+      // verify
+      assertUnit(numDifferent == 0);
+      assertUnit(bst.size() == reference.size());
+      assertUnit(inOrder(bst) == std::vector<std::string>(reference.begin(), reference.end()));
+   }  // teardown
+
+   // URLs that share most of their length rarely need their strings read.
+   // Every URL shares its first eight bytes with the root, so each search
+   // reads the root's string; after that only a hit reads its own to
+   // confirm. A search through std::string compares at every level.
+   void test_find_urlsRarelyRead()
+   {  // setup
+      custom::StringBST bst;
+      for (unsigned int i = 0; i < 2000; i++)
+         bst.insert(url(i * 2654435761u));
+      bst.numStringReads = 0;
+      // exercise
+      int numFound = 0;
+      for (unsigned int i = 0; i < 2000; i++)
+         numFound += bst.find(url(i * 2654435761u)) ? 1 : 0;
+      size_t numReadsHit = bst.numStringReads;
+      bst.numStringReads = 0;
+      for (unsigned int i = 0; i < 2000; i++)
+         numFound += bst.find(url(i * 2654435761u + 1)) ? 1 : 0;
+      size_t numReadsMiss = bst.numStringReads;
+      // verify
+      assertUnit(numFound == 2000);
+      assertUnit(numReadsHit <= 2000 * 2 + 100);
+      assertUnit(numReadsMiss <= 2000 + 300);
+   }  // teardown
+
+   /***************************************
+    * COPY
+    ***************************************/
+
+   // a copy has its own nodes, cached prefixes and all
+   void test_constructCopy_independent()
+   {  // setup
+      custom::StringBST bstSrc{ "img/1.png", "img/2.png", "css/site.css" };
+      // exercise
+      custom::StringBST bstDest(bstSrc);
+      bstDest.erase("img/1.png");
+      // verify
+      assertUnit(bstSrc.size() == 3);
+      assertUnit(bstDest.size() == 2);
+      assertUnit(bstSrc.find("img/1.png") != nullptr);
+      assertUnit(bstDest.find("img/1.png") == nullptr);
+      assertUnit(isCached(bstDest.root, nullptr));
+   }  // teardown
+
+   // sorted paths make a chain far deeper than the call stack; it copies and clears
+   void test_constructCopy_deepChain()
+   {  // setup
+      const size_t num = 1000000;
+      custom::StringBST bstSrc;
+      custom::StringBST::SNode * pTail = nullptr;
+      for (size_t i = 0; i < num; i++)
+      {
+         std::string s = std::to_string(i);
+         auto pNode = new custom::StringBST::SNode("/p/" + std::string(7 - s.size(), '0') + s);
+         pNode->pParent = pTail;
+         pNode->offset = pTail ? custom::StringBST::commonPrefix(pNode->data, pTail->data) : 0;
+         pNode->key8 = custom::StringBST::pack(pNode->data, pNode->offset);
+         (pTail ? pTail->pRight : bstSrc.root) = pNode;
+         pTail = pNode;
+      }
+      bstSrc.numElements = num;
+      // exercise
+      custom::StringBST bstDest(bstSrc);
+      bstSrc.clear();
+      // verify
+      size_t numWrong = 0;
+      size_t i = 0;
+      for (const custom::StringBST::SNode * p = bstDest.root; p; p = p->pRight, i++)
+         numWrong += p->pLeft || (p->pRight && (p->pRight->pParent != p || !(p->data < p->pRight->data)));
+      assertUnit(i == num);
+      assertUnit(numWrong == 0);
+      assertUnit(bstDest.size() == num);
+      assertUnit(bstDest.find("/p/0123456") != nullptr);
+      assertUnit(bstSrc.root == nullptr);
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // every node's offset and key8 describe its current parent
+   static bool isCached(const custom::StringBST::SNode * p, const custom::StringBST::SNode * pParent)
+   {
+      if (!p)
+         return true;
+      size_t offset = pParent ? custom::StringBST::commonPrefix(p->data, pParent->data) : 0;
+      return p->pParent == pParent && p->offset == offset &&
+             p->key8 == custom::StringBST::pack(p->data, offset) &&
+             isCached(p->pLeft, p) && isCached(p->pRight, p);
+   }
+
+   // every string, in the order the iterator gives them
+   static std::vector<std::string> inOrder(const custom::StringBST & bst)
+   {
+      std::vector<std::string> values;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         values.push_back(*it);
+      return values;
+   }
+
+   // short keys over a small alphabet, so there are plenty of shared prefixes
+   static std::string key(unsigned int seed, char first = 'a')
+   {
+      std::string s;
+      for (unsigned int n = seed % 7; n > 0; n--, seed /= 3)
+         s += (char)(first + seed % 3);
+      return s;
+   }
+
+   // a long shared host and path with a varying tail
+   static std::string url(unsigned int seed)
+   {
+      return "https://www.example.com/catalog/products/item-" + std::to_string(seed);
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,250 @@
+/***********************************************************************
+ * Header:
+ *    TEST TREAP
+ * Summary:
+ *    Unit tests for the treap
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "treap.h"
+#include "unitTest.h"
+#include "spy.h"
+
+ /***********************************************
+  * TEST TREAP
+  * Unit tests for the Treap class
+  ***********************************************/
+class TestTreap : public UnitTest
+{
+
+public:
+   void run()
+   {
+      reset();
+
+      test_insert_heapOrdered();
+      test_insert_seedRepeats();
+      test_insert_depthLogarithmic();
+      test_erase_joinsChildren();
+      test_count_duplicates();
+      test_split_middle();
+      test_join_afterSplit();
+      test_unite_interleaved();
+      test_constructCopy_sameShape();
+
+      report("Treap");
+   }
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // values are in order and no child outranks its parent
+   void test_insert_heapOrdered()
+   {  // setup
+      custom::Treap <Spy> treap(42);
+      // exercise
+      for (int i : { 50, 30, 70, 20, 40, 60, 80, 10, 90 })
+         treap.insert(Spy(i));
+      // verify
+      assertUnit(treap.size() == 9);
+      assertUnit(isTreap(treap.root));
+      int num = 0;
+      for (auto it = treap.begin(); it != treap.end(); ++it)
+         assertUnit(*it == Spy(++num * 10));
+      assertUnit(num == 9);
+      assertUnit(treap.insert(Spy(40), true /* keepUnique */) == false);
+   }  // teardown
+
+   // the same seed and the same inserts give the same shape
+   void test_insert_seedRepeats()
+   {  // setup
+      custom::Treap <int> treap1(7);
+      custom::Treap <int> treap2(7);
+      custom::Treap <int> treap3(8);
+      // exercise
+      for (int i = 0; i < 100; i++)
+      {
+         treap1.insert(i);
+         treap2.insert(i);
+         treap3.insert(i);
+      }
+      // verify
+      assertUnit(sameShape(treap1.root, treap2.root));
+      assertUnit(!sameShape(treap1.root, treap3.root));
+   }  // teardown
+
+   // sorted inserts would make a plain BST a list
+   void test_insert_depthLogarithmic()
+   {  // setup
+      custom::Treap <int> treap(1);
+      // exercise
+      for (int i = 0; i < 10000; i++)
+         treap.insert(i);
+      // verify
+      assertUnit(treap.size() == 10000);
+      assertUnit(isTreap(treap.root));
+      assertUnit(depth(treap.root) < 50);      // about 2 ln n expected
+   }  // teardown
+
+   /***************************************
+    * ERASE
+    ***************************************/
+
+   // erase joins the two subtrees in its place
+   void test_erase_joinsChildren()
+   {  // setup
+      custom::Treap <Spy> treap(3);
+      for (int i = 1; i <= 20; i++)
+         treap.insert(Spy(i));
+      // exercise
+      bool fReturn1 = treap.erase(Spy(treap.root->data));
+      bool fReturn2 = treap.erase(Spy(99));
+      // verify
+      assertUnit(fReturn1 == true);
+      assertUnit(fReturn2 == false);
+      assertUnit(treap.size() == 19);
+      assertUnit(isTreap(treap.root));
+   }  // teardown
+
+   // duplicates can land on either side of each other
+   void test_count_duplicates()
+   {  // setup
+      custom::Treap <int> treap(5);
+      for (int i : { 50, 30, 50, 70, 60, 50, 30 })
+         treap.insert(i);
+      // exercise
+      size_t num50 = treap.count(50);
+      // verify
+      assertUnit(num50 == 3);
+      assertUnit(treap.count(30) == 2);
+      assertUnit(treap.count(99) == 0);
+      assertUnit(isTreap(treap.root));
+   }  // teardown
+
+   /***************************************
+    * SPLIT AND JOIN
+    ***************************************/
+
+   // split moves the upper values into a new treap without copying
+   void test_split_middle()
+   {  // setup
+      custom::Treap <Spy> treap(9);
+      for (int i = 1; i <= 100; i++)
+         treap.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::Treap <Spy> upper = treap.split(Spy(41));
+      // verify
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 1);       // just the probe
+      assertUnit(treap.size() == 40);
+      assertUnit(upper.size() == 60);
+      assertUnit(*upper.begin() == Spy(41));
+      assertUnit(isTreap(treap.root));
+      assertUnit(isTreap(upper.root));
+      assertUnit(treap.find(Spy(41)) == nullptr);
+   }  // teardown
+
+   // joining the halves back gives the original values
+   void test_join_afterSplit()
+   {  // setup
+      custom::Treap <int> treap(11);
+      for (int i = 0; i < 50; i++)
+         treap.insert(i * 2);
+      custom::Treap <int> upper = treap.split(50);
+      // exercise
+      treap.join(std::move(upper));
+      // verify
+      assertUnit(upper.empty());
+      assertUnit(treap.size() == 50);
+      assertUnit(isTreap(treap.root));
+      int num = 0;
+      for (auto it = treap.begin(); it != treap.end(); ++it, num++)
+         assertUnit(*it == num * 2);
+      assertUnit(num == 50);
+   }  // teardown
+
+   // union of two interleaved treaps keeps every value, duplicates too
+   void test_unite_interleaved()
+   {  // setup
+      custom::Treap <int> treapEven(1);
+      custom::Treap <int> treapThree(2);
+      for (int i = 0; i < 60; i += 2)
+         treapEven.insert(i);
+      for (int i = 0; i < 60; i += 3)
+         treapThree.insert(i);
+      // exercise
+      treapEven.unite(std::move(treapThree));
+      // verify
+      assertUnit(treapThree.empty());
+      assertUnit(treapEven.size() == 50);
+      assertUnit(isTreap(treapEven.root));
+      assertUnit(treapEven.count(6) == 2);
+      assertUnit(treapEven.count(9) == 1);
+      assertUnit(treapEven.count(7) == 0);
+   }  // teardown
+
+   /***************************************
+    * COPY
+    ***************************************/
+
+   // a copy has the same priorities and so the same shape
+   void test_constructCopy_sameShape()
+   {  // setup
+      custom::Treap <Spy> treapSrc(13);
+      for (int i : { 50, 30, 70, 20, 40 })
+         treapSrc.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::Treap <Spy> treapDest(treapSrc);
+      // verify
+      assertUnit(Spy::numCopy() == 5);
+      assertUnit(treapDest.size() == 5);
+      assertUnit(treapDest.root != treapSrc.root);
+      assertUnit(sameShape(treapDest.root, treapSrc.root));
+   }  // teardown
+
+   /***************************************
+    * HELPERS
+    ***************************************/
+
+   // in order by value and by priority
+   template <class Node>
+   static bool isTreap(const Node * p)
+   {
+      if (!p)
+         return true;
+      if (p->pLeft && (p->data < p->pLeft->data || p->pLeft->priority > p->priority))
+         return false;
+      if (p->pRight && (p->pRight->data < p->data || p->pRight->priority > p->priority))
+         return false;
+      return isTreap(p->pLeft) && isTreap(p->pRight);
+   }
+
+   // same values with the same priorities in the same places
+   template <class Node>
+   static bool sameShape(const Node * p1, const Node * p2)
+   {
+      if (!p1 || !p2)
+         return p1 == p2;
+      return p1->data == p2->data && p1->priority == p2->priority &&
+             sameShape(p1->pLeft, p2->pLeft) && sameShape(p1->pRight, p2->pRight);
+   }
+
+   static int depth(const custom::Treap<int>::TNode * p)
+   {
+      if (!p)
+         return 0;
+      int left = depth(p->pLeft);
+      int right = depth(p->pRight);
+      return 1 + (left > right ? left : right);
+   }
+};
+
+#endif // DEBUG
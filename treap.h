@@ -0,0 +1,597 @@
+/***********************************************************************
+ * Header:
+ *    TREAP
+ * Summary:
+ *    A binary search tree kept balanced by giving every node a random
+ *    priority: the tree is ordered by value, and each node's priority
+ *    is at least that of its children. Any set of values then has the
+ *    shape of a random BST, so every operation is O(log n) expected.
+ *
+ *    Split and join are the core operations; insert, erase and union
+ *    are all built from them.
+ *
+ *    This will contain the class definition of:
+ *        Treap                  : A class that represents a treap
+ *        Treap::iterator        : An iterator through the treap
+ * Author
+ *    Alexander Dohms, Stephen Costigan
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t
+#include <initializer_list>
+#include <utility>    // for std::move
+#include <vector>     // for the iterator stack
+
+namespace custom
+{
+
+/*****************************************************************
+ * TREAP
+ * Same interface as BST, plus:
+ *    split(t) : everything not less than t moves to a new treap
+ *    join(rhs): append a treap whose values are all not less than ours
+ *    unite(rhs): merge any two treaps, keeping duplicates
+ *
+ * Priorities come from a splitmix64 generator seeded per treap, so
+ * the same seed and the same operations always give the same shape.
+ * Nodes store no colour, height or size. After a split the sizes of
+ * both halves are unknown until size() next counts them.
+ *****************************************************************/
+template <typename T>
+class Treap
+{
+public:
+   class TNode;
+   class iterator;
+
+   //
+   // Construct
+   //
+
+   explicit Treap(uint64_t seed = 0) : root(nullptr), numElements(0), state(seed) {}
+   Treap(const Treap &  rhs) : root(nullptr), numElements(0), state(rhs.state) { *this = rhs; }
+   Treap(      Treap && rhs) : root(rhs.root), numElements(rhs.numElements), state(rhs.state)
+   {
+      rhs.root = nullptr;
+      rhs.numElements = 0;
+   }
+   Treap(const std::initializer_list<T> & il) : root(nullptr), numElements(0), state(0) { *this = il; }
+   ~Treap() { clear(); }
+
+   //
+   // Assign
+   //
+
+   Treap & operator = (const Treap &  rhs);
+   Treap & operator = (      Treap && rhs);
+   Treap & operator = (const std::initializer_list<T> & il);
+   void swap(Treap & rhs);
+
+   //
+   // Iterator
+   //
+
+   iterator begin() const { return iterator(root); }
+   iterator end()   const { return iterator();     }
+
+   //
+   // Access
+   //
+
+   const T * find(const T & t) const;
+   T *       find(const T & t);
+   size_t    count(const T & t) const;
+
+   //
+   // Insert
+   //
+
+   bool insert(const T &  t, bool keepUnique = false);
+   bool insert(      T && t, bool keepUnique = false);
+
+   //
+   // Remove
+   //
+
+   void clear() noexcept;
+   bool erase(const T & t);
+
+   //
+   // Split and join
+   //
+
+   Treap split(const T & t);
+   void  join(Treap && rhs);
+   void  unite(Treap && rhs);
+
+   //
+   // Status
+   //
+
+   bool   empty() const noexcept { return root == nullptr; }
+   size_t size()  const;
+
+#ifdef DEBUG // make this visible to the unit tests
+public:
+#else
+private:
+#endif
+   static const size_t UNKNOWN = ~(size_t)0;
+
+   TNode * root;                 // root node of the treap
+   mutable size_t numElements;   // number of elements, or UNKNOWN after a split
+   uint64_t state;               // priority generator state
+
+private:
+   uint32_t nextPriority();
+   TNode *  findNode(const T & t) const;
+   template <class U>
+   bool     insertValue(U && t, bool keepUnique);
+
+   static void    splitBefore(TNode * p, const T & t, TNode * & pLess, TNode * & pRest);
+   static void    splitAfter (TNode * p, const T & t, TNode * & pUpTo, TNode * & pGreater);
+   static TNode * joinNodes(TNode * pLeft, TNode * pRight);
+   static TNode * uniteNodes(TNode * pA, TNode * pB);
+   static TNode * copy(const TNode * pSrc);
+   static size_t  countNodes(const TNode * p);
+   static void    clear(TNode * & p);
+};
+
+/*****************************************************************
+ * TREAP NODE
+ * A value and its priority
+ *****************************************************************/
+template <typename T>
+class Treap <T> :: TNode
+{
+public:
+   TNode(const T & t, uint32_t priority) : data(t),            pLeft(nullptr), pRight(nullptr), priority(priority) {}
+   TNode(T && t,      uint32_t priority) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), priority(priority) {}
+
+   T data;                  // value stored in the node
+   TNode * pLeft;           // left child - smaller
+   TNode * pRight;          // right child - larger
+   uint32_t priority;       // no child has a higher one
+};
+
+/**********************************************************
+ * TREAP ITERATOR
+ * In-order walk using a stack of pending ancestors
+ *********************************************************/
+template <typename T>
+class Treap <T> :: iterator
+{
+public:
+   iterator() {}
+   explicit iterator(const TNode * pRoot) { pushLeft(pRoot); }
+
+   bool operator == (const iterator & rhs) const { return path == rhs.path; }
+   bool operator != (const iterator & rhs) const { return path != rhs.path; }
+
+   const T & operator * () const { assert(!path.empty()); return path.back()->data; }
+
+   iterator & operator ++ ()
+   {
+      assert(!path.empty());
+      const TNode * p = path.back();
+      path.pop_back();
+      pushLeft(p->pRight);
+      return *this;
+   }
+   iterator operator ++ (int) { iterator it(*this); ++(*this); return it; }
+
+private:
+   void pushLeft(const TNode * p)
+   {
+      for (; p; p = p->pLeft)
+         path.push_back(p);
+   }
+
+   std::vector<const TNode *> path;  // ancestors still to be visited
+};
+
+/*********************************************
+ * TREAP :: ASSIGNMENT OPERATOR
+ * Copy the values and their priorities, so the
+ * copy has the same shape
+ ********************************************/
+template <typename T>
+Treap <T> & Treap <T> :: operator = (const Treap <T> & rhs)
+{
+   if (this == &rhs)
+      return *this;
+
+   clear();
+   root = copy(rhs.root);
+   numElements = rhs.numElements;
+   state = rhs.state;
+   return *this;
+}
+
+/*********************************************
+ * TREAP :: ASSIGN-MOVE OPERATOR
+ * Take the other treap
+ ********************************************/
+template <typename T>
+Treap <T> & Treap <T> :: operator = (Treap <T> && rhs)
+{
+   clear();
+   swap(rhs);
+   return *this;
+}
+
+/*********************************************
+ * TREAP :: ASSIGNMENT OPERATOR with INITIALIZATION LIST
+ ********************************************/
+template <typename T>
+Treap <T> & Treap <T> :: operator = (const std::initializer_list<T> & il)
+{
+   clear();
+   for (const T & t : il)
+      insert(t);
+   return *this;
+}
+
+/*********************************************
+ * TREAP :: SWAP
+ ********************************************/
+template <typename T>
+void Treap <T> :: swap(Treap <T> & rhs)
+{
+   std::swap(root, rhs.root);
+   std::swap(numElements, rhs.numElements);
+   std::swap(state, rhs.state);
+}
+
+/*********************************************
+ * TREAP :: NEXT PRIORITY
+ * splitmix64: cheap, and good enough that
+ * neighbouring seeds give unrelated shapes
+ ********************************************/
+template <typename T>
+uint32_t Treap <T> :: nextPriority()
+{
+   uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+   return (uint32_t)((z ^ (z >> 31)) >> 32);
+}
+
+/****************************************************
+ * TREAP :: FIND NODE
+ * The first node matching t on the way down
+ ****************************************************/
+template <typename T>
+typename Treap <T> :: TNode * Treap <T> :: findNode(const T & t) const
+{
+   TNode * p = root;
+   while (p)
+   {
+      if (t == p->data)
+         return p;
+      p = (t < p->data) ? p->pLeft : p->pRight;
+   }
+   return nullptr;
+}
+
+/****************************************************
+ * TREAP :: FIND
+ * Return a pointer to the value if it exists, nullptr otherwise
+ ****************************************************/
+template <typename T>
+const T * Treap <T> :: find(const T & t) const
+{
+   TNode * p = findNode(t);
+   return p ? &p->data : nullptr;
+}
+
+template <typename T>
+T * Treap <T> :: find(const T & t)
+{
+   TNode * p = findNode(t);
+   return p ? &p->data : nullptr;
+}
+
+/****************************************************
+ * TREAP :: COUNT
+ * Duplicates may sit on either side of the first one
+ * found, so count the run starting at the lower bound
+ ****************************************************/
+template <typename T>
+size_t Treap <T> :: count(const T & t) const
+{
+   std::vector<const TNode *> path;
+   for (const TNode * p = root; p; )
+      if (p->data < t)
+         p = p->pRight;
+      else
+      {
+         path.push_back(p);
+         p = p->pLeft;
+      }
+
+   // path ends at the lower bound; walk in order from there
+   size_t num = 0;
+   while (!path.empty() && path.back()->data == t)
+   {
+      const TNode * p = path.back();
+      path.pop_back();
+      num++;
+      for (p = p->pRight; p; p = p->pLeft)
+         path.push_back(p);
+   }
+   return num;
+}
+
+/*****************************************************
+ * TREAP :: INSERT
+ * Insert a value. With keepUnique, a value already
+ * present is left alone and false is returned.
+ ****************************************************/
+template <typename T>
+bool Treap <T> :: insert(const T & t, bool keepUnique)
+{
+   return insertValue(t, keepUnique);
+}
+
+template <typename T>
+bool Treap <T> :: insert(T && t, bool keepUnique)
+{
+   return insertValue(std::move(t), keepUnique);
+}
+
+/*****************************************************
+ * TREAP :: INSERT VALUE
+ * Walk down while the nodes outrank the new one, then
+ * split what is left around the new value and hang the
+ * two halves from it
+ ****************************************************/
+template <typename T>
+template <class U>
+bool Treap <T> :: insertValue(U && t, bool keepUnique)
+{
+   if (keepUnique && findNode(t))
+      return false;
+
+   TNode * pNew = new TNode(std::forward<U>(t), nextPriority());
+   TNode ** ppLink = &root;
+   while (*ppLink && (*ppLink)->priority > pNew->priority)
+      ppLink = (pNew->data < (*ppLink)->data) ? &(*ppLink)->pLeft : &(*ppLink)->pRight;
+
+   splitAfter(*ppLink, pNew->data, pNew->pLeft, pNew->pRight);
+   *ppLink = pNew;
+   if (numElements != UNKNOWN)
+      numElements++;
+   return true;
+}
+
+/*****************************************************
+ * TREAP :: CLEAR
+ * Removes all the nodes
+ ****************************************************/
+template <typename T>
+void Treap <T> :: clear() noexcept
+{
+   clear(root);
+   numElements = 0;
+}
+
+/*************************************************
+ * TREAP :: ERASE
+ * Remove one copy of t: its two subtrees are
+ * joined and take its place
+ ************************************************/
+template <typename T>
+bool Treap <T> :: erase(const T & t)
+{
+   TNode ** ppLink = &root;
+   while (*ppLink && !(t == (*ppLink)->data))
+      ppLink = (t < (*ppLink)->data) ? &(*ppLink)->pLeft : &(*ppLink)->pRight;
+   if (!*ppLink)
+      return false;
+
+   TNode * pDelete = *ppLink;
+   *ppLink = joinNodes(pDelete->pLeft, pDelete->pRight);
+   delete pDelete;
+   if (numElements != UNKNOWN)
+      numElements--;
+   return true;
+}
+
+/*************************************************
+ * TREAP :: SPLIT
+ * Everything not less than t moves to the returned
+ * treap, which carries on our priority sequence
+ ************************************************/
+template <typename T>
+Treap <T> Treap <T> :: split(const T & t)
+{
+   Treap <T> rhs(state ^ 0x5bd1e995u);
+   splitBefore(root, t, root, rhs.root);
+   numElements = rhs.numElements = UNKNOWN;
+   return rhs;
+}
+
+/*************************************************
+ * TREAP :: JOIN
+ * Append rhs, whose values must all be no less
+ * than ours. rhs is left empty.
+ ************************************************/
+template <typename T>
+void Treap <T> :: join(Treap <T> && rhs)
+{
+   if (numElements != UNKNOWN && rhs.numElements != UNKNOWN)
+      numElements += rhs.numElements;
+   else
+      numElements = UNKNOWN;
+   root = joinNodes(root, rhs.root);
+   rhs.root = nullptr;
+   rhs.numElements = 0;
+}
+
+/*************************************************
+ * TREAP :: UNITE
+ * Merge in rhs, keeping duplicates. Costs
+ * O(m log(n/m)) for treaps of size m <= n.
+ ************************************************/
+template <typename T>
+void Treap <T> :: unite(Treap <T> && rhs)
+{
+   if (numElements != UNKNOWN && rhs.numElements != UNKNOWN)
+      numElements += rhs.numElements;
+   else
+      numElements = UNKNOWN;
+   root = uniteNodes(root, rhs.root);
+   rhs.root = nullptr;
+   rhs.numElements = 0;
+}
+
+/*************************************************
+ * TREAP :: SIZE
+ * Count the nodes if a split left the size unknown
+ ************************************************/
+template <typename T>
+size_t Treap <T> :: size() const
+{
+   if (numElements == UNKNOWN)
+      numElements = countNodes(root);
+   return numElements;
+}
+
+/*************************************************
+ * TREAP :: SPLIT BEFORE
+ * pLess gets the values less than t, pRest the others
+ ************************************************/
+template <typename T>
+void Treap <T> :: splitBefore(TNode * p, const T & t, TNode * & pLess, TNode * & pRest)
+{
+   if (!p)
+   {
+      pLess = pRest = nullptr;
+      return;
+   }
+   if (p->data < t)
+   {
+      splitBefore(p->pRight, t, p->pRight, pRest);
+      pLess = p;
+   }
+   else
+   {
+      splitBefore(p->pLeft, t, pLess, p->pLeft);
+      pRest = p;
+   }
+}
+
+/*************************************************
+ * TREAP :: SPLIT AFTER
+ * pUpTo gets the values not greater than t, pGreater the others
+ ************************************************/
+template <typename T>
+void Treap <T> :: splitAfter(TNode * p, const T & t, TNode * & pUpTo, TNode * & pGreater)
+{
+   if (!p)
+   {
+      pUpTo = pGreater = nullptr;
+      return;
+   }
+   if (t < p->data)
+   {
+      splitAfter(p->pLeft, t, pUpTo, p->pLeft);
+      pGreater = p;
+   }
+   else
+   {
+      splitAfter(p->pRight, t, p->pRight, pGreater);
+      pUpTo = p;
+   }
+}
+
+/*************************************************
+ * TREAP :: JOIN NODES
+ * Every value in pLeft is no greater than any in
+ * pRight; the higher priority root wins at each step
+ ************************************************/
+template <typename T>
+typename Treap <T> :: TNode * Treap <T> :: joinNodes(TNode * pLeft, TNode * pRight)
+{
+   if (!pLeft)
+      return pRight;
+   if (!pRight)
+      return pLeft;
+   if (pLeft->priority > pRight->priority)
+   {
+      pLeft->pRight = joinNodes(pLeft->pRight, pRight);
+      return pLeft;
+   }
+   pRight->pLeft = joinNodes(pLeft, pRight->pLeft);
+   return pRight;
+}
+
+/*************************************************
+ * TREAP :: UNITE NODES
+ * The higher priority root stays on top; the other
+ * treap is split around it and each half united
+ * with the matching side
+ ************************************************/
+template <typename T>
+typename Treap <T> :: TNode * Treap <T> :: uniteNodes(TNode * pA, TNode * pB)
+{
+   if (!pA)
+      return pB;
+   if (!pB)
+      return pA;
+   if (pA->priority < pB->priority)
+      std::swap(pA, pB);
+
+   TNode * pLess;
+   TNode * pRest;
+   splitBefore(pB, pA->data, pLess, pRest);
+   pA->pLeft = uniteNodes(pA->pLeft, pLess);
+   pA->pRight = uniteNodes(pA->pRight, pRest);
+   return pA;
+}
+
+/*************************************************
+ * TREAP :: COPY
+ * Clone a subtree, priorities and all
+ ************************************************/
+template <typename T>
+typename Treap <T> :: TNode * Treap <T> :: copy(const TNode * pSrc)
+{
+   if (!pSrc)
+      return nullptr;
+   TNode * p = new TNode(pSrc->data, pSrc->priority);
+   p->pLeft = copy(pSrc->pLeft);
+   p->pRight = copy(pSrc->pRight);
+   return p;
+}
+
+/*************************************************
+ * TREAP :: COUNT NODES
+ ************************************************/
+template <typename T>
+size_t Treap <T> :: countNodes(const TNode * p)
+{
+   return p ? 1 + countNodes(p->pLeft) + countNodes(p->pRight) : 0;
+}
+
+/*****************************************************
+ * TREAP :: CLEAR
+ * Delete all the nodes below p including p
+ ****************************************************/
+template <typename T>
+void Treap <T> :: clear(TNode * & p)
+{
+   if (!p)
+      return;
+   clear(p->pLeft);
+   clear(p->pRight);
+   delete p;
+   p = nullptr;
+}
+
+} // namespace custom